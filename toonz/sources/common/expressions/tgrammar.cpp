@@ -93,6 +93,187 @@ public:
 	}
 };
 
+//===================================================================
+// CalculatorProgram
+//-------------------------------------------------------------------
+
+void CalculatorProgram::clear()
+{
+	m_instructions.clear();
+	m_depth = m_maxDepth = 0;
+}
+
+//-------------------------------------------------------------------
+
+void CalculatorProgram::add(const Instruction &instr, int depthDelta)
+{
+	m_instructions.push_back(instr);
+	m_depth += depthDelta;
+	m_maxDepth = tmax(m_maxDepth, m_depth);
+}
+
+//-------------------------------------------------------------------
+
+void CalculatorProgram::pushNumber(double value)
+{
+	Instruction instr;
+	instr.m_code = PUSH_NUMBER, instr.m_value = value;
+	add(instr, 1);
+}
+
+//-------------------------------------------------------------------
+
+void CalculatorProgram::pushVariable(int varIdx)
+{
+	Instruction instr;
+	instr.m_code = PUSH_VARIABLE, instr.m_index = varIdx;
+	add(instr, 1);
+}
+
+//-------------------------------------------------------------------
+
+void CalculatorProgram::pushNode(const CalculatorNode *node)
+{
+	Instruction instr;
+	instr.m_code = PUSH_NODE, instr.m_node = node;
+	add(instr, 1);
+}
+
+//-------------------------------------------------------------------
+
+void CalculatorProgram::apply(Function1 f)
+{
+	Instruction instr;
+	instr.m_code = APPLY1, instr.m_f1 = f;
+	add(instr, 0);
+}
+
+//-------------------------------------------------------------------
+
+void CalculatorProgram::apply(Function2 f)
+{
+	Instruction instr;
+	instr.m_code = APPLY2, instr.m_f2 = f;
+	add(instr, -1);
+}
+
+//-------------------------------------------------------------------
+
+void CalculatorProgram::apply(Function3 f)
+{
+	Instruction instr;
+	instr.m_code = APPLY3, instr.m_f3 = f;
+	add(instr, -2);
+}
+
+//-------------------------------------------------------------------
+
+void CalculatorProgram::negate()
+{
+	Instruction instr;
+	instr.m_code = NEGATE;
+	add(instr, 0);
+}
+
+//-------------------------------------------------------------------
+
+void CalculatorProgram::logicalNot()
+{
+	Instruction instr;
+	instr.m_code = NOT;
+	add(instr, 0);
+}
+
+//-------------------------------------------------------------------
+
+int CalculatorProgram::jumpIfZero()
+{
+	Instruction instr;
+	instr.m_code = JUMP_IF_ZERO, instr.m_index = -1;
+	add(instr, -1);
+	return m_instructions.size() - 1;
+}
+
+//-------------------------------------------------------------------
+
+int CalculatorProgram::jump()
+{
+	Instruction instr;
+	instr.m_code = JUMP, instr.m_index = -1;
+	add(instr, -1);
+	return m_instructions.size() - 1;
+}
+
+//-------------------------------------------------------------------
+
+void CalculatorProgram::setJumpTarget(int jumpPos)
+{
+	assert(0 <= jumpPos && jumpPos < (int)m_instructions.size());
+	m_instructions[jumpPos].m_index = m_instructions.size();
+}
+
+//-------------------------------------------------------------------
+
+double CalculatorProgram::run(double vars[3]) const
+{
+	if (m_instructions.empty())
+		return 0;
+
+	// Most expressions fit a small stack
+	double localStack[32];
+	std::vector<double> heapStack;
+
+	double *stack = localStack;
+	if (m_maxDepth > 32) {
+		heapStack.resize(m_maxDepth);
+		stack = &heapStack[0];
+	}
+
+	double *top = stack - 1;
+	const Instruction *begin = &m_instructions[0], *end = begin + m_instructions.size();
+
+	for (const Instruction *instr = begin; instr != end; ++instr) {
+		switch (instr->m_code) {
+		case PUSH_NUMBER:
+			*++top = instr->m_value;
+			break;
+		case PUSH_VARIABLE:
+			*++top = vars[instr->m_index];
+			break;
+		case PUSH_NODE:
+			*++top = instr->m_node->compute(vars);
+			break;
+		case APPLY1:
+			*top = instr->m_f1(*top);
+			break;
+		case APPLY2:
+			--top;
+			*top = instr->m_f2(top[0], top[1]);
+			break;
+		case APPLY3:
+			top -= 2;
+			*top = instr->m_f3(top[0], top[1], top[2]);
+			break;
+		case NEGATE:
+			*top = -*top;
+			break;
+		case NOT:
+			*top = (*top == 0);
+			break;
+		case JUMP_IF_ZERO:
+			if (*top-- == 0)
+				instr = begin + instr->m_index - 1;
+			break;
+		case JUMP:
+			instr = begin + instr->m_index - 1;
+			break;
+		}
+	}
+
+	assert(top == stack);
+	return *top;
+}
+
 //===================================================================
 // Calculator
 //-------------------------------------------------------------------
@@ -116,6 +297,10 @@ void Calculator::setRootNode(CalculatorNode *node)
 	if (node != m_rootNode) {
 		delete m_rootNode;
 		m_rootNode = node;
+
+		m_program.clear();
+		if (m_rootNode)
+			m_rootNode->compile(m_program);
 	}
 }
 
@@ -123,6 +308,31 @@ void Calculator::setRootNode(CalculatorNode *node)
 // Nodes
 //-------------------------------------------------------------------
 
+// Plain functions applying the operators, for compiled programs
+
+template <class Op>
+double apply1(double a)
+{
+	Op op;
+	return op(a);
+}
+
+template <class Op>
+double apply2(double a, double b)
+{
+	Op op;
+	return op(a, b);
+}
+
+template <class Op>
+double apply3(double a, double b, double c)
+{
+	Op op;
+	return op(a, b, c);
+}
+
+//-------------------------------------------------------------------
+
 template <class Op>
 class Op0Node : public CalculatorNode
 {
@@ -155,6 +365,12 @@ public:
 		return op(m_a->compute(vars));
 	}
 
+	void compile(CalculatorProgram &program) const
+	{
+		m_a->compile(program);
+		program.apply(&apply1<Op>);
+	}
+
 	void accept(CalculatorNodeVisitor &visitor) { m_a->accept(visitor); }
 };
 
@@ -176,6 +392,12 @@ public:
 		return op(m_a->compute(vars), m_b->compute(vars));
 	}
 
+	void compile(CalculatorProgram &program) const
+	{
+		m_a->compile(program), m_b->compile(program);
+		program.apply(&apply2<Op>);
+	}
+
 	void accept(CalculatorNodeVisitor &visitor)
 	{
 		m_a->accept(visitor), m_b->accept(visitor);
@@ -200,6 +422,12 @@ public:
 		return op(m_a->compute(vars), m_b->compute(vars), m_c->compute(vars));
 	}
 
+	void compile(CalculatorProgram &program) const
+	{
+		m_a->compile(program), m_b->compile(program), m_c->compile(program);
+		program.apply(&apply3<Op>);
+	}
+
 	void accept(CalculatorNodeVisitor &visitor)
 	{
 		m_a->accept(visitor), m_b->accept(visitor), m_c->accept(visitor);
@@ -216,6 +444,11 @@ public:
 	ChsNode(Calculator *calc, CalculatorNode *a) : CalculatorNode(calc), m_a(a) {}
 
 	double compute(double vars[3]) const { return -m_a->compute(vars); }
+	void compile(CalculatorProgram &program) const
+	{
+		m_a->compile(program);
+		program.negate();
+	}
 	void accept(CalculatorNodeVisitor &visitor) { m_a->accept(visitor); }
 };
 
@@ -234,6 +467,17 @@ public:
 		return (m_a->compute(vars) != 0) ? m_b->compute(vars) : m_c->compute(vars);
 	}
 
+	void compile(CalculatorProgram &program) const
+	{
+		m_a->compile(program);
+		int elseJump = program.jumpIfZero();
+		m_b->compile(program);
+		int endJump = program.jump();
+		program.setJumpTarget(elseJump);
+		m_c->compile(program);
+		program.setJumpTarget(endJump);
+	}
+
 	void accept(CalculatorNodeVisitor &visitor)
 	{
 		m_a->accept(visitor), m_b->accept(visitor), m_c->accept(visitor);
@@ -250,6 +494,11 @@ public:
 	NotNode(Calculator *calc, CalculatorNode *a) : CalculatorNode(calc), m_a(a) {}
 
 	double compute(double vars[3]) const { return m_a->compute(vars) == 0; }
+	void compile(CalculatorProgram &program) const
+	{
+		m_a->compile(program);
+		program.logicalNot();
+	}
 	void accept(CalculatorNodeVisitor &visitor) { m_a->accept(visitor); }
 };
 //-------------------------------------------------------------------
@@ -8,6 +8,13 @@
 #include "trasterimage.h"
 #include "trop.h"
 #include "tpixelutils.h"
+#include "tsystem.h"
+
+#include <QFile>
+#include <QDateTime>
+#include <QSemaphore>
+#include <QThreadPool>
+#include <QRunnable>
 
 /*
   The entire content of this file is ridden with LEAKS. A bug has been filed, will hopefully
@@ -38,6 +45,132 @@ void readKey(FILE *f, struct dictentry *parent, TPSDLayerInfo *li);
 void readLayer16(FILE *f, struct dictentry *parent, TPSDLayerInfo *li);
 //----end forward declarations
 
+//----layers index cache and channels decoding
+
+namespace
+{
+
+//! The parsed header and layers infos of a psd file
+struct LayersIndex {
+	QDateTime m_modTime;
+	TINT64 m_size;
+	TPSDHeaderInfo m_header;
+};
+
+struct LayersIndexCache {
+	QMutex m_mutex;
+	std::map<TFilePath, LayersIndex> m_indexes;
+};
+
+LayersIndexCache &layersIndexCache()
+{
+	static LayersIndexCache theCache;
+	return theCache;
+}
+
+bool getCachedLayersIndex(const TFilePath &path, TPSDHeaderInfo &header)
+{
+	TFileStatus fs(path);
+
+	LayersIndexCache &cache = layersIndexCache();
+	QMutexLocker locker(&cache.m_mutex);
+
+	std::map<TFilePath, LayersIndex>::iterator it = cache.m_indexes.find(path);
+	if (it == cache.m_indexes.end() ||
+		it->second.m_modTime != fs.getLastModificationTime() || it->second.m_size != fs.getSize())
+		return false;
+
+	header = it->second.m_header;
+	return true;
+}
+
+void cacheLayersIndex(const TFilePath &path, const TPSDHeaderInfo &header)
+{
+	TFileStatus fs(path);
+
+	LayersIndexCache &cache = layersIndexCache();
+	QMutexLocker locker(&cache.m_mutex);
+
+	// Replaced headers are not freed, since readers may still refer to their layer infos
+	LayersIndex &index = cache.m_indexes[path];
+	index.m_modTime = fs.getLastModificationTime();
+	index.m_size = fs.getSize();
+	index.m_header = header;
+}
+
+//-----------------------------------------------------------------------------
+
+//! Frees the row positions and unzipped data allocated by readChannel()
+void releaseChannels(TPSDChannelInfo *chan, int channels)
+{
+	for (int ch = 0; ch < channels; ++ch) {
+		free(chan[ch].rowpos);
+		free(chan[ch].unzipdata);
+	}
+}
+
+//-----------------------------------------------------------------------------
+
+//! Rows of a channel to be decoded from the file content mapped in memory
+struct ChannelRows {
+	const unsigned char *m_data;
+	psdByte m_size;
+	TPSDChannelInfo *m_chan;
+	int m_firstRow, m_rowStep, m_rowsCount;
+	psdPixel m_stride;
+	unsigned char *m_out;
+
+	void decode() const
+	{
+		for (int j = 0; j < m_rowsCount; ++j) {
+			int row = m_firstRow + j * m_rowStep;
+			if (row < m_chan->rows)
+				readrow(m_data, m_size, m_chan, row, m_out + j * m_stride);
+		}
+	}
+};
+
+//-----------------------------------------------------------------------------
+
+//! Decodes the rows of a channel on the channels pool.
+/*!
+  The pool is private: decoding a channel must not go through the TThread
+  executors, whose queue is shared with render tasks - the reader waits for the
+  channels while possibly running on a render thread itself, and queued render
+  tasks could stall the decoding tasks behind them.
+*/
+class ChannelDecodeTask : public QRunnable
+{
+	ChannelRows m_rows;
+	QSemaphore *m_done;
+
+public:
+	ChannelDecodeTask(const ChannelRows &rows, QSemaphore *done)
+		: m_rows(rows), m_done(done) {}
+
+	void run()
+	{
+		m_rows.decode();
+		m_done->release();
+	}
+};
+
+//-----------------------------------------------------------------------------
+
+QThreadPool &channelsPool()
+{
+	struct ChannelsPool : public QThreadPool {
+		ChannelsPool() { setMaxThreadCount(TSystem::getProcessorCount()); }
+	};
+
+	static ChannelsPool thePool;
+	return thePool;
+}
+
+} // namespace
+
+//----end layers index cache and channels decoding
+
 char swapByte(unsigned char src)
 {
 	unsigned char out = 0;
@@ -62,12 +195,21 @@ TPSDReader::TPSDReader(const TFilePath &path) : m_shrinkX(1),
 	m_path = path.getParentDir() + TFilePath(name.toStdString());
 	//m_path = path;
 	QMutexLocker sl(&m_mutex);
+
+	// The layers index is parsed once per file version, and shared among the readers
+	// of all its layers
+	if (getCachedLayersIndex(m_path, m_headerInfo))
+		return;
+
 	openFile();
 	if (!doInfo()) {
 		fclose(m_file);
 		throw TImageException(m_path, "Do PSD INFO ERROR");
 	}
+	doLayersDataPos();
 	fclose(m_file);
+
+	cacheLayersIndex(m_path, m_headerInfo);
 }
 TPSDReader::~TPSDReader()
 {
@@ -119,6 +261,23 @@ bool TPSDReader::doInfo()
 	}
 	return true;
 }
+// Compute each layer's channels data position, stored after all the layer records
+void TPSDReader::doLayersDataPos()
+{
+	if (m_headerInfo.layersCount <= 0)
+		return;
+
+	struct TPSDLayerInfo *lilast = &m_headerInfo.linfo[m_headerInfo.layersCount - 1];
+	psdByte pos = lilast->additionalpos + lilast->additionallen;
+	for (int i = 0; i < m_headerInfo.layersCount; i++) {
+		struct TPSDLayerInfo *li = &m_headerInfo.linfo[i];
+		li->startDataPos = pos;
+		li->dataLength = 0;
+		for (int ch = 0; ch < li->channels; ch++)
+			li->dataLength += li->chan[ch].length;
+		pos += li->dataLength;
+	}
+}
 // Read Header Block
 bool TPSDReader::doHeaderInfo()
 {
@@ -329,41 +488,22 @@ void TPSDReader::doImage(TRasterP &rasP, int layerId)
 	int layerIndex = getLayerInfoIndexById(layerId);
 	TPSDLayerInfo *li = getLayerInfo(layerIndex);
 	psdByte imageDataEnd;
-	// retrieve start data pos
-	psdByte startPos = ftell(m_file);
-	if (m_headerInfo.layersCount > 0) {
-		struct TPSDLayerInfo *lilast = &m_headerInfo.linfo[m_headerInfo.layersCount - 1];
-		startPos = lilast->additionalpos + lilast->additionallen;
-	}
-	if (layerIndex > 0) {
-		for (int j = 0; j < layerIndex; j++) {
-			struct TPSDLayerInfo *liprev = &m_headerInfo.linfo[j];
-			for (int ch = 0; ch < liprev->channels; ch++) {
-				startPos += liprev->chan[ch].length;
-			}
-		}
-	}
-	fseek(m_file, startPos, SEEK_SET);
+	// seek the layer's data, or the merged image data after the layers
+	if (li)
+		fseek(m_file, li->startDataPos, SEEK_SET);
+	else
+		fseek(m_file, m_headerInfo.lmistart + m_headerInfo.lmilen, SEEK_SET);
 
 	long pixw = li ? li->right - li->left : m_headerInfo.cols;
 	long pixh = li ? li->bottom - li->top : m_headerInfo.rows;
 	int channels = li ? li->channels : m_headerInfo.channels;
-
-	if (li == NULL)
-		fseek(m_file, m_headerInfo.lmistart + m_headerInfo.lmilen, SEEK_SET);
+	if (channels <= 0)
+		return;
 
 	psdPixel rows = pixh;
 	psdPixel cols = pixw;
 
 	int ch = 0;
-	psdByte **rowpos;
-
-	rowpos = (psdByte **)mymalloc(channels * sizeof(psdByte *));
-
-	for (ch = 0; ch < channels; ++ch) {
-		psdPixel chrows = li && !m_headerInfo.linfoBlockEmpty && li->chan[ch].id == -2 ? li->mask.rows : rows;
-		rowpos[ch] = (psdByte *)mymalloc((chrows + 1) * sizeof(psdByte));
-	}
 
 	int tnzchannels = 0;
 
@@ -399,24 +539,26 @@ void TPSDReader::doImage(TRasterP &rasP, int layerId)
 	}
 
 	if (!li || m_headerInfo.linfoBlockEmpty) { // merged channel
-		TPSDChannelInfo *mergedChans = (TPSDChannelInfo *)mymalloc(channels * sizeof(struct TPSDChannelInfo));
+		std::vector<TPSDChannelInfo> mergedChans(channels); // zero initialized
 
-		readChannel(m_file, NULL, mergedChans, channels, &m_headerInfo);
+		readChannel(m_file, NULL, &mergedChans[0], channels, &m_headerInfo);
 		imageDataEnd = ftell(m_file);
-		readImageData(rasP, NULL, mergedChans, tnzchannels, rows, cols);
-		free(mergedChans);
+		readImageData(rasP, NULL, &mergedChans[0], tnzchannels, rows, cols);
+		releaseChannels(&mergedChans[0], channels);
 	} else {
+		// Channels are read in a copy of the layer's ones, since layer infos are
+		// shared among readers
+		std::vector<TPSDChannelInfo> chans(li->chan, li->chan + channels);
 		for (ch = 0; ch < channels; ++ch) {
-			readChannel(m_file, li, li->chan + ch, 1, &m_headerInfo);
+			chans[ch].rowpos = NULL;
+			chans[ch].unzipdata = NULL;
+			readChannel(m_file, li, &chans[ch], 1, &m_headerInfo);
 		}
 		imageDataEnd = ftell(m_file);
-		readImageData(rasP, li, li->chan, tnzchannels, rows, cols);
+		readImageData(rasP, li, &chans[0], tnzchannels, rows, cols);
+		releaseChannels(&chans[0], channels);
 	}
 	fseek(m_file, imageDataEnd, SEEK_SET);
-
-	for (ch = 0; ch < channels; ++ch)
-		free(rowpos[ch]);
-	free(rowpos);
 }
 
 void TPSDReader::load(TRasterImageP &img, int layerId)
@@ -533,16 +675,12 @@ void TPSDReader::readImageData(TRasterP &rasP, TPSDLayerInfo *li, TPSDChannelInf
 		return;
 	psdPixel j;
 
-	unsigned char *inrows[4], *rledata;
+	unsigned char *inrows[4];
 
 	int ch, map[4];
 
-	rledata = (unsigned char *)mymalloc(chan->rowbytes * 2);
-
-	for (ch = 0; ch < chancount; ++ch) {
-		inrows[ch] = (unsigned char *)mymalloc(chan->rowbytes);
+	for (ch = 0; ch < chancount; ++ch)
 		map[ch] = li && chancount > 1 ? li->chindex[ch] : ch;
-	}
 
 	// find the alpha channel, if needed
 	if (li && (chancount == 2 || chancount == 4)) { // grey+alpha
@@ -656,15 +794,16 @@ void TPSDReader::readImageData(TRasterP &rasP, TPSDLayerInfo *li, TPSDChannelInf
 	int rowOffset = abs(sby1) % m_shrinkY;
 	int rowCount = rowOffset;
 	//if(m_shrinkY==3) rowCount--;
+
+	// decode all the rows to be read beforehand
+	std::vector<std::vector<unsigned char>> chanRows(chancount);
+	for (ch = 0; ch < chancount; ++ch)
+		chanRows[ch].resize(smallRas->getLy() * chan->rowbytes); // zeroed out rows
+	readRows(chan, map, chancount, rowOffset, smallRas->getLy(), chanRows);
+
 	for (j = 0; j < smallRas->getLy(); j++) {
-		for (ch = 0; ch < chancount; ++ch) {
-			/* get row data */
-			if (map[ch] < 0 || map[ch] > chancount) {
-				//warn("bad map[%d]=%d, skipping a channel", i, map[i]);
-				memset(inrows[ch], 0, chan->rowbytes); // zero out the row
-			} else
-				readrow(m_file, chan + map[ch], rowCount, inrows[ch], rledata);
-		}
+		for (ch = 0; ch < chancount; ++ch)
+			inrows[ch] = &chanRows[ch][j * chan->rowbytes];
 		// se la riga corrente non rientra nell'immagine salto la copia
 		if (sby1 - rowCount < 0 || sby1 - rowCount > m_headerInfo.rows - 1) {
 			rowCount += m_shrinkY;
@@ -778,10 +917,66 @@ void TPSDReader::readImageData(TRasterP &rasP, TPSDLayerInfo *li, TPSDChannelInf
 		rowCount += m_shrinkY;
 	}
 	fseek(m_file, savepos, SEEK_SET); // restoring filepos
+}
 
-	free(rledata);
-	for (ch = 0; ch < chancount; ++ch)
-		free(inrows[ch]);
+// Decode the rows of the channels to be read, starting from firstRow and stepping by
+// the vertical shrink. Channels are decoded in parallel from the file mapped in memory,
+// falling back to sequential reads if the file can't be mapped.
+void TPSDReader::readRows(TPSDChannelInfo *chan, int *map, int chancount,
+						  int firstRow, int rowsCount,
+						  std::vector<std::vector<unsigned char>> &chanRows)
+{
+	std::vector<int> chans;
+	for (int ch = 0; ch < chancount; ++ch) {
+		// bad channels maps are left zeroed out
+		if (map[ch] >= 0 && map[ch] <= chancount)
+			chans.push_back(ch);
+	}
+	if (chans.empty() || rowsCount <= 0)
+		return;
+
+	QFile file(QString::fromStdWString(m_path.getWideString()));
+	const unsigned char *data = file.open(QIODevice::ReadOnly) ? file.map(0, file.size()) : NULL;
+
+	if (!data) {
+		std::vector<unsigned char> rledata(chan->rowbytes * 2);
+		for (int c = 0; c < (int)chans.size(); ++c) {
+			int ch = chans[c];
+			for (int j = 0; j < rowsCount; ++j) {
+				int row = firstRow + j * m_shrinkY;
+				if (row < chan[map[ch]].rows)
+					readrow(m_file, chan + map[ch], row, &chanRows[ch][j * chan->rowbytes], &rledata[0]);
+			}
+		}
+		return;
+	}
+
+	std::vector<ChannelRows> rows(chans.size());
+	for (int c = 0; c < (int)chans.size(); ++c) {
+		ChannelRows &r = rows[c];
+		r.m_data = data;
+		r.m_size = file.size();
+		r.m_chan = chan + map[chans[c]];
+		r.m_firstRow = firstRow;
+		r.m_rowStep = m_shrinkY;
+		r.m_rowsCount = rowsCount;
+		r.m_stride = chan->rowbytes;
+		r.m_out = &chanRows[chans[c]][0];
+	}
+
+	if (rows.size() == 1 || TSystem::getProcessorCount() == 1) {
+		for (int c = 0; c < (int)rows.size(); ++c)
+			rows[c].decode();
+		return;
+	}
+
+	// the first channel is decoded here while the others are decoded by the pool
+	QSemaphore done;
+	for (int c = 1; c < (int)rows.size(); ++c)
+		channelsPool().start(new ChannelDecodeTask(rows[c], &done));
+
+	rows[0].decode();
+	done.acquire(rows.size() - 1);
 }
 
 void TPSDReader::doExtraData(TPSDLayerInfo *li, psdByte length)
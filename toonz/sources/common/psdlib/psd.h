@@ -6,6 +6,9 @@
 #include "psdutils.h"
 #include "timage_io.h"
 
+#include <map>
+#include <vector>
+
 #define REF_LAYER_BY_NAME
 using namespace std;
 
@@ -164,6 +167,8 @@ public:
 	TDimension getSize() const { return TDimension(m_lx, m_ly); }
 	TPSDLayerInfo *getLayerInfo(int index);
 	int getLayerInfoIndexById(int layerId);
+	// Channel rows are compressed one by one, so only the rows sampled by the
+	// vertical shrink get decoded
 	void setShrink(int shrink)
 	{
 		m_shrinkX = shrink;
@@ -184,6 +189,7 @@ private:
 	map<int, TRect> m_layersSavebox;
 
 	bool doInfo();
+	void doLayersDataPos();
 	bool doHeaderInfo();
 	bool doColorModeData();
 	bool doImageResources();
@@ -196,6 +202,9 @@ private:
 
 	void readImageData(TRasterP &rasP, TPSDLayerInfo *li, TPSDChannelInfo *chan,
 					   int chancount, psdPixel rows, psdPixel cols);
+	void readRows(TPSDChannelInfo *chan, int *map, int chancount,
+				  int firstRow, int rowsCount,
+				  std::vector<std::vector<unsigned char>> &chanRows);
 	int m_error;
 	TThread::Mutex m_mutex;
 	int openFile();
@@ -52,7 +52,43 @@ void readrow(FILE *psd,
 	}
 }
 
-int unpackrow(unsigned char *out, unsigned char *in,
+void readrow(const unsigned char *psdData, // file content
+			 psdByte psdSize,			 // file size
+			 TPSDChannelInfo *chan,
+			 psdPixel row,			  // row index
+			 unsigned char *inbuffer) // dest buffer for the uncompressed row
+{
+	psdPixel n = 0;
+	psdByte pos, end;
+
+	switch (chan->comptype) {
+	case RAWDATA: /* uncompressed */
+		pos = chan->filepos + chan->rowbytes * row;
+		if (pos >= 0 && pos < psdSize) {
+			n = psdSize - pos < chan->rowbytes ? psdSize - pos : chan->rowbytes;
+			memcpy(inbuffer, psdData + pos, n);
+		}
+		break;
+	case RLECOMP:
+		pos = chan->rowpos[row];
+		end = chan->rowpos[row + 1] < psdSize ? chan->rowpos[row + 1] : psdSize;
+		if (pos >= 0 && pos < end)
+			n = unpackrow(inbuffer, psdData + pos, chan->rowbytes, end - pos);
+		break;
+	case ZIPWITHPREDICTION:
+	case ZIPWITHOUTPREDICTION:
+		if (chan->unzipdata) {
+			memcpy(inbuffer, chan->unzipdata + chan->rowbytes * row, chan->rowbytes);
+			return;
+		}
+		break;
+	}
+
+	if (n < chan->rowbytes)
+		memset(inbuffer + n, 0, chan->rowbytes - n);
+}
+
+int unpackrow(unsigned char *out, const unsigned char *in,
 			  psdPixel outlen, psdPixel inlen)
 {
 	psdPixel i, len;
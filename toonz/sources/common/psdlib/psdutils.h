@@ -30,7 +30,7 @@ struct TPSDChannelInfo {
 	unsigned char *unzipdata; // uncompressed data (ZIP ONLY)
 };
 
-int unpackrow(unsigned char *out, unsigned char *in, psdPixel outlen, psdPixel inlen);
+int unpackrow(unsigned char *out, const unsigned char *in, psdPixel outlen, psdPixel inlen);
 
 void readrow(FILE *psd,
 			 TPSDChannelInfo *chan,
@@ -38,6 +38,13 @@ void readrow(FILE *psd,
 			 unsigned char *inbuffer,
 			 unsigned char *outbuffer);
 
+// same as above, reading from the whole file's content mapped in memory
+void readrow(const unsigned char *psdData,
+			 psdByte psdSize,
+			 TPSDChannelInfo *chan,
+			 psdPixel rowIndex,
+			 unsigned char *inbuffer);
+
 void skipBlock(FILE *f);
 
 void *mymalloc(long n);
@@ -49,7 +49,7 @@ JMETHOD(void, reset_error_mgr, (j_common_ptr cinfo));
 
 using namespace Tiio;
 
-JpgReader::JpgReader() : m_chan(0), m_isOpen(false)
+JpgReader::JpgReader() : m_chan(0), m_isOpen(false), m_decodeShrink(1)
 {
 	memset(&m_cinfo, 0, sizeof m_cinfo);
 	memset(&m_jerr, 0, sizeof m_jerr);
@@ -81,6 +81,10 @@ void JpgReader::open(FILE *file)
 	m_chan = file;
 	jpeg_stdio_src(&m_cinfo, m_chan);
 	bool ret = jpeg_read_header(&m_cinfo, TRUE);
+	if (ret && m_decodeShrink > 1) {
+		m_cinfo.scale_num = 1;
+		m_cinfo.scale_denom = m_decodeShrink;
+	}
 	ret = ret && jpeg_start_decompress(&m_cinfo);
 	if (!ret)
 		return;
@@ -88,8 +92,9 @@ void JpgReader::open(FILE *file)
 	int row_stride = m_cinfo.output_width * m_cinfo.output_components;
 	m_buffer = (*m_cinfo.mem->alloc_sarray)((j_common_ptr)&m_cinfo, JPOOL_IMAGE, row_stride, 1);
 
-	m_info.m_lx = m_cinfo.output_width;
-	m_info.m_ly = m_cinfo.output_height;
+	// The output size is the reduced one, in case of decode shrink
+	m_info.m_lx = m_cinfo.image_width;
+	m_info.m_ly = m_cinfo.image_height;
 	m_info.m_samplePerPixel = 3;
 	m_info.m_valid = true;
 	m_isOpen = true;
@@ -141,6 +146,12 @@ void JpgReader::readLine(char *buffer, int x0, int x1, int shrink)
 	}
 }
 
+int JpgReader::setDecodeShrink(int shrink)
+{
+	m_decodeShrink = (shrink % 8 == 0) ? 8 : (shrink % 4 == 0) ? 4 : (shrink % 2 == 0) ? 2 : 1;
+	return m_decodeShrink;
+}
+
 int JpgReader::skipLines(int lineCount)
 {
 	for (int i = 0; i < lineCount; i++) {
@@ -12,6 +12,10 @@
 #include "tiio.h"
 #include "tfilepath_io.h"
 
+// Qt includes
+#include <QMutex>
+#include <QMutexLocker>
+
 // boost includes
 #include <boost/range.hpp>
 
@@ -43,7 +47,7 @@ bool TImageReader::m_safeMode = false;
 //-----------------------------------------------------------
 
 TImageReader::TImageReader(const TFilePath &path)
-	: TSmartObject(m_classCode), m_path(path), m_reader(0), m_vectorReader(0), m_readGreytones(true), m_file(NULL), m_is64BitEnabled(false), m_shrink(1), m_region(TRect())
+	: TSmartObject(m_classCode), m_path(path), m_reader(0), m_vectorReader(0), m_readGreytones(true), m_file(NULL), m_is64BitEnabled(false), m_shrink(1), m_decodeShrink(1), m_region(TRect())
 {
 }
 
@@ -85,6 +89,7 @@ void TImageReader::close()
 	m_file = NULL;
 	m_reader = 0;
 	m_vectorReader = 0;
+	m_decodeShrink = 1;
 }
 
 //-----------------------------------------------------------
@@ -118,8 +123,12 @@ void TImageReader::open()
 	else {
 		try {
 			m_reader = Tiio::makeReader(type);
-			if (m_reader)
+			if (m_reader) {
+				if (m_shrink > 1 && m_region.isEmpty())
+					m_decodeShrink = m_reader->setDecodeShrink(m_shrink);
+
 				m_reader->open(m_file);
+			}
 			else {
 				m_vectorReader = Tiio::makeVectorReader(type);
 				if (m_vectorReader)
@@ -330,8 +339,42 @@ void readRaster(const TRasterPT<Pix> &ras, Tiio::Reader *reader,
 
 //------------------------------------------------------------------------------------
 
+//! Returns the reduction factor that a reader of the specified file type would
+//! apply while decoding, given the requested shrink and loading region.
+int getDecodeShrink(const string &type, int shrink, const TRect &region)
+{
+	if (shrink <= 1 || !region.isEmpty())
+		return 1;
+
+	// Factors depend on the type and shrink only - so readers are built
+	// just once per pair to retrieve them
+	static std::map<std::pair<string, int>, int> factors;
+	static QMutex mutex;
+
+	QMutexLocker locker(&mutex);
+
+	std::pair<string, int> key(type, shrink);
+	std::map<std::pair<string, int>, int>::iterator ft = factors.find(key);
+	if (ft != factors.end())
+		return ft->second;
+
+	std::auto_ptr<Tiio::Reader> reader(Tiio::makeReader(type));
+	int factor = reader.get() ? reader->setDecodeShrink(shrink) : 1;
+
+	factors.insert(std::make_pair(key, factor));
+	return factor;
+}
+
+//------------------------------------------------------------------------------------
+
 TImageP TImageReader::load0()
 {
+	if (m_reader && m_decodeShrink != getDecodeShrink(toLower(m_path.getType()), m_shrink, m_region)) {
+		// The reader was opened for a different shrink or region - and decode
+		// shrink must be specified before opening
+		close();
+	}
+
 	if (!m_reader && !m_vectorReader)
 		open();
 
@@ -371,11 +414,19 @@ TImageP TImageReader::load0()
 
 		TDimension imageDimension = TDimension((x1 - x0) / m_shrink + 1, (y1 - y0) / m_shrink + 1);
 
+		// Translate the loading rect to the (possibly reduced) image decoded by the reader
+		int f = m_decodeShrink;
+		assert(m_shrink % f == 0);
+
+		int rx0 = x0 / f, ry0 = y0 / f, rx1 = x1 / f, ry1 = y1 / f;
+		int rLx = (info.m_lx + f - 1) / f, rLy = (info.m_ly + f - 1) / f;
+		int rShrink = m_shrink / f;
+
 		if (m_path.getType() == "tzp" || m_path.getType() == "tzu") {
 			// Colormap case
 
 			TRasterCM32P ras(imageDimension);
-			readRaster(ras, m_reader, x0, y0, x1, y1, info.m_lx, info.m_ly, m_shrink);
+			readRaster(ras, m_reader, rx0, ry0, rx1, ry1, rLx, rLy, rShrink);
 
 			// Build the savebox
 			TRect saveBox(info.m_x0, info.m_y0, info.m_x1, info.m_y1);
@@ -420,7 +471,7 @@ TImageP TImageReader::load0()
 				// Should we implement that too?
 
 				TRasterGR8P ras(imageDimension);
-				readRaster_copyLines(ras, m_reader, x0, y0, x1, y1, info.m_lx, info.m_ly, m_shrink);
+				readRaster_copyLines(ras, m_reader, rx0, ry0, rx1, ry1, rLx, rLy, rShrink);
 
 				TRasterImageP ri(ras);
 				ri->setDpi(info.m_dpix, info.m_dpiy);
@@ -439,7 +490,7 @@ TImageP TImageReader::load0()
 					// not a tif file (see below).
 
 					TRaster64P ras(imageDimension);
-					readRaster(ras, m_reader, x0, y0, x1, y1, info.m_lx, info.m_ly, m_shrink);
+					readRaster(ras, m_reader, rx0, ry0, rx1, ry1, rLx, rLy, rShrink);
 
 					_ras = ras;
 				} else {
@@ -448,14 +499,14 @@ TImageP TImageReader::load0()
 					// 64-bit raster is required in this case.
 
 					TRaster32P ras(imageDimension);
-					readRaster(ras, m_reader, x0, y0, x1, y1, info.m_lx, info.m_ly, m_shrink);
+					readRaster(ras, m_reader, rx0, ry0, rx1, ry1, rLx, rLy, rShrink);
 
 					_ras = ras;
 				}
 			} else if (info.m_bitsPerSample == 8) {
 				//  Standard 32-bit case
 				TRaster32P ras(imageDimension);
-				readRaster(ras, m_reader, x0, y0, x1, y1, info.m_lx, info.m_ly, m_shrink);
+				readRaster(ras, m_reader, rx0, ry0, rx1, ry1, rLx, rLy, rShrink);
 
 				_ras = ras;
 			} else
@@ -477,7 +528,7 @@ TImageP TImageReader::load0()
 			//  Previously dubbed as 'Palette cases'. No clue about what is this... :|
 
 			TRaster32P ras(imageDimension);
-			readRaster(ras, m_reader, x0, y0, x1, y1, info.m_lx, info.m_ly, m_shrink);
+			readRaster(ras, m_reader, rx0, ry0, rx1, ry1, rLx, rLy, rShrink);
 
 			TRasterImageP ri(ras);
 			ri->setDpi(info.m_dpix, info.m_dpiy);
@@ -487,7 +538,7 @@ TImageP TImageReader::load0()
 			//  Black-and-White case, I guess. Standard greymaps were considered above...
 
 			TRasterGR8P ras(imageDimension);
-			readRaster_copyLines(ras, m_reader, x0, y0, x1, y1, info.m_lx, info.m_ly, m_shrink);
+			readRaster_copyLines(ras, m_reader, rx0, ry0, rx1, ry1, rLx, rLy, rShrink);
 
 			TRasterImageP ri(ras);
 			ri->setDpi(info.m_dpix, info.m_dpiy);
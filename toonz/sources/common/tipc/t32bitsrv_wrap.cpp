@@ -1,6 +1,10 @@
 
 
 #include <QDebug>
+#include <QThread>
+
+// STD includes
+#include <deque>
 
 #include "t32bitsrv_wrap.h"
 
@@ -81,3 +85,216 @@ int t32bitsrv::RasterExchanger<PIXEL>::write(char *dstBuf, int len)
 template class DVAPI t32bitsrv::RasterExchanger<TPixel32>;
 
 //================================================================================
+
+//================================================================================
+
+/*!
+  The thread owning the persistent connection used to post requests - since
+  sockets cannot be shared among the threads saving frames.
+*/
+class t32bitsrv::FrameSlots::Pipe : public QThread
+{
+public:
+	FrameSlots *m_slots;
+
+	QMutex m_mutex;
+	QWaitCondition m_cond;
+	std::deque<std::pair<QByteArray, int>> m_queue; //!< Requests to be sent, and their slots
+	int m_pending;									  //!< Posted requests not replied yet
+	bool m_failed, m_stop;
+
+public:
+	Pipe(FrameSlots *frameSlots) : m_slots(frameSlots), m_pending(0), m_failed(false), m_stop(false) {}
+
+	void run();
+
+private:
+	void complete(int slot, bool ok);
+};
+
+//--------------------------------------------------------------------------------
+
+void t32bitsrv::FrameSlots::Pipe::run()
+{
+	QLocalSocket socket;
+	bool connected = tipc::startSlaveConnection(&socket, srvName(), -1, srvCmdline());
+
+	tipc::Stream stream(&socket);
+	std::deque<int> inFlight;
+
+	while (true) {
+		std::deque<std::pair<QByteArray, int>> queue;
+		{
+			QMutexLocker locker(&m_mutex);
+			while (m_queue.empty() && inFlight.empty() && !m_stop)
+				m_cond.wait(&m_mutex);
+
+			if (m_queue.empty() && inFlight.empty())
+				return;
+
+			queue.swap(m_queue);
+		}
+
+		// Send all queued requests before waiting for the oldest reply - the server
+		// processes the requests of a connection in order
+		for (int i = 0; i < (int)queue.size(); ++i) {
+			if (!connected) {
+				complete(queue[i].second, false);
+				continue;
+			}
+
+			tipc::Message msg;
+			msg.ba() = queue[i].first;
+			stream << msg;
+
+			inFlight.push_back(queue[i].second);
+		}
+
+		if (!inFlight.empty()) {
+			tipc::Message msg;
+			bool ok = (tipc::readMessage(stream, msg) == "ok");
+
+			complete(inFlight.front(), ok);
+			inFlight.pop_front();
+		}
+	}
+}
+
+//--------------------------------------------------------------------------------
+
+void t32bitsrv::FrameSlots::Pipe::complete(int slot, bool ok)
+{
+	m_slots->release(slot);
+
+	QMutexLocker locker(&m_mutex);
+	m_failed = m_failed || !ok;
+	--m_pending;
+	m_cond.wakeAll();
+}
+
+//================================================================================
+
+t32bitsrv::FrameSlots::FrameSlots(int slotSize, int slotsCount)
+	: m_pipe(0), m_shmem(tipc::uniqueId()), m_slotSize(slotSize), m_slotsCount(slotsCount)
+{
+	if (tipc::create(m_shmem, slotSize * slotsCount, true) <= 0)
+		return;
+
+	for (int s = slotsCount - 1; s >= 0; --s)
+		m_freeSlots.push_back(s);
+}
+
+//--------------------------------------------------------------------------------
+
+t32bitsrv::FrameSlots::~FrameSlots()
+{
+	if (m_pipe) {
+		{
+			QMutexLocker locker(&m_pipe->m_mutex);
+			m_pipe->m_stop = true;
+			m_pipe->m_cond.wakeAll();
+		}
+
+		m_pipe->wait();
+		delete m_pipe;
+	}
+}
+
+//--------------------------------------------------------------------------------
+
+int t32bitsrv::FrameSlots::acquire()
+{
+	QMutexLocker locker(&m_mutex);
+	while (m_freeSlots.empty())
+		m_slotReleased.wait(&m_mutex);
+
+	int slot = m_freeSlots.back();
+	m_freeSlots.pop_back();
+
+	return slot;
+}
+
+//--------------------------------------------------------------------------------
+
+void t32bitsrv::FrameSlots::release(int slot)
+{
+	QMutexLocker locker(&m_mutex);
+	m_freeSlots.push_back(slot);
+	m_slotReleased.wakeOne();
+}
+
+//--------------------------------------------------------------------------------
+
+void t32bitsrv::FrameSlots::write(int slot, const TRasterP &ras)
+{
+	assert(ras->getPixelSize() == 4 && ras->getLx() * ras->getLy() * 4 <= m_slotSize);
+
+	UCHAR *dst = (UCHAR *)m_shmem.data() + offset(slot);
+	int rowSize = ras->getLx() * 4;
+
+	ras->lock();
+	if (ras->getWrap() == ras->getLx())
+		memcpy(dst, ras->getRawData(), rowSize * ras->getLy());
+	else {
+		for (int y = 0; y < ras->getLy(); ++y, dst += rowSize)
+			memcpy(dst, ras->getRawData(0, y), rowSize);
+	}
+	ras->unlock();
+}
+
+//--------------------------------------------------------------------------------
+
+void t32bitsrv::FrameSlots::read(int slot, const TRasterP &ras) const
+{
+	assert(ras->getPixelSize() == 4 && ras->getLx() * ras->getLy() * 4 <= m_slotSize);
+
+	const UCHAR *src = (const UCHAR *)m_shmem.constData() + offset(slot);
+	int rowSize = ras->getLx() * 4;
+
+	ras->lock();
+	if (ras->getWrap() == ras->getLx())
+		memcpy(ras->getRawData(), src, rowSize * ras->getLy());
+	else {
+		for (int y = 0; y < ras->getLy(); ++y, src += rowSize)
+			memcpy(ras->getRawData(0, y), src, rowSize);
+	}
+	ras->unlock();
+}
+
+//--------------------------------------------------------------------------------
+
+void t32bitsrv::FrameSlots::post(tipc::Message &msg, int slot)
+{
+	{
+		QMutexLocker locker(&m_mutex);
+		if (!m_pipe) {
+			m_pipe = new Pipe(this);
+			m_pipe->start();
+		}
+	}
+
+	QMutexLocker locker(&m_pipe->m_mutex);
+	m_pipe->m_queue.push_back(std::make_pair(msg.ba(), slot));
+	++m_pipe->m_pending;
+	m_pipe->m_cond.wakeAll();
+}
+
+//--------------------------------------------------------------------------------
+
+bool t32bitsrv::FrameSlots::flush()
+{
+	{
+		QMutexLocker locker(&m_mutex);
+		if (!m_pipe)
+			return true;
+	}
+
+	QMutexLocker locker(&m_pipe->m_mutex);
+	while (m_pipe->m_pending > 0)
+		m_pipe->m_cond.wait(&m_pipe->m_mutex);
+
+	bool ok = !m_pipe->m_failed;
+	m_pipe->m_failed = false;
+
+	return ok;
+}
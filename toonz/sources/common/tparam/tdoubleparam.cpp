@@ -139,14 +139,14 @@ void truncateSpeeds(double aFrame, double bFrame, TPointD &aSpeedTrunc, TPointD
 
 //---------------------------------------------------------
 
-inline double getSpeedInOutValue(
+//! Speeds must have been truncated already - see truncateSpeeds()
+inline double getTruncatedSpeedInOutValue(
 	const TActualDoubleKeyframe &k0,
 	const TActualDoubleKeyframe &k1,
-	const TPointD &speed0,
-	const TPointD &speed1,
+	const TPointD &aSpeedTrunc,
+	const TPointD &bSpeedTrunc,
 	double frame)
 {
-
 	double aFrame = k0.m_frame;
 	double bFrame = k1.m_frame;
 
@@ -158,10 +158,6 @@ inline double getSpeedInOutValue(
 	else if (frame >= bFrame)
 		return bValue;
 
-	TPointD aSpeedTrunc = speed0;
-	TPointD bSpeedTrunc = speed1;
-	truncateSpeeds(aFrame, bFrame, aSpeedTrunc, bSpeedTrunc);
-
 	return getCubicBezierY(frame,
 						   TPointD(aFrame, aValue),
 						   aSpeedTrunc,
@@ -171,6 +167,25 @@ inline double getSpeedInOutValue(
 
 //---------------------------------------------------------
 
+inline double getSpeedInOutValue(
+	const TActualDoubleKeyframe &k0,
+	const TActualDoubleKeyframe &k1,
+	const TPointD &speed0,
+	const TPointD &speed1,
+	double frame)
+{
+	if (frame <= k0.m_frame || frame >= k1.m_frame)
+		return getTruncatedSpeedInOutValue(k0, k1, speed0, speed1, frame);
+
+	TPointD aSpeedTrunc = speed0;
+	TPointD bSpeedTrunc = speed1;
+	truncateSpeeds(k0.m_frame, k1.m_frame, aSpeedTrunc, bSpeedTrunc);
+
+	return getTruncatedSpeedInOutValue(k0, k1, aSpeedTrunc, bSpeedTrunc, frame);
+}
+
+//---------------------------------------------------------
+
 DV_EXPORT_API void splitSpeedInOutSegment(
 	TDoubleKeyframe &k,
 	TDoubleKeyframe &k0,
@@ -721,6 +736,86 @@ double TDoubleParam::getValue(double frame, bool leftmost) const
 
 //---------------------------------------------------------
 
+void TDoubleParam::getValues(double frame, double step, int count, double values[]) const
+{
+	assert(m_imp);
+	const DoubleKeyframeVector &keyframes = m_imp->m_keyframes;
+	int kCount = keyframes.size();
+	int i;
+
+	if (kCount < 2 || m_imp->m_cycleEnabled || step <= 0) {
+		// nothing to share among the frames
+		for (i = 0; i < count; i++)
+			values[i] = getValue(frame + i * step);
+		return;
+	}
+
+	// keyframes range is [f0,f1]
+	double f0 = keyframes.front().m_frame;
+	double f1 = keyframes.back().m_frame;
+
+	// the segment being sampled, and its evaluation data
+	int k = 0, segment = -1;
+	bool sampled = false;
+	TPointD aSpeedTrunc, bSpeedTrunc;
+
+	for (i = 0; i < count; i++) {
+		double f = tcrop(frame + i * step, f0, f1);
+
+		// frames are increasing: segments are found walking forward, as in getValue()
+		while (k + 2 < kCount && keyframes[k + 1].m_frame <= f)
+			k++;
+
+		const TActualDoubleKeyframe &a = keyframes[k], &b = keyframes[k + 1];
+
+		if (k != segment) {
+			segment = k;
+
+			// segments depending on other ones, or not keyframe based, are left to getValue()
+			sampled = TDoubleKeyframe::isKeyframeBased(a.m_type) && a.m_type != TDoubleKeyframe::None &&
+					  a.m_step <= 1 &&
+					  (k + 2 == kCount || TDoubleKeyframe::isKeyframeBased(b.m_type)) &&
+					  (k == 0 || TDoubleKeyframe::isKeyframeBased(keyframes[k - 1].m_type));
+
+			if (sampled && a.m_type == TDoubleKeyframe::SpeedInOut) {
+				aSpeedTrunc = getSpeedOut(k);
+				bSpeedTrunc = getSpeedIn(k + 1);
+				truncateSpeeds(a.m_frame, b.m_frame, aSpeedTrunc, bSpeedTrunc);
+			}
+		}
+
+		if (!sampled) {
+			values[i] = getValue(f);
+			continue;
+		}
+
+		switch (a.m_type) {
+		case TDoubleKeyframe::Constant:
+			values[i] = getConstantValue(a, b, f);
+			break;
+		case TDoubleKeyframe::Linear:
+			values[i] = getLinearValue(a, b, f);
+			break;
+		case TDoubleKeyframe::SpeedInOut:
+			values[i] = getTruncatedSpeedInOutValue(a, b, aSpeedTrunc, bSpeedTrunc, f);
+			break;
+		case TDoubleKeyframe::EaseInOut:
+			values[i] = getEaseInOutValue(a, b, f, false);
+			break;
+		case TDoubleKeyframe::EaseInOutPercentage:
+			values[i] = getEaseInOutValue(a, b, f, true);
+			break;
+		case TDoubleKeyframe::Exponential:
+			values[i] = getExponentialValue(a, b, f);
+			break;
+		default:
+			values[i] = getValue(f);
+		}
+	}
+}
+
+//---------------------------------------------------------
+
 bool TDoubleParam::setValue(double frame, double value)
 {
 	assert(m_imp);
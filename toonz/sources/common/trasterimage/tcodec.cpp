@@ -740,7 +740,7 @@ bool TRasterCodecLZO::decompress(const UCHAR *inData, TINT32 inDataSize, TRaster
 	size_t outSize = outDataSize; // Calculate output buffer size
 
 	QByteArray decompressedBuffer;
-	if (!lzoDecompress(QByteArray(mc, ds), outSize, decompressedBuffer))
+	if (!lzoDecompress(QByteArray::fromRawData(mc, ds), outSize, decompressedBuffer))
 		throw TException("LZO decompression failed");
 
 	outRas->lock();
@@ -799,7 +799,7 @@ void TRasterCodecLZO::decompress(const TRasterP &compressedRas, TRasterP &outRas
 	char *outData = (char *)outRas->getRawData();
 
 	QByteArray decompressedBuffer;
-	if (!lzoDecompress(QByteArray(mc, ds), outSize, decompressedBuffer))
+	if (!lzoDecompress(QByteArray::fromRawData(mc, ds), outSize, decompressedBuffer))
 		throw TException("LZO decompression failed");
 	outRas->lock();
 	memcpy(outRas->getRawData(), decompressedBuffer.data(), decompressedBuffer.size());
@@ -14,6 +14,13 @@
 #endif
 
 #include <sstream>
+#include <climits>
+#include <cstring>
+#include <cstdio>
+#include <set>
+#include <algorithm>
+
+#include <QMutex>
 
 using namespace std;
 
@@ -215,6 +222,215 @@ TPersist *TPersist::create(const string &name)
 
 //===============================================================
 
+//===============================================================
+//    Binary snapshots
+//===============================================================
+
+/*
+  A binary snapshot is the token sequence of an XML document: tags, with their
+  attributes, and values. Every child of the root tag is a section, stored in a
+  file of the snapshot's sections folder named after its content hash and
+  referenced by a Section token in the snapshot file.
+
+  Strings are length-prefixed, integers are zigzag varints and doubles are
+  little endian IEEE 754.
+*/
+
+namespace
+{
+
+const char BinaryMagic[4] = {'T', 'N', 'Z', 'B'};
+const char BinaryVersion = 1;
+
+enum BinaryToken {
+	BinaryBeginTag = '<',	//!< name, attributes count, (name, value)*
+	BinaryBeginEndTag = '/', //!< as BinaryBeginTag
+	BinaryEndTag = '>',
+	BinaryInt = 'i',	 //!< zigzag varint
+	BinaryDouble = 'd',  //!< 8 bytes
+	BinaryString = 's',  //!< varint length, bytes
+	BinarySection = '#'  //!< 8 bytes hash, varint size
+};
+
+//---------------------------------------------------------------
+
+TFilePath getSectionsFolder(const TFilePath &fp)
+{
+	return fp.getParentDir() + (fp.getName() + "_sections");
+}
+
+//---------------------------------------------------------------
+
+TUINT64 getSectionHash(const void *data, size_t size, TUINT64 hash = 14695981039346656037ULL)
+{
+	// FNV-1a
+	for (size_t i = 0; i < size; ++i)
+		hash = (hash ^ ((const unsigned char *)data)[i]) * 1099511628211ULL;
+	return hash;
+}
+
+//---------------------------------------------------------------
+
+TFilePath getSectionPath(const TFilePath &folder, TUINT64 hash)
+{
+	char name[17];
+	sprintf(name, "%08x%08x", (unsigned int)(hash >> 32), (unsigned int)hash);
+	return folder + (string(name) + ".sec");
+}
+
+//---------------------------------------------------------------
+
+inline void putUInt(string &data, TUINT64 v)
+{
+	while (v >= 0x80) {
+		data.push_back((char)(v | 0x80));
+		v >>= 7;
+	}
+	data.push_back((char)v);
+}
+
+inline void putFixed64(string &data, TUINT64 v)
+{
+	for (int i = 0; i < 8; ++i, v >>= 8)
+		data.push_back((char)v);
+}
+
+inline void putBinaryString(string &data, const string &s)
+{
+	putUInt(data, s.size());
+	data.append(s);
+}
+
+inline bool getUInt(const char *&pos, const char *end, TUINT64 &v)
+{
+	v = 0;
+	for (int shift = 0; pos < end && shift < 64; shift += 7) {
+		unsigned char c = *pos++;
+		v |= (TUINT64)(c & 0x7f) << shift;
+		if (!(c & 0x80))
+			return true;
+	}
+	return false;
+}
+
+inline bool getFixed64(const char *&pos, const char *end, TUINT64 &v)
+{
+	if (end - pos < 8)
+		return false;
+	v = 0;
+	for (int i = 0; i < 8; ++i)
+		v |= (TUINT64)(unsigned char)pos[i] << (8 * i);
+	pos += 8;
+	return true;
+}
+
+inline bool getBinaryString(const char *&pos, const char *end, string &s)
+{
+	TUINT64 size;
+	if (!getUInt(pos, end, size) || size > (TUINT64)(end - pos))
+		return false;
+	s.assign(pos, (size_t)size);
+	pos += size;
+	return true;
+}
+
+//---------------------------------------------------------------
+
+//! Moves pos past the token at pos
+bool skipToken(const char *&pos, const char *end)
+{
+	if (pos >= end)
+		return false;
+
+	TUINT64 v;
+	string s;
+	switch (*pos++) {
+	case BinaryBeginTag:
+	case BinaryBeginEndTag: {
+		TUINT64 count;
+		if (!getBinaryString(pos, end, s) || !getUInt(pos, end, count))
+			return false;
+		for (TUINT64 i = 0; i < count; ++i)
+			if (!getBinaryString(pos, end, s) || !getBinaryString(pos, end, s))
+				return false;
+		return true;
+	}
+	case BinaryEndTag:
+		return true;
+	case BinaryInt:
+		return getUInt(pos, end, v);
+	case BinaryDouble:
+		return getFixed64(pos, end, v);
+	case BinaryString:
+		return getBinaryString(pos, end, s);
+	case BinarySection:
+		return getFixed64(pos, end, v) && getUInt(pos, end, v);
+	default:
+		return false;
+	}
+}
+
+//---------------------------------------------------------------
+
+//! Replaces the section references of a snapshot with the sections' content
+void readSnapshot(const TFilePath &fp, string &buffer)
+{
+	TFilePath folder = getSectionsFolder(fp);
+	string tokens;
+
+	const char *pos = buffer.data() + 5, *end = buffer.data() + buffer.size();
+	while (pos < end) {
+		const char *token = pos;
+		if (!skipToken(pos, end))
+			throw TException("Corrupted snapshot");
+
+		if (*token != BinarySection) {
+			tokens.append(token, pos);
+			continue;
+		}
+
+		TUINT64 hash, size;
+		const char *p = token + 1;
+		getFixed64(p, end, hash);
+		getUInt(p, end, size);
+
+		TFilePath sectionPath = getSectionPath(folder, hash);
+		Tifstream is(sectionPath);
+		size_t offset = tokens.size();
+		tokens.resize(offset + (size_t)size);
+		if (!is || (size > 0 && !is.read(&tokens[offset], (streamsize)size)) ||
+			getSectionHash(tokens.data() + offset, (size_t)size) != hash)
+			throw TException(sectionPath.getWideString() + L": Missing or corrupted snapshot section");
+	}
+
+	buffer.swap(tokens);
+}
+
+//---------------------------------------------------------------
+
+//! A section of a snapshot, along with the persistent objects it wrote
+struct SnapshotSection {
+	string m_name;
+	TUINT64 m_hash, m_size;
+	string m_data; //!< Empty if reused from the previous snapshot
+
+	//! The objects table before and after the section, hashed - sections
+	//! can refer to the objects written by the previous ones
+	TUINT64 m_tableBefore, m_tableAfter;
+	vector<pair<TPersist *, int>> m_objects;
+	int m_maxId;
+};
+
+//! The sections of the last snapshot written, which the next snapshot at the
+//! same path can reuse
+TFilePath l_lastSnapshotPath;
+vector<SnapshotSection> l_lastSnapshotSections;
+QMutex l_lastSnapshotMutex;
+
+} // namespace
+
+//===============================================================
+
 class TOStream::Imp
 {
 public:
@@ -231,17 +447,191 @@ public:
 	int m_maxId;
 	TFilePath m_filepath;
 
-	Imp() : m_os(0), m_chanOwner(false), m_tab(0), m_justStarted(true), m_maxId(0), m_compressed(false) {}
+	bool m_binary;
+	string m_data;						//!< Binary tokens, sections excluded
+	size_t m_sectionStart;				//!< Start of the section being written in m_data
+	size_t m_sectionObjects;			//!< Objects written before the section being written
+	vector<SnapshotSection> m_sections; //!< Sections written so far
+	vector<pair<TPersist *, int>> m_objects; //!< Objects written so far, in order
+	TUINT64 m_tableHash;					 //!< Hash of m_objects
+	bool m_written, m_ok;
+
+	Imp() : m_os(0), m_chanOwner(false), m_tab(0), m_justStarted(true), m_maxId(0), m_compressed(false), m_binary(false), m_sectionStart(0), m_sectionObjects(0), m_tableHash(0), m_written(false), m_ok(true) {}
+
+	void putBeginTag(const string &tagName, const map<string, string> &attributes, bool closed)
+	{
+		m_data.push_back(closed ? BinaryBeginEndTag : BinaryBeginTag);
+		putBinaryString(m_data, tagName);
+		putUInt(m_data, attributes.size());
+		for (map<string, string>::const_iterator it = attributes.begin(); it != attributes.end(); ++it) {
+			putBinaryString(m_data, it->first);
+			putBinaryString(m_data, it->second);
+		}
+	}
+
+	//! Writes the begin tag of a tag just pushed on m_tagStack
+	void putChildTag(const map<string, string> &attributes)
+	{
+		// children of the root tag are sections
+		if (m_tagStack.size() == 2) {
+			m_sectionStart = m_data.size();
+
+			SnapshotSection section;
+			section.m_name = m_tagStack.back();
+			section.m_tableBefore = m_tableHash;
+			m_sections.push_back(section);
+			m_sectionObjects = m_objects.size();
+		}
+		putBeginTag(m_tagStack.back(), attributes, false);
+	}
+
+	void addObject(TPersist *object, int id)
+	{
+		m_table[object] = id;
+		m_objects.push_back(make_pair(object, id));
+		m_tableHash = getSectionHash(&object, sizeof object, getSectionHash(&id, sizeof id, m_tableHash));
+	}
+
+	//! Writes the end tag of a tag already removed from m_tagStack
+	void putEndTag()
+	{
+		m_data.push_back(BinaryEndTag);
+
+		if (m_tagStack.size() == 1) {
+			SnapshotSection &section = m_sections.back();
+			section.m_data.assign(m_data, m_sectionStart, string::npos);
+			section.m_hash = getSectionHash(section.m_data.data(), section.m_data.size());
+			section.m_size = section.m_data.size();
+			section.m_tableAfter = m_tableHash;
+			section.m_objects.assign(m_objects.begin() + m_sectionObjects, m_objects.end());
+			section.m_maxId = m_maxId;
+
+			m_data.resize(m_sectionStart);
+			putSectionRef(section);
+		} else if (m_tagStack.empty())
+			writeSnapshot();
+	}
+
+	void putSectionRef(const SnapshotSection &section)
+	{
+		m_data.push_back(BinarySection);
+		putFixed64(m_data, section.m_hash);
+		putUInt(m_data, section.m_size);
+	}
+
+	bool reuseSection(const string &tagName);
+	void writeSnapshot();
 };
 
 //---------------------------------------------------------------
 
-TOStream::TOStream(const TFilePath &fp, bool compressed)
+bool TOStream::Imp::reuseSection(const string &tagName)
+{
+	QMutexLocker sl(&l_lastSnapshotMutex);
+	if (l_lastSnapshotPath != m_filepath)
+		return false;
+
+	int s, count = (int)l_lastSnapshotSections.size();
+	for (s = 0; s < count && l_lastSnapshotSections[s].m_name != tagName; ++s)
+		;
+	if (s == count)
+		return false;
+
+	// The objects the section refers to must have kept their ids
+	const SnapshotSection &section = l_lastSnapshotSections[s];
+	if (section.m_tableBefore != m_tableHash)
+		return false;
+
+	TFileStatus fs(getSectionPath(getSectionsFolder(m_filepath), section.m_hash));
+	if (!fs.doesExist() || fs.getSize() != (TINT64)section.m_size)
+		return false;
+
+	for (int o = 0; o < (int)section.m_objects.size(); ++o)
+		addObject(section.m_objects[o].first, section.m_objects[o].second);
+	m_maxId = std::max(m_maxId, section.m_maxId);
+	assert(m_tableHash == section.m_tableAfter);
+
+	m_sections.push_back(section);
+	putSectionRef(section);
+	return true;
+}
+
+//---------------------------------------------------------------
+
+void TOStream::Imp::writeSnapshot()
+{
+	if (m_written)
+		return;
+	m_written = true;
+
+	try {
+		TFilePath folder = getSectionsFolder(m_filepath);
+		if (!TFileStatus(folder).doesExist())
+			TSystem::mkDir(folder);
+
+		// Sections are written under their final name only when complete
+		std::set<TFilePath> sectionPaths;
+		for (int i = 0; i < (int)m_sections.size(); ++i) {
+			const SnapshotSection &section = m_sections[i];
+			TFilePath sectionPath = getSectionPath(folder, section.m_hash);
+			if (!sectionPaths.insert(sectionPath).second || section.m_data.empty())
+				continue;
+
+			TFileStatus fs(sectionPath);
+			if (fs.doesExist() && fs.getSize() == (TINT64)section.m_size)
+				continue;
+
+			TFilePath tempPath = sectionPath.withType("tmp");
+			{
+				Tofstream os(tempPath);
+				if (!os.write(section.m_data.data(), section.m_data.size()))
+					throw TException("Could not write snapshot section");
+			}
+			TSystem::renameFile(sectionPath, tempPath);
+		}
+
+		// The snapshot file replaces the previous one only when complete, too
+		TFilePath tempPath(m_filepath.getWideString() + L".tmp");
+		{
+			Tofstream os(tempPath);
+			os.write(BinaryMagic, 4);
+			os.put(BinaryVersion);
+			if (!os.write(m_data.data(), m_data.size()))
+				throw TException("Could not write snapshot");
+		}
+		TSystem::renameFile(m_filepath, tempPath);
+
+		// Drop the sections of previous snapshots
+		TFilePathSet files = TSystem::readDirectory(folder, false, true);
+		for (TFilePathSet::iterator it = files.begin(); it != files.end(); ++it)
+			if (it->getType() == "sec" && sectionPaths.count(*it) == 0)
+				TSystem::deleteFile(*it);
+	} catch (...) {
+		m_ok = false;
+	}
+
+	// Remember the sections for the next snapshot - their content is on disk
+	QMutexLocker sl(&l_lastSnapshotMutex);
+	l_lastSnapshotPath = m_ok ? m_filepath : TFilePath();
+	l_lastSnapshotSections.clear();
+	if (m_ok) {
+		l_lastSnapshotSections.swap(m_sections);
+		for (int i = 0; i < (int)l_lastSnapshotSections.size(); ++i)
+			string().swap(l_lastSnapshotSections[i].m_data);
+	}
+}
+
+//---------------------------------------------------------------
+
+TOStream::TOStream(const TFilePath &fp, bool compressed, bool binary)
 	: m_imp(new Imp)
 {
 	m_imp->m_filepath = fp;
 
-	if (compressed) {
+	if (binary) {
+		m_imp->m_binary = true;
+		m_imp->m_chanOwner = false;
+	} else if (compressed) {
 		m_imp->m_os = &m_imp->m_ostrstream;
 		m_imp->m_compressed = true;
 		m_imp->m_chanOwner = false;
@@ -260,6 +650,10 @@ TOStream::TOStream(Imp *imp)
 	: m_imp(imp)
 {
 	assert(!imp->m_tagStack.empty());
+	if (m_imp->m_binary) {
+		m_imp->putChildTag(map<string, string>());
+		return;
+	}
 	ostream &os = *m_imp->m_os;
 	if (m_imp->m_justStarted == false)
 		cr();
@@ -278,6 +672,10 @@ TOStream::~TOStream()
 			string tagName = m_imp->m_tagStack.back();
 			m_imp->m_tagStack.pop_back();
 			assert(tagName != "");
+			if (m_imp->m_binary) {
+				m_imp->putEndTag();
+				return;
+			}
 			ostream &os = *m_imp->m_os;
 			m_imp->m_tab--;
 			if (!m_imp->m_justStarted)
@@ -286,6 +684,8 @@ TOStream::~TOStream()
 			cr();
 			m_imp->m_justStarted = true;
 		} else {
+			if (m_imp->m_binary)
+				m_imp->writeSnapshot();
 			if (m_imp->m_compressed) {
 				const void *in = (const void *)m_imp->m_ostrstream.str();
 				size_t in_len = strlen((char *)in);
@@ -339,6 +739,11 @@ TFilePath TOStream::getRepositoryPath()
 
 TOStream &TOStream::operator<<(int v)
 {
+	if (m_imp->m_binary) {
+		m_imp->m_data.push_back(BinaryInt);
+		putUInt(m_imp->m_data, ((TUINT32)v << 1) ^ (TUINT32)(v >> 31));
+		return *this;
+	}
 	*(m_imp->m_os) << v << " ";
 	m_imp->m_justStarted = false;
 	return *this;
@@ -351,6 +756,13 @@ TOStream &TOStream::operator<<(double v)
 	if (areAlmostEqual(v, 0)) //con valori molto piccoli (es. 1.4e-310) non riesce a rileggerli!
 		v = 0;
 
+	if (m_imp->m_binary) {
+		TUINT64 bits;
+		memcpy(&bits, &v, sizeof bits);
+		m_imp->m_data.push_back(BinaryDouble);
+		putFixed64(m_imp->m_data, bits);
+		return *this;
+	}
 	*(m_imp->m_os) << v << " ";
 	m_imp->m_justStarted = false;
 	return *this;
@@ -360,6 +772,11 @@ TOStream &TOStream::operator<<(double v)
 
 TOStream &TOStream::operator<<(string v)
 {
+	if (m_imp->m_binary) {
+		m_imp->m_data.push_back(BinaryString);
+		putBinaryString(m_imp->m_data, v);
+		return *this;
+	}
 	ostream &os = *(m_imp->m_os);
 	int len = v.length();
 	if (len == 0) {
@@ -386,6 +803,8 @@ TOStream &TOStream::operator<<(string v)
 TOStream &TOStream::operator<<(QString _v)
 {
 	string v = _v.toStdString();
+	if (m_imp->m_binary)
+		return operator<<(v);
 
 	ostream &os = *(m_imp->m_os);
 	int len = v.length();
@@ -463,6 +882,8 @@ TOStream &TOStream::operator<<(const TFilePath &v)
 
 TOStream &TOStream::operator<<(const TPixel32 &v)
 {
+	if (m_imp->m_binary)
+		return *this << (int)v.r << (int)v.g << (int)v.b << (int)v.m;
 	ostream &os = *(m_imp->m_os);
 	os << (int)v.r << " " << (int)v.g << " " << (int)v.b << " " << (int)v.m << " ";
 	m_imp->m_justStarted = false;
@@ -473,6 +894,8 @@ TOStream &TOStream::operator<<(const TPixel32 &v)
 
 TOStream &TOStream::operator<<(const TPixel64 &v)
 {
+	if (m_imp->m_binary)
+		return *this << (int)v.r << (int)v.g << (int)v.b << (int)v.m;
 	ostream &os = *(m_imp->m_os);
 	os << (int)v.r << " " << (int)v.g << " " << (int)v.b << " " << (int)v.m << " ";
 	m_imp->m_justStarted = false;
@@ -483,6 +906,8 @@ TOStream &TOStream::operator<<(const TPixel64 &v)
 
 void TOStream::cr()
 {
+	if (m_imp->m_binary)
+		return;
 	*(m_imp->m_os) << endl;
 	for (int i = 0; i < m_imp->m_tab; i++)
 		*(m_imp->m_os) << "  ";
@@ -493,6 +918,8 @@ void TOStream::cr()
 
 TOStream::operator bool() const
 {
+	if (m_imp->m_binary)
+		return m_imp->m_ok;
 	return (m_imp->m_os && *m_imp->m_os);
 }
 
@@ -511,6 +938,10 @@ void TOStream::openChild(string tagName)
 {
 	assert(tagName != "");
 	m_imp->m_tagStack.push_back(tagName);
+	if (m_imp->m_binary) {
+		m_imp->putChildTag(map<string, string>());
+		return;
+	}
 	if (m_imp->m_justStarted == false)
 		cr();
 	*(m_imp->m_os) << "<" << m_imp->m_tagStack.back() << ">";
@@ -525,6 +956,10 @@ void TOStream::openChild(string tagName, const map<string, string> &attributes)
 {
 	assert(tagName != "");
 	m_imp->m_tagStack.push_back(tagName);
+	if (m_imp->m_binary) {
+		m_imp->putChildTag(attributes);
+		return;
+	}
 	if (m_imp->m_justStarted == false)
 		cr();
 	*(m_imp->m_os) << "<" << m_imp->m_tagStack.back();
@@ -547,6 +982,10 @@ void TOStream::closeChild()
 	string tagName = m_imp->m_tagStack.back();
 	m_imp->m_tagStack.pop_back();
 	assert(tagName != "");
+	if (m_imp->m_binary) {
+		m_imp->putEndTag();
+		return;
+	}
 	//ostream &os = *m_imp->m_os; //os non e' usato
 	m_imp->m_tab--;
 	if (!m_imp->m_justStarted)
@@ -562,6 +1001,10 @@ void TOStream::openCloseChild(string tagName, const map<string, string> &attribu
 {
 	assert(tagName != "");
 	// m_imp->m_tagStack.push_back(tagName);
+	if (m_imp->m_binary) {
+		m_imp->putBeginTag(tagName, attributes, true);
+		return;
+	}
 	if (m_imp->m_justStarted == false)
 		cr();
 	*(m_imp->m_os) << "<" << tagName;
@@ -589,6 +1032,20 @@ TOStream &TOStream::operator<<(TPersist &v)
 TOStream &TOStream::operator<<(TPersist *v)
 {
 	Imp::PersistTable::iterator it = m_imp->m_table.find(v);
+	if (m_imp->m_binary) {
+		map<string, string> attributes;
+		bool written = (it != m_imp->m_table.end());
+		int id = written ? it->second : ++m_imp->m_maxId;
+		attributes["id"] = toString(id);
+
+		m_imp->putBeginTag(v->getStreamTag(), attributes, written);
+		if (!written) {
+			m_imp->addObject(v, id);
+			v->saveData(*this);
+			m_imp->m_data.push_back(BinaryEndTag);
+		}
+		return *this;
+	}
 	if (it != m_imp->m_table.end()) {
 		*(m_imp->m_os) << "<" << v->getStreamTag() << " id='" << it->second << "'/>";
 		m_imp->m_justStarted = false;
@@ -609,8 +1066,19 @@ TOStream &TOStream::operator<<(TPersist *v)
 
 //---------------------------------------------------------------
 
+bool TOStream::reuseSection(string tagName)
+{
+	assert(tagName != "");
+	return m_imp->m_binary && m_imp->m_tagStack.size() == 1 && !m_imp->m_written &&
+		   m_imp->reuseSection(tagName);
+}
+
+//---------------------------------------------------------------
+
 bool TOStream::checkStatus() const
 {
+	if (m_imp->m_binary)
+		return m_imp->m_ok;
 	if (!m_imp->m_os)
 		return false;
 
@@ -622,14 +1090,18 @@ bool TOStream::checkStatus() const
 /*! 
 	This class contains TIStream's attributes.
 	It is created by memory allocation in the TIStream's constructor.
+
+	The whole document is loaded in memory (already inflated, if compressed)
+	and tokenized in place, so that tokens are copied once from contiguous
+	memory rather than read character by character from a std::istream.
 */
 class TIStream::Imp
 {
 public:
-	istream *m_is;
-	bool m_chanOwner;
+	string m_buffer;		   //!< The document's content
+	const char *m_pos, *m_end; //!< Current read position and end of m_buffer
+	bool m_fail;			   //!< Whether a read failed - as std::istream's failbit
 	int m_line;
-	string m_strbuffer;
 	bool m_compressed;
 
 	vector<string> m_tagStack;
@@ -643,7 +1115,36 @@ public:
 
 	VersionNumber m_versionNumber;
 
-	Imp() : m_is(0), m_chanOwner(false), m_line(0), m_compressed(false), m_versionNumber(0, 0) {}
+	std::istringstream m_numberStream; //!< Parses the numbers outside the fast path
+
+	bool m_binary;					  //!< Whether the document is a binary snapshot
+	vector<string> m_binaryTagStack; //!< Names of the binary tags still open
+
+	Imp() : m_pos(0), m_end(0), m_fail(true), m_line(0), m_compressed(false), m_versionNumber(0, 0), m_binary(false)
+	{
+		m_numberStream.imbue(std::locale::classic());
+	}
+
+	void setBuffer()
+	{
+		m_pos = m_buffer.data();
+		m_end = m_pos + m_buffer.size();
+		m_fail = false;
+	}
+
+	//! Returns the next character as an unsigned char, or -1 at eof - or after a failure
+	inline int peek() const { return (!m_fail && m_pos < m_end) ? (unsigned char)*m_pos : -1; }
+	inline bool eof() const { return m_pos >= m_end; }
+
+	inline bool get(char &c)
+	{
+		if (!m_fail && m_pos < m_end) {
+			c = *m_pos++;
+			return true;
+		}
+		m_fail = true;
+		return false;
+	}
 
 	// update m_line if necessary; returns -e if eof
 	int getNextChar();
@@ -654,6 +1155,14 @@ public:
 	bool matchIdent(string &ident);
 	bool matchValue(string &value);
 
+	bool readInt(int &v);
+	bool readDouble(double &v);
+	void readString(string &v);
+
+	bool matchBinaryTag();
+	bool readBinaryValue(int &type, int &i, double &d, string &s);
+	bool parseNumber(const string &s, double &v);
+
 	void skipCurrentTag();
 };
 
@@ -677,8 +1186,7 @@ TFilePath TIStream::getRepositoryPath()
 int TIStream::Imp::getNextChar()
 {
 	char c;
-	m_is->get(c);
-	if (m_is->eof())
+	if (!get(c))
 		return -1;
 	if (c == '\r')
 		m_line++;
@@ -689,9 +1197,8 @@ int TIStream::Imp::getNextChar()
 
 void TIStream::Imp::skipBlanks()
 {
-	istream &is = *m_is;
-	istream::int_type c;
-	while (c = is.peek(), (isspace(c) || c == '\r'))
+	int c;
+	while (c = peek(), (isspace(c) || c == '\r'))
 		getNextChar();
 }
 
@@ -699,7 +1206,7 @@ void TIStream::Imp::skipBlanks()
 
 bool TIStream::Imp::match(char c)
 {
-	if (m_is->peek() == c) {
+	if (peek() == (unsigned char)c) {
 		getNextChar();
 		return true;
 	} else
@@ -708,19 +1215,31 @@ bool TIStream::Imp::match(char c)
 
 //---------------------------------------------------------------
 
+namespace
+{
+
+inline bool isIdentChar(int c)
+{
+	return isalnum(c) || c == '_' || c == '.' || c == '-';
+}
+
+inline bool isWordChar(int c)
+{
+	return isalnum(c) || c == '_' || c == '&' || c == '#' || c == ';' || c == '%';
+}
+
+} // namespace
+
+//---------------------------------------------------------------
+
 bool TIStream::Imp::matchIdent(string &ident)
 {
-	istream &is = *m_is;
-	if (!isalnum(is.peek()))
+	if (!isalnum(peek()))
 		return false;
-	ident = "";
-	char c;
-	is.get(c);
-	ident.append(1, c);
-	while (c = is.peek(), isalnum(c) || c == '_' || c == '.' || c == '-') {
-		is.get(c);
-		ident.append(1, c);
-	}
+	const char *begin = m_pos++;
+	while (m_pos < m_end && isIdentChar((unsigned char)*m_pos))
+		++m_pos;
+	ident.assign(begin, m_pos);
 	return true;
 }
 
@@ -728,39 +1247,245 @@ bool TIStream::Imp::matchIdent(string &ident)
 
 bool TIStream::Imp::matchValue(string &str)
 {
-	istream &is = *m_is;
-	char quote = is.peek();
-	char c;
-	if (!is || (quote != '\'' && quote != '\"'))
+	int quote = peek();
+	if (m_fail || (quote != '\'' && quote != '\"'))
 		return false;
-	is.get(c);
+	++m_pos;
 	str = "";
 	for (;;) {
-		is.get(c);
-		if (!is)
+		// copy the plain characters in one go
+		const char *begin = m_pos;
+		while (m_pos < m_end && *m_pos != quote && *m_pos != '\\')
+			++m_pos;
+		str.append(begin, m_pos);
+
+		char c;
+		if (!get(c))
 			throw TException("expected '\"'");
 		if (c == quote)
 			break;
-		if (c == '\\') {
-			is.get(c);
-			if (!is)
-				throw TException("unexpected EOF");
-			if (c != '\'' && c != '\"' && c != '\\')
-				throw TException("bad escape sequence");
-		}
+		if (!get(c))
+			throw TException("unexpected EOF");
+		if (c != '\'' && c != '\"' && c != '\\')
+			throw TException("bad escape sequence");
 		str.append(1, c);
 	}
-	if (c != quote)
-		throw TException("missing '\"'");
 	return true;
 }
 
 //---------------------------------------------------------------
 
+namespace
+{
+
+// Powers of ten exactly representable as doubles
+const double Pow10[] = {1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+						1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+
+const unsigned long long MaxExactMantissa = (1ULL << 53) - 1;
+
+} // namespace
+
+//---------------------------------------------------------------
+
+bool TIStream::Imp::readInt(int &v)
+{
+	if (m_fail)
+		return false;
+
+	if (m_binary) {
+		int type, i;
+		double d;
+		string s;
+		if (!readBinaryValue(type, i, d, s))
+			return false;
+		if (type == BinaryInt)
+			v = i;
+		else if (type == BinaryDouble)
+			v = (int)d;
+		else if (parseNumber(s, d))
+			v = (int)d;
+		return !m_fail;
+	}
+	while (m_pos < m_end && isspace((unsigned char)*m_pos))
+		++m_pos;
+
+	const char *p = m_pos;
+	bool negative = false;
+	if (p < m_end && (*p == '-' || *p == '+'))
+		negative = (*p++ == '-');
+
+	if (p >= m_end || !isdigit((unsigned char)*p)) {
+		v = 0;
+		m_fail = true;
+		return false;
+	}
+
+	long long n = 0;
+	for (; p < m_end && isdigit((unsigned char)*p); ++p)
+		if (n <= INT_MAX)
+			n = n * 10 + (*p - '0');
+	m_pos = p;
+
+	if (negative)
+		n = -n;
+	if (n > INT_MAX || n < INT_MIN) {
+		v = (n > 0) ? INT_MAX : INT_MIN;
+		m_fail = true;
+		return false;
+	}
+
+	v = (int)n;
+	return true;
+}
+
+//---------------------------------------------------------------
+
+bool TIStream::Imp::readDouble(double &v)
+{
+	if (m_fail)
+		return false;
+
+	if (m_binary) {
+		int type, i;
+		double d;
+		string s;
+		if (!readBinaryValue(type, i, d, s))
+			return false;
+		if (type == BinaryInt)
+			v = i;
+		else if (type == BinaryDouble)
+			v = d;
+		else if (parseNumber(s, d))
+			v = d;
+		return !m_fail;
+	}
+	while (m_pos < m_end && isspace((unsigned char)*m_pos))
+		++m_pos;
+
+	// [sign] digits [. digits] [(e|E) [sign] digits]
+	const char *begin = m_pos, *p = m_pos;
+	bool negative = false;
+	if (p < m_end && (*p == '-' || *p == '+'))
+		negative = (*p++ == '-');
+
+	unsigned long long mantissa = 0;
+	int digitsCount = 0, exponent = 0;
+	bool exact = true;
+
+	for (; p < m_end && isdigit((unsigned char)*p); ++p, ++digitsCount) {
+		if (mantissa <= (MaxExactMantissa - 9) / 10)
+			mantissa = mantissa * 10 + (*p - '0');
+		else
+			exact = false;
+	}
+	if (p < m_end && *p == '.') {
+		for (++p; p < m_end && isdigit((unsigned char)*p); ++p, ++digitsCount) {
+			if (mantissa <= (MaxExactMantissa - 9) / 10)
+				mantissa = mantissa * 10 + (*p - '0'), --exponent;
+			else
+				exact = false;
+		}
+	}
+	if (digitsCount == 0) {
+		m_fail = true;
+		return false;
+	}
+
+	if (p < m_end && (*p == 'e' || *p == 'E')) {
+		const char *q = p + 1;
+		bool negativeExp = false;
+		if (q < m_end && (*q == '-' || *q == '+'))
+			negativeExp = (*q++ == '-');
+		if (q < m_end && isdigit((unsigned char)*q)) {
+			int e = 0;
+			for (; q < m_end && isdigit((unsigned char)*q); ++q)
+				if (e < 10000)
+					e = e * 10 + (*q - '0');
+			exponent += negativeExp ? -e : e;
+			p = q;
+		}
+	}
+	m_pos = p;
+
+	if (exact && exponent >= -22 && exponent <= 22) {
+		// Both the mantissa and the power of ten are exact - so is their
+		// (correctly rounded) product or quotient
+		double value = (double)mantissa;
+		value = (exponent < 0) ? value / Pow10[-exponent] : value * Pow10[exponent];
+		v = negative ? -value : value;
+		return true;
+	}
+
+	m_numberStream.clear();
+	m_numberStream.str(string(begin, p));
+	if (!(m_numberStream >> v))
+		m_fail = true;
+	return !m_fail;
+}
+
+//---------------------------------------------------------------
+
+void TIStream::Imp::readString(string &v)
+{
+	v = "";
+
+	if (m_binary) {
+		// a tag is left to be matched, as in XML documents
+		if (m_pos < m_end && (*m_pos == BinaryBeginTag || *m_pos == BinaryBeginEndTag || *m_pos == BinaryEndTag))
+			return;
+
+		int type, i;
+		double d;
+		if (!readBinaryValue(type, i, d, v))
+			return;
+		if (type == BinaryInt)
+			v = toString(i);
+		else if (type == BinaryDouble) {
+			// as written to XML documents
+			std::ostringstream os;
+			os.imbue(std::locale::classic());
+			os << d;
+			v = os.str();
+		}
+		return;
+	}
+
+	skipBlanks();
+	char c;
+	if (!get(c))
+		return;
+	if (c == '\"') {
+		for (;;) {
+			const char *begin = m_pos;
+			while (m_pos < m_end && *m_pos != '\"' && *m_pos != '\\')
+				++m_pos;
+			v.append(begin, m_pos);
+
+			if (!get(c) || c == '\"')
+				break;
+			if (!get(c))
+				throw TException("unexpected EOF");
+			if (c != '\"' && c != '\\' && c != '\'')
+				v.append(1, '\\');
+			v.append(1, c);
+		}
+	} else {
+		const char *begin = m_pos - 1;
+		while (m_pos < m_end && isWordChar((unsigned char)*m_pos))
+			++m_pos;
+		v.assign(begin, m_pos);
+	}
+}
+
+//---------------------------------------------------------------
+
 bool TIStream::Imp::matchTag()
 {
 	if (m_currentTag)
 		return true;
+	if (m_binary)
+		return matchBinaryTag();
 	StreamTag &tag = m_currentTag;
 	tag = StreamTag();
 	skipBlanks();
@@ -771,10 +1496,9 @@ bool TIStream::Imp::matchTag()
 		skipBlanks();
 		if (!match('-') || !match('-'))
 			throw TException("expected '<!--' tag");
-		istream &is = *m_is;
 		char c;
 		int status = 1;
-		while (status != 0 && is.get(c))
+		while (status != 0 && get(c))
 			switch (status) {
 			case 1:
 				if (c == '-')
@@ -832,17 +1556,128 @@ bool TIStream::Imp::matchTag()
 
 //---------------------------------------------------------------
 
+bool TIStream::Imp::parseNumber(const string &s, double &v)
+{
+	m_numberStream.clear();
+	m_numberStream.str(s);
+	if (!(m_numberStream >> v))
+		m_fail = true;
+	return !m_fail;
+}
+
+//---------------------------------------------------------------
+
+bool TIStream::Imp::matchBinaryTag()
+{
+	if (m_fail || m_pos >= m_end)
+		return false;
+
+	StreamTag &tag = m_currentTag;
+	tag = StreamTag();
+
+	const char *pos = m_pos;
+	switch (*pos++) {
+	case BinaryBeginTag:
+	case BinaryBeginEndTag: {
+		TUINT64 count;
+		if (!getBinaryString(pos, m_end, tag.m_name) || !getUInt(pos, m_end, count))
+			throw TException("Corrupted snapshot");
+		for (TUINT64 i = 0; i < count; ++i) {
+			string name, value;
+			if (!getBinaryString(pos, m_end, name) || !getBinaryString(pos, m_end, value))
+				throw TException("Corrupted snapshot");
+			tag.m_attributes[name] = value;
+		}
+
+		if (*m_pos == BinaryBeginTag)
+			m_binaryTagStack.push_back(tag.m_name);
+		else
+			tag.m_type = StreamTag::BeginEndTag;
+		break;
+	}
+	case BinaryEndTag:
+		if (m_binaryTagStack.empty())
+			throw TException("Corrupted snapshot");
+		tag.m_name = m_binaryTagStack.back();
+		tag.m_type = StreamTag::EndTag;
+		m_binaryTagStack.pop_back();
+		break;
+	default:
+		return false;
+	}
+
+	m_pos = pos;
+	return true;
+}
+
+//---------------------------------------------------------------
+
+bool TIStream::Imp::readBinaryValue(int &type, int &i, double &d, string &s)
+{
+	if (m_fail || m_pos >= m_end) {
+		m_fail = true;
+		return false;
+	}
+
+	type = *m_pos;
+	const char *pos = m_pos + 1;
+	TUINT64 v;
+	bool ok;
+	switch (type) {
+	case BinaryInt:
+		if ((ok = getUInt(pos, m_end, v))) {
+			TUINT32 u = (TUINT32)v;
+			i = (int)((u >> 1) ^ (0u - (u & 1)));
+		}
+		break;
+	case BinaryDouble:
+		if ((ok = getFixed64(pos, m_end, v)))
+			memcpy(&d, &v, sizeof d);
+		break;
+	case BinaryString:
+		ok = getBinaryString(pos, m_end, s);
+		break;
+	default:
+		// not a value
+		m_fail = true;
+		return false;
+	}
+
+	if (!ok)
+		throw TException("Corrupted snapshot");
+
+	m_pos = pos;
+	return true;
+}
+
+//---------------------------------------------------------------
+
 void TIStream::Imp::skipCurrentTag()
 {
 	if (m_currentTag.m_type == StreamTag::BeginEndTag)
 		return;
-	istream &is = *m_is;
+
+	if (m_binary) {
+		size_t depth = m_binaryTagStack.size();
+		while (m_pos < m_end) {
+			if (matchBinaryTag()) {
+				if (m_binaryTagStack.size() < depth) {
+					m_tagStack.pop_back();
+					m_currentTag = StreamTag();
+					break;
+				}
+			} else if (!skipToken(m_pos, m_end))
+				throw TException("Corrupted snapshot");
+		}
+		m_currentTag = StreamTag();
+		return;
+	}
 	int level = 1;
 	int c;
 	for (;;) {
-		if (is.eof())
+		if (eof())
 			break; //unexpected eof
-		c = is.peek();
+		c = peek();
 		if (c != '<') {
 			getNextChar();
 			continue;
@@ -891,27 +1726,54 @@ TIStream::TIStream(const TFilePath &fp)
 	: m_imp(new Imp)
 {
 	m_imp->m_filepath = fp;
-	m_imp->m_is = new Tifstream(fp);
 
-	if (m_imp->m_is->peek() == 'T') // non comincia con '<' dev'essere compresso
+	{
+		Tifstream is(fp);
+		if (!is)
+			return;
+
+		is.seekg(0, ios::end);
+		streamoff size = is.tellg();
+		is.seekg(0, ios::beg);
+		if (size < 0)
+			return;
+
+		m_imp->m_buffer.resize((size_t)size);
+		if (size > 0 && !is.read(&m_imp->m_buffer[0], size))
+			return;
+	}
+
+	string &buffer = m_imp->m_buffer;
+	if (buffer.size() >= 5 && memcmp(buffer.data(), BinaryMagic, 4) == 0) {
+		if (buffer[4] != BinaryVersion)
+			throw TException("Unsupported snapshot version");
+
+		readSnapshot(fp, buffer);
+		m_imp->m_binary = true;
+	} else if (!buffer.empty() && buffer[0] == 'T') // non comincia con '<' dev'essere compresso
 	{
 		bool swapForEndianess = false;
 
-		auto_ptr<std::istream> is(m_imp->m_is);
-		m_imp->m_is = 0;
+		const char *pos = buffer.data(), *end = pos + buffer.size();
+		if (end - pos < 4)
+			throw TException("Bad magic number");
 
-		char magicBuffer[4];
-		is->read(magicBuffer, 4);
-		string magic(magicBuffer, 4);
+		string magic(pos, 4);
+		pos += 4;
 		size_t in_len, out_len;
 
 		if (magic == "TNZC") {
 			// Tab3.0 beta
-			is->read((char *)&out_len, sizeof out_len);
-			is->read((char *)&in_len, sizeof in_len);
+			if (end - pos < (int)(2 * sizeof(size_t)))
+				throw TException("Corrupted file");
+			memcpy(&out_len, pos, sizeof out_len), pos += sizeof out_len;
+			memcpy(&in_len, pos, sizeof in_len), pos += sizeof in_len;
 		} else if (magic == "TABc") {
+			if (end - pos < (int)(3 * sizeof(TINT32)))
+				throw TException("Corrupted file");
+
 			TINT32 v;
-			is->read((char *)&v, sizeof v);
+			memcpy(&v, pos, sizeof v), pos += sizeof v;
 			printf("magic = %08X\n", v);
 
 			if (v == 0x0A0B0C0D)
@@ -923,15 +1785,17 @@ TIStream::TIStream(const TFilePath &fp)
 				printf("UH OH!\n");
 			}
 
-			is->read((char *)&v, sizeof v);
+			memcpy(&v, pos, sizeof v), pos += sizeof v;
 			out_len = swapForEndianess ? swapTINT32(v) : v;
-			is->read((char *)&v, sizeof v);
+			memcpy(&v, pos, sizeof v), pos += sizeof v;
 			in_len = swapForEndianess ? swapTINT32(v) : v;
 		} else
 			throw TException("Bad magic number");
 
 		if (in_len <= 0 || in_len > 100000000) // 100M di tnzfile (compresso) sembrano proprio esagerati
 			throw TException("Corrupted file");
+		if (in_len > (size_t)(end - pos))
+			throw TException("Couldn't decompress file");
 
 		LZ4F_decompressionContext_t lz4dctx;
 
@@ -939,30 +1803,26 @@ TIStream::TIStream(const TFilePath &fp)
 		if (LZ4F_isError(err))
 			throw TException("Couldn't decompress file");
 
-		char *in = (char *)malloc(in_len);
-		is->read((char *)in, in_len);
-
-		m_imp->m_strbuffer.resize(out_len + 1000); // per prudenza
-		char *out = (char *)m_imp->m_strbuffer.c_str();
+		// Decompress straight into the parsed buffer
+		string out;
+		out.resize(out_len + 1000); // per prudenza
 
 		size_t check_len = out_len;
 
-		//size_t remaining = LZ4F_decompress(lz4dctx, out, &out_len, in, &in_len, NULL);
-		bool ok = lz4decompress(lz4dctx, out, &out_len, in, in_len);
+		bool ok = lz4decompress(lz4dctx, &out[0], &out_len, pos, in_len);
 		LZ4F_freeDecompressionContext(lz4dctx);
 
-		free(in);
-
 		if (!ok)
 			throw TException("Couldn't decompress file");
 
 		if (check_len != out_len)
 			throw TException("corrupted file");
 
-		m_imp->m_is = new istrstream((char *)out, out_len);
+		out.resize(out_len);
+		buffer.swap(out);
 	}
 
-	m_imp->m_chanOwner = true;
+	m_imp->setBuffer();
 }
 
 //---------------------------------------------------------------
@@ -979,8 +1839,6 @@ TIStream::TIStream(istream &is)
 
 TIStream::~TIStream()
 {
-	if (m_imp->m_chanOwner)
-		delete m_imp->m_is;
 	delete m_imp;
 }
 
@@ -988,7 +1846,7 @@ TIStream::~TIStream()
 
 TIStream &TIStream::operator>>(int &v)
 {
-	*(m_imp->m_is) >> v;
+	m_imp->readInt(v);
 	return *this;
 }
 
@@ -996,7 +1854,7 @@ TIStream &TIStream::operator>>(int &v)
 
 TIStream &TIStream::operator>>(double &v)
 {
-	*(m_imp->m_is) >> v;
+	m_imp->readDouble(v);
 	return *this;
 }
 //---------------------------------------------------------------
@@ -1041,40 +1899,7 @@ TIStream &TIStream::operator>>(wstring &v)
 
 TIStream &TIStream::operator>>(string &v)
 {
-	istream &is = *(m_imp->m_is);
-	v = "";
-	m_imp->skipBlanks();
-	char c;
-	is.get(c);
-	if (c == '\"') {
-		is.get(c);
-		while (is && c != '"') {
-			if (c == '\\') {
-				is.get(c);
-				if (!is)
-					throw TException("unexpected EOF");
-				if (c == '"')
-					v.append(1, '"');
-				else if (c == '\\')
-					v.append(1, '\\');
-				else if (c == '\'')
-					v.append(1, '\'');
-				else {
-					v.append(1, '\\');
-					v.append(1, c);
-				}
-			} else
-				v.append(1, c);
-			is.get(c);
-		}
-	} else {
-		v.append(1, c);
-		while (c = is.peek(), isalnum(c) || c == '_' || c == '&' || c == '#' || c == ';' || c == '%') {
-			is.get(c);
-			v.append(1, c);
-		}
-	}
-
+	m_imp->readString(v);
 	return *this;
 }
 
@@ -1082,40 +1907,9 @@ TIStream &TIStream::operator>>(string &v)
 
 TIStream &TIStream::operator>>(QString &v)
 {
-	istream &is = *(m_imp->m_is);
-	v = "";
-	m_imp->skipBlanks();
-	char c;
-	is.get(c);
-	if (c == '\"') {
-		is.get(c);
-		while (is && c != '"') {
-			if (c == '\\') {
-				is.get(c);
-				if (!is)
-					throw TException("unexpected EOF");
-				if (c == '"')
-					v.append('"');
-				else if (c == '\\')
-					v.append('\\');
-				else if (c == '\'')
-					v.append('\'');
-				else {
-					v.append('\\');
-					v.append(c);
-				}
-			} else
-				v.append(c);
-			is.get(c);
-		}
-	} else {
-		v.append(c);
-		while (c = is.peek(), isalnum(c) || c == '_' || c == '&' || c == '#' || c == ';' || c == '%') {
-			is.get(c);
-			v.append(c);
-		}
-	}
-
+	string s;
+	m_imp->readString(s);
+	v = QString::fromLatin1(s.data(), (int)s.size());
 	return *this;
 }
 
@@ -1123,30 +1917,44 @@ TIStream &TIStream::operator>>(QString &v)
 
 string TIStream::getString()
 {
-	istream &is = *(m_imp->m_is);
-	string v = "";
-	m_imp->skipBlanks();
-	char c = is.peek();
-	while (c != '<') {
-		is.get(c);
-		c = is.peek();
-		if (!is)
-			throw TException("unexpected EOF");
-		v.append(1, c);
+	if (m_imp->m_binary) {
+		// The values up to the next tag, separated by blanks
+		string v, value;
+		m_imp->readString(value);
+		while (m_imp->m_pos < m_imp->m_end && *m_imp->m_pos != BinaryBeginTag &&
+			   *m_imp->m_pos != BinaryBeginEndTag && *m_imp->m_pos != BinaryEndTag) {
+			v += value + " ";
+			m_imp->readString(value);
+		}
+		return v + value;
 	}
-	return v;
+
+	m_imp->skipBlanks();
+	if (m_imp->m_fail)
+		throw TException("unexpected EOF");
+
+	const char *begin = m_imp->m_pos;
+	const char *tag = (const char *)memchr(begin, '<', m_imp->m_end - begin);
+	if (!tag)
+		throw TException("unexpected EOF");
+
+	m_imp->m_pos = tag;
+	if (tag == begin)
+		return "";
+
+	// Historically, the first character is skipped and the '<' included
+	return string(begin + 1, tag + 1);
 }
 
 //---------------------------------------------------------------
 
 TIStream &TIStream::operator>>(TPixel32 &v)
 {
-	istream &is = *(m_imp->m_is);
-	int r, g, b, m;
-	is >> r;
-	is >> g;
-	is >> b;
-	is >> m;
+	int r = 0, g = 0, b = 0, m = 0;
+	m_imp->readInt(r);
+	m_imp->readInt(g);
+	m_imp->readInt(b);
+	m_imp->readInt(m);
 	v.r = r;
 	v.g = g;
 	v.b = b;
@@ -1157,12 +1965,11 @@ TIStream &TIStream::operator>>(TPixel32 &v)
 
 TIStream &TIStream::operator>>(TPixel64 &v)
 {
-	istream &is = *(m_imp->m_is);
-	int r, g, b, m;
-	is >> r;
-	is >> g;
-	is >> b;
-	is >> m;
+	int r = 0, g = 0, b = 0, m = 0;
+	m_imp->readInt(r);
+	m_imp->readInt(g);
+	m_imp->readInt(b);
+	m_imp->readInt(m);
 	v.r = r;
 	v.g = g;
 	v.b = b;
@@ -1174,30 +1981,34 @@ TIStream &TIStream::operator>>(TPixel64 &v)
 
 TIStream &TIStream::operator>>(TFilePath &v)
 {
-	istream &is = *(m_imp->m_is);
 	string s;
+	if (m_imp->m_binary) {
+		m_imp->readString(s);
+		v = TFilePath(s);
+		return *this;
+	}
+
 	char c;
 	m_imp->skipBlanks();
-	is.get(c);
+	if (!m_imp->get(c)) {
+		v = TFilePath();
+		return *this;
+	}
+
+	const char *begin = m_imp->m_pos;
 	if (c == '"') {
-		is.get(c);
-		while (is && c != '"') {
-			//if(c=='\\')
-			//   is.get(c);
-			s.append(1, c);
-			is.get(c);
-		}
+		while (m_imp->m_pos < m_imp->m_end && *m_imp->m_pos != '"')
+			++m_imp->m_pos;
+		s.assign(begin, m_imp->m_pos);
+		m_imp->get(c); // the closing '"'
 	} else {
 		// il filepath non e' fra virgolette:
 		// puo' contenere solo caratteri alfanumerici, % e _
-		s.append(1, c);
-		while (is) {
-			c = is.peek();
-			if (!isalnum(c) && c != '%' && c != '_')
-				break;
-			is.get(c);
-			s.append(1, c);
-		}
+		--begin;
+		int next;
+		while (next = m_imp->peek(), isalnum(next) || next == '%' || next == '_')
+			++m_imp->m_pos;
+		s.assign(begin, m_imp->m_pos);
 	}
 
 	v = TFilePath(s);
@@ -1279,7 +2090,7 @@ bool TIStream::eos()
 	if (m_imp->matchTag())
 		return m_imp->m_currentTag.m_type == StreamTag::EndTag;
 	else
-		return !(*m_imp->m_is);
+		return m_imp->m_fail;
 }
 
 //---------------------------------------------------------------
@@ -1376,10 +2187,13 @@ void TIStream::closeChild()
 
 bool TIStream::match(char c) const
 {
+	if (m_imp->m_binary)
+		return false;
+
 	m_imp->skipBlanks();
-	if (m_imp->m_is->peek() != c)
+	if (m_imp->peek() != (unsigned char)c)
 		return false;
-	m_imp->m_is->get(c);
+	m_imp->get(c);
 	if (c == '\r')
 		m_imp->m_line++;
 	return true;
@@ -1389,7 +2203,7 @@ bool TIStream::match(char c) const
 
 TIStream::operator bool() const
 {
-	return (m_imp->m_is && *m_imp->m_is);
+	return !m_imp->m_fail;
 }
 
 //---------------------------------------------------------------
@@ -201,15 +201,29 @@ TUnit *TMeasure::getUnit(wstring ext) const
 
 //-------------------------------------------------------------------
 
+namespace
+{
+int l_currentUnitsRevision = 0;
+}
+
 void TMeasure::setCurrentUnit(TUnit *unit)
 {
 	assert(unit);
 	assert(m_extensions.count(unit->getDefaultExtension()) > 0);
+	if (m_currentUnit != unit)
+		++l_currentUnitsRevision;
 	m_currentUnit = unit;
 }
 
 //-------------------------------------------------------------------
 
+int TMeasure::getCurrentUnitsRevision()
+{
+	return l_currentUnitsRevision;
+}
+
+//-------------------------------------------------------------------
+
 void TMeasure::setStandardUnit(TUnit *unit)
 {
 	assert(unit);
@@ -0,0 +1,165 @@
+
+
+#include "tboxindex.h"
+
+#include <algorithm>
+#include <cmath>
+
+//=============================================================================
+
+namespace
+{
+
+const int c_nodeCapacity = 16;
+
+//-----------------------------------------------------------------------------
+
+template <typename Node>
+struct CenterXLess {
+	bool operator()(const Node &a, const Node &b) const
+	{
+		return a.m_box.x0 + a.m_box.x1 < b.m_box.x0 + b.m_box.x1;
+	}
+};
+
+template <typename Node>
+struct CenterYLess {
+	bool operator()(const Node &a, const Node &b) const
+	{
+		return a.m_box.y0 + a.m_box.y1 < b.m_box.y0 + b.m_box.y1;
+	}
+};
+
+//-----------------------------------------------------------------------------
+
+//! Sorts the specified nodes in Sort-Tile-Recursive order, and packs them into
+//! the returned parent nodes.
+template <typename Node>
+void packLevel(std::vector<Node> &nodes, std::vector<Node> &parents)
+{
+	int count = nodes.size();
+	int parentsCount = (count + c_nodeCapacity - 1) / c_nodeCapacity;
+	int slicesCount = (int)ceil(sqrt((double)parentsCount));
+	int sliceSize = slicesCount * c_nodeCapacity;
+
+	std::sort(nodes.begin(), nodes.end(), CenterXLess<Node>());
+
+	int s, n, nEnd;
+	for (s = 0; s < count; s += sliceSize) {
+		int sEnd = tmin(s + sliceSize, count);
+		std::sort(nodes.begin() + s, nodes.begin() + sEnd, CenterYLess<Node>());
+
+		for (n = s; n < sEnd; n = nEnd) {
+			nEnd = tmin(n + c_nodeCapacity, sEnd);
+
+			Node parent = {nodes[n].m_box, n, nEnd - n};
+			for (int c = n + 1; c < nEnd; ++c)
+				parent.m_box += nodes[c].m_box;
+
+			parents.push_back(parent);
+		}
+	}
+}
+
+} // namespace
+
+//=============================================================================
+
+void TBoxIndex::build(const std::vector<TRectD> &boxes)
+{
+	clear();
+
+	m_boxes = boxes;
+	if (m_boxes.empty())
+		return;
+
+	m_levels.push_back(std::vector<Node>());
+
+	std::vector<Node> &leaves = m_levels.back();
+	leaves.reserve(m_boxes.size());
+
+	for (int i = 0; i != (int)m_boxes.size(); ++i) {
+		Node leaf = {m_boxes[i], i, 0};
+		leaves.push_back(leaf);
+	}
+
+	// Children are reordered while packing their parents, which is fine since
+	// the grandchildren ranges are stored in the children themselves
+	while (m_levels.back().size() > 1) {
+		m_levels.push_back(std::vector<Node>());
+		packLevel(m_levels[m_levels.size() - 2], m_levels.back());
+	}
+}
+
+//-----------------------------------------------------------------------------
+
+void TBoxIndex::clear()
+{
+	m_boxes.clear();
+	m_levels.clear();
+}
+
+//-----------------------------------------------------------------------------
+
+void TBoxIndex::getBoxesAt(const TPointD &p, std::vector<int> &indices) const
+{
+	indices.clear();
+	if (m_levels.empty())
+		return;
+
+	std::vector<std::pair<int, int>> stack; // (level, node)
+
+	int n, top = m_levels.size() - 1;
+	for (n = 0; n != (int)m_levels[top].size(); ++n)
+		stack.push_back(std::make_pair(top, n));
+
+	while (!stack.empty()) {
+		std::pair<int, int> entry = stack.back();
+		stack.pop_back();
+
+		const Node &node = m_levels[entry.first][entry.second];
+		if (!node.m_box.contains(p))
+			continue;
+
+		if (entry.first == 0)
+			indices.push_back(node.m_first);
+		else {
+			for (n = node.m_first; n != node.m_first + node.m_count; ++n)
+				stack.push_back(std::make_pair(entry.first - 1, n));
+		}
+	}
+
+	std::sort(indices.begin(), indices.end());
+}
+
+//-----------------------------------------------------------------------------
+
+void TBoxIndex::getBoxesIn(const TRectD &rect, std::vector<int> &indices) const
+{
+	indices.clear();
+	if (m_levels.empty())
+		return;
+
+	std::vector<std::pair<int, int>> stack; // (level, node)
+
+	int n, top = m_levels.size() - 1;
+	for (n = 0; n != (int)m_levels[top].size(); ++n)
+		stack.push_back(std::make_pair(top, n));
+
+	while (!stack.empty()) {
+		std::pair<int, int> entry = stack.back();
+		stack.pop_back();
+
+		const Node &node = m_levels[entry.first][entry.second];
+
+		if (entry.first == 0) {
+			if (rect.contains(node.m_box))
+				indices.push_back(node.m_first);
+		} else if (rect.overlaps(node.m_box)) {
+			for (n = node.m_first; n != node.m_first + node.m_count; ++n)
+				stack.push_back(std::make_pair(entry.first - 1, n));
+		}
+	}
+
+	std::sort(indices.begin(), indices.end());
+}
@@ -0,0 +1,118 @@
+
+
+#ifndef T_BOXINDEX_H
+#define T_BOXINDEX_H
+
+#include "tgeometry.h"
+
+#include <vector>
+#include <queue>
+#include <limits>
+
+//=============================================================================
+
+/*!
+  The TBoxIndex class is a static R-tree over an indexed set of boxes, used
+  to speed up point-based lookups (hit tests, nearest object searches) in
+  images with many strokes or regions.
+
+  The tree is bulk-loaded with the Sort-Tile-Recursive method; it is not meant
+  to be edited - callers should rather rebuild it whenever getBox() no longer
+  matches the indexed objects.
+*/
+class TBoxIndex
+{
+	struct Node {
+		TRectD m_box;
+		int m_first, m_count; //!< Children range in the lower level (on level 0,
+							  //!< m_first is the box index and m_count is 0)
+	};
+
+	std::vector<TRectD> m_boxes;
+	std::vector<std::vector<Node>> m_levels; //!< m_levels[0] contains the boxes
+
+public:
+	TBoxIndex() {}
+
+	void build(const std::vector<TRectD> &boxes);
+	void clear();
+
+	int size() const { return m_boxes.size(); }
+	const TRectD &getBox(int i) const { return m_boxes[i]; }
+
+	//! Retrieves the indices of the boxes containing p, in increasing order.
+	void getBoxesAt(const TPointD &p, std::vector<int> &indices) const;
+
+	//! Retrieves the indices of the boxes inside rect, in increasing order.
+	void getBoxesIn(const TRectD &rect, std::vector<int> &indices) const;
+
+	//! Returns the squared distance of p from the specified box (0 if inside).
+	static double distance2(const TPointD &p, const TRectD &box)
+	{
+		double dx = tmax(box.x0 - p.x, 0.0, p.x - box.x1),
+			   dy = tmax(box.y0 - p.y, 0.0, p.y - box.y1);
+		return dx * dx + dy * dy;
+	}
+
+	/*!
+	  Visits boxes in order of increasing distance from p. The visitor is invoked
+	  as <TT>double visitor(int boxIndex)</TT> and must return the squared
+	  distance of the best object found so far - the search stops as soon as all
+	  the remaining boxes lie \a farther than that.
+	*/
+	template <typename Visitor>
+	void visitNearest(const TPointD &p, Visitor &visitor) const;
+};
+
+//=============================================================================
+
+template <typename Visitor>
+void TBoxIndex::visitNearest(const TPointD &p, Visitor &visitor) const
+{
+	if (m_levels.empty())
+		return;
+
+	struct Entry {
+		double m_dist2;
+		int m_level, m_node;
+
+		// Reversed, so that the priority queue top is the nearest entry
+		bool operator<(const Entry &other) const { return m_dist2 > other.m_dist2; }
+	};
+
+	std::priority_queue<Entry> queue;
+
+	int l, n, top = m_levels.size() - 1;
+	const std::vector<Node> &roots = m_levels[top];
+	for (n = 0; n != (int)roots.size(); ++n) {
+		Entry entry = {distance2(p, roots[n].m_box), top, n};
+		queue.push(entry);
+	}
+
+	double best2 = (std::numeric_limits<double>::max)();
+	while (!queue.empty()) {
+		Entry entry = queue.top();
+		if (entry.m_dist2 > best2)
+			break;
+
+		queue.pop();
+
+		const Node &node = m_levels[entry.m_level][entry.m_node];
+		if (entry.m_level == 0) {
+			best2 = visitor(node.m_first);
+			continue;
+		}
+
+		l = entry.m_level - 1;
+		const std::vector<Node> &children = m_levels[l];
+		for (n = node.m_first; n != node.m_first + node.m_count; ++n) {
+			double dist2 = distance2(p, children[n].m_box);
+			if (dist2 <= best2) {
+				Entry child = {dist2, l, n};
+				queue.push(child);
+			}
+		}
+	}
+}
+
+#endif // T_BOXINDEX_H
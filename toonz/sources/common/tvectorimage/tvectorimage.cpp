@@ -616,30 +616,124 @@ bool TVectorImage::getNearestStroke(
 	double &dist2,
 	bool onlyInCurrentGroup) const
 {
+	struct NearestStrokeVisitor {
+		const TVectorImage *m_this;
+		const TPointD &m_p;
+		bool m_onlyInCurrentGroup;
+
+		double &m_outW, &m_dist2;
+		UINT &m_strokeIndex;
+
+		double operator()(int i)
+		{
+			if (m_onlyInCurrentGroup && !m_this->inCurrentGroup(i))
+				return m_dist2;
+
+			TStroke *s = m_this->m_imp->m_strokes[i]->m_s;
+			double tempPar = s->getW(m_p);
+			double tempdis2 = tdistance2(TThickPoint(m_p, 0), s->getThickPoint(tempPar));
+
+			// Ties are resolved in stroke order, as strokes are visited by distance
+			if (tempdis2 < m_dist2 || (tempdis2 == m_dist2 && i < (int)m_strokeIndex)) {
+				m_outW = tempPar;
+				m_dist2 = tempdis2;
+				m_strokeIndex = i;
+			}
+
+			return m_dist2;
+		}
+	} visitor = {this, p, onlyInCurrentGroup, outW, dist2, strokeIndex};
+
 	dist2 = (std::numeric_limits<double>::max)();
 	strokeIndex = getStrokeCount();
 	outW = -1;
 
-	double
-		tempdis2,
-		tempPar;
+	// The strokes' bboxes contain their centerlines, and thus bound the distance from below
+	QMutexLocker sl(m_imp->m_mutex);
 
-	for (int i = 0; i < (int)m_imp->m_strokes.size(); ++i) {
-		if (onlyInCurrentGroup && !inCurrentGroup(i))
-			continue;
-		TStroke *s = m_imp->m_strokes[i]->m_s;
-		tempPar = s->getW(p);
+	m_imp->updateStrokeIndex();
+	m_imp->m_strokeIndex.visitNearest(p, visitor);
+
+	return dist2 < (std::numeric_limits<double>::max)();
+}
 
-		tempdis2 = tdistance2(TThickPoint(p, 0), s->getThickPoint(tempPar));
+//-----------------------------------------------------------------------------
 
-		if (tempdis2 < dist2) {
-			outW = tempPar;
-			dist2 = tempdis2;
-			strokeIndex = i;
-		}
+void TVectorImage::Imp::updateStrokeIndex()
+{
+	int i, count = m_strokes.size();
+
+	bool valid = (m_strokeIndex.size() == count);
+	for (i = 0; valid && i < count; ++i)
+		valid = (m_strokes[i]->m_s->getBBox() == m_strokeIndex.getBox(i));
+
+	if (!valid) {
+		std::vector<TRectD> boxes(count);
+		for (i = 0; i < count; ++i)
+			boxes[i] = m_strokes[i]->m_s->getBBox();
+
+		m_strokeIndex.build(boxes);
 	}
+}
 
-	return dist2 < (std::numeric_limits<double>::max)();
+//-----------------------------------------------------------------------------
+
+void TVectorImage::Imp::updateRegionIndex()
+{
+	int i, count = m_regions.size();
+
+	bool valid = (m_regionIndex.size() == count);
+	for (i = 0; valid && i < count; ++i)
+		valid = (m_regions[i]->getBBox() == m_regionIndex.getBox(i));
+
+	if (!valid) {
+		std::vector<TRectD> boxes(count);
+		for (i = 0; i < count; ++i)
+			boxes[i] = m_regions[i]->getBBox();
+
+		m_regionIndex.build(boxes);
+	}
+}
+
+//-----------------------------------------------------------------------------
+
+void TVectorImage::Imp::updateRegionTree()
+{
+	struct locals {
+		static void addRegion(TRegion *r, int root, vector<TRegion *> &tree, vector<int> &roots)
+		{
+			tree.push_back(r);
+			roots.push_back(root);
+
+			for (UINT i = 0; i < r->getSubregionCount(); i++)
+				addRegion(r->getSubregion(i), root, tree, roots);
+		}
+	};
+
+	vector<TRegion *> tree;
+	vector<int> roots;
+	tree.reserve(m_regionTree.size());
+	roots.reserve(m_regionTree.size());
+
+	int i, count = m_regions.size();
+	for (i = 0; i < count; ++i)
+		locals::addRegion(m_regions[i], i, tree, roots);
+
+	count = tree.size();
+
+	bool valid = (tree == m_regionTree && roots == m_regionTreeRoots);
+	for (i = 0; valid && i < count; ++i)
+		valid = (tree[i]->getBBox() == m_regionTreeIndex.getBox(i));
+
+	if (!valid) {
+		std::vector<TRectD> boxes(count);
+		for (i = 0; i < count; ++i)
+			boxes[i] = tree[i]->getBBox();
+
+		m_regionTree.swap(tree);
+		m_regionTreeRoots.swap(roots);
+		m_regionTreeIndex.build(boxes);
+	}
 }
 
 //-----------------------------------------------------------------------------
@@ -692,11 +786,27 @@ TRegion *TVectorImage::getRegion(const TPointD &p)
 TRegion *TVectorImage::Imp::getRegion(const TPointD &p)
 {
 	int strokeIndex = (int)m_strokes.size() - 1;
+	if (strokeIndex < 0)
+		return 0;
+
+	// Only regions whose bbox contains p are tested, in index order
+	std::vector<int> regionIndices;
+	{
+		QMutexLocker sl(m_mutex);
+
+		updateRegionIndex();
+		m_regionIndex.getBoxesAt(p, regionIndices);
+	}
+
+	if (regionIndices.empty())
+		return 0;
 
 	while (strokeIndex >= 0) {
-		for (UINT regionIndex = 0; regionIndex < m_regions.size(); regionIndex++)
+		for (UINT r = 0; r < regionIndices.size(); r++) {
+			int regionIndex = regionIndices[r];
 			if (areDifferentGroup(strokeIndex, false, regionIndex, true) == -1 && m_regions[regionIndex]->contains(p))
 				return m_regions[regionIndex]->getRegion(p);
+		}
 		int curr = strokeIndex;
 		while (strokeIndex >= 0 && areDifferentGroup(curr, false, strokeIndex, false) == -1)
 			strokeIndex--;
@@ -826,11 +936,27 @@ bool TVectorImage::Imp::selectFill(const TRectD &selArea, TStroke *s, int newSty
 		TVectorImage aux;
 		aux.addStroke(s);
 		aux.findRegions();
+
+		// Only regions and strokes whose bbox lies inside r0's are tested
+		std::vector<int> regionIndices, strokeIndices;
 		for (UINT j = 0; j < aux.getRegionCount(); j++) {
 			TRegion *r0 = aux.getRegion(j);
+			{
+				QMutexLocker sl(m_mutex);
+
+				if (fillAreas) {
+					updateRegionIndex();
+					m_regionIndex.getBoxesIn(r0->getBBox(), regionIndices);
+				}
+				if (fillLines) {
+					updateStrokeIndex();
+					m_strokeIndex.getBoxesIn(r0->getBBox(), strokeIndices);
+				}
+			}
+
 			if (fillAreas)
-				for (UINT i = 0; i < m_regions.size(); i++) {
-					TRegion *r1 = m_regions[i];
+				for (UINT i = 0; i < regionIndices.size(); i++) {
+					TRegion *r1 = m_regions[regionIndices[i]];
 
 					if (m_insideGroup != TGroupId() && !m_insideGroup.isParentOf(m_strokes[r1->getEdge(0)->m_index]->m_groupId))
 						continue;
@@ -842,11 +968,11 @@ bool TVectorImage::Imp::selectFill(const TRectD &selArea, TStroke *s, int newSty
 					}
 				}
 			if (fillLines)
-				for (UINT i = 0; i < m_strokes.size(); i++) {
-					if (!inCurrentGroup(i))
+				for (UINT i = 0; i < strokeIndices.size(); i++) {
+					if (!inCurrentGroup(strokeIndices[i]))
 						continue;
 
-					TStroke *s1 = m_strokes[i]->m_s;
+					TStroke *s1 = m_strokes[strokeIndices[i]]->m_s;
 					if ((!onlyUnfilled || s1->getStyle() == 0) &&
 						r0->contains(*s1)) {
 						s1->setStyle(newStyleId);
@@ -862,7 +988,26 @@ bool TVectorImage::Imp::selectFill(const TRectD &selArea, TStroke *s, int newSty
 
 	if (fillAreas)
 #ifndef NEW_REGION_FILL
-		for (UINT i = 0; i < m_regions.size(); i++) {
+	{
+		// Subregions are filled along with their top-level region: whether it
+		// can be filled is decided before changing any style
+		std::vector<int> regionIndices;
+		{
+			QMutexLocker sl(m_mutex);
+
+			updateRegionTree();
+			m_regionTreeIndex.getBoxesIn(selArea, regionIndices);
+		}
+
+		enum { UNKNOWN = -1, SKIPPED, FILLABLE };
+		std::vector<int> rootsStatus(m_regions.size(), UNKNOWN);
+
+		UINT r;
+		for (r = 0; r < regionIndices.size(); r++) {
+			int i = m_regionTreeRoots[regionIndices[r]];
+			if (rootsStatus[i] != UNKNOWN)
+				continue;
+
 			int index, j = 0;
 
 			do
@@ -870,10 +1015,18 @@ bool TVectorImage::Imp::selectFill(const TRectD &selArea, TStroke *s, int newSty
 			while (index < 0 && j < (int)m_regions[i]->getEdgeCount());
 			//if index<0, means that the region is purely of autoclose strokes!
 			if (m_insideGroup != TGroupId() && index >= 0 && !m_insideGroup.isParentOf(m_strokes[index]->m_groupId))
-				continue;
-			if (!onlyUnfilled || m_regions[i]->getStyle() == 0)
-				hitSome |= m_regions[i]->selectFill(selArea, newStyleId);
+				rootsStatus[i] = SKIPPED;
+			else
+				rootsStatus[i] = (!onlyUnfilled || m_regions[i]->getStyle() == 0) ? FILLABLE : SKIPPED;
 		}
+
+		for (r = 0; r < regionIndices.size(); r++) {
+			if (rootsStatus[m_regionTreeRoots[regionIndices[r]]] == FILLABLE) {
+				m_regionTree[regionIndices[r]]->setStyle(newStyleId);
+				hitSome = true;
+			}
+		}
+	}
 #else
 
 		findRegions(selArea);
@@ -886,18 +1039,29 @@ bool TVectorImage::Imp::selectFill(const TRectD &selArea, TStroke *s, int newSty
 	}
 #endif
 
-	if (fillLines)
-		for (UINT i = 0; i < m_strokes.size(); i++) {
+	if (fillLines) {
+		std::vector<int> strokeIndices;
+		{
+			QMutexLocker sl(m_mutex);
+
+			updateStrokeIndex();
+			m_strokeIndex.getBoxesIn(selArea, strokeIndices);
+		}
+
+		for (UINT k = 0; k < strokeIndices.size(); k++) {
+			int i = strokeIndices[k];
 			if (!inCurrentGroup(i))
 				continue;
 
 			TStroke *s = m_strokes[i]->m_s;
 
-			if ((!onlyUnfilled || s->getStyle() == 0) && selArea.contains(s->getBBox())) {
+			if (!onlyUnfilled || s->getStyle() == 0) {
 				s->setStyle(newStyleId);
 				hitSome = true;
 			}
 		}
+	}
+
 	return hitSome;
 }
 
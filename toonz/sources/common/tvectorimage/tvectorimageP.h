@@ -7,6 +7,7 @@
 #include "tvectorimage.h"
 #include "tregion.h"
 #include "tcurves.h"
+#include "tboxindex.h"
 using namespace std;
 
 //-----------------------------------------------------------------------------
@@ -143,6 +144,19 @@ public:
 	IntersectionData *m_intersectionData;
 	vector<TRegion *> m_regions;
 	TThread::Mutex *m_mutex;
+
+	//! Spatial indices of strokes and regions bboxes. They are built lazily, and
+	//! rebuilt on lookup whenever any indexed bbox changed.
+	TBoxIndex m_strokeIndex, m_regionIndex;
+
+	//! Containment tree of the regions, flattened in depth-first order: every
+	//! region is followed by its subregions, and m_regionTreeRoots[i] is the
+	//! m_regions index of the top-level region including m_regionTree[i].
+	//! Updated along with its own bboxes index, like the ones above.
+	vector<TRegion *> m_regionTree;
+	vector<int> m_regionTreeRoots;
+	TBoxIndex m_regionTreeIndex;
+
 	Imp(TVectorImage *vi);
 	~Imp();
 
@@ -151,6 +165,10 @@ public:
 
 	TRegion *getRegion(const TPointD &p);
 
+	void updateStrokeIndex();
+	void updateRegionIndex();
+	void updateRegionTree();
+
 	int fill(const TPointD &p, int styleId);
 	bool selectFill(const TRectD &selectArea, TStroke *s, int styleId, bool onlyUnfilled, bool fillAreas, bool fillLines);
 
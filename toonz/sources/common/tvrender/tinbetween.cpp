@@ -13,6 +13,11 @@
 #include <limits>
 #include <list>
 
+#include <QThread>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QWaitCondition>
+
 #include "../tvectorimage/tvectorimageP.h"
 
 //#include "tdebugmessage.h"
@@ -687,6 +692,7 @@ public:
 	std::vector<StrokeTransform> m_transformation;
 
 	void computeTransformation();
+	void prepareStrokes(const TVectorImageP &image) const;
 
 	void transferColor(const TVectorImageP &destination) const;
 
@@ -696,6 +702,10 @@ public:
 		: m_firstImage(firstImage), m_lastImage(lastImage)
 	{
 		computeTransformation();
+
+		// tween() only reads from the source images afterwards, allowing concurrent calls
+		prepareStrokes(m_firstImage);
+		prepareStrokes(m_lastImage);
 	}
 };
 //-------------------------------------------------------------------
@@ -1341,6 +1351,19 @@ void TInbetween::Imp::computeTransformation()
 
 //-------------------------------------------------------------------
 
+void TInbetween::Imp::prepareStrokes(const TVectorImageP &image) const
+{
+	// Strokes evaluate their length and bbox caches lazily - build them now
+	UINT i, strokeCount = image->getStrokeCount();
+	for (i = 0; i < strokeCount; i++) {
+		const TStroke *stroke = image->getStroke(i);
+		stroke->getLength();
+		stroke->getBBox();
+	}
+}
+
+//-------------------------------------------------------------------
+
 TVectorImageP TInbetween::Imp::tween(double t) const
 {
 	const double step = 5.0;
@@ -1515,3 +1538,108 @@ TVectorImageP TInbetween::tween(double t) const
 }
 
 //-------------------------------------------------------------------
+
+namespace
+{
+
+struct TweenBatch {
+	const TInbetween *m_inbetween;
+	const std::vector<double> &m_ts;
+	std::vector<TVectorImageP> &m_images;
+
+	QMutex m_mutex;
+	QWaitCondition m_frameDone;
+	int m_next, m_done;
+	bool m_canceled;
+
+	TweenBatch(const TInbetween *inbetween, const std::vector<double> &ts,
+			   std::vector<TVectorImageP> &images)
+		: m_inbetween(inbetween), m_ts(ts), m_images(images), m_next(0), m_done(0), m_canceled(false)
+	{
+	}
+
+	//! Returns the index of the next frame to be built, or -1 if none remains.
+	int takeFrame()
+	{
+		QMutexLocker locker(&m_mutex);
+		return (m_canceled || m_next >= (int)m_ts.size()) ? -1 : m_next++;
+	}
+
+	void storeFrame(int i, const TVectorImageP &vi)
+	{
+		QMutexLocker locker(&m_mutex);
+		m_images[i] = vi;
+		++m_done;
+		m_frameDone.wakeAll();
+	}
+
+	void cancel()
+	{
+		QMutexLocker locker(&m_mutex);
+		m_canceled = true;
+	}
+};
+
+//-------------------------------------------------------------------
+
+class TweenWorker : public QThread
+{
+	TweenBatch &m_batch;
+
+public:
+	TweenWorker(TweenBatch &batch) : m_batch(batch) {}
+
+	void run()
+	{
+		int i;
+		while ((i = m_batch.takeFrame()) >= 0)
+			m_batch.storeFrame(i, m_batch.m_inbetween->tween(m_batch.m_ts[i]));
+	}
+};
+
+} // namespace
+
+//-------------------------------------------------------------------
+
+void TInbetween::tween(const std::vector<double> &ts, std::vector<TVectorImageP> &images,
+					   Listener *listener) const
+{
+	int count = ts.size();
+	images.assign(count, TVectorImageP());
+	if (count == 0)
+		return;
+
+	TweenBatch batch(this, ts, images);
+
+	int w, workersCount = tmax(1, tmin(QThread::idealThreadCount(), count));
+	std::vector<TweenWorker *> workers(workersCount);
+	for (w = 0; w < workersCount; ++w) {
+		workers[w] = new TweenWorker(batch);
+		workers[w]->start();
+	}
+
+	if (listener) {
+		// Wake up at least every 100 msecs, so the listener may keep the event loop alive
+		int done = 0;
+		while (done < count) {
+			{
+				QMutexLocker locker(&batch.m_mutex);
+				if (batch.m_done == done)
+					batch.m_frameDone.wait(&batch.m_mutex, 100);
+				done = batch.m_done;
+			}
+
+			if (!listener->onProgress(done, count)) {
+				batch.cancel();
+				break;
+			}
+		}
+	}
+
+	for (w = 0; w < workersCount; ++w) {
+		workers[w]->wait();
+		delete workers[w];
+	}
+}
+
+//-------------------------------------------------------------------
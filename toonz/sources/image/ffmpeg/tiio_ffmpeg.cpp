@@ -0,0 +1,374 @@
+
+
+#include "tiio_ffmpeg.h"
+
+// TnzCore includes
+#include "trasterimage.h"
+#include "tsound.h"
+#include "tsystem.h"
+
+// Qt includes
+#include <QStandardPaths>
+#include <QStringList>
+
+#ifndef WIN32
+#include <errno.h>
+#include <pthread.h>
+#include <signal.h>
+#endif
+
+//******************************************************************************
+//    Local namespace
+//******************************************************************************
+
+namespace
+{
+
+QString ffmpegPath()
+{
+	static QString path = QStandardPaths::findExecutable("ffmpeg");
+	return path;
+}
+
+//------------------------------------------------------------------
+
+//! Quotes the specified argument for the shell launching the encoder.
+QString quoted(const QString &arg)
+{
+#ifdef WIN32
+	return "\"" + arg + "\"";
+#else
+	QString escaped(arg);
+	return "'" + escaped.replace("'", "'\\''") + "'";
+#endif
+}
+
+//------------------------------------------------------------------
+
+//! Returns ffmpeg's name of the TPixel32 memory layout.
+const char *rawPixelFormat()
+{
+#if defined(TNZ_MACHINE_CHANNEL_ORDER_BGRM)
+	return "bgra";
+#elif defined(TNZ_MACHINE_CHANNEL_ORDER_MBGR)
+	return "abgr";
+#elif defined(TNZ_MACHINE_CHANNEL_ORDER_RGBM)
+	return "rgba";
+#else
+	return "argb";
+#endif
+}
+
+//------------------------------------------------------------------
+
+#ifndef WIN32
+
+//! Blocks SIGPIPE in the calling thread while alive, so that writes to a dead
+//! encoder fail with EPIPE instead of terminating the process. A SIGPIPE raised
+//! in the meantime is consumed before unblocking.
+class SigPipeBlocker
+{
+	sigset_t m_set, m_oldSet;
+	bool m_wasPending;
+
+public:
+	SigPipeBlocker()
+	{
+		sigemptyset(&m_set);
+		sigaddset(&m_set, SIGPIPE);
+
+		sigset_t pending;
+		sigpending(&pending);
+		m_wasPending = sigismember(&pending, SIGPIPE);
+
+		pthread_sigmask(SIG_BLOCK, &m_set, &m_oldSet);
+	}
+
+	~SigPipeBlocker()
+	{
+		sigset_t pending;
+		sigpending(&pending);
+		if (!m_wasPending && sigismember(&pending, SIGPIPE)) {
+			int sig;
+			sigwait(&m_set, &sig);
+		}
+
+		pthread_sigmask(SIG_SETMASK, &m_oldSet, 0);
+	}
+};
+
+#endif
+
+} // namespace
+
+//------------------------------------------------------------------
+
+bool IsFfmpegInstalled()
+{
+	return !ffmpegPath().isEmpty();
+}
+
+//******************************************************************************
+//    TImageWriterFfmpeg  implementation
+//******************************************************************************
+
+class TImageWriterFfmpeg : public TImageWriter
+{
+	TLevelWriterFfmpeg *m_lw;
+	int m_frameIndex;
+
+public:
+	TImageWriterFfmpeg(const TFilePath &fp, int frameIndex, TLevelWriterFfmpeg *lw)
+		: TImageWriter(fp), m_lw(lw), m_frameIndex(frameIndex) { m_lw->addRef(); }
+	~TImageWriterFfmpeg() { m_lw->release(); }
+
+	bool is64bitOutputSupported() { return false; }
+	void save(const TImageP &img) { m_lw->save(img, m_frameIndex); }
+
+private:
+	//not implemented
+	TImageWriterFfmpeg(const TImageWriterFfmpeg &);
+	TImageWriterFfmpeg &operator=(const TImageWriterFfmpeg &src);
+};
+
+//******************************************************************************
+//    TLevelWriterFfmpeg  implementation
+//******************************************************************************
+
+TLevelWriterFfmpeg::TLevelWriterFfmpeg(const TFilePath &path, TPropertyGroup *winfo)
+	: TLevelWriter(path, winfo), m_pipe(0), m_lx(0), m_ly(0), m_lastFrameIndex(-1), m_audioRate(0), m_audioChannels(0)
+{
+	m_frameRate = 24.;
+
+	if (!IsFfmpegInstalled())
+		throw TImageException(m_path, "ffmpeg was not found");
+
+	if (!m_properties)
+		m_properties = new Tiio::FfmpegWriterProperties();
+
+	if (TSystem::doesExistFileOrLevel(m_path))
+		TSystem::deleteFile(m_path);
+}
+
+//------------------------------------------------------------------
+
+TLevelWriterFfmpeg::~TLevelWriterFfmpeg()
+{
+	if (m_pipe) {
+// Closing the pipe ends the input stream, and waits for ffmpeg to finalize the file
+#ifdef WIN32
+		_pclose(m_pipe);
+#else
+		SigPipeBlocker blocker; // Flushing may write to a dead encoder
+		pclose(m_pipe);
+#endif
+	}
+}
+
+//------------------------------------------------------------------
+
+TImageWriterP TLevelWriterFfmpeg::getFrameWriter(TFrameId fid)
+{
+	if (fid.getLetter() != 0)
+		return TImageWriterP(0);
+
+	int index = fid.getNumber() - 1;
+	return new TImageWriterFfmpeg(m_path, index, this);
+}
+
+//------------------------------------------------------------------
+
+void TLevelWriterFfmpeg::saveSoundTrack(TSoundTrack *st)
+{
+	if (!st)
+		return;
+
+	QMutexLocker sl(&m_mutex);
+
+	if (m_pipe)
+		throw TImageException(m_path, "The soundtrack must be saved before the frames");
+
+	switch (st->getBitPerSample()) {
+	case 8:
+		m_audioFormat = st->getFormat().m_signedSample ? "s8" : "u8";
+		break;
+	case 16:
+#if TNZ_LITTLE_ENDIAN
+		m_audioFormat = "s16le";
+#else
+		m_audioFormat = "s16be";
+#endif
+		break;
+	case 24:
+		m_audioFormat = "s24le";
+		break;
+	default:
+		throw TImageException(m_path, "Unsupported soundtrack format");
+	}
+
+	m_audioRate = st->getSampleRate();
+	m_audioChannels = st->getChannelCount();
+
+	QByteArray data;
+	if (st->getBitPerSample() == 24) {
+		// 24-bit samples are stored in 32-bit integers - pack them in 3 bytes
+		const TINT32 *values = (const TINT32 *)st->getRawData();
+		int count = st->getSampleCount() * st->getChannelCount();
+
+		data.resize(3 * count);
+		char *out = data.data();
+		for (int i = 0; i < count; ++i, out += 3) {
+			TINT32 value = values[i];
+			out[0] = (char)(value & 0xff);
+			out[1] = (char)((value >> 8) & 0xff);
+			out[2] = (char)((value >> 16) & 0xff);
+		}
+	} else
+		data = QByteArray::fromRawData((const char *)st->getRawData(), st->getSampleSize() * st->getSampleCount());
+
+	if (!m_audioFile.open() || m_audioFile.write(data) != data.size())
+		throw TImageException(m_path, "Can't write the soundtrack");
+
+	m_audioFile.close();
+}
+
+//------------------------------------------------------------------
+
+void TLevelWriterFfmpeg::startEncoder(int lx, int ly)
+{
+	Tiio::FfmpegWriterProperties *prop = (Tiio::FfmpegWriterProperties *)m_properties;
+	int quality = prop->m_quality.getValue();
+
+	QStringList args;
+	args << quoted(ffmpegPath()) << "-y"
+		 << "-loglevel"
+		 << "error"
+		 << "-f"
+		 << "rawvideo"
+		 << "-pix_fmt" << rawPixelFormat()
+		 << "-s" << QString("%1x%2").arg(lx).arg(ly)
+		 << "-r" << QString::number(m_frameRate)
+		 << "-i"
+		 << "pipe:0";
+
+	bool hasAudio = !m_audioFormat.isEmpty();
+	if (hasAudio)
+		args << "-f" << m_audioFormat
+			 << "-ar" << QString::number(m_audioRate)
+			 << "-ac" << QString::number(m_audioChannels)
+			 << "-i" << quoted(m_audioFile.fileName());
+
+	// Toonz rasters are stored bottom-up
+	if (prop->m_codec.getValue() == L"H.264")
+		args << "-vf" << quoted("vflip,pad=ceil(iw/2)*2:ceil(ih/2)*2") // yuv420p requires even sizes
+			 << "-c:v"
+			 << "libx264"
+			 << "-pix_fmt"
+			 << "yuv420p"
+			 << "-crf" << QString::number((51 * (100 - quality)) / 100);
+	else
+		args << "-vf"
+			 << "vflip"
+			 << "-c:v"
+			 << "mpeg4"
+			 << "-q:v" << QString::number(1 + (30 * (100 - quality)) / 100);
+
+	if (hasAudio)
+		args << "-c:a"
+			 << "aac";
+
+	args << quoted(QString::fromStdWString(m_path.getWideString()));
+
+	QByteArray command = args.join(" ").toLocal8Bit();
+
+#ifdef WIN32
+	// cmd.exe strips the outermost quotes of the command line
+	command = "\"" + command + "\"";
+	m_pipe = _popen(command.constData(), "wb");
+#else
+	m_pipe = popen(command.constData(), "w");
+#endif
+	if (!m_pipe)
+		throw TImageException(m_path, "Can't start ffmpeg");
+
+	m_lx = lx, m_ly = ly;
+}
+
+//------------------------------------------------------------------
+
+void TLevelWriterFfmpeg::writeFrame(const TRasterP &ras)
+{
+	// The raster's buffer is written to the pipe directly, with no intermediate copies
+#ifndef WIN32
+	SigPipeBlocker blocker;
+#endif
+	ras->lock();
+
+	int rowSize = m_lx * ras->getPixelSize();
+	bool ok = true;
+	if (ras->getWrap() == m_lx)
+		ok = fwrite(ras->getRawData(), rowSize * m_ly, 1, m_pipe) == 1;
+	else {
+		for (int y = 0; ok && y < m_ly; ++y)
+			ok = fwrite(ras->getRawData(0, y), rowSize, 1, m_pipe) == 1;
+	}
+
+	ras->unlock();
+
+	if (!ok) {
+#ifndef WIN32
+		if (errno == EPIPE)
+			throw TImageException(m_path, "ffmpeg terminated unexpectedly");
+#endif
+		throw TImageException(m_path, "Can't write to ffmpeg");
+	}
+}
+
+//------------------------------------------------------------------
+
+void TLevelWriterFfmpeg::save(const TImageP &img, int frameIndex)
+{
+	TRasterImageP ri(img);
+	if (!ri)
+		throw TImageException(m_path, "Unsupported image type");
+
+	TRaster32P ras(ri->getRaster());
+	if (!ras)
+		throw TImageException(m_path, "Unsupported pixel type");
+
+	QMutexLocker sl(&m_mutex);
+
+	if (!m_pipe)
+		startEncoder(ras->getLx(), ras->getLy());
+	else if (ras->getLx() != m_lx || ras->getLy() != m_ly)
+		throw TImageException(m_path, "Frames must have the same size");
+
+	if (frameIndex <= m_lastFrameIndex)
+		throw TImageException(m_path, "Frames must be saved in increasing order");
+
+	// Fill holes with the previous frame
+	if (m_lastRas) {
+		for (int f = m_lastFrameIndex + 1; f < frameIndex; ++f)
+			writeFrame(m_lastRas);
+	}
+
+	writeFrame(ras);
+
+	m_lastRas = ras;
+	m_lastFrameIndex = frameIndex;
+}
+
+//******************************************************************************
+//    Tiio::FfmpegWriterProperties  implementation
+//******************************************************************************
+
+Tiio::FfmpegWriterProperties::FfmpegWriterProperties()
+	: m_codec("Codec"), m_quality("Quality", 1, 100, 60)
+{
+	m_codec.addValue(L"H.264");
+	m_codec.addValue(L"MPEG-4");
+	m_codec.setValue(L"H.264");
+
+	bind(m_codec);
+	bind(m_quality);
+}
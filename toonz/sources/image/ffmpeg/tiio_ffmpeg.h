@@ -0,0 +1,82 @@
+
+
+#ifndef TIIO_FFMPEG_H
+#define TIIO_FFMPEG_H
+
+#include "tlevel_io.h"
+#include "tthread.h"
+
+// Qt includes
+#include <QTemporaryFile>
+
+// STD includes
+#include <stdio.h>
+
+//---------------------------------------------------------------------
+
+//! Returns whether an ffmpeg executable can be found on the PATH.
+bool IsFfmpegInstalled();
+
+//******************************************************************************
+//    TLevelWriterFfmpeg  declaration
+//******************************************************************************
+
+/*!
+  TLevelWriterFfmpeg writes movies by streaming raw frames to an external
+  ffmpeg process through a pipe to its standard input.
+
+  Rasters are written to the pipe straight from their buffers, in the machine's
+  channel order - ffmpeg takes care of the flip, color conversion and encoding.
+  The soundtrack, if any, must be supplied before the first frame: it is stored
+  to a temporary PCM file that ffmpeg reads as a second input.
+  \n\n
+  Frames must be saved in increasing order. Holes in the frames sequence are
+  filled by repeating the previous frame.
+*/
+
+class TLevelWriterFfmpeg : public TLevelWriter
+{
+	FILE *m_pipe;
+	QTemporaryFile m_audioFile;
+	TRasterP m_lastRas;
+	int m_lx, m_ly, m_lastFrameIndex;
+
+	QString m_audioFormat;
+	int m_audioRate, m_audioChannels;
+
+	TThread::Mutex m_mutex;
+
+public:
+	TLevelWriterFfmpeg(const TFilePath &path, TPropertyGroup *winfo);
+	~TLevelWriterFfmpeg();
+
+	TImageWriterP getFrameWriter(TFrameId fid);
+
+	void save(const TImageP &img, int frameIndex);
+	void saveSoundTrack(TSoundTrack *st);
+
+	static TLevelWriter *create(const TFilePath &f, TPropertyGroup *winfo)
+	{
+		return new TLevelWriterFfmpeg(f, winfo);
+	}
+
+private:
+	void startEncoder(int lx, int ly);
+	void writeFrame(const TRasterP &ras);
+};
+
+//===========================================================================
+
+namespace Tiio
+{
+class FfmpegWriterProperties : public TPropertyGroup
+{
+public:
+	FfmpegWriterProperties();
+
+	TEnumProperty m_codec;
+	TIntProperty m_quality;
+};
+}
+
+#endif //TIIO_FFMPEG_H
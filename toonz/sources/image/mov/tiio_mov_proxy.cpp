@@ -26,6 +26,37 @@
   see the related "t32libserver" project.
 */
 
+//******************************************************************************
+//    Local namespace stuff
+//******************************************************************************
+
+namespace
+{
+
+// Frames in flight per writer, and concurrent loads per reader
+const int c_writerSlotsCount = 4;
+const int c_readerSlotsCount = 2;
+
+//---------------------------------------------------------------------
+
+//! Makes the server attach the specified frame slots for the level with specified id.
+bool attachSlots(const QString &header, unsigned int id, t32bitsrv::FrameSlots *frameSlots)
+{
+	if (!frameSlots->isValid())
+		return false;
+
+	QLocalSocket socket;
+	tipc::startSlaveConnection(&socket, t32bitsrv::srvName(), -1, t32bitsrv::srvCmdline());
+
+	tipc::Stream stream(&socket);
+	tipc::Message msg;
+
+	stream << (msg << header << id << frameSlots->shMemId());
+	return (tipc::readMessage(stream, msg) == "ok");
+}
+
+} // namespace
+
 //******************************************************************************
 //    Generic stuff implementation
 //******************************************************************************
@@ -153,7 +184,7 @@ void TImageWriterMovProxy::save(const TImageP &img)
 //******************************************************************************
 
 TLevelWriterMov::TLevelWriterMov(const TFilePath &path, TPropertyGroup *winfo)
-	: TLevelWriter(path, winfo)
+	: TLevelWriter(path, winfo), m_slots(0), m_slotsFailed(false)
 {
 	static TAtomicVar count;
 	unsigned int currCount = ++count;
@@ -205,6 +236,9 @@ err:
 
 TLevelWriterMov::~TLevelWriterMov()
 {
+	//Wait for the frames in flight
+	bool ok = !m_slots || m_slots->flush();
+
 	QLocalSocket socket;
 	tipc::startSlaveConnection(&socket, t32bitsrv::srvName(), -1, t32bitsrv::srvCmdline());
 
@@ -213,15 +247,59 @@ TLevelWriterMov::~TLevelWriterMov()
 	QString res;
 
 	stream << (msg << QString("$closeLWMov") << m_id);
-	if (tipc::readMessage(stream, msg) != "ok")
+	ok = (tipc::readMessage(stream, msg) == "ok") && ok;
+
+	//The server detached the slots on close
+	delete m_slots;
+
+	if (!ok)
 		throw TException("Unable to write file");
 }
 
 //------------------------------------------------------------------
 
+/*!
+  Returns the frame slots to be used to save frames of the specified byte size, or 0
+  if frames must be passed on a temporary shared memory segment instead.
+*/
+t32bitsrv::FrameSlots *TLevelWriterMov::frameSlots(int frameSize)
+{
+	QMutexLocker locker(&m_slotsMutex);
+
+	if (!m_slots && !m_slotsFailed) {
+		//Slots are sized after the first frame - movie frames typically share their size
+		m_slots = new t32bitsrv::FrameSlots(frameSize, c_writerSlotsCount);
+		if (!attachSlots("$LWMovAttachSlots", m_id, m_slots)) {
+			delete m_slots;
+			m_slots = 0;
+			m_slotsFailed = true;
+		}
+	}
+
+	return (m_slots && frameSize <= m_slots->slotSize()) ? m_slots : 0;
+}
+
+//------------------------------------------------------------------
+
+//! Waits for the frames in flight - so that subsequent commands are processed after them.
+void TLevelWriterMov::flushSlots()
+{
+	t32bitsrv::FrameSlots *frameSlots;
+	{
+		QMutexLocker locker(&m_slotsMutex);
+		frameSlots = m_slots;
+	}
+
+	if (frameSlots && !frameSlots->flush())
+		throw TImageException(getFilePath(), "Couln't save image");
+}
+
+//------------------------------------------------------------------
+
 void TLevelWriterMov::setFrameRate(double fps)
 {
 	TLevelWriter::setFrameRate(fps);
+	flushSlots();
 
 	QLocalSocket socket;
 	tipc::startSlaveConnection(&socket, t32bitsrv::srvName(), -1, t32bitsrv::srvCmdline());
@@ -262,6 +340,20 @@ void TLevelWriterMov::save(const TImageP &img, int frameIndex)
 
 	int size = lx * ly * pixSize;
 
+	//Post the frame through a free slot, without waiting for the server to save it
+	if (t32bitsrv::FrameSlots *frameSlots = this->frameSlots(size)) {
+		int slot = frameSlots->acquire();
+		frameSlots->write(slot, ras);
+
+		tipc::Message msg;
+		msg << QString("$LWMovSlotWrite") << m_id << frameIndex << lx << ly << frameSlots->offset(slot);
+		frameSlots->post(msg, slot);
+
+		return;
+	}
+
+	flushSlots();
+
 	//Send messages
 	QLocalSocket socket;
 	tipc::startSlaveConnection(&socket, t32bitsrv::srvName(), -1, t32bitsrv::srvCmdline());
@@ -289,6 +381,8 @@ void TLevelWriterMov::saveSoundTrack(TSoundTrack *st)
 	if (st == 0)
 		return;
 
+	flushSlots();
+
 	//Prepare connection
 	QLocalSocket socket;
 	tipc::startSlaveConnection(&socket, t32bitsrv::srvName(), -1, t32bitsrv::srvCmdline());
@@ -371,7 +465,7 @@ void TImageReaderMovProxy::load(const TRasterP &rasP, const TPoint &pos, int shr
 //******************************************************************************
 
 TLevelReaderMov::TLevelReaderMov(const TFilePath &path)
-	: TLevelReader(path)
+	: TLevelReader(path), m_slots(0), m_slotsFailed(false)
 {
 	static TAtomicVar count;
 	unsigned int currCount = ++count;
@@ -409,6 +503,31 @@ TLevelReaderMov::~TLevelReaderMov()
 	stream << (msg << QString("$closeLRMov") << m_id);
 	QString res(tipc::readMessage(stream, msg));
 	assert(res == "ok");
+
+	//The server detached the slots on close
+	delete m_slots;
+}
+
+//------------------------------------------------------------------
+
+/*!
+  Returns the frame slots to be used to load frames of the specified byte size, or 0
+  if frames must be passed on a temporary shared memory segment instead.
+*/
+t32bitsrv::FrameSlots *TLevelReaderMov::frameSlots(int frameSize)
+{
+	QMutexLocker locker(&m_slotsMutex);
+
+	if (!m_slots && !m_slotsFailed) {
+		m_slots = new t32bitsrv::FrameSlots(tmax(frameSize, m_lx * m_ly * 4), c_readerSlotsCount);
+		if (!attachSlots("$LRMovAttachSlots", m_id, m_slots)) {
+			delete m_slots;
+			m_slots = 0;
+			m_slotsFailed = true;
+		}
+	}
+
+	return (m_slots && frameSize <= m_slots->slotSize()) ? m_slots : 0;
 }
 
 //------------------------------------------------------------------
@@ -501,6 +620,26 @@ void TLevelReaderMov::load(const TRasterP &ras, int frameIndex, const TPoint &po
 
 	unsigned int size = ras->getLx() * ras->getLy() * ras->getPixelSize();
 
+	//Make the server load the frame straight into a free slot
+	t32bitsrv::FrameSlots *frameSlots = (ras->getPixelSize() == 4) ? this->frameSlots(size) : 0;
+	if (frameSlots) {
+		int slot = frameSlots->acquire();
+
+		stream << (msg << QString("$LRMovSlotRead") << m_id << ras->getLx() << ras->getLy() << frameIndex
+					   << pos.x << pos.y << shrinkX << shrinkY << frameSlots->offset(slot));
+
+		bool ok = (tipc::readMessage(stream, msg) == "ok");
+		if (ok)
+			frameSlots->read(slot, ras);
+
+		frameSlots->release(slot);
+
+		if (!ok)
+			throw TException("Couldn't load image");
+
+		return;
+	}
+
 	//Send the appropriate command to the 32-bit server
 	stream << (msg << QString("$LRMovImageRead") << m_id << ras->getLx() << ras->getLy() << ras->getPixelSize()
 				   << frameIndex << pos.x << pos.y << shrinkX << shrinkY);
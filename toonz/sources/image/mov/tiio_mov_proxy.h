@@ -8,11 +8,21 @@
 //Qt includes
 #include <QString>
 #include <QLocalSocket>
+#include <QMutex>
 
 #include "tlevel_io.h"
 
 //---------------------------------------------------------------------
 
+//  Forward declarations
+
+namespace t32bitsrv
+{
+class FrameSlots;
+}
+
+//---------------------------------------------------------------------
+
 //QuickTime check
 bool IsQuickTimeInstalled();
 
@@ -26,6 +36,10 @@ class TLevelWriterMov : public TLevelWriter
 {
 	unsigned int m_id;
 
+	t32bitsrv::FrameSlots *m_slots; //!< Frames are posted through these, once allocated
+	bool m_slotsFailed;
+	QMutex m_slotsMutex;
+
 public:
 	TLevelWriterMov(const TFilePath &path, TPropertyGroup *winfo);
 	~TLevelWriterMov();
@@ -44,6 +58,10 @@ public:
 	};
 
 	QLocalSocket *socket();
+
+private:
+	t32bitsrv::FrameSlots *frameSlots(int frameSize);
+	void flushSlots();
 };
 
 //******************************************************************************
@@ -55,6 +73,10 @@ class TLevelReaderMov : public TLevelReader
 	unsigned int m_id;
 	int m_lx, m_ly;
 
+	t32bitsrv::FrameSlots *m_slots; //!< Frames are loaded through these, once allocated
+	bool m_slotsFailed;
+	QMutex m_slotsMutex;
+
 public:
 	TLevelReaderMov(const TFilePath &path);
 	~TLevelReaderMov();
@@ -74,6 +96,9 @@ public:
 	{
 		return new TLevelReaderMov(f);
 	}
+
+private:
+	t32bitsrv::FrameSlots *frameSlots(int frameSize);
 };
 
 //===========================================================================
@@ -15,6 +15,8 @@
 #include "../compatibility/tfile_io.h"
 #include "tenv.h"
 
+#include <QFile>
+
 /*=====================================================================*/
 
 #if defined(MACOSX)
@@ -32,7 +34,7 @@ TNZ_LITTLE_ENDIAN undefined !!
 #endif
 
 	static const int c_majorVersionNumber = 71;
-static const int c_minorVersionNumber = 0;
+static const int c_minorVersionNumber = 1; // 71.1: packed stroke data
 
 /*=====================================================================*/
 /*=====================================================================*/
@@ -162,18 +164,27 @@ MyOfstream &MyOfstream::operator<<(const string &s)
 /*=====================================================================*/
 
 class MyIfstream //The input is done without stl; it was crashing in release version loading textures!!
-{
+{				 //The file is memory-mapped, so that only the accessed parts are actually read from disk
 private:
 	bool m_isIrixEndian;
-	FILE *m_fp;
+	QFile m_file;
+	QByteArray m_contents; //Used only when the file could not be mapped
+	const UCHAR *m_data;
+	TUINT32 m_size, m_pos;
 
-public:
-	MyIfstream() : m_isIrixEndian(false) { m_fp = 0; }
-	~MyIfstream()
+	inline const UCHAR *take(TUINT32 length)
 	{
-		if (m_fp)
-			fclose(m_fp);
+		if (length > m_size - m_pos)
+			throw TException("corrupted pli file: unexpected end of file");
+
+		const UCHAR *data = m_data + m_pos;
+		m_pos += length;
+		return data;
 	}
+
+public:
+	MyIfstream() : m_isIrixEndian(false), m_data(0), m_size(0), m_pos(0) {}
+	~MyIfstream() { close(); }
 	void setEndianess(bool isIrixEndian) { m_isIrixEndian = isIrixEndian; }
 	MyIfstream &operator>>(TUINT32 &un);
 	MyIfstream &operator>>(string &un);
@@ -183,24 +194,37 @@ public:
 	void open(const TFilePath &filename);
 	void close()
 	{
-		if (m_fp)
-			fclose(m_fp);
-		m_fp = 0;
+		if (m_file.isOpen())
+			m_file.close(); // Unmaps the file, too
+		m_contents.clear();
+		m_data = 0;
+		m_size = m_pos = 0;
 	}
-	TUINT32 tellg() { return (TUINT32)ftell(m_fp); }
+	TUINT32 size() const { return m_size; }
+	TUINT32 tellg() { return m_pos; }
 	//void seekg(TUINT32 pos, ios_base::seek_dir type);
 	void seekg(TUINT32 pos, int type);
-	void read(char *m_buf, int length) { fread((void *)m_buf, sizeof(char), length, m_fp); }
+	void read(char *m_buf, int length) { memcpy(m_buf, take(length), length); }
 };
 
 /*=====================================================================*/
 
 void MyIfstream::open(const TFilePath &filename)
 {
-	try {
-		m_fp = fopen(filename, "rb");
-	} catch (TException &) {
+	close();
+
+	m_file.setFileName(filename.getQString());
+	if (!m_file.open(QIODevice::ReadOnly))
 		throw TImageException(filename, "File not found");
+
+	m_size = (TUINT32)m_file.size();
+	m_data = m_file.map(0, m_size);
+	if (!m_data) {
+		m_contents = m_file.readAll();
+		m_file.close();
+
+		m_data = (const UCHAR *)m_contents.constData();
+		m_size = m_contents.size();
 	}
 }
 
@@ -208,22 +232,20 @@ void MyIfstream::open(const TFilePath &filename)
 
 void MyIfstream::seekg(TUINT32 pos, int type)
 {
-	if (type == ios_base::beg)
-		fseek(m_fp, pos, SEEK_SET);
-	else if (type == ios_base::cur)
-		fseek(m_fp, pos, SEEK_CUR);
+	if (type == ios_base::cur)
+		pos += m_pos;
 	else
-		assert(false);
+		assert(type == ios_base::beg);
+
+	// Seeking past the end is allowed; the next read will throw
+	m_pos = tmin(pos, m_size);
 }
 
 /*=====================================================================*/
 
 inline MyIfstream &MyIfstream::operator>>(UCHAR &un)
 {
-	int ret = fread((void *)&un, sizeof(UCHAR), 1, m_fp);
-	if (ret < 1)
-		throw TException("corrupted pli file: unexpected end of file");
-	//read((char *)&un, sizeof(UCHAR));
+	un = *take(sizeof(UCHAR));
 	return *this;
 }
 
@@ -231,10 +253,7 @@ inline MyIfstream &MyIfstream::operator>>(UCHAR &un)
 
 inline MyIfstream &MyIfstream::operator>>(char &un)
 {
-	int ret = fread((void *)&un, sizeof(char), 1, m_fp);
-	if (ret < 1)
-		throw TException("corrupted pli file: unexpected end of file");
-	//read((char *)&un, sizeof(char));
+	un = (char)*take(sizeof(char));
 	return *this;
 }
 
@@ -242,10 +261,7 @@ inline MyIfstream &MyIfstream::operator>>(char &un)
 
 inline MyIfstream &MyIfstream::operator>>(USHORT &un)
 {
-	int ret = fread((void *)&un, sizeof(USHORT), 1, m_fp);
-	if (ret < 1)
-		throw TException("corrupted pli file: unexpected end of file");
-	//  read((char *)&un, sizeof(USHORT));
+	memcpy(&un, take(sizeof(USHORT)), sizeof(USHORT));
 
 	if (m_isIrixEndian)
 		un = ((un & 0xff00) >> 8) | ((un & 0x00ff) << 8);
@@ -256,10 +272,7 @@ inline MyIfstream &MyIfstream::operator>>(USHORT &un)
 
 inline MyIfstream &MyIfstream::operator>>(TUINT32 &un)
 {
-	int ret = fread((void *)&un, sizeof(TUINT32), 1, m_fp);
-	if (ret < 1)
-		throw TException("corrupted pli file: unexpected end of file");
-	// read((char *)&un, sizeof(TUINT32));
+	memcpy(&un, take(sizeof(TUINT32)), sizeof(TUINT32));
 
 	if (m_isIrixEndian)
 		un = ((un & 0xff000000) >> 24) | ((un & 0x00ff0000) >> 8) |
@@ -271,15 +284,9 @@ inline MyIfstream &MyIfstream::operator>>(TUINT32 &un)
 
 inline MyIfstream &MyIfstream::operator>>(string &un)
 {
-	string s = "";
 	USHORT lenght;
 	(*this) >> lenght;
-	for (UINT i = 0; i < lenght; i++) {
-		UCHAR ch;
-		(*this) >> ch;
-		s.append(1, ch);
-	}
-	un = s;
+	un.assign((const char *)take(lenght), lenght);
 
 	return *this;
 }
@@ -369,11 +376,20 @@ public:
 	TAffine m_affine;
 	int m_precisionScale;
 	std::map<TFrameId, int> m_frameOffsInFile;
+	std::map<TUINT32, PliTag *> m_tagsByOffset; //!< Read tags in the list, by file offset
+	std::map<PliTag *, TUINT32> m_offsetsByTag; //!< Written tags, by tag
+	std::vector<UCHAR> m_packBuf;				//!< Encoding buffer for packed tags
+
+	bool hasPackedStrokes() const
+	{
+		return m_majorVersionNumber > 71 || (m_majorVersionNumber == 71 && m_minorVersionNumber >= 1);
+	}
 
 	PliTag *readTextTag();
 	PliTag *readPaletteTag();
 	PliTag *readPaletteWithAlphaTag();
 	PliTag *readThickQuadraticChainTag(bool isLoop);
+	PliTag *readPackedThickQuadraticChainTag(bool isLoop);
 	PliTag *readColorTag();
 	PliTag *readStyleTag();
 	PliTag *readGroupTag();
@@ -399,6 +415,7 @@ public:
 	TUINT32 writePaletteTag(PaletteTag *tag);
 	TUINT32 writePaletteWithAlphaTag(PaletteWithAlphaTag *tag);
 	TUINT32 writeThickQuadraticChainTag(ThickQuadraticChainTag *tag);
+	TUINT32 writePackedThickQuadraticChainTag(ThickQuadraticChainTag *tag);
 	TUINT32 writeGroupTag(GroupTag *tag);
 	TUINT32 writeImageTag(ImageTag *tag);
 	TUINT32 writeColorTag(ColorTag *tag);
@@ -415,6 +432,12 @@ public:
 
 	inline void setDinamicTypeBytesNum(int minval, int maxval);
 
+	bool readFrameIndex(TUINT32 indexOffset);
+	TUINT32 writeFrameIndex();
+
+	void appendTag(TagElem *elem);
+	void clearTags();
+
 	PliTag *findTagFromOffset(UINT tagOffs);
 	UINT findOffsetFromTag(PliTag *tag);
 	TagElem *findTag(PliTag *tag);
@@ -512,6 +535,95 @@ static inline short complement2(USHORT val)
 
 /*=====================================================================*/
 
+/*
+  Packed stroke data (version 71.1 on): control points are stored as deltas
+  from the previous control vector, zig-zag mapped and written as base-128
+  varints - so the usual short, smooth segments take a byte per coordinate.
+*/
+
+static inline void packUInt(std::vector<UCHAR> &buf, TUINT32 val)
+{
+	while (val >= 0x80) {
+		buf.push_back((UCHAR)(val | 0x80));
+		val >>= 7;
+	}
+	buf.push_back((UCHAR)val);
+}
+
+/*=====================================================================*/
+
+static inline void packInt(std::vector<UCHAR> &buf, TINT32 val)
+{
+	packUInt(buf, ((TUINT32)val << 1) ^ (TUINT32)(val >> 31));
+}
+
+/*=====================================================================*/
+
+static inline UCHAR packThickness(double thick)
+{
+	return (UCHAR)tmin(tround(tmax(thick, 0.0)), 255);
+}
+
+/*=====================================================================*/
+
+static inline UCHAR unpackUChar(const UCHAR *buf, TUINT32 bufLength, TUINT32 &bufOffs)
+{
+	if (bufOffs >= bufLength)
+		throw TException("corrupted pli file: bad stroke data");
+
+	return buf[bufOffs++];
+}
+
+/*=====================================================================*/
+
+static inline TUINT32 unpackUInt(const UCHAR *buf, TUINT32 bufLength, TUINT32 &bufOffs)
+{
+	TUINT32 val = 0;
+	for (int shift = 0; shift < 35; shift += 7) {
+		UCHAR c = unpackUChar(buf, bufLength, bufOffs);
+		val |= (TUINT32)(c & 0x7f) << shift;
+		if (!(c & 0x80))
+			return val;
+	}
+
+	throw TException("corrupted pli file: bad stroke data");
+}
+
+/*=====================================================================*/
+
+static inline TINT32 unpackInt(const UCHAR *buf, TUINT32 bufLength, TUINT32 &bufOffs)
+{
+	TUINT32 val = unpackUInt(buf, bufLength, bufOffs);
+	return (TINT32)(val >> 1) ^ -(TINT32)(val & 1);
+}
+
+/*=====================================================================*/
+
+//! p0==p1, or p1==p2 creates problems (in the increasecontrolpoints for
+//! example): the coincident control point is slightly moved.
+static inline void adjustDegenerateQuadratic(double &dx1, double &dy1, double &dx2, double &dy2)
+{
+	if (dx1 == 0 && dy1 == 0) {
+		if (dx2 != 0 || dy2 != 0) {
+			dx1 = 0.001 * dx2;
+			dx2 = 0.999 * dx2;
+			dy1 = 0.001 * dy2;
+			dy2 = 0.999 * dy2;
+			assert(dx1 != 0 || dy1 != 0);
+		}
+	} else if (dx2 == 0 && dy2 == 0) {
+		if (dx1 != 0 || dy1 != 0) {
+			dx2 = 0.001 * dx1;
+			dx1 = 0.999 * dx1;
+			dy2 = 0.001 * dy1;
+			dy1 = 0.999 * dy1;
+			assert(dx2 != 0 || dy2 != 0);
+		}
+	}
+}
+
+/*=====================================================================*/
+
 ParsedPliImp::ParsedPliImp()
 	: m_majorVersionNumber(0), m_minorVersionNumber(0), m_framesNumber(0), m_thickRatio(1.0), m_maxThickness(0.0), m_firstTag(NULL), m_lastTag(NULL), m_currTag(NULL), m_iChan(), m_oChan(0), m_bufLength(0), m_buf(NULL), m_affine(), m_precisionScale(REGION_COMPUTING_PRECISION), m_creator("")
 {
@@ -603,17 +715,12 @@ ParsedPliImp::ParsedPliImp(const TFilePath &filename, bool readInfo)
 
 		m_currDinamicTypeBytesNum = 2;
 
-		while ((tagElem = readTag())) {
-			if (!m_firstTag)
-				m_firstTag = m_lastTag = tagElem;
-			else {
-				m_lastTag->m_next = tagElem;
-				m_lastTag = m_lastTag->m_next;
-			}
-		}
+		while ((tagElem = readTag()))
+			appendTag(tagElem);
 
 		for (tagElem = m_firstTag; tagElem; tagElem = tagElem->m_next)
 			tagElem->m_offset = 0;
+		m_tagsByOffset.clear();
 
 		m_iChan.close();
 	}
@@ -640,9 +747,10 @@ const TFrameId &ParsedPli::getFrameNumber(int index)
 
 void ParsedPliImp::loadInfo(bool readPlt, TPalette *&palette, TContentHistory *&history)
 {
-	TUINT32 fileLenght;
+	// Former file length field, now storing the offset of the frames index (0 if missing)
+	TUINT32 indexOffset;
 
-	m_iChan >> fileLenght;
+	m_iChan >> indexOffset;
 	m_iChan >> m_framesNumber;
 	if (!((m_majorVersionNumber == 5 && m_minorVersionNumber >= 7) || (m_majorVersionNumber > 5))) {
 		UCHAR maxThickness;
@@ -667,7 +775,11 @@ void ParsedPliImp::loadInfo(bool readPlt, TPalette *&palette, TContentHistory *&
 	TUINT32 pos = m_iChan.tellg();
 	USHORT type;
 	while ((type = readTagHeader()) != PliTag::END_CNTRL) {
-		if (type == PliTag::IMAGE_BEGIN_GOBJ) {
+		if (type == PliTag::IMAGE_BEGIN_GOBJ && m_frameOffsInFile.empty() &&
+			indexOffset && readFrameIndex(indexOffset)) {
+			// Palette and history are saved before the frames: no need to scan any further
+			break;
+		} else if (type == PliTag::IMAGE_BEGIN_GOBJ) {
 			USHORT frame;
 			m_iChan >> frame;
 
@@ -679,7 +791,7 @@ void ParsedPliImp::loadInfo(bool readPlt, TPalette *&palette, TContentHistory *&
 
 			//m_iChan.seekg(m_tagLength, ios::cur);
 			m_iChan.seekg(m_tagLength - 2, ios::cur);
-		} else if (type == PliTag::STYLE_NGOBJ) {
+		} else if (type == PliTag::STYLE_NGOBJ && readPlt) {
 			m_iChan.seekg(pos, ios::beg);
 			TagElem *tagElem = readTag();
 			addTag(*tagElem);
@@ -774,13 +886,8 @@ ImageTag *ParsedPliImp::loadFrame(const TFrameId &frameNumber)
 {
 	m_currDinamicTypeBytesNum = 2;
 
-	TagElem *tagElem = m_firstTag;
-	while (tagElem) {
-		TagElem *auxTag = tagElem;
-		tagElem = tagElem->m_next;
-		delete auxTag;
-	}
-	m_firstTag = 0;
+	clearTags();
+	TagElem *tagElem;
 
 	//PliTag *tag;
 	USHORT type = PliTag::IMAGE_BEGIN_GOBJ;
@@ -820,12 +927,7 @@ ImageTag *ParsedPliImp::loadFrame(const TFrameId &frameNumber)
 
 	//trovato; leggo i suoi tag
 	while ((tagElem = readTag())) {
-		if (!m_firstTag)
-			m_firstTag = m_lastTag = tagElem;
-		else {
-			m_lastTag->m_next = tagElem;
-			m_lastTag = m_lastTag->m_next;
-		}
+		appendTag(tagElem);
 		if (tagElem->m_tag->m_type == PliTag::IMAGE_GOBJ) {
 			assert(((ImageTag *)(tagElem->m_tag))->m_numFrame == frameId);
 			return (ImageTag *)tagElem->m_tag;
@@ -918,22 +1020,113 @@ TagElem *ParsedPliImp::readTag()
 
 /*=====================================================================*/
 
+void ParsedPliImp::appendTag(TagElem *elem)
+{
+	if (!m_firstTag)
+		m_firstTag = m_lastTag = elem;
+	else {
+		m_lastTag->m_next = elem;
+		m_lastTag = m_lastTag->m_next;
+	}
+
+	m_tagsByOffset[elem->m_offset] = elem->m_tag;
+}
+
+/*=====================================================================*/
+
+void ParsedPliImp::clearTags()
+{
+	TagElem *tagElem = m_firstTag;
+	while (tagElem) {
+		TagElem *auxTag = tagElem;
+		tagElem = tagElem->m_next;
+		delete auxTag;
+	}
+	m_firstTag = m_lastTag = 0;
+	m_tagsByOffset.clear();
+}
+
+/*=====================================================================*/
+
+bool ParsedPliImp::readFrameIndex(TUINT32 indexOffset)
+{
+	// The index is trusted only if fully consistent; otherwise, the caller
+	// keeps scanning the file from where it was
+	TUINT32 pos = m_iChan.tellg(), tagLength = m_tagLength;
+	std::map<TFrameId, int> frameOffsInFile;
+
+	try {
+		if (indexOffset < pos || indexOffset >= m_iChan.size())
+			throw TException("invalid pli frames index");
+
+		m_iChan.seekg(indexOffset, ios::beg);
+		if (readTagHeader() != PliTag::FRAME_INDEX_CNTRL)
+			throw TException("invalid pli frames index");
+
+		TUINT32 f, framesCount, offset;
+		m_iChan >> framesCount;
+		if (framesCount != m_framesNumber || m_tagLength != 4 + 7 * framesCount)
+			throw TException("invalid pli frames index");
+
+		for (f = 0; f < framesCount; ++f) {
+			USHORT frame;
+			char letter;
+			m_iChan >> frame;
+			m_iChan >> letter;
+			m_iChan >> offset;
+
+			if (offset < pos || offset >= indexOffset)
+				throw TException("invalid pli frames index");
+
+			frameOffsInFile[TFrameId(frame, letter)] = offset;
+		}
+
+		if (frameOffsInFile.size() != framesCount)
+			throw TException("invalid pli frames index");
+	} catch (...) {
+		m_iChan.seekg(pos, ios::beg);
+		m_tagLength = tagLength;
+		return false;
+	}
+
+	m_frameOffsInFile.swap(frameOffsInFile);
+	return true;
+}
+
+/*=====================================================================*/
+
+TUINT32 ParsedPliImp::writeFrameIndex()
+{
+	assert(m_oChan);
+	assert(m_frameOffsInFile.size() == m_framesNumber);
+
+	TUINT32 offset = writeTagHeader((UCHAR)PliTag::FRAME_INDEX_CNTRL, 4 + 7 * m_frameOffsInFile.size());
+
+	*m_oChan << (TUINT32)m_frameOffsInFile.size();
+
+	std::map<TFrameId, int>::iterator it, end = m_frameOffsInFile.end();
+	for (it = m_frameOffsInFile.begin(); it != end; ++it) {
+		*m_oChan << (USHORT)it->first.getNumber();
+		*m_oChan << it->first.getLetter();
+		*m_oChan << (TUINT32)it->second;
+	}
+
+	return offset;
+}
+
+/*=====================================================================*/
+
 PliTag *ParsedPliImp::findTagFromOffset(UINT tagOffs)
 {
-	for (TagElem *elem = m_firstTag; elem; elem = elem->m_next)
-		if (elem->m_offset == tagOffs)
-			return elem->m_tag;
-	return NULL;
+	std::map<TUINT32, PliTag *>::iterator it = m_tagsByOffset.find(tagOffs);
+	return (it == m_tagsByOffset.end()) ? NULL : it->second;
 }
 /*=====================================================================*/
 
 UINT ParsedPliImp::findOffsetFromTag(PliTag *tag)
 {
-	for (TagElem *elem = m_firstTag; elem; elem = elem->m_next)
-		if (elem->m_tag == tag)
-			return elem->m_offset;
-
-	return 0;
+	std::map<PliTag *, TUINT32>::iterator it = m_offsetsByTag.find(tag);
+	return (it == m_offsetsByTag.end()) ? 0 : it->second;
 }
 /*=====================================================================*/
 
@@ -1091,6 +1284,9 @@ PliTag *ParsedPliImp::readThickQuadraticChainTag(bool isLoop)
 	TUINT32 numQuadratics = 0;
 	double scale;
 
+	if (hasPackedStrokes())
+		return readPackedThickQuadraticChainTag(isLoop);
+
 	bool newThicknessWriteMethod = ((m_majorVersionNumber == 5 && m_minorVersionNumber >= 7) ||
 									(m_majorVersionNumber > 5));
 
@@ -1143,24 +1339,7 @@ PliTag *ParsedPliImp::readThickQuadraticChainTag(bool isLoop)
 		readDinamicData(d, bufOffs);
 		dy2 = scale * d;
 
-		if (dx1 == 0 && dy1 == 0) //p0==p1, or p1==p2  creates problems (in the increasecontrolpoints for example) I slightly move it...
-		{
-			if (dx2 != 0 || dy2 != 0) {
-				dx1 = 0.001 * dx2;
-				dx2 = 0.999 * dx2;
-				dy1 = 0.001 * dy2;
-				dy2 = 0.999 * dy2;
-				assert(dx1 != 0 || dy1 != 0);
-			}
-		} else if (dx2 == 0 && dy2 == 0) {
-			if (dx1 != 0 || dy1 != 0) {
-				dx2 = 0.001 * dx1;
-				dx1 = 0.999 * dx1;
-				dy2 = 0.001 * dy1;
-				dy1 = 0.999 * dy1;
-				assert(dx2 != 0 || dy2 != 0);
-			}
-		}
+		adjustDegenerateQuadratic(dx1, dy1, dx2, dy2);
 
 		p.x += dx1;
 		p.y += dy1;
@@ -1186,6 +1365,71 @@ PliTag *ParsedPliImp::readThickQuadraticChainTag(bool isLoop)
 
 /*=====================================================================*/
 
+PliTag *ParsedPliImp::readPackedThickQuadraticChainTag(bool isLoop)
+{
+	TUINT32 bufOffs = 0;
+	double scale = 1.0 / (double)m_precisionScale;
+
+	int maxThickness = unpackUChar(m_buf, m_tagLength, bufOffs);
+	m_thickRatio = maxThickness / 255.0;
+
+	// Every quadratic takes at least 6 bytes
+	TUINT32 numQuadratics = unpackUInt(m_buf, m_tagLength, bufOffs);
+	if (numQuadratics > m_tagLength / 6)
+		throw TException("corrupted pli file: bad stroke data");
+
+	TThickPoint p;
+	p.x = scale * unpackInt(m_buf, m_tagLength, bufOffs);
+	p.y = scale * unpackInt(m_buf, m_tagLength, bufOffs);
+	p.thick = unpackUChar(m_buf, m_tagLength, bufOffs) * m_thickRatio;
+
+	TThickQuadratic *quadratic = new TThickQuadratic[numQuadratics];
+
+	try {
+		TPoint dp1, dp2;
+		for (unsigned int i = 0; i < numQuadratics; i++) {
+			quadratic[i].setThickP0(p);
+
+			dp1.x = dp2.x + unpackInt(m_buf, m_tagLength, bufOffs);
+			dp1.y = dp2.y + unpackInt(m_buf, m_tagLength, bufOffs);
+			double thick1 = unpackUChar(m_buf, m_tagLength, bufOffs) * m_thickRatio;
+
+			dp2.x = dp1.x + unpackInt(m_buf, m_tagLength, bufOffs);
+			dp2.y = dp1.y + unpackInt(m_buf, m_tagLength, bufOffs);
+			double thick2 = unpackUChar(m_buf, m_tagLength, bufOffs) * m_thickRatio;
+
+			double dx1 = scale * dp1.x, dy1 = scale * dp1.y,
+				   dx2 = scale * dp2.x, dy2 = scale * dp2.y;
+			adjustDegenerateQuadratic(dx1, dy1, dx2, dy2);
+
+			p.x += dx1;
+			p.y += dy1;
+			p.thick = thick1;
+
+			quadratic[i].setThickP1(p);
+
+			p.x += dx2;
+			p.y += dy2;
+			p.thick = thick2;
+
+			quadratic[i].setThickP2(p);
+		}
+	} catch (...) {
+		delete[] quadratic;
+		throw;
+	}
+
+	ThickQuadraticChainTag *tag = new ThickQuadraticChainTag();
+	tag->m_numCurves = numQuadratics;
+	tag->m_curve = quadratic;
+	tag->m_isLoop = isLoop;
+	tag->m_maxThickness = maxThickness;
+
+	return tag;
+}
+
+/*=====================================================================*/
+
 PliTag *ParsedPliImp::readGroupTag()
 {
 	PliObjectTag **object;
@@ -1697,6 +1941,8 @@ bool ParsedPliImp::addTag(PliTag *tagPtr, bool addFront)
 bool ParsedPliImp::addTag(const TagElem &elem, bool addFront)
 {
 	TagElem *_tag = new TagElem(elem);
+	if (_tag->m_offset)
+		m_tagsByOffset[_tag->m_offset] = _tag->m_tag;
 
 	if (!m_firstTag) {
 		m_firstTag = m_lastTag = _tag;
@@ -1739,6 +1985,9 @@ void ParsedPliImp::writeTag(TagElem *elem)
 		//m_error = UNKNOWN_TAG;
 		;
 	}
+
+	if (elem->m_offset)
+		m_offsetsByTag[elem->m_tag] = elem->m_offset;
 }
 
 /*=====================================================================*/
@@ -1918,6 +2167,9 @@ TUINT32 ParsedPliImp::writeThickQuadraticChainTag(ThickQuadraticChainTag *tag)
 
 	assert(m_majorVersionNumber > 5 || (m_majorVersionNumber == 5 && m_minorVersionNumber >= 5));
 
+	if (hasPackedStrokes())
+		return writePackedThickQuadraticChainTag(tag);
+
 	scale = m_precisionScale;
 
 	/*for ( i=0; i<tag->m_numCurves; i++)
@@ -1982,6 +2234,55 @@ TUINT32 ParsedPliImp::writeThickQuadraticChainTag(ThickQuadraticChainTag *tag)
 
 /*=====================================================================*/
 
+TUINT32 ParsedPliImp::writePackedThickQuadraticChainTag(ThickQuadraticChainTag *tag)
+{
+	assert(m_oChan);
+	assert(tag->m_numCurves > 0);
+	assert(tag->m_maxThickness <= 255);
+	assert(tag->m_maxThickness > 0);
+
+	double scale = m_precisionScale;
+	UCHAR maxThickness = (UCHAR)(tceil(tag->m_maxThickness));
+	double thickRatio = maxThickness / 255.0;
+
+	// The tag is encoded in memory, and written at once
+	std::vector<UCHAR> &buf = m_packBuf;
+	buf.clear();
+
+	buf.push_back(maxThickness);
+	packUInt(buf, tag->m_numCurves);
+
+	const TThickPoint &p0 = tag->m_curve[0].getThickP0();
+	packInt(buf, (TINT32)(scale * p0.x));
+	packInt(buf, (TINT32)(scale * p0.y));
+	buf.push_back(packThickness(p0.thick / thickRatio));
+
+	TPoint dp, prevDp;
+	for (int i = 0; i < (int)tag->m_numCurves; i++) {
+		const TThickQuadratic &q = tag->m_curve[i];
+
+		dp = convert(scale * (q.getP1() - q.getP0()));
+		packInt(buf, dp.x - prevDp.x);
+		packInt(buf, dp.y - prevDp.y);
+		buf.push_back(packThickness(q.getThickP1().thick / thickRatio));
+		prevDp = dp;
+
+		dp = convert(scale * (q.getP2() - q.getP1()));
+		packInt(buf, dp.x - prevDp.x);
+		packInt(buf, dp.y - prevDp.y);
+		buf.push_back(packThickness(q.getThickP2().thick / thickRatio));
+		prevDp = dp;
+	}
+
+	TUINT32 offset = writeTagHeader((UCHAR)(tag->m_isLoop ? PliTag::THICK_QUADRATIC_LOOP_GOBJ : PliTag::THICK_QUADRATIC_CHAIN_GOBJ),
+									buf.size());
+	m_oChan->writeBuf(&buf[0], buf.size());
+
+	return offset;
+}
+
+/*=====================================================================*/
+
 TUINT32 ParsedPliImp::writeGroupTag(GroupTag *tag)
 {
 	assert(m_oChan);
@@ -2035,6 +2336,8 @@ TUINT32 ParsedPliImp::writeImageTag(ImageTag *tag)
 	*m_oChan << (USHORT)tag->m_numFrame.getNumber();
 	*m_oChan << tag->m_numFrame.getLetter();
 
+	m_frameOffsInFile[tag->m_numFrame] = m_oChan->tellp();
+
 	m_currDinamicTypeBytesNum = 3;
 
 	objectOffset = new TUINT32[tag->m_numObjects];
@@ -2445,7 +2748,8 @@ bool ParsedPliImp::writePli(const TFilePath &filename)
 
 	*m_oChan << m_creator;
 
-	*m_oChan << (TUINT32)0; //fileLenght;
+	TUINT32 indexOffsetPos = m_oChan->tellp();
+	*m_oChan << (TUINT32)0; //frames index offset, formerly fileLenght
 	*m_oChan << m_framesNumber;
 
 	UCHAR s, i, d;
@@ -2461,15 +2765,34 @@ bool ParsedPliImp::writePli(const TFilePath &filename)
 
 	m_currDinamicTypeBytesNum = 2;
 
+	m_frameOffsInFile.clear();
+
+	m_offsetsByTag.clear();
+	for (TagElem *elem = m_firstTag; elem; elem = elem->m_next)
+		if (elem->m_offset)
+			m_offsetsByTag[elem->m_tag] = elem->m_offset;
+
 	for (TagElem *elem = m_firstTag; elem; elem = elem->m_next) {
 		writeTag(elem);
 		CHECK_FOR_WRITE_ERROR(filename);
 	}
 
-	*m_oChan << (UCHAR)PliTag::END_CNTRL;
+	// The frames index lets readers locate frames without scanning the whole file
+	if (m_frameOffsInFile.size() == m_framesNumber) {
+		TUINT32 indexOffset = writeFrameIndex();
+		*m_oChan << (UCHAR)PliTag::END_CNTRL;
+
+		m_oChan->seekp(indexOffsetPos);
+		*m_oChan << indexOffset;
+		m_oChan->seekp(0, ios::end);
+	} else
+		*m_oChan << (UCHAR)PliTag::END_CNTRL;
+
+	CHECK_FOR_WRITE_ERROR(filename);
 
 	m_oChan->close();
 	m_oChan = 0;
+	m_offsetsByTag.clear();
 
 	return true;
 }
@@ -2585,12 +2908,7 @@ ParsedPliImp::~ParsedPliImp()
 		m_buf = NULL;
 	}
 
-	TagElem *tag = m_firstTag;
-	while (tag) {
-		TagElem *auxTag = tag;
-		tag = tag->m_next;
-		delete auxTag;
-	}
+	clearTags();
 }
 
 /*=====================================================================*/
@@ -77,6 +77,7 @@ public:
 		THICK_QUADRATIC_LOOP_GOBJ,
 		OUTLINE_OPTIONS_GOBJ,
 		PRECISION_SCALE_GOBJ,
+		FRAME_INDEX_CNTRL,
 		// ...
 		HOW_MANY_TAG_TYPES
 	};
@@ -18,6 +18,12 @@
 #include "tconvert.h"
 #include "tpixelutils.h"
 #include "traster.h"
+#include "tthread.h"
+
+#include <QMutex>
+#include <QWaitCondition>
+
+#include <algorithm>
 
 extern "C" {
 #include "tiffio.h"
@@ -710,6 +716,269 @@ Tiio::TifWriterProperties::TifWriterProperties()
 
 //============================================================
 
+//**************************************************************************
+//    TifStripEncoder  implementation
+//**************************************************************************
+
+namespace
+{
+
+//! Approximate size of the strips compressed in parallel
+const int c_parallelStripSize = 1 << 20;
+
+//-------------------------------------------------------------------
+
+//! Write-only in-memory file, where single strips get compressed by libtiff
+struct TiffMemoryStream {
+	std::vector<UCHAR> m_data;
+	toff_t m_pos;
+
+	TiffMemoryStream() : m_pos(0) {}
+};
+
+tmsize_t memoryRead(thandle_t, void *, tmsize_t) { return 0; }
+
+tmsize_t memoryWrite(thandle_t handle, void *buf, tmsize_t size)
+{
+	TiffMemoryStream *stream = (TiffMemoryStream *)handle;
+	if (stream->m_data.size() < stream->m_pos + size)
+		stream->m_data.resize(stream->m_pos + size);
+
+	memcpy(&stream->m_data[stream->m_pos], buf, size);
+	stream->m_pos += size;
+	return size;
+}
+
+toff_t memorySeek(thandle_t handle, toff_t offset, int whence)
+{
+	TiffMemoryStream *stream = (TiffMemoryStream *)handle;
+	switch (whence) {
+	case SEEK_SET:
+		stream->m_pos = offset;
+		break;
+	case SEEK_CUR:
+		stream->m_pos += offset;
+		break;
+	case SEEK_END:
+		stream->m_pos = stream->m_data.size() + offset;
+		break;
+	}
+	return stream->m_pos;
+}
+
+int memoryClose(thandle_t) { return 0; }
+toff_t memorySize(thandle_t handle) { return ((TiffMemoryStream *)handle)->m_data.size(); }
+int memoryMap(thandle_t, void **, toff_t *) { return 0; }
+void memoryUnmap(thandle_t, void *, toff_t) {}
+
+//-------------------------------------------------------------------
+
+struct TifStrip {
+	std::vector<UCHAR> m_raw, m_encoded;
+	bool m_done, m_failed;
+
+	TifStrip() : m_done(false), m_failed(false) {}
+};
+
+//-------------------------------------------------------------------
+
+/*!
+  TifStripEncoder compresses the strips of a tif file on a pool of threads.
+
+  Strips are compressed independently (which is the case for LZW, PackBits and
+  Deflate) by libtiff itself, in a single-strip tif held in memory - and the
+  resulting data is copied in the actual file, in order, as raw strips.
+*/
+class TifStripEncoder
+{
+	TIFF *m_tiff;
+	std::string m_mode;
+	uint32 m_lx;
+	uint16 m_bitsPerSample, m_samplesPerPixel, m_compression, m_photometric;
+	int m_ly, m_rowsPerStrip, m_scanlineSize;
+
+	std::vector<TifStrip *> m_strips;
+	int m_row, m_writtenStrips;
+
+	QMutex m_mutex;
+	QWaitCondition m_stripDone;
+
+public:
+	TifStripEncoder(TIFF *tiff, const std::string &mode, int ly, int rowsPerStrip);
+	~TifStripEncoder();
+
+	//! Returns whether strips compressed with the specified method can be encoded in parallel.
+	static bool isParallel(int compression);
+
+	void writeLine(const UCHAR *line);
+
+	//! Waits for all strips to be compressed, and writes them to the file.
+	void flush() { writeStrips(0); }
+
+private:
+	static TThread::Executor &executor();
+
+	void encode(TifStrip *strip, int rows);
+	void writeStrips(int maxPendingStrips);
+
+	friend class TifStripTask;
+};
+
+//-------------------------------------------------------------------
+
+class TifStripTask : public TThread::Runnable
+{
+	TifStripEncoder *m_encoder;
+	TifStrip *m_strip;
+	int m_rows;
+
+public:
+	TifStripTask(TifStripEncoder *encoder, TifStrip *strip, int rows)
+		: m_encoder(encoder), m_strip(strip), m_rows(rows) {}
+
+	void run() { m_encoder->encode(m_strip, m_rows); }
+};
+
+//-------------------------------------------------------------------
+
+TifStripEncoder::TifStripEncoder(TIFF *tiff, const std::string &mode, int ly, int rowsPerStrip)
+	: m_tiff(tiff), m_mode(mode), m_ly(ly), m_rowsPerStrip(rowsPerStrip), m_scanlineSize(TIFFScanlineSize(tiff)), m_row(0), m_writtenStrips(0)
+{
+	TIFFGetField(tiff, TIFFTAG_IMAGEWIDTH, &m_lx);
+	TIFFGetField(tiff, TIFFTAG_BITSPERSAMPLE, &m_bitsPerSample);
+	TIFFGetField(tiff, TIFFTAG_SAMPLESPERPIXEL, &m_samplesPerPixel);
+	TIFFGetField(tiff, TIFFTAG_COMPRESSION, &m_compression);
+	TIFFGetField(tiff, TIFFTAG_PHOTOMETRIC, &m_photometric);
+}
+
+//-------------------------------------------------------------------
+
+TifStripEncoder::~TifStripEncoder()
+{
+	// Strips being compressed refer to this
+	QMutexLocker locker(&m_mutex);
+	for (int s = m_writtenStrips; s < (int)m_strips.size(); ++s) {
+		while (!m_strips[s]->m_done)
+			m_stripDone.wait(&m_mutex);
+		delete m_strips[s];
+	}
+}
+
+//-------------------------------------------------------------------
+
+bool TifStripEncoder::isParallel(int compression)
+{
+	return TSystem::getProcessorCount() > 1 &&
+		   (compression == COMPRESSION_LZW || compression == COMPRESSION_PACKBITS ||
+			compression == COMPRESSION_DEFLATE || compression == COMPRESSION_ADOBE_DEFLATE);
+}
+
+//-------------------------------------------------------------------
+
+TThread::Executor &TifStripEncoder::executor()
+{
+	struct StripsExecutor : public TThread::Executor {
+		StripsExecutor() { setMaxActiveTasks(TSystem::getProcessorCount()); }
+	};
+
+	static StripsExecutor theExecutor;
+	return theExecutor;
+}
+
+//-------------------------------------------------------------------
+
+void TifStripEncoder::writeLine(const UCHAR *line)
+{
+	int r = m_row % m_rowsPerStrip;
+	if (r == 0) {
+		m_strips.push_back(new TifStrip);
+		m_strips.back()->m_raw.resize(std::min(m_rowsPerStrip, m_ly - m_row) * m_scanlineSize);
+	}
+
+	TifStrip *strip = m_strips.back();
+	memcpy(&strip->m_raw[r * m_scanlineSize], line, m_scanlineSize);
+
+	if (++m_row % m_rowsPerStrip == 0 || m_row == m_ly) {
+		executor().addTask(new TifStripTask(this, strip, r + 1));
+
+		// Don't let the strips waiting for compression pile up in memory
+		writeStrips(2 * TSystem::getProcessorCount());
+	}
+}
+
+//-------------------------------------------------------------------
+
+void TifStripEncoder::encode(TifStrip *strip, int rows)
+{
+	bool ok = false;
+
+	TiffMemoryStream stream;
+	TIFF *tiff = TIFFClientOpen("", m_mode.c_str(), (thandle_t)&stream,
+								memoryRead, memoryWrite, memorySeek, memoryClose,
+								memorySize, memoryMap, memoryUnmap);
+	if (tiff) {
+		TIFFSetField(tiff, TIFFTAG_IMAGEWIDTH, m_lx);
+		TIFFSetField(tiff, TIFFTAG_IMAGELENGTH, rows);
+		TIFFSetField(tiff, TIFFTAG_BITSPERSAMPLE, m_bitsPerSample);
+		TIFFSetField(tiff, TIFFTAG_SAMPLESPERPIXEL, m_samplesPerPixel);
+		TIFFSetField(tiff, TIFFTAG_COMPRESSION, m_compression);
+		TIFFSetField(tiff, TIFFTAG_PLANARCONFIG, PLANARCONFIG_CONTIG);
+		TIFFSetField(tiff, TIFFTAG_PHOTOMETRIC, m_photometric);
+		TIFFSetField(tiff, TIFFTAG_ROWSPERSTRIP, rows);
+
+		uint64 *offsets = 0, *byteCounts = 0;
+		if (TIFFWriteEncodedStrip(tiff, 0, &strip->m_raw[0], strip->m_raw.size()) != -1 &&
+			TIFFGetField(tiff, TIFFTAG_STRIPOFFSETS, &offsets) &&
+			TIFFGetField(tiff, TIFFTAG_STRIPBYTECOUNTS, &byteCounts) &&
+			offsets[0] + byteCounts[0] <= stream.m_data.size()) {
+			strip->m_encoded.assign(stream.m_data.begin() + offsets[0],
+									stream.m_data.begin() + offsets[0] + byteCounts[0]);
+			ok = true;
+		} else if (TIFFIsByteSwapped(tiff) && m_bitsPerSample == 16)
+			// The strip will be encoded again - restore the byte order swapped by libtiff
+			TIFFSwabArrayOfShort((uint16 *)&strip->m_raw[0], strip->m_raw.size() / 2);
+
+		TIFFCleanup(tiff);
+	}
+
+	QMutexLocker locker(&m_mutex);
+	strip->m_done = true;
+	strip->m_failed = !ok;
+	m_stripDone.wakeAll();
+}
+
+//-------------------------------------------------------------------
+
+void TifStripEncoder::writeStrips(int maxPendingStrips)
+{
+	while (m_writtenStrips < (int)m_strips.size()) {
+		TifStrip *strip = m_strips[m_writtenStrips];
+		{
+			QMutexLocker locker(&m_mutex);
+			while (!strip->m_done) {
+				if ((int)m_strips.size() - m_writtenStrips <= maxPendingStrips)
+					return;
+
+				m_stripDone.wait(&m_mutex);
+			}
+		}
+
+		if (strip->m_failed)
+			TIFFWriteEncodedStrip(m_tiff, m_writtenStrips, &strip->m_raw[0], strip->m_raw.size());
+		else
+			TIFFWriteRawStrip(m_tiff, m_writtenStrips, &strip->m_encoded[0], strip->m_encoded.size());
+
+		delete strip;
+		m_strips[m_writtenStrips++] = 0;
+	}
+}
+
+} // namespace
+
+//**************************************************************************
+//    TifWriter  implementation
+//**************************************************************************
+
 class TifWriter : public Tiio::Writer
 {
 
@@ -720,7 +989,9 @@ class TifWriter : public Tiio::Writer
 	Tiio::RowOrder m_rowOrder;
 	int m_bpp;
 	int m_RightToLeft;
+	TifStripEncoder *m_stripEncoder; // Set when strips are compressed in parallel
 	void fillBits(UCHAR *bufout, UCHAR *bufin, int lx, int incr);
+	void writeScanline();
 
 public:
 	TifWriter();
@@ -741,7 +1012,7 @@ public:
 //------------------------------------------------------------
 
 TifWriter::TifWriter()
-	: m_tiff(0), m_row(-1), m_lineBuffer(0), m_RightToLeft(false)
+	: m_tiff(0), m_row(-1), m_lineBuffer(0), m_RightToLeft(false), m_stripEncoder(0)
 {
 	TIFFSetWarningHandler(0);
 }
@@ -750,6 +1021,8 @@ TifWriter::TifWriter()
 
 TifWriter::~TifWriter()
 {
+	delete m_stripEncoder;
+
 	if (m_tiff)
 		TIFFClose(m_tiff);
 
@@ -888,7 +1161,18 @@ void TifWriter::open(FILE *file, const TImageInfo &info)
 	TIFFSetField(m_tiff, TIFFTAG_XRESOLUTION, m_info.m_dpix);
 	TIFFSetField(m_tiff, TIFFTAG_YRESOLUTION, m_info.m_dpiy);
 	TIFFSetField(m_tiff, TIFFTAG_RESOLUTIONUNIT, RESUNIT_INCH);
-	TIFFSetField(m_tiff, TIFFTAG_ROWSPERSTRIP, TIFFDefaultStripSize(m_tiff, 0));
+
+	// Compress large strips on multiple threads when possible - otherwise, strips are
+	// compressed one scanline at a time while being written
+	uint16 compression = COMPRESSION_NONE;
+	TIFFGetField(m_tiff, TIFFTAG_COMPRESSION, &compression);
+
+	if (m_bpp != 1 && TifStripEncoder::isParallel(compression)) {
+		int rowsPerStrip = std::max(c_parallelStripSize / (int)TIFFScanlineSize(m_tiff), 1);
+		TIFFSetField(m_tiff, TIFFTAG_ROWSPERSTRIP, rowsPerStrip);
+		m_stripEncoder = new TifStripEncoder(m_tiff, mode, m_info.m_ly, rowsPerStrip);
+	} else
+		TIFFSetField(m_tiff, TIFFTAG_ROWSPERSTRIP, TIFFDefaultStripSize(m_tiff, 0));
 
 	m_row = 0;
 	if (m_bpp == 1)
@@ -901,11 +1185,26 @@ void TifWriter::open(FILE *file, const TImageInfo &info)
 
 void TifWriter::flush()
 {
+	if (m_stripEncoder)
+		m_stripEncoder->flush();
+
 	TIFFFlush(m_tiff);
 }
 
 //------------------------------------------------------------
 
+void TifWriter::writeScanline()
+{
+	if (m_stripEncoder)
+		m_stripEncoder->writeLine(m_lineBuffer);
+	else
+		TIFFWriteScanline(m_tiff, m_lineBuffer, m_row, 0);
+
+	++m_row;
+}
+
+//------------------------------------------------------------
+
 void TifWriter::writeLine(short *buffer)
 {
 	int delta = 1;
@@ -944,7 +1243,7 @@ void TifWriter::writeLine(short *buffer)
 				pix = pix + delta;
 			}
 	}
-	TIFFWriteScanline(m_tiff, m_lineBuffer, m_row++, 0);
+	writeScanline();
 }
 
 //------------------------------------------------------------
@@ -1003,7 +1302,7 @@ void TifWriter::writeLine(char *buffer)
 				pix = pix + delta;
 			}
 	}
-	TIFFWriteScanline(m_tiff, m_lineBuffer, m_row++, 0);
+	writeScanline();
 }
 
 //============================================================
@@ -54,6 +54,7 @@
 #include "./tzl/tiio_tzl.h"
 #include "./svg/tiio_svg.h"
 #include "./mesh/tiio_mesh.h"
+#include "./ffmpeg/tiio_ffmpeg.h"
 
 //-------------------------------------------------------------------
 
@@ -174,6 +175,12 @@ void initImageIo(bool lightVersion)
 			Tiio::defineWriterProperties("3gp", new Tiio::MovWriterProperties());
 		}
 
+		// Movies encoded by an external ffmpeg process - write only
+		if (IsFfmpegInstalled()) {
+			TLevelWriter::define("mp4", TLevelWriterFfmpeg::create, true);
+			Tiio::defineWriterProperties("mp4", new Tiio::FfmpegWriterProperties());
+		}
+
 		/*
 #if (defined(WIN32) && !defined(x64))
 
@@ -20,8 +20,20 @@
 #include "tenv.h"
 #include "tconvert.h"
 #include "trasterimage.h"
+#include "tthread.h"
 
 #include "QByteArray.h"
+#include <QFile>
+#include <QThread>
+
+#include <limits>
+
+#ifdef WIN32
+#include <io.h>
+#include <windows.h>
+#else
+#include <unistd.h>
+#endif
 
 #if !defined(TNZ_LITTLE_ENDIAN)
 TNZ_LITTLE_ENDIAN undefined !!
@@ -339,6 +351,60 @@ void getThumbnail(TRasterP ras, int shrink, TRasterP &thumbnail)
 
 //-------------------------------------------------------------------
 
+namespace
+{
+
+//! Reads frame chunks from the level file's memory mapping or, when not
+//! available, from its stream.
+class TzlChunkReader
+{
+	FILE *m_chan;
+	const UCHAR *m_data;
+	TINT32 m_dataSize, m_pos;
+	std::vector<UCHAR> m_buffer;
+
+public:
+	TzlChunkReader(FILE *chan, const UCHAR *data, TINT32 dataSize)
+		: m_chan(chan), m_data(data), m_dataSize(dataSize), m_pos(0) {}
+
+	void seek(TINT32 offs)
+	{
+		if (m_data)
+			m_pos = offs;
+		else
+			fseek(m_chan, offs, SEEK_SET);
+	}
+
+	void read(void *dst, TINT32 length)
+	{
+		if (m_data)
+			memcpy(dst, take(length), length);
+		else
+			fread(dst, length, 1, m_chan);
+	}
+
+	//! Returns the next length bytes - directly from the mapping, if any.
+	UCHAR *take(TINT32 length)
+	{
+		if (m_data) {
+			if (length < 0 || m_pos < 0 || m_pos > m_dataSize - length)
+				throw TException("Loading tlv: unexpected end of file.");
+
+			const UCHAR *data = m_data + m_pos;
+			m_pos += length;
+			return const_cast<UCHAR *>(data); // Mapped only on little-endian machines, where no byte swapping is needed
+		}
+
+		m_buffer.resize(tmax(length, 1));
+		fread(&m_buffer[0], length, 1, m_chan);
+		return &m_buffer[0];
+	}
+};
+
+} // namespace
+
+//-------------------------------------------------------------------
+
 class TImageReaderTzl : public TImageReader
 {
 public:
@@ -352,10 +418,12 @@ private:
 	TImageP load10();
 	TImageP load11();
 	TImageP load13(); // Aggiunta iconcine
-	TImageP load14(); //	Aggiunto creator con lunghezza fissa
+	TImageP load14(int shrink = 1); //	Aggiunto creator con lunghezza fissa
 	const TImageInfo *getImageInfo10() const;
 	const TImageInfo *getImageInfo11() const; // vale anche le versioni > di 11
 
+	mutable TImageInfo m_info;
+
 public:
 	//! Indice del frame del livello
 	TFrameId m_fid;
@@ -447,10 +515,227 @@ public:
 	RasType m_rasType;
 };
 
+//-------------------------------------------------------------------
+
+//! Free space ratio above which a level file gets compacted
+const float c_optimizeThreshold = 0.3f;
+
+//-------------------------------------------------------------------
+
+//! Flushes the file down to the disk, so that writes following the call
+//! are not stored before the preceding ones.
+void syncFile(FILE *chan)
+{
+	fflush(chan);
+#ifdef WIN32
+	_commit(_fileno(chan));
+#else
+	fsync(fileno(chan));
+#endif
+}
+
+//-------------------------------------------------------------------
+
+//! Replaces dst with src in a single step, so that dst is never missing or half
+//! written. Returns false if the file could not be replaced - eg on Windows, when
+//! dst is still opened by someone.
+bool replaceFile(const TFilePath &dst, const TFilePath &src)
+{
+#ifdef WIN32
+	return MoveFileExW(src.getWideString().c_str(), dst.getWideString().c_str(),
+					   MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH) != 0;
+#else
+	return ::rename(toString(src.getWideString()).c_str(), toString(dst.getWideString()).c_str()) == 0;
+#endif
+}
+
+//-------------------------------------------------------------------
+
+//! Runs the level compactions in the background, one at a time.
+/*!
+  Compactions never block the levels they work on: readers may open a level
+  being compacted, since the level is only replaced as a whole once complete,
+  and writers just cancel the compaction. Each scheduled compaction gets a
+  ticket, which is revoked on cancelation - the level is replaced only if the
+  ticket is still valid at that time.
+*/
+class TzlOptimizer
+{
+	QMutex m_mutex;
+	std::map<TFilePath, int> m_tickets;
+	int m_lastTicket;
+	TThread::Executor m_executor;
+
+public:
+	TzlOptimizer() : m_lastTicket(0) { m_executor.setMaxActiveTasks(1); }
+
+	static TzlOptimizer *instance()
+	{
+		static TzlOptimizer theInstance;
+		return &theInstance;
+	}
+
+	void schedule(const TFilePath &path, const TDimension &iconSize);
+	void cancel(const TFilePath &path);
+
+	bool isValid(const TFilePath &path, int ticket);
+	bool commit(const TFilePath &path, int ticket, const TFilePath &optimizedPath);
+	void end(const TFilePath &path, int ticket);
+};
+
+//-------------------------------------------------------------------
+
+//! Rewrites the specified level without free chunks. Background compactions
+//! pass their ticket, and stop as soon as it is revoked.
+bool optimizeLevel(const TFilePath &path, const TDimension &iconSize, int ticket = 0)
+{
+	TFileStatus fs(path);
+	assert(fs.doesExist());
+
+	std::string tempName = "~" + path.getName() + "tmp&.tlv";
+	TFilePath tempPath = TSystem::getTempDir() + tempName; // Path temporaneo del file ottimizzato
+
+	if (TSystem::doesExistFileOrLevel(tempPath))
+		TSystem::deleteFile(tempPath);
+
+	TzlOptimizer *optimizer = TzlOptimizer::instance();
+	bool canceled = false;
+	{
+		TLevelWriterP lw(tempPath);
+
+		TLevelReaderP lr(path);
+		lw->setIconSize(iconSize);
+		TLevelP level = lr->loadInfo();
+		if (!level || level->getFrameCount() == 0)
+			return false;
+		TLevel::Iterator levelIt = level->begin();
+		for (levelIt; levelIt != level->end(); ++levelIt) {
+			if (ticket && !optimizer->isValid(path, ticket)) {
+				canceled = true;
+				break;
+			}
+
+			TToonzImageP img = lr->getFrameReader(levelIt->first)->load();
+			assert(img);
+			lw->getFrameWriter(levelIt->first)->save(img);
+		}
+	}
+
+	if (!TSystem::doesExistFileOrLevel(tempPath))
+		return false;
+	if (canceled) {
+		TSystem::removeFileOrLevel(tempPath);
+		return false;
+	}
+
+	// Se il file tempPath (ottimizzato) è stato creato lo sostituisco a path.
+	// The file is first copied next to path, so that path can be replaced
+	// with a rename.
+	assert(path != tempPath);
+	TFilePath swapPath = path.withName("~" + path.getName() + "tmp&");
+	TSystem::copyFile(swapPath, tempPath);
+	TSystem::deleteFile(tempPath);
+
+	bool replaced = ticket ? optimizer->commit(path, ticket, swapPath) : replaceFile(path, swapPath);
+	if (!replaced)
+		TSystem::removeFileOrLevel(swapPath);
+
+	return replaced;
+}
+
+//-------------------------------------------------------------------
+
+class TzlOptimizeTask : public TThread::Runnable
+{
+	TFilePath m_path;
+	TDimension m_iconSize;
+	int m_ticket;
+
+public:
+	TzlOptimizeTask(const TFilePath &path, const TDimension &iconSize, int ticket)
+		: m_path(path), m_iconSize(iconSize), m_ticket(ticket) {}
+
+	QThread::Priority runningPriority() { return QThread::LowPriority; }
+
+	void run()
+	{
+		try {
+			if (TzlOptimizer::instance()->isValid(m_path, m_ticket)) // Not canceled in the meantime
+				optimizeLevel(m_path, m_iconSize, m_ticket);
+		} catch (...) {
+			// The level stays as it is - compaction will be retried on its next save
+		}
+
+		TzlOptimizer::instance()->end(m_path, m_ticket);
+	}
+};
+
+//-------------------------------------------------------------------
+
+void TzlOptimizer::schedule(const TFilePath &path, const TDimension &iconSize)
+{
+	QMutexLocker locker(&m_mutex);
+
+	int &ticket = m_tickets[path];
+	if (ticket) // Already scheduled
+		return;
+
+	ticket = ++m_lastTicket;
+	m_executor.addTask(new TzlOptimizeTask(path, iconSize, ticket));
+}
+
+//-------------------------------------------------------------------
+
+void TzlOptimizer::cancel(const TFilePath &path)
+{
+	QMutexLocker locker(&m_mutex);
+	m_tickets.erase(path);
+}
+
+//-------------------------------------------------------------------
+
+bool TzlOptimizer::isValid(const TFilePath &path, int ticket)
+{
+	QMutexLocker locker(&m_mutex);
+
+	std::map<TFilePath, int>::iterator it = m_tickets.find(path);
+	return it != m_tickets.end() && it->second == ticket;
+}
+
+//-------------------------------------------------------------------
+
+bool TzlOptimizer::commit(const TFilePath &path, int ticket, const TFilePath &optimizedPath)
+{
+	// The replacement happens under the lock, so a writer canceling the compaction
+	// either finds the level already replaced, or never replaced
+	QMutexLocker locker(&m_mutex);
+
+	std::map<TFilePath, int>::iterator it = m_tickets.find(path);
+	return it != m_tickets.end() && it->second == ticket && replaceFile(path, optimizedPath);
+}
+
+//-------------------------------------------------------------------
+
+void TzlOptimizer::end(const TFilePath &path, int ticket)
+{
+	QMutexLocker locker(&m_mutex);
+
+	std::map<TFilePath, int>::iterator it = m_tickets.find(path);
+	if (it != m_tickets.end() && it->second == ticket)
+		m_tickets.erase(it);
+}
+
 } // namespace
 
 //-------------------------------------------------------------------
 
+void TLevelWriterTzl::cancelOptimization(const TFilePath &path)
+{
+	TzlOptimizer::instance()->cancel(path);
+}
+
+//-------------------------------------------------------------------
+
 //-------------------------------------------------------------------
 
 void TLevelWriterTzl::buildFreeChunksTable()
@@ -492,6 +777,13 @@ void TLevelWriterTzl::buildFreeChunksTable()
 	assert(lastOccupiedPos < m_offsetTablePos);
 	if (lastOccupiedPos + 1 < m_offsetTablePos)
 		m_freeChunks.insert(TzlChunk(lastOccupiedPos + 1, m_offsetTablePos - lastOccupiedPos));
+
+	// In append-only mode, the current offset tables (and whatever follows them) are
+	// superseded by the ones written on close
+	fseek(m_chan, 0, SEEK_END);
+	m_appendPos = ftell(m_chan);
+	if (m_appendOnly && m_offsetTablePos < m_appendPos)
+		addFreeChunk(m_offsetTablePos, m_appendPos - m_offsetTablePos);
 }
 
 //===================================================================
@@ -501,8 +793,10 @@ void TLevelWriterTzl::buildFreeChunksTable()
 //-------------------------------------------------------------------
 
 TLevelWriterTzl::TLevelWriterTzl(const TFilePath &path, TPropertyGroup *info)
-	: TLevelWriter(path, info), m_headerWritten(false), m_creatorWritten(false), m_chan(0), m_frameCountPos(0), m_frameCount(0), m_palette(0), m_res(0, 0), m_exists(false), m_version(CURRENT_VERSION), m_updatedIconsSize(false), m_currentIconSize(0, 0), m_iconSize(TDimension(80, 60)), m_userIconSize(TDimension(80, 60)), m_adjustRatio(false), m_codec(new TRasterCodecLZO("LZO", true)), m_overwritePaletteFlag(true)
+	: TLevelWriter(path, info), m_headerWritten(false), m_creatorWritten(false), m_chan(0), m_frameCountPos(0), m_frameCount(0), m_palette(0), m_res(0, 0), m_exists(false), m_version(CURRENT_VERSION), m_updatedIconsSize(false), m_currentIconSize(0, 0), m_iconSize(TDimension(80, 60)), m_userIconSize(TDimension(80, 60)), m_adjustRatio(false), m_codec(new TRasterCodecLZO("LZO", true)), m_overwritePaletteFlag(true), m_appendOnly(true), m_appendPos(0)
 {
+	cancelOptimization(path);
+
 	m_path = path;
 	m_palettePath = path.withNoFrame().withType("tpl");
 	TFileStatus fs(path);
@@ -581,7 +875,7 @@ TLevelWriterTzl::~TLevelWriterTzl()
 	assert(m_frameCount == (int)m_frameOffsTable.size());
 	assert(m_frameCount == (int)m_iconOffsTable.size());
 
-	offsetMapPos = (m_exists ? m_offsetTablePos : ftell(m_chan));
+	offsetMapPos = (m_exists ? (m_appendOnly ? m_appendPos : m_offsetTablePos) : ftell(m_chan));
 	fseek(m_chan, offsetMapPos, SEEK_SET);
 
 	TzlOffsetMap::iterator it = m_frameOffsTable.begin();
@@ -614,12 +908,17 @@ TLevelWriterTzl::~TLevelWriterTzl()
 		tfwrite(&thumbnailLength, 1, m_chan);
 	}
 
+	// The header must point to the new tables only once these (and the frames they
+	// refer to) are on disk - until then, the previous tables stay valid.
+	syncFile(m_chan);
+
 	fseek(m_chan, m_frameCountPos, SEEK_SET);
 	TINT32 frameCount = m_frameCount;
 
 	tfwrite(&frameCount, 1, m_chan);
 	tfwrite(&offsetMapPos, 1, m_chan);
 	tfwrite(&iconOffsetMapPos, 1, m_chan);
+	syncFile(m_chan);
 	fclose(m_chan);
 	m_chan = 0;
 
@@ -641,7 +940,12 @@ TLevelWriterTzl::~TLevelWriterTzl()
 	// Se lo spazio libero (cioè la somma di tutti i buchi che si sono creati tra i frame)
 	// è maggiore di una certa soglia oppure è stato rimosso almeno un frame allora ottimizzo il file
 	// (in pratica risalvo il file da capo senza buchi).
-	if (getFreeSpace() > 0.3 || erasedFrame)
+	// In append-only mode removed frames are just free space, and the file is
+	// rewritten in the background.
+	if (m_appendOnly) {
+		if (getFreeSpace() > c_optimizeThreshold)
+			TzlOptimizer::instance()->schedule(m_path, m_userIconSize);
+	} else if (getFreeSpace() > c_optimizeThreshold || erasedFrame)
 		optimize();
 }
 
@@ -755,6 +1059,25 @@ TINT32 TLevelWriterTzl::findSavingChunk(const TFrameId &fid, TINT32 length, bool
 		return m_offsetTablePos - length;
 	}
 }
+
+//-------------------------------------------------------------------
+
+TINT32 TLevelWriterTzl::findAppendingChunk(const TFrameId &fid, TINT32 length, bool isIcon)
+{
+	// il chunk del fid, se c'e', diventa libero - but it is not overwritten, since the
+	// tables in the file still refer to it
+	TzlOffsetMap &offsTable = isIcon ? m_iconOffsTable : m_frameOffsTable;
+
+	TzlOffsetMap::iterator it = offsTable.find(fid);
+	if (it != offsTable.end()) {
+		addFreeChunk(it->second.m_offs, it->second.m_length);
+		offsTable.erase(it);
+	} else if (!isIcon)
+		m_frameCount++;
+
+	m_appendPos += length;
+	return m_appendPos - length;
+}
 //-------------------------------------------------------------------
 bool TLevelWriterTzl::convertToLatestVersion()
 {
@@ -1017,7 +1340,7 @@ void TLevelWriterTzl::saveImage(const TImageP &img, const TFrameId &_fid, bool i
 			m_iconOffsTable[fid] = TzlChunk(offs, length);
 
 	} else {
-		long frameOffset = findSavingChunk(fid, length, isIcon);
+		long frameOffset = m_appendOnly ? findAppendingChunk(fid, length, isIcon) : findSavingChunk(fid, length, isIcon);
 		if (!isIcon)
 			m_frameOffsTable[fid] = TzlChunk(frameOffset, length);
 		else
@@ -1378,11 +1701,13 @@ float TLevelWriterTzl::getFreeSpace()
 		for (; it != m_freeChunks.end(); ++it)
 			freeSpace += it->m_length;
 
+		TINT32 dataEnd = m_appendOnly ? m_appendPos : m_offsetTablePos;
+
 		TINT32 totalSpace = 0;
 		if (m_version == 13)
-			totalSpace = m_offsetTablePos - 6 * sizeof(TINT32) - 4 * sizeof(char) - 8 * sizeof(char);
+			totalSpace = dataEnd - 6 * sizeof(TINT32) - 4 * sizeof(char) - 8 * sizeof(char);
 		else if (m_version == 14)
-			totalSpace = m_offsetTablePos - 6 * sizeof(TINT32) - 4 * sizeof(char) - 8 * sizeof(char) - CREATOR_LENGTH * sizeof(char);
+			totalSpace = dataEnd - 6 * sizeof(TINT32) - 4 * sizeof(char) - 8 * sizeof(char) - CREATOR_LENGTH * sizeof(char);
 		assert(totalSpace > 0);
 		return (float)freeSpace / totalSpace;
 	}
@@ -1391,42 +1716,7 @@ float TLevelWriterTzl::getFreeSpace()
 // creo il file ottimizzato, cioè senza spazi liberi
 bool TLevelWriterTzl::optimize()
 {
-	TFileStatus fs(m_path);
-	assert(fs.doesExist());
-
-	std::string tempName = "~" + m_path.getName() + "tmp&.tlv";
-	TFilePath tempPath = TSystem::getTempDir() + tempName; // Path temporaneo del file ottimizzato
-
-	if (TSystem::doesExistFileOrLevel(tempPath))
-		TSystem::deleteFile(tempPath);
-
-	TLevelWriterP lw(tempPath);
-
-	TLevelReaderP lr(m_path);
-	lw->setIconSize(m_userIconSize);
-	TLevelP level = lr->loadInfo();
-	if (!level || level->getFrameCount() == 0)
-		return false;
-	TLevel::Iterator levelIt = level->begin();
-	for (levelIt; levelIt != level->end(); ++levelIt) {
-		TToonzImageP img = lr->getFrameReader(levelIt->first)->load();
-		assert(img);
-		lw->getFrameWriter(levelIt->first)->save(img);
-	}
-	lr = TLevelReaderP();
-	lw = TLevelWriterP();
-
-	// Se il file tempPath (ottimizzato) è stato creato
-	// lo copio sostituendolo ad m_path
-	if (TSystem::doesExistFileOrLevel(tempPath)) {
-		assert(m_path != tempPath);
-		if (TSystem::doesExistFileOrLevel(m_path))
-			TSystem::deleteFile(m_path); // Cancello il file non ottimizzato
-		TSystem::copyFile(m_path, tempPath);
-		TSystem::deleteFile(tempPath);
-	} else
-		return false;
-	return true;
+	return optimizeLevel(m_path, m_userIconSize);
 }
 
 //===================================================================
@@ -1466,9 +1756,8 @@ void TLevelReaderTzl::readPalette()
 //---------------------------------------------------
 
 TLevelReaderTzl::TLevelReaderTzl(const TFilePath &path)
-	: TLevelReader(path), m_chan(0), m_res(0, 0), m_xDpi(0), m_yDpi(0), m_version(0), m_frameOffsTable(), m_iconOffsTable(), m_level(), m_readPalette(true)
+	: TLevelReader(path), m_chan(0), m_file(0), m_data(0), m_dataSize(0), m_res(0, 0), m_xDpi(0), m_yDpi(0), m_version(0), m_frameOffsTable(), m_iconOffsTable(), m_level(), m_readPalette(true)
 {
-
 	m_chan = fopen(path, "rb");
 
 	if (!m_chan)
@@ -1477,6 +1766,20 @@ TLevelReaderTzl::TLevelReaderTzl(const TFilePath &path)
 	if (!readHeaderAndOffsets(m_chan, m_frameOffsTable, m_iconOffsTable, m_res, m_version, m_creator, 0, 0, 0, m_level))
 		return;
 
+#if TNZ_LITTLE_ENDIAN
+	// Current version frames are read from a mapping of the whole file
+	if (m_version == 14) {
+		m_file = new QFile(QString::fromStdWString(path.getWideString()));
+		if (m_file->open(QIODevice::ReadOnly) && m_file->size() < (std::numeric_limits<TINT32>::max)() &&
+			(m_data = m_file->map(0, m_file->size())))
+			m_dataSize = (TINT32)m_file->size();
+		else {
+			delete m_file;
+			m_file = 0;
+		}
+	}
+#endif
+
 	TFilePath historyFp = path.withNoFrame().withType("hst");
 	FILE *historyChan = fopen(historyFp, "r");
 	if (historyChan) {
@@ -1510,6 +1813,10 @@ void TLevelReaderTzl::doReadPalette(bool doReadIt)
 
 TLevelReaderTzl::~TLevelReaderTzl()
 {
+	delete m_file; // Unmaps the file, too
+	m_file = 0;
+	m_data = 0;
+
 	if (m_chan)
 		fclose(m_chan);
 	m_chan = 0;
@@ -1550,6 +1857,8 @@ bool TLevelReaderTzl::getIconSize(TDimension &iconSize)
 	if (m_version < 13)
 		return false;
 	assert(m_chan);
+	QMutexLocker sl(&m_mutex);
+
 	TINT32 currentPos = ftell(m_chan);
 	TzlOffsetMap::iterator it = m_iconOffsTable.begin();
 	TINT32 offs = it->second.m_offs;
@@ -2035,18 +2344,9 @@ TImageP TImageReaderTzl::load13()
 	//ToonzImageUtils::updateRas32(ti);
 }
 
-// Restituisce la regione del raster shrinkata e la relativa savebox.
-TRect applyShrinkAndRegion(TRasterP &ras, int shrink, TRect region, TRect savebox)
+// Restituisce la savebox nelle coordinate della regione shrinkata.
+TRect shrinkSavebox(TRect savebox, int shrink, const TRect &region)
 {
-	// estraggo la regione solo se essa ha coordinate valide.
-	if (!region.isEmpty() && region != TRect() && region.getLx() > 0 && region.getLy() > 0)
-		ras = ras->extract(region);
-	else
-		region = TRect(0, 0, ras->getLx() - 1, ras->getLy() - 1);
-	if (shrink > 1) {
-		ras = TRop::shrink(ras, shrink);
-	}
-	// calcolo la nuova savebox
 	savebox *= region;
 	if (savebox == TRect() || savebox.getLx() <= 0 || savebox.getLy() <= 0)
 		return TRect();
@@ -2061,12 +2361,33 @@ TRect applyShrinkAndRegion(TRasterP &ras, int shrink, TRect region, TRect savebo
 
 //-------------------------------------------------------------------
 
-TImageP TImageReaderTzl::load14()
+// Restituisce la regione del raster shrinkata e la relativa savebox.
+TRect applyShrinkAndRegion(TRasterP &ras, int shrink, TRect region, TRect savebox)
 {
-	FILE *chan = m_lrp->m_chan;
+	// estraggo la regione solo se essa ha coordinate valide.
+	if (!region.isEmpty() && region != TRect() && region.getLx() > 0 && region.getLy() > 0)
+		ras = ras->extract(region);
+	else
+		region = TRect(0, 0, ras->getLx() - 1, ras->getLy() - 1);
+	if (shrink > 1) {
+		ras = TRop::shrink(ras, shrink);
+	}
+	// calcolo la nuova savebox
+	return shrinkSavebox(savebox, shrink, region);
+}
 
-	if (!chan)
+//-------------------------------------------------------------------
+
+/*!
+  Loads the frame at full resolution - or, with \b shrink > 1, already shrunk
+  as applyShrinkAndRegion() would, without building the full resolution raster.
+*/
+TImageP TImageReaderTzl::load14(int shrink)
+{
+	if (!m_lrp->m_chan)
 		return TImageP();
+
+	TzlChunkReader chan(m_lrp->m_chan, m_lrp->m_data, m_lrp->m_dataSize);
 	// SAVEBOX_X0 SAVEBOX_Y0 SAVEBOX_LX SAVEBOX_LY BUFFER_SIZE
 	TINT32 sbx0 = 0, sby0 = 0, sblx, sbly;
 	TINT32 actualBuffSize;
@@ -2086,14 +2407,14 @@ TImageP TImageReaderTzl::load14()
 	if (it == m_lrp->m_frameOffsTable.end() || iconIt == m_lrp->m_iconOffsTable.end())
 		throw TException("Loading tlv: frame ID not found.");
 
-	fseek(chan, it->second.m_offs, SEEK_SET);
-	fread(&sbx0, sizeof(TINT32), 1, chan);
-	fread(&sby0, sizeof(TINT32), 1, chan);
-	fread(&sblx, sizeof(TINT32), 1, chan);
-	fread(&sbly, sizeof(TINT32), 1, chan);
-	fread(&actualBuffSize, sizeof(TINT32), 1, chan);
-	fread(&xdpi, sizeof(double), 1, chan);
-	fread(&ydpi, sizeof(double), 1, chan);
+	chan.seek(it->second.m_offs);
+	chan.read(&sbx0, sizeof(TINT32));
+	chan.read(&sby0, sizeof(TINT32));
+	chan.read(&sblx, sizeof(TINT32));
+	chan.read(&sbly, sizeof(TINT32));
+	chan.read(&actualBuffSize, sizeof(TINT32));
+	chan.read(&xdpi, sizeof(double));
+	chan.read(&ydpi, sizeof(double));
 
 	if (sbx0 < 0 || sby0 < 0 || sblx < 0 || sbly < 0 || sblx > m_lx || sbly > m_ly)
 		throw TException("Loading tlv: savebox dimension error.");
@@ -2110,24 +2431,19 @@ TImageP TImageReaderTzl::load14()
 
 	// Carico l'icona dal file
 	if (m_isIcon) {
-		fseek(chan, iconIt->second.m_offs, SEEK_SET);
-		fread(&iconLx, sizeof(TINT32), 1, chan);
-		fread(&iconLy, sizeof(TINT32), 1, chan);
+		chan.seek(iconIt->second.m_offs);
+		chan.read(&iconLx, sizeof(TINT32));
+		chan.read(&iconLy, sizeof(TINT32));
 		assert(iconLx > 0 && iconLy > 0);
 		if (iconLx < 0 || iconLy < 0 || iconLx > m_lx || iconLy > m_ly)
 			throw TException("Loading tlv: bad icon size.");
-		fread(&actualBuffSize, sizeof(TINT32), 1, chan);
+		chan.read(&actualBuffSize, sizeof(TINT32));
 
 		assert(actualBuffSize > 0 && actualBuffSize <= (int)(iconLx * iconLx * sizeof(TPixelCM32)));
 		if (actualBuffSize <= 0 || actualBuffSize > (int)(iconLx * iconLx * sizeof(TPixelCM32)))
 			throw TException("Loading tlv: icon buffer size error.");
 
-		TRasterCM32P raux = TRasterCM32P(iconLx, iconLy);
-		if (!raux)
-			return TImageP();
-		raux->lock();
-		imgBuff = (UCHAR *)raux->getRawData(); //new UCHAR[imgBuffSize];
-		fread(imgBuff, actualBuffSize, 1, chan);
+		imgBuff = chan.take(actualBuffSize);
 
 #if !TNZ_LITTLE_ENDIAN
 		Header *header = (Header *)imgBuff;
@@ -2141,8 +2457,6 @@ TImageP TImageReaderTzl::load14()
 		if (!codec.decompress(imgBuff, actualBuffSize, ras, m_safeMode))
 			return TImageP();
 		assert((TRasterCM32P)ras);
-		raux->unlock();
-		raux = TRasterCM32P();
 
 #if !TNZ_LITTLE_ENDIAN
 
@@ -2217,16 +2531,8 @@ TImageP TImageReaderTzl::load14()
 	if (actualBuffSize <= 0 || actualBuffSize > (int)(m_lx * m_ly * sizeof(TPixelCM32)))
 		throw TException("Loading tlv: buffer size error");
 
-	TRasterCM32P raux = TRasterCM32P(m_lx, m_ly);
-
-	//imgBuffSize = m_lx*m_ly*sizeof(TPixelCM32);
-
-	raux->lock();
-	imgBuff = (UCHAR *)raux->getRawData(); //new UCHAR[imgBuffSize];
-										   //int ret =
-
-	fread(imgBuff, actualBuffSize, 1, chan);
-	//assert(ret==1);
+	// Compressed data is decoded straight from the file mapping, when available
+	imgBuff = chan.take(actualBuffSize);
 
 	Header *header = (Header *)imgBuff;
 
@@ -2247,8 +2553,6 @@ TImageP TImageReaderTzl::load14()
 		throw TException("Loading tlv: lx dimension error.");
 	if (ras->getLy() != header->m_ly)
 		throw TException("Loading tlv: ly dimension error.");
-	raux->unlock();
-	raux = TRasterCM32P();
 
 #if !TNZ_LITTLE_ENDIAN
 
@@ -2271,7 +2575,34 @@ TImageP TImageReaderTzl::load14()
 	assert(TRect(imgSize).contains(savebox));
 	if (!TRect(imgSize).contains(savebox))
 		throw TException("Loading tlv: bad savebox size.");
-	if (imgSize != savebox.getSize()) {
+	if (shrink > 1) {
+		// Sample the savebox content straight into the shrunk raster
+		TRasterCM32P savedRas = ras;
+		TRasterCM32P shrunkRas((imgSize.lx - 1) / shrink + 1, (imgSize.ly - 1) / shrink + 1);
+		if (!savebox.isEmpty()) {
+			if (savebox.getSize() != ras->getSize())
+				throw TException("Loading tlv: bad savebox size.");
+			shrunkRas->fill(TPixelCM32());
+
+			int x0 = (savebox.x0 + shrink - 1) / shrink, x1 = savebox.x1 / shrink;
+			int y0 = (savebox.y0 + shrink - 1) / shrink, y1 = savebox.y1 / shrink;
+
+			savedRas->lock();
+			shrunkRas->lock();
+			for (int y = y0; y <= y1; ++y) {
+				TPixelCM32 *pixIn = savedRas->pixels(y * shrink - savebox.y0) + x0 * shrink - savebox.x0;
+				TPixelCM32 *pixOut = shrunkRas->pixels(y) + x0;
+				for (int x = x0; x <= x1; ++x, pixIn += shrink, ++pixOut)
+					*pixOut = *pixIn;
+			}
+			shrunkRas->unlock();
+			savedRas->unlock();
+		} else
+			shrunkRas->clear();
+
+		ras = shrunkRas;
+		savebox = shrinkSavebox(savebox, shrink, TRect(imgSize));
+	} else if (imgSize != savebox.getSize()) {
 		TRasterCM32P fullRas(imgSize);
 		TPixelCM32 bgColor;
 		if (!savebox.isEmpty()) {
@@ -2303,6 +2634,13 @@ TImageP TImageReaderTzl::load()
 {
 	int version = m_lrp->m_version;
 	TImageP image = TImageP();
+
+	// Without a region, version 14 frames are shrunk while being decoded
+	bool hasRegion = (m_region != TRect() && m_region.getLx() > 0 && m_region.getLy() > 0);
+	int decodeShrink = (version == 14 && !m_isIcon && !hasRegion) ? tmax(m_shrink, 1) : 1;
+
+	// Frames read from the file mapping need no file positioning, and can be loaded concurrently
+	QMutexLocker sl((version == 14 && m_lrp->m_data) ? 0 : &m_lrp->m_mutex);
 	switch (version) {
 	case 11:
 		if (!m_lrp->m_frameOffsTable.empty())
@@ -2318,7 +2656,7 @@ TImageP TImageReaderTzl::load()
 		break;
 	case 14:
 		if (!m_lrp->m_frameOffsTable.empty() && !m_lrp->m_iconOffsTable.empty())
-			image = load14();
+			image = load14(decodeShrink);
 		break;
 	default:
 		image = load10();
@@ -2326,7 +2664,7 @@ TImageP TImageReaderTzl::load()
 	if (image == TImageP())
 		return TImageP();
 
-	if (!m_isIcon) {
+	if (!m_isIcon && decodeShrink == 1) {
 		TToonzImageP ti = image;
 		if (!ti)
 			return TImageP();
@@ -2396,7 +2734,7 @@ const TImageInfo *TImageReaderTzl::getImageInfo11() const
 	reverse((char *)&ydpi, sizeof(double));
 #endif
 
-	static TImageInfo info;
+	TImageInfo &info = m_info;
 	info.m_x0 = sbx0;
 	info.m_y0 = sby0;
 	info.m_x1 = sbx0 + sblx - 1;
@@ -2481,7 +2819,7 @@ const TImageInfo *TImageReaderTzl::getImageInfo10() const
 
 	delete[] imgBuff;
 
-	static TImageInfo info;
+	TImageInfo &info = m_info;
 	info.m_x0 = sbx0;
 	info.m_y0 = sby0;
 	info.m_x1 = sbx0 + sblx - 1;
@@ -2499,6 +2837,8 @@ const TImageInfo *TImageReaderTzl::getImageInfo10() const
 
 const TImageInfo *TImageReaderTzl::getImageInfo() const
 {
+	QMutexLocker sl(&m_lrp->m_mutex);
+
 	if (m_lrp->m_version > 10 && !m_lrp->m_frameOffsTable.empty())
 		return getImageInfo11();
 	else
@@ -6,6 +6,10 @@
 #include "tlevel_io.h"
 #include <set>
 
+#include <QMutex>
+
+class QFile;
+
 class TImageWriterTzl;
 class TImageReaderTzl;
 
@@ -59,6 +63,9 @@ class TLevelWriterTzl : public TLevelWriter
 
 	bool m_overwritePaletteFlag;
 
+	bool m_appendOnly;	// New chunks are appended instead of reusing free ones
+	TINT32 m_appendPos; // End of the data chunks written so far (append mode)
+
 public:
 	TLevelWriterTzl(const TFilePath &path, TPropertyGroup *winfo);
 	~TLevelWriterTzl();
@@ -70,6 +77,20 @@ public:
 		m_overwritePaletteFlag = overwrite;
 	}
 
+	/*!
+	  Chooses how frames are saved into an already existing file (default is true).
+	  In append-only mode frame chunks and offset tables are never rewritten in place:
+	  they are appended at the end of the file, and the header is made to point to the
+	  new tables only once they are safely on disk - so that an interrupted save leaves
+	  the previous level contents intact. Free space is reclaimed by a background
+	  compaction, when it exceeds a threshold.
+	  Otherwise, frames are written inside the free chunks of the file.
+	*/
+	void setAppendOnly(bool appendOnly)
+	{
+		m_appendOnly = appendOnly;
+	}
+
 	void renumberFids(const std::map<TFrameId, TFrameId> &renumberTable);
 	/*!
 			Setta le dimensioni dell'iconcina nel file.
@@ -104,6 +125,10 @@ public:
 	 */
 	bool optimize();
 
+	//! Cancels the background compaction of the specified level, if any - without
+	//! waiting for it.
+	static void cancelOptimization(const TFilePath &path);
+
 public:
 	static TLevelWriter *create(const TFilePath &f, TPropertyGroup *winfo)
 	{
@@ -121,6 +146,7 @@ private:
 	void buildFreeChunksTable();
 	void addFreeChunk(TINT32 offs, TINT32 length);
 	TINT32 findSavingChunk(const TFrameId &fid, TINT32 length, bool isIcon = false);
+	TINT32 findAppendingChunk(const TFrameId &fid, TINT32 length, bool isIcon = false);
 	//not implemented
 	TLevelWriterTzl(const TLevelWriterTzl &);
 	TLevelWriterTzl &operator=(const TLevelWriterTzl &);
@@ -161,6 +187,10 @@ public:
 
 private:
 	FILE *m_chan;
+	QFile *m_file;		 //!< The level file, when mapped in memory
+	const UCHAR *m_data; //!< The level file's contents, when mapped
+	TINT32 m_dataSize;
+	QMutex m_mutex; //!< Serializes the frame reads through m_chan
 	TLevelP m_level;
 	TDimension m_res;
 	double m_xDpi, m_yDpi;
@@ -14,6 +14,12 @@
 // Qt includes
 #include <QCoreApplication>
 #include <QDir>
+#include <QSharedMemory>
+#include <QMutex>
+#include <QWaitCondition>
+
+// STD includes
+#include <vector>
 
 #undef DVAPI
 #undef DVVAR
@@ -103,6 +109,80 @@ public:
 	int write(char *dstBuf, int len);
 };
 
+//*************************************************************************************
+//  Frame slots
+//*************************************************************************************
+
+/*!
+  FrameSlots is a ring of fixed-size slots in a single shared memory segment, used
+  to exchange frames with the 32-bit server for the whole lifetime of a level
+  reader or writer.
+
+  The segment is created once by the client, and attached once by the server - so
+  that frames are written to and read from the slots directly, without the per-frame
+  segment allocations and chunk handshakes of tipc::readShMemBuffer() and
+  tipc::writeShMemBuffer().
+  \n\n
+  A slot is owned by the client between acquire() and release(), and by the server
+  while processing a request referring to it - ownership is handed over by the
+  messages themselves, so the segment is never locked.
+  \n\n
+  Requests may either be sent synchronously on a connection of the caller, or posted
+  through a persistent connection to the server: posted requests are sent as soon as
+  possible without waiting for the replies to the previous ones, so that up to
+  slotsCount() frames are in flight at once. The slot of a posted request is
+  released as soon as its reply is received.
+*/
+
+class DVAPI FrameSlots
+{
+	class Pipe;
+	Pipe *m_pipe;
+
+	QSharedMemory m_shmem;
+	int m_slotSize, m_slotsCount;
+
+	QMutex m_mutex;
+	QWaitCondition m_slotReleased;
+	std::vector<int> m_freeSlots;
+
+public:
+	FrameSlots(int slotSize, int slotsCount);
+	~FrameSlots();
+
+	//! Returns whether the shared memory segment could be allocated.
+	bool isValid() const { return m_shmem.isAttached(); }
+
+	QString shMemId() const { return m_shmem.key(); }
+	int slotSize() const { return m_slotSize; }
+	int slotsCount() const { return m_slotsCount; }
+
+	//! Returns the byte offset of the specified slot in the shared memory segment.
+	int offset(int slot) const { return slot * m_slotSize; }
+
+	//! Waits for a free slot, and returns it.
+	int acquire();
+	void release(int slot);
+
+	//! Copies the specified 32-bit raster to the specified slot.
+	void write(int slot, const TRasterP &ras);
+	//! Copies the content of the specified slot to the specified 32-bit raster.
+	void read(int slot, const TRasterP &ras) const;
+
+	//! Sends the specified request through the persistent connection, without waiting
+	//! for the reply. The slot is released once the request has been replied.
+	void post(tipc::Message &msg, int slot);
+
+	//! Waits until all posted requests have been replied, and returns whether they
+	//! were all successful since the last flush.
+	bool flush();
+
+private:
+	// Not copyable
+	FrameSlots(const FrameSlots &);
+	FrameSlots &operator=(const FrameSlots &);
+};
+
 } //namespace t32bitsrv
 
 #endif //T32BITSRV_WRAP
@@ -81,6 +81,11 @@ public:
 	// note: if frame is a keyframe separating two segments of different types
 	// (e.g. expression and linear) then getValue(frame,true) can be != getValue(frame,false)
 
+	//! Stores in values[] the param values at frames frame, frame+step, ... (count of them),
+	//! as getValue() would. Keyframe segments are located, and their evaluation prepared,
+	//! once for all the frames they contain.
+	void getValues(double frame, double step, int count, double values[]) const;
+
 	bool setValue(double frame, double value);
 
 	// returns the incoming speed vector for keyframe kIndex. kIndex-1 must be speedinout
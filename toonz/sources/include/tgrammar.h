@@ -30,6 +30,7 @@ namespace TSyntax
 {
 class Token;
 class Calculator;
+class CalculatorNode;
 }
 
 //==============================================
@@ -50,6 +51,80 @@ public:
 
 //-------------------------------------------------------------------
 
+//! The flat form of a calculator nodes tree.
+/*!
+  Nodes compile themselves (see CalculatorNode::compile()) into a sequence of
+  instructions working on a stack of values, which run() executes in a single
+  loop. Nodes without a compiled form are pushed as a whole, and computed
+  recursively.
+*/
+class DVAPI CalculatorProgram
+{
+public:
+	typedef double (*Function1)(double);
+	typedef double (*Function2)(double, double);
+	typedef double (*Function3)(double, double, double);
+
+	enum OpCode {
+		PUSH_NUMBER,   //!< Pushes m_value
+		PUSH_VARIABLE, //!< Pushes vars[m_index]
+		PUSH_NODE,	 //!< Pushes m_node->compute(vars)
+		APPLY1,		   //!< Replaces the top value with m_f1(top)
+		APPLY2,		   //!< Replaces the 2 top values with m_f2(a, b)
+		APPLY3,		   //!< Replaces the 3 top values with m_f3(a, b, c)
+		NEGATE,		   //!< Replaces the top value with -top
+		NOT,		   //!< Replaces the top value with (top == 0)
+		JUMP_IF_ZERO,  //!< Pops a value, and jumps to m_index if it is 0
+		JUMP		   //!< Jumps to m_index
+	};
+
+	struct Instruction {
+		OpCode m_code;
+		union {
+			double m_value;
+			int m_index;
+			const CalculatorNode *m_node;
+			Function1 m_f1;
+			Function2 m_f2;
+			Function3 m_f3;
+		};
+	};
+
+public:
+	CalculatorProgram() : m_depth(0), m_maxDepth(0) {}
+
+	void clear();
+	bool isEmpty() const { return m_instructions.empty(); }
+
+	void pushNumber(double value);
+	void pushVariable(int varIdx);
+	void pushNode(const CalculatorNode *node);
+
+	void apply(Function1 f);
+	void apply(Function2 f);
+	void apply(Function3 f);
+	void negate();
+	void logicalNot();
+
+	//! Adds a conditional jump, to be resolved with setJumpTarget(); returns its position.
+	int jumpIfZero();
+	//! Adds a jump ending a branch that left a value on the stack - the instructions
+	//! that follow start without it; returns its position.
+	int jump();
+	//! Makes the jump at the specified position land on the next added instruction.
+	void setJumpTarget(int jumpPos);
+
+	double run(double vars[3]) const;
+
+private:
+	std::vector<Instruction> m_instructions;
+	int m_depth, m_maxDepth; //!< Stack depth at the end of the program, and its maximum
+
+	void add(const Instruction &instr, int depthDelta);
+};
+
+//-------------------------------------------------------------------
+
 class DVAPI CalculatorNode
 {
 	Calculator *m_calculator;
@@ -65,6 +140,10 @@ public:
 		   RFRAME };
 	virtual double compute(double vars[3]) const = 0;
 
+	//! Appends the instructions computing the node to the program - by default,
+	//! the node is computed as a whole.
+	virtual void compile(CalculatorProgram &program) const { program.pushNode(this); }
+
 	virtual void accept(CalculatorNodeVisitor &visitor) = 0;
 
 private:
@@ -78,6 +157,7 @@ private:
 class DVAPI Calculator
 {
 	CalculatorNode *m_rootNode; //!< (owned) Root calculator node
+	CalculatorProgram m_program; //!< The root node, compiled
 
 	TDoubleParam *m_param; //!< (not owned) Owner of the calculator object
 	const TUnit *m_unit;   //!< (not owned)
@@ -92,7 +172,7 @@ public:
 	{
 		double vars[3];
 		vars[0] = t, vars[1] = frame, vars[2] = rframe;
-		return m_rootNode->compute(vars);
+		return m_program.run(vars);
 	}
 
 	void accept(CalculatorNodeVisitor &visitor) { m_rootNode->accept(visitor); }
@@ -121,6 +201,7 @@ public:
 	NumberNode(Calculator *calc, double value) : CalculatorNode(calc), m_value(value) {}
 
 	double compute(double vars[3]) const { return m_value; }
+	void compile(CalculatorProgram &program) const { program.pushNumber(m_value); }
 
 	void accept(CalculatorNodeVisitor &visitor) {}
 };
@@ -136,6 +217,7 @@ public:
 		: CalculatorNode(calc), m_varIdx(varIdx) {}
 
 	double compute(double vars[3]) const { return vars[m_varIdx]; }
+	void compile(CalculatorProgram &program) const { program.pushVariable(m_varIdx); }
 
 	void accept(CalculatorNodeVisitor &visitor) {}
 };
@@ -64,6 +64,17 @@ public:
 	// If not implemented returns 0;
 	virtual int skipLines(int lineCount) = 0;
 
+	/*!
+	  Asks the reader to decode the image at a reduced resolution, for formats
+	  that can do so without decoding all of the full resolution pixels.
+	  Must be invoked before open(). Returns the reduction factor actually
+	  applied, which divides \b shrink - or 1 if unsupported.
+	  The image info keeps describing the full resolution image, whereas
+	  readLine() and skipLines() work on the reduced one - whose lines are
+	  (lx + factor - 1) / factor pixels long, in the same number.
+	*/
+	virtual int setDecodeShrink(int shrink) { return 1; }
+
 	virtual RowOrder getRowOrder() const { return BOTTOM2TOP; }
 	virtual bool read16BitIsEnabled() const { return false; }
 
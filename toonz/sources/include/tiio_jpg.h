@@ -34,6 +34,7 @@ class DVAPI JpgReader : public Tiio::Reader
 	FILE *m_chan;
 	JSAMPARRAY m_buffer;
 	bool m_isOpen;
+	int m_decodeShrink;
 
 public:
 	JpgReader();
@@ -45,6 +46,9 @@ public:
 
 	void readLine(char *buffer, int x0, int x1, int shrink);
 	int skipLines(int lineCount);
+
+	//! Uses libjpeg's DCT scaling, by 1/2, 1/4 or 1/8.
+	int setDecodeShrink(int shrink);
 };
 
 DVAPI Tiio::ReaderMaker makeJpgReader;
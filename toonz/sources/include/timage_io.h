@@ -100,6 +100,7 @@ protected:
 	bool m_readGreytones;
 	bool m_is64BitEnabled;
 	int m_shrink;
+	int m_decodeShrink; // Reduction factor applied by m_reader while decoding
 	TRect m_region;
 	static bool m_safeMode;
 
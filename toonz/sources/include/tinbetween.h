@@ -6,6 +6,8 @@
 //#include "tvectorimage.h"
 #include "tcommon.h"
 
+#include <vector>
+
 class TVectorImageP;
 
 #undef DVAPI
@@ -31,6 +33,24 @@ public:
 	virtual ~TInbetween();
 
 	TVectorImageP tween(double t) const;
+
+	//! Receives notifications about the progress of a batch tween() invocation.
+	class Listener
+	{
+	public:
+		virtual ~Listener() {}
+
+		/*! Invoked periodically in the \a calling thread while frames are being
+		    generated. Returns false to cancel the frames not yet started.  */
+		virtual bool onProgress(int doneFrames, int totalFrames) = 0;
+	};
+
+	/*! Generates the inbetweens at each of the specified interpolation parameters,
+	    reusing the stroke correspondences computed at construction. Frames are built
+	    concurrently on worker threads; the function returns once all of them are
+	    done. Frames skipped due to cancellation are returned as empty pointers.  */
+	void tween(const std::vector<double> &ts, std::vector<TVectorImageP> &images,
+			   Listener *listener = 0) const;
 };
 
 #endif
@@ -240,7 +240,7 @@ public:
 
 inline bool isMovieType(string type)
 {
-	return (type == "mov" || type == "avi" || type == "3gp");
+	return (type == "mov" || type == "avi" || type == "3gp" || type == "mp4");
 }
 
 //-----------------------------------------------------------
@@ -0,0 +1,91 @@
+
+
+#ifndef FRAMEPREFETCHER_H
+#define FRAMEPREFETCHER_H
+
+// TnzCore includes
+#include "tthread.h"
+
+// STD includes
+#include <vector>
+
+#undef DVAPI
+#undef DVVAR
+#ifdef TOONZLIB_EXPORTS
+#define DVAPI DV_EXPORT_API
+#define DVVAR DV_EXPORT_VAR
+#else
+#define DVAPI DV_IMPORT_API
+#define DVVAR DV_IMPORT_VAR
+#endif
+
+//=====================================================
+
+//! Frames loaded in background ahead of the current one, during playback
+const int c_prefetchedFramesCount = 8;
+
+//=====================================================
+
+//  Forward declarations
+
+class TFrameId;
+class TXsheet;
+class TXshSimpleLevel;
+
+//=====================================================
+
+//***************************************************************************************
+//    FramePrefetcher declaration
+//***************************************************************************************
+
+//! FramePrefetcher is a singleton class loading level frames ahead of their use.
+/*!
+    Frames are loaded on a small pool of background threads through
+    TXshSimpleLevel::getFrame(), so that they get stored in the ImageManager's cache -
+    where subsequent getFrame() invocations, typically from playback, will find them.
+    \n\n
+    Each prefetch request \a replaces the pending ones, so that callers can simply
+    resubmit the frames they are about to need at every frame change. Frames already
+    in cache are skipped, and loads already in progress are completed anyway.
+
+    \sa The ImageManager class.
+*/
+
+class DVAPI FramePrefetcher
+{
+	TThread::Executor m_executor;
+
+public:
+	static FramePrefetcher *instance();
+
+	//! Sets the maximum number of frames being loaded at the same time (default is 2).
+	void setThreadsCount(int count);
+
+	//! Queues the specified level frames for loading, in priority order. A 0 \b subsampling
+	//! stands for the level's own one - the one viewers request.
+	void prefetch(TXshSimpleLevel *sl, const std::vector<TFrameId> &fids, int subsampling = 0);
+
+	//! Queues the \b framesCount level frames following the one at \b index, along the
+	//! specified direction (+1 for forward playback, -1 for backward).
+	void prefetch(TXshSimpleLevel *sl, int index, int direction, int framesCount, int subsampling = 0);
+
+	/*!
+    Queues the frames of the levels exposed in the \b rowsCount xsheet rows following
+    \b row along the specified direction (+1 for forward playback, -1 for backward).
+    Nearer rows are loaded first.
+  */
+	void prefetch(TXsheet *xsh, int row, int direction, int rowsCount, int subsampling = 0);
+
+	//! Discards all pending requests - typically when the current frame jumps elsewhere.
+	void cancel();
+
+private:
+	FramePrefetcher();
+	~FramePrefetcher();
+
+	// Not copyable
+	FramePrefetcher(const FramePrefetcher &);
+	FramePrefetcher &operator=(const FramePrefetcher &);
+};
+
+#endif // FRAMEPREFETCHER_H
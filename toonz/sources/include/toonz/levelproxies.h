@@ -0,0 +1,108 @@
+
+
+#ifndef LEVELPROXIES_H
+#define LEVELPROXIES_H
+
+// TnzCore includes
+#include "tthread.h"
+#include "tfilepath.h"
+
+// Qt includes
+#include <QMutex>
+#include <QDateTime>
+
+// STD includes
+#include <map>
+#include <vector>
+
+#undef DVAPI
+#undef DVVAR
+#ifdef TOONZLIB_EXPORTS
+#define DVAPI DV_EXPORT_API
+#define DVVAR DV_EXPORT_VAR
+#else
+#define DVAPI DV_IMPORT_API
+#define DVVAR DV_IMPORT_VAR
+#endif
+
+//=====================================================
+
+//  Forward declarations
+
+class TXshSimpleLevel;
+
+//=====================================================
+
+//***************************************************************************************
+//    LevelProxies declaration
+//***************************************************************************************
+
+//! LevelProxies is a singleton class managing reduced resolution copies of raster levels.
+/*!
+    Proxies are half and quarter resolution copies of Toonz raster and raster levels,
+    written in background into the \a proxies folder of the level's project. They are
+    keyed by the level path and the latest modification time of its files, so that
+    outdated proxies get replaced whenever a level is changed.
+    \n\n
+    Subsampled image loads (see the ImageManager class) read the proxy with the largest
+    reduction factor dividing the required subsampling, when available - so that viewers
+    and shrunk renders need not access the original files at all.
+
+    \note Proxies are generated only for image sequences and Toonz raster levels - movie
+    formats are left out since their readers may not be used in background.
+*/
+
+class DVAPI LevelProxies
+{
+	class BuildTask;
+	friend class BuildTask;
+
+	TThread::Executor m_executor;
+
+	struct Proxies {
+		std::map<int, TFilePath> m_paths; //!< Proxy paths by shrink
+		QDateTime m_modTime;			  //!< Level modification time the proxies refer to
+	};
+
+	mutable QMutex m_mutex;
+	std::map<TFilePath, Proxies> m_proxies; //!< Available proxies, by decoded level path
+
+public:
+	static LevelProxies *instance();
+
+	//! Returns the reduction factors of the generated proxies, in decreasing order.
+	static const std::vector<int> &getShrinks();
+
+	//! Returns whether proxies can be generated for the specified level.
+	static bool canHaveProxies(TXshSimpleLevel *sl);
+
+	//! Queues the generation of the proxies of the specified level, unless up-to-date
+	//! ones are found on disk.
+	void build(TXshSimpleLevel *sl);
+
+	//! Makes the proxies of the specified decoded level path unavailable - typically
+	//! because the level is being overwritten.
+	void invalidate(const TFilePath &levelPath);
+
+	/*!
+    Returns the path of the available proxy of the specified decoded level path whose
+    reduction factor, returned in \b proxyShrink, is the largest one dividing \b shrink.
+    An empty path is returned if there is no such proxy, or if the file of frame \b fid
+    was modified after the proxies were generated.
+  */
+	TFilePath getProxyPath(const TFilePath &levelPath, const TFrameId &fid,
+						   int shrink, int &proxyShrink) const;
+
+private:
+	LevelProxies();
+	~LevelProxies();
+
+	void setProxies(const TFilePath &levelPath, const std::map<int, TFilePath> &proxyPaths,
+					const QDateTime &modTime);
+
+	// Not copyable
+	LevelProxies(const LevelProxies &);
+	LevelProxies &operator=(const LevelProxies &);
+};
+
+#endif // LEVELPROXIES_H
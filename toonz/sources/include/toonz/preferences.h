@@ -105,6 +105,9 @@ public:
 		return m_autosaveEnabled;
 	}
 
+	void enableAutosaveSnapshots(bool on);
+	bool isAutosaveSnapshotsEnabled() const { return m_autosaveSnapshotsEnabled; }
+
 	void setAutosavePeriod(int minutes);
 	int getAutosavePeriod() const
 	{
@@ -114,6 +117,9 @@ public:
 	void enableLevelsBackup(bool enabled);
 	bool isLevelsBackupEnabled() const { return m_levelsBackupEnabled; }
 
+	void enableLevelProxies(bool enabled);
+	bool isLevelProxiesEnabled() const { return m_levelProxiesEnabled; }
+
 	void enableSceneNumbering(bool enabled);
 	bool isSceneNumberingEnabled() const { return m_sceneNumberingEnabled; }
 
@@ -487,6 +493,7 @@ private:
 		m_rewindAfterPlaybackEnabled,
 		m_fitToFlipbookEnabled,
 		m_autosaveEnabled,
+		m_autosaveSnapshotsEnabled,
 		m_defaultViewerEnabled;
 	bool m_rasterOptimizedMemory,
 		m_saveUnpaintedInCleanup,
@@ -494,6 +501,7 @@ private:
 		m_automaticSVNFolderRefreshEnabled,
 		m_SVNEnabled,
 		m_levelsBackupEnabled,
+		m_levelProxiesEnabled,
 		m_minimizeSaveboxAfterEditing,
 		m_sceneNumberingEnabled,
 		m_animationSheetEnabled,
@@ -109,6 +109,10 @@ public:
 private:
 	void getImageInfo(TImageInfo &imageInfo, TXshSimpleLevel *sl, TFrameId frameId);
 
+	//! Returns the shrink of the level proxies usable to render the specified frame
+	//! with the specified settings, or 1 if none.
+	int getProxyShrink(TXshSimpleLevel *sl, const TFrameId &fid, const TRenderSettings &info);
+
 	TImageP applyTzpFxs(TToonzImageP &ti, double frame, const TRenderSettings &info);
 	void applyTzpFxsOnVector(const TVectorImageP &vi,
 							 TTile &tile, double frame, const TRenderSettings &info);
@@ -8,6 +8,9 @@
 #include "traster.h"
 #include "tstream.h"
 
+// STD includes
+#include <set>
+
 #undef DVAPI
 #undef DVVAR
 #ifdef TOONZLIB_EXPORTS
@@ -88,12 +91,43 @@ public:
 
 	void save(const TFilePath &path, TXsheet *subxsheet = 0);		   //!< Saves the scene (or a sub-xsheet) at the
 																	   //!  specified path.
+
+	//! Scene data a snapshot can take from the previous one, if unchanged.
+	enum SnapshotSection {
+		LevelSetSection = 0x1,
+		XsheetSection = 0x2
+	};
+
+	/*! \details  Snapshots hold the same data as scene files in a binary format,
+                and are loaded the same way. Unlike save(), the scene path and
+                resources are left untouched - file paths are coded for the scene's
+                own location. The \p unchangedSections (a combination of
+                SnapshotSection values) are taken from the previous snapshot saved
+                at the same path, instead of being serialized again: the caller
+                guarantees they were not modified since.                            */
+
+	void saveSnapshot(const TFilePath &path, int unchangedSections = 0); //!< Saves a binary snapshot of the scene data.
+	void loadSnapshot(const TFilePath &path, const TFilePath &scenePath); //!< Loads a snapshot of the scene at \p scenePath,
+																		  //!  resources included.
+
+	static TFilePath getSnapshotPath(const TFilePath &scenePath); //!< Returns the path of the autosave snapshot
+																  //!  of the specified scene.
 	void loadTnzFile(const TFilePath &path);						   //!< Loads scene data from file, \a excluding the
 																	   //!  associated project and the scene resources.
 	void loadNoResources(const TFilePath &path);					   //!< Loads a scene \a without loading its resources.
 	void loadResources(bool withProgressDialog = false);			   //!< Loads the scene resources.
 	void load(const TFilePath &path, bool withProgressDialog = false); //!  Loads a scene from file.
 
+	/*! \details  Meant to follow loadNoResources(): only image levels exposed in
+                rows [r0, r1] - sub-xsheets included - are loaded, the others are
+                deferred to subsequent calls.                                         */
+
+	void loadResources(int r0, int r1); //!< Loads the resources needed to render the specified rows.
+	bool hasDeferredResources() const   //!  Whether some resources are still to be loaded.
+	{
+		return !m_deferredLevels.empty();
+	}
+
 	/*! \return   The \a coded path to be used for import. */
 
 	TFilePath getImportedLevelPath(const TFilePath path) const; //!< Builds the path to be used during a level import
@@ -238,12 +272,17 @@ private:
 	bool m_isUntitled; //!< Whether the scene is untitled.
 					   //!  \sa  The setUntitled() member function.
 	VersionNumber m_versionNumber;
+	std::set<TXshLevel *> m_deferredLevels; //!< Levels still to be loaded.
+											//!  \sa  Member function loadResources(int, int).
 
 private:
 	// noncopyable
 	ToonzScene(const ToonzScene &);
 	ToonzScene &operator=(const ToonzScene &);
 
+	void saveTnzFile(TOStream &os, TXsheet *subxsheet, int unchangedSections = 0); //!< Writes the scene data to os.
+	void loadNoResources(const TFilePath &path, const TFilePath &scenePath);
+
 	// if the option is set in the preferences,
 	// remove the scene numbers("c####_") from the file name
 	std::wstring getLevelNameWithoutSceneNumber(std::wstring orgName);
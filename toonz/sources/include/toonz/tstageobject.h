@@ -20,6 +20,7 @@
 
 // Qt includes
 #include <QStack>
+#include <QMutex>
 
 #undef DVAPI
 #undef DVVAR
@@ -405,7 +406,8 @@ public:
 	//! Makes all children of \e this childern of \e parentId.
 	void attachChildrenToParent(const TStageObjectId &parentId);
 
-	//! Resets the area position setting internal time of the object and of all his children to -1.
+	//! Resets the area position setting internal time of the object and of all his children to -1,
+	//! discarding their memoized placements. To be called whenever their placements change.
 	void invalidate();
 
 	/*!
@@ -464,13 +466,21 @@ private:
 	struct LazyData {
 		KeyframeMap m_keyframes;
 		double m_time;
+		bool m_notifiedValues; //!< Whether no animated param has expression or similar shape keyframes
 
 		LazyData();
 	};
 
+	typedef std::map<double, TAffine> PlacementsMap;
+
 private:
 	tcg::invalidable<LazyData> m_lazyData;
 
+	mutable PlacementsMap m_placements; //!< Memoized absolute placements by frame - see getPlacement()
+	mutable QMutex m_placementsMutex;   //!< Guards m_placements, read by concurrent render threads
+	mutable int m_placementsRevision;   //!< Incremented whenever m_placements is cleared
+	int m_placementsSplineRevision;		//!< Motion path revision the placements were computed with
+
 	TStageObjectId m_id;
 	TStageObjectTree *m_tree;
 	TStageObject *m_parent;
@@ -529,8 +539,13 @@ private:
 	TPointD getHandlePos(string handle, int row) const;
 	TAffine computeLocalPlacement(double frame);
 	TStageObject *findRoot(double frame) const;
+	//! Like invalidate(), but keeps the memoized placements - the evaluation moved to another frame.
+	void resetPlacementTime();
 	TStageObject *getPinnedDescendant(int frame);
 
+	bool canMemoizePlacement(bool refresh);
+	void memoizePlacement(double frame, const TAffine &placement, int revision);
+
 private:
 	// Lazy data-related functions
 
@@ -45,6 +45,7 @@ class DVAPI TStageObjectSpline : public TSmartObject, public TPersist
 	string m_name;
 	bool m_isOpened;
 	std::vector<TDoubleParam *> m_posPathParams;
+	int m_revision;
 
 public:
 	TStageObjectSpline();
@@ -63,6 +64,10 @@ public:
   */
 	void setStroke(TStroke *stroke); //! keeps ownership
 
+	//! Returns a number identifying the current stroke; it changes, among all
+	//! splines, whenever a stroke is set or loaded.
+	int getRevision() const { return m_revision; }
+
 	TPointD getDagNodePos() const { return m_dagNodePos; }
 	void setDagNodePos(const TPointD &pos) { m_dagNodePos = pos; }
 
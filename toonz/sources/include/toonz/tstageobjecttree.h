@@ -21,6 +21,7 @@ class TStageObjectSpline;
 class TCamera;
 
 class TXsheet;
+class QMutex;
 
 //=============================================================================
 // HandleManager
@@ -216,6 +217,10 @@ public:
 	void setGrammar(const TDoubleParamP &param);
 	TSyntax::Grammar *getGrammar() const;
 
+	//! Returns the (recursive) lock serializing the placement evaluations of the
+	//! tree's objects - see TStageObject::getPlacement().
+	QMutex *getEvaluationMutex() const;
+
 	/*!
 		Returns the number of camera objects in the tree.
 	*/
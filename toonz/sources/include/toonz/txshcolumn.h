@@ -6,6 +6,7 @@
 #include "tcolumnset.h"
 #include "tpersist.h"
 #include "traster.h"
+#include "toonz/txshcell.h"
 
 #undef DVAPI
 #undef DVVAR
@@ -243,8 +244,10 @@ typedef TSmartPointerT<TXshColumn> TXshColumnP;
 \n This is an abstract base class inherited by the concrete classes
    \b TXshLevelColumn and \b TXshZeraryFxColumn. 
 
-   The class defines column by cells getCellColumn(). TXshCellColumn is an object
-   composed of a \b TXshCell vector and of an integer to memorize first not empty cell.
+   The class defines column by cells getCellColumn(). TXshCellColumn stores its cells
+   as runs of identical cells (holds), sorted by row: a cell is found by binary search
+   among the runs, and editing a range of rows costs in proportion to the runs, not
+   to the rows, involved.
 
    Class allows to manage cells in a column.
    It's possible to know if cell is empty isCellEmpty(), if column is empty
@@ -259,8 +262,17 @@ typedef TSmartPointerT<TXshColumn> TXshColumnP;
 class DVAPI TXshCellColumn : public TXshColumn
 {
 protected:
-	vector<TXshCell> m_cells;
-	int m_first;
+	//! A run of identical cells, from m_row up to the next run's row.
+	struct CellRun {
+		TXshCell m_cell;
+		int m_row;
+
+		CellRun(const TXshCell &cell, int row) : m_cell(cell), m_row(row) {}
+	};
+
+	vector<CellRun> m_runs; //!< Cells in rows [m_first, m_end) - first and last runs are not empty
+	int m_first;			//!< First not empty row
+	int m_end;				//!< Row following the last not empty one
 
 public:
 	/*!
@@ -356,6 +368,14 @@ public:
 	virtual bool getLevelRange(int row, int &r0, int &r1) const;
 
 	//virtual void updateIcon() = 0;
+
+private:
+	int findRun(int row) const;
+	int splitRun(int row);
+	void mergeRun(int i);
+	void shiftRuns(int i, int delta);
+	void trimRuns();
+	void replaceRuns(int row, int rowCount, const vector<CellRun> &runs);
 };
 
 #endif
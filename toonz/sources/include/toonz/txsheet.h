@@ -206,6 +206,12 @@ public:
 		\sa isLevelUsed()
 	*/
 	void getUsedLevels(std::set<TXshLevel *> &levels) const;
+	/*! Like getUsedLevels(), but only cells in rows [\b \e r0, \b \e r1] are considered.
+		Sub-xsheet levels are taken from the sub-xsheet rows actually exposed by those cells.
+		Xsheets containing fxs which may read other frames than the rendered one (particles,
+		motion blurs, plugins) contribute all their levels.
+	*/
+	void getUsedLevels(std::set<TXshLevel *> &levels, int r0, int r1) const;
 	/*! Returns true if \b \e level is used in current xsheet or in sub-xsheet, otherwise returns
 		false. It verifies if \b \e level is contained in level set \b getUsedLevels().
 	*/
@@ -177,6 +177,7 @@ public:
 	/*!
     \param fp           Output file path
     \param compressed   Enables compression of the whole file
+    \param binary       Writes a binary snapshot instead of XML
 
     \note     Stream construction <I> does not throw </I>. However, the stream
               status could be invalid. Remeber to check the stream validity using
@@ -184,8 +185,14 @@ public:
 
     \warning  Stream compression has been verified to be unsafe.
               Please consider it \a deprecated.
+
+    \note     Binary snapshots store each child of the root tag in a separate
+              file of the <TT>\<name\>_sections</TT> folder, named after its
+              content hash - so sections unchanged since the previous snapshot at
+              the same path are not written again. Snapshots are written when the
+              root tag is closed, and read back transparently by TIStream.
   */
-	TOStream(const TFilePath &fp, bool compressed = false); //!< Opens the specified file for write
+	TOStream(const TFilePath &fp, bool compressed = false, bool binary = false); //!< Opens the specified file for write
 	~TOStream();											//!< Closes the file and destroys the stream
 
 	//! \sa std::basic_ostream::operator void*().
@@ -221,6 +228,15 @@ public:
 
 	void closeChild(); //!< Closes current tag, writing </currentTagName> to the stream.
 
+	/*! \details  Meant for binary snapshots, in place of writing a child of the root
+                tag the caller knows to be unchanged since the previous snapshot
+                written at the same path - in this process. The section is not
+                serialized again: the new snapshot refers to the previous one's.
+
+      \return   Whether the section was reused. If not, the caller must write it. */
+
+	bool reuseSection(string tagName); //!< Refers to the section \p tagName of the previous snapshot.
+
 	void cr(); //!< Writes carriage return to the stream. \deprecated
 
 	void tab(int dt); //!< \deprecated
@@ -8,6 +8,8 @@
 #include <QString>
 #include <QThread>
 
+#include <vector>
+
 //---------------------------------------------------------------------
 
 #ifdef TFARMAPI
@@ -28,6 +30,15 @@
 
 class TTcpIpServerImp;
 
+//! TTcpIpServer listens for connections on the specified port.
+/*!
+  Connections are persistent: each one is served by its own thread, which reads
+  binary requests (see TTcpIpConnection) and passes them to onReceive() as soon
+  as they arrive - so that clients may pipeline their requests. Replies are sent
+  back as soon as they are available. The legacy text messages, made of a single
+  request per connection, are accepted too.
+*/
+
 class TFARMAPI TTcpIpServer : public QThread
 {
 	int m_exitCode;
@@ -41,9 +52,8 @@ public:
 	void run();
 	int shutdown();
 
-	virtual void onReceive(int socket, const QString &data) = 0;
-
-	void sendReply(int socket, const QString &reply);
+	//! Serves a request, returning its reply. Calls are serialized.
+	virtual QString onReceive(const std::vector<QString> &argv) = 0;
 
 	int getExitCode() const;
 
@@ -78,4 +88,48 @@ public:
 	int send(int sock, const QString &data, QString &reply);
 };
 
+//---------------------------------------------------------------------
+
+class TTcpIpConnectionImp;
+
+//! TTcpIpConnection is a persistent connection to a TTcpIpServer.
+/*!
+  Messages are exchanged in a length-prefixed binary format. Requests are tagged
+  with an id which the server's replies refer to, so that any number of threads
+  may send requests through the same connection without waiting for each other's
+  replies. Posted messages get no reply at all, and return as soon as they are
+  written.
+  \n\n
+  The connection is established on first use, and again on the first use after
+  a failure. A request whose reply doesn't arrive in time fails, and drops the
+  connection along with any other pending request.
+*/
+
+class TFARMAPI TTcpIpConnection
+{
+public:
+	enum { DefaultReplyTimeout = 60000 };
+
+public:
+	TTcpIpConnection(const QString &hostName, const QString &addr, int port);
+	~TTcpIpConnection();
+
+	//! Returns the connection to the specified server shared by the whole process.
+	static TTcpIpConnection *instance(const QString &hostName, const QString &addr, int port);
+
+	//! Returns whether the connection is currently established.
+	bool isConnected() const;
+
+	//! Sends a request, waiting at most \b timeout milliseconds for its reply.
+	int send(const std::vector<QString> &argv, QString &reply, int timeout = DefaultReplyTimeout);
+	int post(const std::vector<QString> &argv);
+
+private:
+	TTcpIpConnectionImp *m_imp;
+
+	// not implemented
+	TTcpIpConnection(const TTcpIpConnection &);
+	TTcpIpConnection &operator=(const TTcpIpConnection &);
+};
+
 #endif
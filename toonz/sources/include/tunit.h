@@ -101,6 +101,9 @@ public:
 	const TUnit *getCurrentUnit() const { return m_currentUnit; }
 	void setCurrentUnit(TUnit *unit);
 
+	//! Returns a counter incremented whenever the current unit of any measure changes.
+	static int getCurrentUnitsRevision();
+
 	// standard unit e' quella usata nelle espressioni
 	const TUnit *getStandardUnit() const { return m_standardUnit; }
 	void setStandardUnit(TUnit *unit);
@@ -61,6 +61,41 @@ namespace
 {
 QHash<unsigned int, TLevelReaderP> readers;
 QHash<unsigned int, TLevelWriterP> writers;
+
+// Frame slots segments attached by readers and writers, see t32bitsrv::FrameSlots
+QHash<unsigned int, QSharedMemory *> readerSlots;
+QHash<unsigned int, QSharedMemory *> writerSlots;
+
+//---------------------------------------------------
+
+bool attachSlots(QHash<unsigned int, QSharedMemory *> &slotsTable, unsigned int id, const QString &shMemId)
+{
+	QSharedMemory *shm = new QSharedMemory(shMemId);
+	if (!shm->attach()) {
+		delete shm;
+		return false;
+	}
+
+	delete slotsTable.take(id);
+	slotsTable.insert(id, shm);
+
+	return true;
+}
+
+//---------------------------------------------------
+
+//! Returns the raster of the specified size at the specified offset of the attached
+//! slots segment, or an empty raster if it does not fit.
+TRaster32P slotRaster(const QHash<unsigned int, QSharedMemory *> &slotsTable, unsigned int id,
+					  int lx, int ly, int offset)
+{
+	QSharedMemory *shm = slotsTable.value(id);
+	if (!shm || lx <= 0 || ly <= 0 || offset < 0 ||
+		offset + (qint64)lx * ly * sizeof(TPixel32) > shm->size())
+		return TRaster32P();
+
+	return TRaster32P(lx, ly, lx, (TPixel32 *)((char *)shm->data() + offset));
+}
 }
 
 //---------------------------------------------------
@@ -78,6 +113,8 @@ void addParsers(tipc::Server *srv)
 	srv->addParser(new InitLWMovParser);
 	srv->addParser(new LWSetFrameRateParser);
 	srv->addParser(new LWImageWriteParser);
+	srv->addParser(new LWAttachSlotsParser);
+	srv->addParser(new LWSlotWriteParser);
 	srv->addParser(new LWSaveSoundTrackParser);
 	srv->addParser(new CloseLWMovParser);
 	srv->addParser(new InitLRMovParser);
@@ -85,6 +122,8 @@ void addParsers(tipc::Server *srv)
 	srv->addParser(new LREnableRandomAccessReadParser);
 	srv->addParser(new LRImageReadParser);
 	srv->addParser(new LRImageReadSHMParser);
+	srv->addParser(new LRAttachSlotsParser);
+	srv->addParser(new LRSlotReadParser);
 	srv->addParser(new CloseLRMovParser);
 
 #ifdef WIN32
@@ -262,6 +301,48 @@ void LWImageWriteParser::operator()(Message &msg)
 	}
 }
 
+//************************************************************************
+//    LWAttachSlots Parser
+//************************************************************************
+
+void LWAttachSlotsParser::operator()(Message &msg)
+{
+	unsigned int id;
+	QString shMemId;
+	msg >> id >> shMemId >> clr;
+
+	msg << QString(attachSlots(writerSlots, id, shMemId) ? "ok" : "err");
+}
+
+//************************************************************************
+//    LWSlotWrite Parser
+//************************************************************************
+
+void LWSlotWriteParser::operator()(Message &msg)
+{
+	unsigned int id;
+	int frameIdx, lx, ly, offset;
+	msg >> id >> frameIdx >> lx >> ly >> offset >> clr;
+
+	QHash<unsigned int, TLevelWriterP>::iterator it = writers.find(id);
+
+	//The slot is saved in place - the client won't touch it until replied
+	TRaster32P ras(slotRaster(writerSlots, id, lx, ly, offset));
+	if (it == writers.end() || !ras) {
+		msg << QString("err");
+		return;
+	}
+
+	try {
+		TImageWriterP iw(it.value()->getFrameWriter(frameIdx + 1));
+		iw->save(TRasterImageP(ras));
+
+		msg << QString("ok");
+	} catch (...) {
+		msg << QString("err");
+	}
+}
+
 //************************************************************************
 //    LWSaveSoundTrack Parser
 //************************************************************************
@@ -303,6 +384,7 @@ void CloseLWMovParser::operator()(Message &msg)
 
 	try {
 		writers.take(id);
+		delete writerSlots.take(id);
 		msg << QString("ok");
 	} catch (...) {
 		msg << QString("err");
@@ -625,6 +707,48 @@ err:
 	msg << QString("err");
 }
 
+//************************************************************************
+//    LRAttachSlots Parser
+//************************************************************************
+
+void LRAttachSlotsParser::operator()(Message &msg)
+{
+	unsigned int id;
+	QString shMemId;
+	msg >> id >> shMemId >> clr;
+
+	msg << QString(attachSlots(readerSlots, id, shMemId) ? "ok" : "err");
+}
+
+//************************************************************************
+//    LRSlotRead Parser
+//************************************************************************
+
+void LRSlotReadParser::operator()(Message &msg)
+{
+	unsigned int id;
+	int lx, ly, frameIdx, x, y, shrinkX, shrinkY, offset;
+	msg >> id >> lx >> ly >> frameIdx >> x >> y >> shrinkX >> shrinkY >> offset >> clr;
+
+	QHash<unsigned int, TLevelReaderP>::iterator it = readers.find(id);
+
+	//The image is loaded straight into the slot
+	TRaster32P ras(slotRaster(readerSlots, id, lx, ly, offset));
+	if (it == readers.end() || !ras) {
+		msg << QString("err");
+		return;
+	}
+
+	try {
+		TImageReaderP ir(it.value()->getFrameReader(frameIdx + 1));
+		ir->load(ras, TPoint(x, y), shrinkX, shrinkY);
+
+		msg << QString("ok");
+	} catch (...) {
+		msg << QString("err");
+	}
+}
+
 //************************************************************************
 //    CloseLRMov Parser
 //************************************************************************
@@ -635,6 +759,7 @@ void CloseLRMovParser::operator()(Message &msg)
 	msg >> id >> clr;
 
 	readers.take(id);
+	delete readerSlots.take(id);
 	msg << QString("ok");
 }
 
@@ -100,6 +100,32 @@ public:
 
 //------------------------------------------------------------------------------
 
+class LWAttachSlotsParser : public tipc::MessageParser
+{
+	//Syntax: $LWMovAttachSlots <id> <shmem id>
+	//Reply: ok | err
+
+	//NOTE: The segment stays attached until $closeLWMov <id>.
+
+public:
+	QString header() const { return "$LWMovAttachSlots"; }
+	void operator()(Message &stream);
+};
+
+//------------------------------------------------------------------------------
+
+class LWSlotWriteParser : public tipc::MessageParser
+{
+	//Syntax: $LWMovSlotWrite <id> <frameIdx> <lx> <ly> <slot offset>
+	//Reply: ok | err
+
+public:
+	QString header() const { return "$LWMovSlotWrite"; }
+	void operator()(Message &stream);
+};
+
+//------------------------------------------------------------------------------
+
 class LWSaveSoundTrackParser : public tipc::MessageParser
 {
 	//Syntax: [$LWMovSaveSoundTrack <id> <sampleRate> <bps> <chanCount> <sCount> <signedSample>] [data writer]
@@ -229,6 +255,32 @@ public:
 
 //------------------------------------------------------------------------------
 
+class LRAttachSlotsParser : public tipc::MessageParser
+{
+	//Syntax: $LRMovAttachSlots <id> <shmem id>
+	//Reply: ok | err
+
+	//NOTE: The segment stays attached until $closeLRMov <id>.
+
+public:
+	QString header() const { return "$LRMovAttachSlots"; }
+	void operator()(Message &stream);
+};
+
+//------------------------------------------------------------------------------
+
+class LRSlotReadParser : public tipc::MessageParser
+{
+	//Syntax: $LRMovSlotRead <id> <lx> <ly> <frameIdx> <x> <y> <shrinkX> <shrinkY> <slot offset>
+	//Reply: ok | err
+
+public:
+	QString header() const { return "$LRMovSlotRead"; }
+	void operator()(Message &stream);
+};
+
+//------------------------------------------------------------------------------
+
 class CloseLRMovParser : public tipc::MessageParser
 {
 	//Syntax: $closeLRMov <id>
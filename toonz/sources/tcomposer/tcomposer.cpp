@@ -62,6 +62,7 @@
 #include "tpluginmanager.h"
 #include "tiio_std.h"
 #include "tsimplecolorstyles.h"
+#include "tipc.h"
 
 #include "tvectorbrushstyle.h"
 #include "tpalette.h"
@@ -73,6 +74,9 @@
 #include <QApplication>
 #include <QWaitCondition>
 #include <QMessageBox>
+#include <QDateTime>
+#include <QLocalServer>
+#include <QLocalSocket>
 
 //==================================================================================
 
@@ -582,186 +586,118 @@ std::pair<int, int> generateMovie(ToonzScene *scene,
 
 //==================================================================================
 //
-// main()
+// Tasks
 //
 //----------------------------------------------------------------------------------
 
-//TODO: il main comincia a diventare troppo lungo. Forse val la pena
-// separarlo in varie funzioni
-// (tipo initToonzEnvironment(), parseCommandLine(), ecc)
-
-DV_IMPORT_API void initStdFx();
-DV_IMPORT_API void initColorFx();
-int main(int argc, char *argv[])
+namespace
 {
-	QApplication app(argc, argv);
 
-	// Create a QObject destroyed just before app - see Tnz6's main.cpp for rationale
-	std::auto_ptr<QObject> mainScope(new QObject(&app));
-	mainScope->setObjectName("mainScope");
+/*
+  In worker mode, tcomposer serves successive render tasks - typically the chunks of
+  farm tasks - sent by the farm server through a local socket. The loaded scene, and
+  the decoded levels in the image cache, are kept between tasks as long as tasks
+  refer to the same, unchanged scene file.
+*/
+
+bool WorkerMode = false;
+
+ToonzScene *CachedScene = 0;
+TFilePath CachedScenePath;
+QDateTime CachedSceneTime;
+int CachedSceneMultimedia = 0; //!< The scene's own setting, overridden by tasks
+
+// Workers quit when no task has been received for this long
+const int WorkerIdleTimeout = 10 * 60 * 1000;
 
 #ifdef WIN32
 #ifndef x64
-	//Store the floating point control word. It will be re-set before Toonz initialization
-	//has ended.
-	unsigned int fpWord = 0;
-	_controlfp_s(&fpWord, 0, 0);
+//The floating point control word at startup - restored before each render
+unsigned int fpWord = 0;
 #endif
 #endif
 
-	//Set the app's locale for numeric stuff to standard C. This is important for atof() and similar
-	//calls that are locale-dependant.
-	setlocale(LC_NUMERIC, "C");
+//-------------------------------------------------------------------------------
 
-	// Install run out of contiguous memory callback
-	TBigMemoryManager::instance()->setRunOutOfContiguousMemoryHandler(&tcomposerRunOutOfContMemHandler);
+void releaseCachedScene()
+{
+	if (!CachedScene)
+		return;
 
-#ifdef WIN32
-//Define 64-bit precision for floating-point arithmetic. Please observe that the
-//initImageIo() call below would already impose this precision. This just wants to be
-//explicit.
-//_controlfp_s(0, 0, 0x10000);
-#endif
+	TImageStyle::setCurrentScene(0);
+	delete CachedScene;
+	CachedScene = 0;
 
-	// Initialize thread components
-	TThread::init();
+	CachedScenePath = TFilePath();
+	CachedSceneTime = QDateTime();
 
-	// questo definisce la registry root e inizializza TEnv
-	TEnv::setApplication(applicationName, applicationVersion);
-	TEnv::setApplicationFullName(applicationFullName);
-	TEnv::setRootVarName(rootVarName);
-	TEnv::setSystemVarPrefix(systemVarPrefix);
-	TSystem::hasMainLoop(true);
+	TImageCache::instance()->clear(true);
+}
 
-	//QMessageBox::information(0, QString("eccolo"), QString("composer!"));
+//-------------------------------------------------------------------------------
 
-	int i;
-	for (i = 0; i < argc; i++) //tmsg must be set as soon as it's possible
-	{
-		QString str = argv[i];
-		if (str == "-tmsg") {
-			TMsgCore::instance()->connectTo(argv[i + 1]);
-			break;
-		}
+//! Loads the scene levels needed to render the task's frames. The others are
+//! deferred - a cached scene loads them as soon as a later task needs them.
+void loadRenderedResources(ToonzScene *scene, const RangeQualifier &range, const IntQualifier &stepOpt)
+{
+	if (!range.isSelected()) {
+		scene->loadResources(0, scene->getFrameCount() - 1);
+		return;
 	}
-	if (i == argc)
-		TMsgCore::instance()->connectTo("");
 
-// TODO: non va qui. Bisognerebbe semmai modificare l'implementazione
-// delle TEnv:: precedenti. Discutiamone
-#ifdef MACOSX
-// StuffDir
-#ifdef BRAVO
-	QFileInfo infoStuff(QString("Toonz 7.1 Bravo stuff"));
-#else
-	QFileInfo infoStuff(QString("Toonz 7.1 stuff"));
-#endif
-	TFilePath stuffDirPath(infoStuff.absoluteFilePath().toStdString());
-	TEnv::setStuffDir(stuffDirPath);
+	TOutputProperties *outProp = scene->getProperties()->getOutputProperties();
+	int scene_from, scene_to, scene_step;
+	outProp->getRange(scene_from, scene_to, scene_step);
 
-/*
-    #ifdef BRAVO
-      TFilePath stuffDir("/Applications/Toonz 7.1 Bravo/Toonz 7.1 Bravo stuff");
-    #else
-      TFilePath stuffDir("/Applications/Toonz 7.1/Toonz 7.1 stuff");
-    #endif	
-	  TEnv::setStuffDir(stuffDir);
-*/
+	int step = stepOpt.isSelected() ? stepOpt.getValue() : scene_step;
+	int r0 = tmax(range.getFrom() - 1, 0), r1 = tmax(range.getTo() - 1, r0);
 
-#endif
+	// Rendered frames are mapped to xsheet rows through the time stretch - see
+	// generateMovie()
+	const TRenderSettings &rs = outProp->getRenderSettings();
+	double timeStretchFactor = (double)rs.m_timeStretchFrom / rs.m_timeStretchTo;
 
-	// controllo se la xxxroot e' definita e corrisponde ad un file esistente
-	TFilePath fp = TEnv::getStuffDir();
-	if (fp == TFilePath())
-		fatalError(string("Undefined: \"") + toString(TEnv::getRootVarPath().getWideString()) + "\"");
-	if (!TFileStatus(fp).isDirectory())
-		fatalError(string("Directory \"") + toString(fp.getWideString()) + "\" not found or not readable");
+	int row0 = tfloor(r0 * timeStretchFactor);
+	int row1 = tceil((r0 + (r1 - r0 + 1) * tmax(step, 1)) * timeStretchFactor);
 
-	TFilePath lRootDir = fp + "toonzfarm";
-	TFilePath logFilePath = lRootDir + "tcomposer.log";
-	m_userLog = new TUserLogAppend(logFilePath);
-	string msg;
+	scene->loadResources(row0, row1);
+}
 
-	/*
+//-------------------------------------------------------------------------------
 
-  #ifdef MACOSX
-    // Library and cacheRoot Folders
-	
-	TFilePath libraryFolder = 
-      setToonzFolder(
-        TEnv::getStuffDir() + "toonzenv.txt",
-        TEnv::getSystemVarPrefix() +"LIBRARY");
-	  if(libraryFolder == TFilePath())
-	  {
-	    cout << "Cannot set " << TEnv::getSystemVarPrefix() << "LIBRARY folder" << endl;
-	    m_userLog->error("Cannot set " +TEnv::getSystemVarPrefix()+"LIBRARY folder");
-		  return -1;
-	  }
-	  TFilePath cacheRoot = 
-      setToonzFolder(
-        TEnv::getStuffDir() + "toonzenv.txt",
-        TEnv::getSystemVarPrefix()+"CACHEROOT");
-	  if(cacheRoot == TFilePath())
-	  {
-	    cout << "Cannot set " + TEnv::getSystemVarPrefix() +"CACHEROOT folder" << endl;
-	    m_userLog->error("Cannot set " + TEnv::getSystemVarPrefix() + "CACHEROOT folder");
-		  return -1;
-	  }
-*/
-	/*
-    #ifdef BRAVO
-    TFilePath libraryFolder("/Applications/Toonz 5.0 Bravo/Toonz 5.0 Bravo stuff/projects/library");
-    TFilePath cacheRoot("/Applications/Toonz 5.0 Bravo/Toonz 5.0 Bravo stuff/cache");
-    #else
-    TFilePath libraryFolder("/Applications/Toonz 5.0/Toonz 5.0 stuff/projects/library");
-    TFilePath cacheRoot("/Applications/Toonz 5.0/Toonz 5.0 stuff/cache");
-    #endif
-*/
-	/*
-	TRasterImagePatternStrokeStyle::setRootDir(libraryFolder);
-	  TVectorImagePatternStrokeStyle::setRootDir(libraryFolder);
-	  TPalette::setRootDir(libraryFolder);
-    cacheRoot += TFilePath(toString(TSystem::getProcessId()));
-    TFileStatus fs(cacheRoot);
-    if (!fs.doesExist())
-      TSystem::mkDir(cacheRoot);
-    TImageCache::instance()->setRootDir(cacheRoot);
-  
-  	// ProjectFolder
-    TFilePath projectFolder = setToonzFolder(TEnv::getStuffDir() + "toonzenv.txt", TEnv::getSystemVarPrefix()+"PROJECTS");
-		
-	  if(projectFolder == TFilePath()) 
-	  {
-	    cout << "Cannot set TOONZPROJECTS folder" << endl;
-	    m_userLog->error("Cannot set TOONZPROJECTS folder");
-		  return -1;
-	  }
-	
-	  TProjectManager::instance()->addProjectsRoot(projectFolder);
-  #else
-*/
+//! Splits a command line into its arguments, removing the double quotes that
+//! group arguments containing spaces.
+QStringList splitCommandLine(const QString &cmdline)
+{
+	QStringList args;
+
+	QString arg;
+	bool quoted = false, hasArg = false;
+	for (int i = 0; i < cmdline.size(); ++i) {
+		QChar c = cmdline[i];
+		if (c == '"')
+			quoted = !quoted, hasArg = true;
+		else if (c.isSpace() && !quoted) {
+			if (hasArg)
+				args.push_back(arg);
+			arg.clear(), hasArg = false;
+		} else
+			arg += c, hasArg = true;
+	}
 
-	// Initialize measure units
-	Preferences::instance();					 // Loads standard (linear) units
-	TMeasureManager::instance()->				 // Loads camera-related units
-		addCameraMeasures(getCurrentCameraSize); //
+	if (hasArg)
+		args.push_back(arg);
 
-	TFilePathSet fps = ToonzFolder::getProjectsFolders();
-	TFilePathSet::iterator fpIt;
-	for (fpIt = fps.begin(); fpIt != fps.end(); ++fpIt)
-		TProjectManager::instance()->addProjectsRoot(*fpIt);
+	return args;
+}
 
-	TFilePath libraryFolder = ToonzFolder::getLibraryFolder();
-	TRasterImagePatternStrokeStyle::setRootDir(libraryFolder);
-	TVectorImagePatternStrokeStyle::setRootDir(libraryFolder);
-	TVectorBrushStyle::setRootDir(libraryFolder);
-	TPalette::setRootDir(libraryFolder);
-	TImageStyle::setLibraryDir(libraryFolder);
-	TFilePath cacheRoot = ToonzFolder::getCacheRootFolder();
-	if (cacheRoot.isEmpty())
-		cacheRoot = TEnv::getStuffDir() + "cache";
-	TImageCache::instance()->setRootDir(cacheRoot);
-	// #endif
+} // namespace
+
+//==================================================================================
+
+int composeTask(int argc, char *argv[])
+{
+	string msg;
 
 	//  setCurrentModule("tcomposer");
 	TCli::FilePathArgument srcName("srcName", "Source file");
@@ -779,7 +715,7 @@ int main(int argc, char *argv[])
 	Usage usage(argv[0]);
 	usage.add(srcName + dstName + range + stepOpt + shrinkOpt + multimedia + farmData + idq + nthreads + tileSize + tmsg);
 	if (!usage.parse(argc, argv))
-		exit(1);
+		return 1;
 
 	TaskId = QString::fromStdString(idq.getValue());
 	string fdata = farmData.getValue();
@@ -796,47 +732,23 @@ int main(int argc, char *argv[])
 		}
 	}
 
+	delete FarmController;
+	FarmController = 0;
+
 	if (UseRenderFarm) {
 		TFarmControllerFactory factory;
 		factory.create(FarmControllerName, FarmControllerPort, &FarmController);
 	}
 
-	while (!PluginLoader::load_entries(""))
-		app.processEvents();
+	// Timings are reported per task
+	Sw1.reset();
+	Sw2.reset();
+	TStopWatch::global(0).reset();
+	TStopWatch::global(8).reset();
 
 	std::pair<int, int> framePair(1, 0);
 
 	try {
-		Tiio::defineStd();
-#ifdef BRAVO
-		TPluginManager::instance()->setIgnored("tnzimage");
-#endif
-
-		//#ifdef MACOSX
-		// LoadStandardPlugins ha bisogno di BINROOT definita
-		// non potendola memorizzare su TSystem (non ci sono setter)
-		// mi prendo il suo valore da toonzenv.txt e carico direttamente
-		// i plugins scolpendo le directory mancanti
-
-		//	TFilePath binRoot = setToonzFolder(TEnv::getStuffDir() + "toonzenv.txt","BINROOT");
-
-		//	TPluginManager::instance()->loadPlugins(binRoot + "bin" + "plugins" + "io");
-		//	TPluginManager::instance()->loadPlugins(binRoot + "bin" + "plugins" + "fx");
-		//#else
-		//    TPluginManager::instance()->loadStandardPlugins();//per ora , visto che altrimenti non funzionano gli stili speciali
-
-		initImageIo();
-		Tiio::defineStd();
-		initSoundIo();
-		initStdFx();
-		initColorFx();
-
-		loadShaderInterfaces(ToonzFolder::getLibraryFolder() + TFilePath("shaders"));
-
-		//#endif
-
-		//---------------------------------------------------------
-
 		TFilePath srcFilePath = srcName.getValue();
 
 		try {
@@ -868,31 +780,58 @@ int main(int argc, char *argv[])
 
 		if (!TSystem::doesExistFileOrLevel(srcFilePath))
 			return false;
-		ToonzScene *scene = new ToonzScene();
 
-		TImageStyle::setCurrentScene(scene);
+		ToonzScene *scene = 0;
+		QDateTime sceneTime = TFileStatus(srcFilePath).getLastModificationTime();
 
-		try {
-			Sw2.start();
-			scene->load(srcFilePath);
-			Sw2.stop();
-		} catch (TException &e) {
-			cout << toString(e.getMessage()) << endl;
-			m_userLog->error(toString(e.getMessage()));
-			return -2;
-		} catch (...) {
-			string msg;
-			msg = "There were problems loading the scene " + toString(srcFilePath.getWideString()) +
-				  ".\n Some files may be missing.";
+		if (CachedScene && CachedScenePath == srcFilePath && CachedSceneTime == sceneTime) {
+			scene = CachedScene;
+			scene->getProperties()->getOutputProperties()->setMultimediaRendering(CachedSceneMultimedia);
+
+			// Levels deferred by previous chunks may be needed by this one
+			if (scene->hasDeferredResources())
+				loadRenderedResources(scene, range, stepOpt);
+
+			msg = "scene already loaded";
 			cout << msg << endl;
-			m_userLog->error(msg);
-			//return false;
-		}
+			m_userLog->info(msg);
+		} else {
+			releaseCachedScene();
+
+			scene = new ToonzScene();
+
+			TImageStyle::setCurrentScene(scene);
+
+			try {
+				Sw2.start();
+				// Chunks load only the levels exposed in their frame range
+				scene->loadNoResources(srcFilePath);
+				loadRenderedResources(scene, range, stepOpt);
+				Sw2.stop();
+			} catch (TException &e) {
+				cout << toString(e.getMessage()) << endl;
+				m_userLog->error(toString(e.getMessage()));
+				return -2;
+			} catch (...) {
+				string msg;
+				msg = "There were problems loading the scene " + toString(srcFilePath.getWideString()) +
+					  ".\n Some files may be missing.";
+				cout << msg << endl;
+				m_userLog->error(msg);
+				//return false;
+			}
 
-		msg = "scene loaded";
-		cout << "scene loaded" << endl;
-		m_userLog->info(msg);
+			msg = "scene loaded";
+			cout << "scene loaded" << endl;
+			m_userLog->info(msg);
 
+			if (WorkerMode) {
+				CachedScene = scene;
+				CachedScenePath = srcFilePath;
+				CachedSceneTime = sceneTime;
+				CachedSceneMultimedia = scene->getProperties()->getOutputProperties()->getMultimediaRendering();
+			}
+		}
 		//---------------------------------------------------------
 
 		TFilePath dstFilePath;
@@ -965,7 +904,7 @@ int main(int argc, char *argv[])
 
 			if (threadCount <= 0) {
 				cout << "Qualifier 'nthreads': bad input" << endl;
-				exit(1);
+				return 1;
 			}
 		} else {
 			int threadIndex = outProp->getThreadIndex();
@@ -988,7 +927,7 @@ int main(int argc, char *argv[])
 
 			if (maxTileSize <= 0) {
 				cout << "Qualifier 'maxtilesize': bad input" << endl;
-				exit(1);
+				return 1;
 			}
 		} else {
 			int maxTileSizeIndex = outProp->getMaxTileSizeIndex();
@@ -999,10 +938,6 @@ int main(int argc, char *argv[])
 		if (maxTileSize != (std::numeric_limits<int>::max)())
 			m_userLog->info("Render tile: " + toString(maxTileSize));
 
-		//Disable the Passive cache manager. It has no sense if it cannot write on disk...
-		//TCacheResourcePool::instance();   //Needs to be instanced before TPassiveCacheManager...
-		TPassiveCacheManager::instance()->setEnabled(false);
-
 #ifdef WIN32
 #ifndef x64
 		//On 32-bit architecture, there could be cases in which initialization could alter the
@@ -1030,7 +965,10 @@ int main(int argc, char *argv[])
 		cout << msg + msg2;
 		m_userLog->info(msg + msg2);
 		DVGui::MsgBox(INFORMATION, QString::fromStdString(msg));
-		TImageCache::instance()->clear(true);
+
+		//Workers keep the decoded levels for the next task on the same scene
+		if (!CachedScene)
+			TImageCache::instance()->clear(true);
 		/*
     cout << "Compositing completed in " + toString(Sw1.getTotalTime()/1000.0, 2) + " seconds";
     cout << endl;
@@ -1043,10 +981,12 @@ int main(int argc, char *argv[])
 		msg = "Untrapped exception: " + toString(e.getMessage()),
 		cout << msg << endl;
 		m_userLog->error(msg);
+		releaseCachedScene();
 		TImageCache::instance()->clear(true);
 	} catch (...) {
 		cout << "Untrapped exception" << endl;
 		m_userLog->error("Untrapped exception");
+		releaseCachedScene();
 		TImageCache::instance()->clear(true);
 	}
 
@@ -1054,3 +994,314 @@ int main(int argc, char *argv[])
 		return -1;
 	return 0;
 }
+
+//-------------------------------------------------------------------------------
+
+/*!
+  Serves the render tasks received on the local server with specified name, until
+  a $quit message is received or no task arrives within WorkerIdleTimeout.
+
+  Each connection carries one message, <$compose> <command line>, which is replied
+  with <ok> <exit code> once the task is completed - the exit code being the one a
+  tcomposer process would have returned for the same command line.
+*/
+int runWorker(const QString &name)
+{
+	WorkerMode = true;
+
+	QLocalServer server;
+	QLocalServer::removeServer(name);
+	if (!server.listen(name)) {
+		m_userLog->error("Couldn't start the worker " + name.toStdString());
+		return 1;
+	}
+
+	m_userLog->info("Worker " + name.toStdString() + " started");
+
+	// No event loop runs between tasks: the render's own loop quits the whole application
+	// loop stack when completed
+	while (server.waitForNewConnection(WorkerIdleTimeout)) {
+		QLocalSocket *socket = server.nextPendingConnection();
+
+		tipc::Stream stream(socket);
+		tipc::Message msg;
+
+		QString header, cmdline;
+		if (stream.readMessage(msg, 10000))
+			msg >> header >> cmdline >> tipc::clr;
+
+		if (header == "$quit") {
+			delete socket;
+			break;
+		}
+
+		if (header == "$compose") {
+			QStringList args = splitCommandLine(cmdline);
+
+			std::vector<QByteArray> argsData;
+			std::vector<char *> argv;
+			for (int a = 0; a < args.size(); ++a)
+				argsData.push_back(args[a].toLocal8Bit());
+			for (int a = 0; a < (int)argsData.size(); ++a)
+				argv.push_back(argsData[a].data());
+			argv.push_back(0);
+
+			int ret = composeTask(argv.size() - 1, &argv[0]);
+
+			stream << (msg << QString("ok") << ret);
+			stream.flush();
+		}
+
+		socket->disconnectFromServer();
+		delete socket;
+	}
+
+	releaseCachedScene();
+
+	m_userLog->info("Worker " + name.toStdString() + " quit");
+	return 0;
+}
+
+
+//==================================================================================
+//
+// main()
+//
+//----------------------------------------------------------------------------------
+
+//TODO: il main comincia a diventare troppo lungo. Forse val la pena
+// separarlo in varie funzioni
+// (tipo initToonzEnvironment(), parseCommandLine(), ecc)
+
+DV_IMPORT_API void initStdFx();
+DV_IMPORT_API void initColorFx();
+int main(int argc, char *argv[])
+{
+	QApplication app(argc, argv);
+
+	// Create a QObject destroyed just before app - see Tnz6's main.cpp for rationale
+	std::auto_ptr<QObject> mainScope(new QObject(&app));
+	mainScope->setObjectName("mainScope");
+
+#ifdef WIN32
+#ifndef x64
+	//Store the floating point control word. It will be re-set before Toonz initialization
+	//has ended.
+	_controlfp_s(&fpWord, 0, 0);
+#endif
+#endif
+
+	//Set the app's locale for numeric stuff to standard C. This is important for atof() and similar
+	//calls that are locale-dependant.
+	setlocale(LC_NUMERIC, "C");
+
+	// Install run out of contiguous memory callback
+	TBigMemoryManager::instance()->setRunOutOfContiguousMemoryHandler(&tcomposerRunOutOfContMemHandler);
+
+#ifdef WIN32
+//Define 64-bit precision for floating-point arithmetic. Please observe that the
+//initImageIo() call below would already impose this precision. This just wants to be
+//explicit.
+//_controlfp_s(0, 0, 0x10000);
+#endif
+
+	// Initialize thread components
+	TThread::init();
+
+	// questo definisce la registry root e inizializza TEnv
+	TEnv::setApplication(applicationName, applicationVersion);
+	TEnv::setApplicationFullName(applicationFullName);
+	TEnv::setRootVarName(rootVarName);
+	TEnv::setSystemVarPrefix(systemVarPrefix);
+	TSystem::hasMainLoop(true);
+
+	//QMessageBox::information(0, QString("eccolo"), QString("composer!"));
+
+	int i;
+	for (i = 0; i < argc; i++) //tmsg must be set as soon as it's possible
+	{
+		QString str = argv[i];
+		if (str == "-tmsg") {
+			TMsgCore::instance()->connectTo(argv[i + 1]);
+			break;
+		}
+	}
+	if (i == argc)
+		TMsgCore::instance()->connectTo("");
+
+// TODO: non va qui. Bisognerebbe semmai modificare l'implementazione
+// delle TEnv:: precedenti. Discutiamone
+#ifdef MACOSX
+// StuffDir
+#ifdef BRAVO
+	QFileInfo infoStuff(QString("Toonz 7.1 Bravo stuff"));
+#else
+	QFileInfo infoStuff(QString("Toonz 7.1 stuff"));
+#endif
+	TFilePath stuffDirPath(infoStuff.absoluteFilePath().toStdString());
+	TEnv::setStuffDir(stuffDirPath);
+
+/*
+    #ifdef BRAVO
+      TFilePath stuffDir("/Applications/Toonz 7.1 Bravo/Toonz 7.1 Bravo stuff");
+    #else
+      TFilePath stuffDir("/Applications/Toonz 7.1/Toonz 7.1 stuff");
+    #endif	
+	  TEnv::setStuffDir(stuffDir);
+*/
+
+#endif
+
+	// controllo se la xxxroot e' definita e corrisponde ad un file esistente
+	TFilePath fp = TEnv::getStuffDir();
+	if (fp == TFilePath())
+		fatalError(string("Undefined: \"") + toString(TEnv::getRootVarPath().getWideString()) + "\"");
+	if (!TFileStatus(fp).isDirectory())
+		fatalError(string("Directory \"") + toString(fp.getWideString()) + "\" not found or not readable");
+
+	TFilePath lRootDir = fp + "toonzfarm";
+	TFilePath logFilePath = lRootDir + "tcomposer.log";
+	m_userLog = new TUserLogAppend(logFilePath);
+	string msg;
+
+	/*
+
+  #ifdef MACOSX
+    // Library and cacheRoot Folders
+	
+	TFilePath libraryFolder = 
+      setToonzFolder(
+        TEnv::getStuffDir() + "toonzenv.txt",
+        TEnv::getSystemVarPrefix() +"LIBRARY");
+	  if(libraryFolder == TFilePath())
+	  {
+	    cout << "Cannot set " << TEnv::getSystemVarPrefix() << "LIBRARY folder" << endl;
+	    m_userLog->error("Cannot set " +TEnv::getSystemVarPrefix()+"LIBRARY folder");
+		  return -1;
+	  }
+	  TFilePath cacheRoot = 
+      setToonzFolder(
+        TEnv::getStuffDir() + "toonzenv.txt",
+        TEnv::getSystemVarPrefix()+"CACHEROOT");
+	  if(cacheRoot == TFilePath())
+	  {
+	    cout << "Cannot set " + TEnv::getSystemVarPrefix() +"CACHEROOT folder" << endl;
+	    m_userLog->error("Cannot set " + TEnv::getSystemVarPrefix() + "CACHEROOT folder");
+		  return -1;
+	  }
+*/
+	/*
+    #ifdef BRAVO
+    TFilePath libraryFolder("/Applications/Toonz 5.0 Bravo/Toonz 5.0 Bravo stuff/projects/library");
+    TFilePath cacheRoot("/Applications/Toonz 5.0 Bravo/Toonz 5.0 Bravo stuff/cache");
+    #else
+    TFilePath libraryFolder("/Applications/Toonz 5.0/Toonz 5.0 stuff/projects/library");
+    TFilePath cacheRoot("/Applications/Toonz 5.0/Toonz 5.0 stuff/cache");
+    #endif
+*/
+	/*
+	TRasterImagePatternStrokeStyle::setRootDir(libraryFolder);
+	  TVectorImagePatternStrokeStyle::setRootDir(libraryFolder);
+	  TPalette::setRootDir(libraryFolder);
+    cacheRoot += TFilePath(toString(TSystem::getProcessId()));
+    TFileStatus fs(cacheRoot);
+    if (!fs.doesExist())
+      TSystem::mkDir(cacheRoot);
+    TImageCache::instance()->setRootDir(cacheRoot);
+  
+  	// ProjectFolder
+    TFilePath projectFolder = setToonzFolder(TEnv::getStuffDir() + "toonzenv.txt", TEnv::getSystemVarPrefix()+"PROJECTS");
+		
+	  if(projectFolder == TFilePath()) 
+	  {
+	    cout << "Cannot set TOONZPROJECTS folder" << endl;
+	    m_userLog->error("Cannot set TOONZPROJECTS folder");
+		  return -1;
+	  }
+	
+	  TProjectManager::instance()->addProjectsRoot(projectFolder);
+  #else
+*/
+
+	// Initialize measure units
+	Preferences::instance();					 // Loads standard (linear) units
+	TMeasureManager::instance()->				 // Loads camera-related units
+		addCameraMeasures(getCurrentCameraSize); //
+
+	TFilePathSet fps = ToonzFolder::getProjectsFolders();
+	TFilePathSet::iterator fpIt;
+	for (fpIt = fps.begin(); fpIt != fps.end(); ++fpIt)
+		TProjectManager::instance()->addProjectsRoot(*fpIt);
+
+	TFilePath libraryFolder = ToonzFolder::getLibraryFolder();
+	TRasterImagePatternStrokeStyle::setRootDir(libraryFolder);
+	TVectorImagePatternStrokeStyle::setRootDir(libraryFolder);
+	TVectorBrushStyle::setRootDir(libraryFolder);
+	TPalette::setRootDir(libraryFolder);
+	TImageStyle::setLibraryDir(libraryFolder);
+	TFilePath cacheRoot = ToonzFolder::getCacheRootFolder();
+	if (cacheRoot.isEmpty())
+		cacheRoot = TEnv::getStuffDir() + "cache";
+	TImageCache::instance()->setRootDir(cacheRoot);
+	// #endif
+
+	// A worker serves the tasks sent by a farm server, see runWorker()
+	QString workerName;
+	for (i = 0; i < argc - 1; i++) {
+		if (QString(argv[i]) == "-worker") {
+			workerName = argv[i + 1];
+			break;
+		}
+	}
+
+	while (!PluginLoader::load_entries(""))
+		app.processEvents();
+
+	try {
+		Tiio::defineStd();
+#ifdef BRAVO
+		TPluginManager::instance()->setIgnored("tnzimage");
+#endif
+
+		//#ifdef MACOSX
+		// LoadStandardPlugins ha bisogno di BINROOT definita
+		// non potendola memorizzare su TSystem (non ci sono setter)
+		// mi prendo il suo valore da toonzenv.txt e carico direttamente
+		// i plugins scolpendo le directory mancanti
+
+		//	TFilePath binRoot = setToonzFolder(TEnv::getStuffDir() + "toonzenv.txt","BINROOT");
+
+		//	TPluginManager::instance()->loadPlugins(binRoot + "bin" + "plugins" + "io");
+		//	TPluginManager::instance()->loadPlugins(binRoot + "bin" + "plugins" + "fx");
+		//#else
+		//    TPluginManager::instance()->loadStandardPlugins();//per ora , visto che altrimenti non funzionano gli stili speciali
+
+		initImageIo();
+		Tiio::defineStd();
+		initSoundIo();
+		initStdFx();
+		initColorFx();
+
+		loadShaderInterfaces(ToonzFolder::getLibraryFolder() + TFilePath("shaders"));
+
+		//#endif
+	} catch (TException &e) {
+		msg = "Untrapped exception: " + toString(e.getMessage()),
+		cout << msg << endl;
+		m_userLog->error(msg);
+		return -1;
+	} catch (...) {
+		cout << "Untrapped exception" << endl;
+		m_userLog->error("Untrapped exception");
+		return -1;
+	}
+
+	//Disable the Passive cache manager. It has no sense if it cannot write on disk...
+	//TCacheResourcePool::instance();   //Needs to be instanced before TPassiveCacheManager...
+	TPassiveCacheManager::instance()->setEnabled(false);
+
+	if (!workerName.isEmpty())
+		return runWorker(workerName);
+
+	return composeTask(argc, argv);
+}
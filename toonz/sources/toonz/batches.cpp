@@ -318,7 +318,7 @@ void BatchesController::setTasksTree(TaskTreeModel *tree)
 
 inline bool isMovieType(string type)
 {
-	return (type == "mov" || type == "avi" || type == "3gp");
+	return (type == "mov" || type == "avi" || type == "3gp" || type == "mp4");
 }
 
 //------------------------------------------------------------------------------
@@ -21,6 +21,8 @@
 #include "toonz/stage2.h"
 #include "toonz/txshlevel.h"
 #include "toonz/txshcell.h"
+#include "toonz/txshsimplelevel.h"
+#include "toonz/frameprefetcher.h"
 #include "toonz/tcamera.h"
 #include "toonz/tstageobjecttree.h"
 #include "toonz/tobjecthandle.h"
@@ -287,6 +289,17 @@ void ComboViewerPanel::onDrawFrame(int frame, const ImagePainter::VisualSettings
 		}
 	}
 
+	// Load the frames about to be played in background
+	if (frameHandle->isPlaying() && !m_sceneViewer->isPreviewEnabled()) {
+		int row = frame - 1, direction = (row < frameHandle->getFrameIndex()) ? -1 : 1;
+
+		if (frameHandle->isEditingScene())
+			FramePrefetcher::instance()->prefetch(app->getCurrentXsheet()->getXsheet(), row, direction, c_prefetchedFramesCount);
+		else if (TXshSimpleLevel *sl = app->getCurrentLevel()->getSimpleLevel())
+			FramePrefetcher::instance()->prefetch(sl, row, direction, c_prefetchedFramesCount);
+	} else if (frame != frameHandle->getFrameIndex() + 1)
+		FramePrefetcher::instance()->cancel();
+
 	assert(frame >= 0);
 	if (frame != frameHandle->getFrameIndex() + 1) {
 		if (frameHandle->isEditingScene()) {
@@ -42,6 +42,7 @@
 
 #include <QApplication>
 #include <QClipboard>
+#include <memory>
 
 //=============================================================================
 
@@ -2560,33 +2561,63 @@ public:
 // inbetween
 //-----------------------------------------------------------------------------
 
-void FilmstripCmd::inbetweenWithoutUndo(TXshSimpleLevel *sl,
+namespace
+{
+
+// Keeps the UI alive with a cancelable modal dialog while the inbetweens
+// are built concurrently
+class InbetweenProgress : public TInbetween::Listener
+{
+	DVGui::ProgressDialog m_dialog;
+
+public:
+	InbetweenProgress(int count)
+		: m_dialog(QObject::tr("Inbetweening..."), QObject::tr("Cancel"), 0, count)
+	{
+		m_dialog.setWindowTitle(QObject::tr("Inbetween"));
+		m_dialog.setModal(true);
+		m_dialog.show();
+	}
+
+	bool onProgress(int doneFrames, int totalFrames)
+	{
+		m_dialog.setValue(doneFrames); // Processes events
+		return !m_dialog.wasCanceled();
+	}
+};
+
+} // namespace
+
+//-----------------------------------------------------------------------------
+
+bool FilmstripCmd::inbetweenWithoutUndo(TXshSimpleLevel *sl,
 										const TFrameId &fid0,
 										const TFrameId &fid1,
-										FilmstripCmd::InbetweenInterpolation interpolation)
+										FilmstripCmd::InbetweenInterpolation interpolation,
+										bool showProgress)
 {
 	if (!sl)
-		return;
+		return false;
 	std::vector<TFrameId> fids;
 	sl->getFids(fids);
 	std::vector<TFrameId>::iterator it;
 	it = std::find(fids.begin(), fids.end(), fid0);
 	if (it == fids.end())
-		return;
+		return false;
 	int ia = std::distance(fids.begin(), it);
 	it = std::find(fids.begin(), fids.end(), fid1);
 	if (it == fids.end())
-		return;
+		return false;
 	int ib = std::distance(fids.begin(), it);
 	if (ib - ia < 2)
-		return;
+		return false;
 
 	TVectorImageP img0 = sl->getFrame(fid0, false);
 	TVectorImageP img1 = sl->getFrame(fid1, false);
 	if (!img0 || !img1)
-		return;
+		return false;
 
-	TInbetween inbetween(img0, img1);
+	std::vector<double> ts;
 	int i;
 	for (i = ia + 1; i < ib; i++) {
 		double t = (double)(i - ia) / (double)(ib - ia);
@@ -2606,12 +2637,30 @@ void FilmstripCmd::inbetweenWithoutUndo(TXshSimpleLevel *sl,
 			break; // s'(0) = s'(1) = 0
 		}
 
-		TVectorImageP vi = inbetween.tween(s);
-		sl->setFrame(fids[i], vi);
+		ts.push_back(s);
+	}
+
+	// The stroke correspondences are computed once, then all the inbetweens are
+	// built concurrently
+	std::unique_ptr<InbetweenProgress> progress(showProgress ? new InbetweenProgress(ts.size()) : 0);
+
+	std::vector<TVectorImageP> images;
+	TInbetween(img0, img1).tween(ts, images, progress.get());
+	progress.reset();
+
+	// A canceled tween leaves some images empty - in that case the level
+	// is left untouched
+	for (i = 0; i < (int)images.size(); i++)
+		if (!images[i])
+			return false;
+
+	for (i = ia + 1; i < ib; i++) {
+		sl->setFrame(fids[i], images[i - ia - 1]);
 		IconGenerator::instance()->invalidate(sl, fids[i]);
 	}
 	sl->setDirtyFlag(true);
 	TApp::instance()->getCurrentLevel()->notifyLevelChange();
+	return true;
 }
 
 //-----------------------------------------------------------------------------
@@ -2631,9 +2680,16 @@ void FilmstripCmd::inbetween(TXshSimpleLevel *sl,
 			fids.push_back(*it);
 	}
 
-	TUndoManager::manager()->add(new UndoInbeteween(sl, fids, interpolation));
+	// The undo stores the original images, so it must be built before they
+	// get replaced - and registered only if the inbetweens were applied
+	UndoInbeteween *undo = new UndoInbeteween(sl, fids, interpolation);
 
-	inbetweenWithoutUndo(sl, fid0, fid1, interpolation);
+	if (!inbetweenWithoutUndo(sl, fid0, fid1, interpolation, true)) {
+		delete undo;
+		return;
+	}
+
+	TUndoManager::manager()->add(undo);
 	TApp::instance()->getCurrentScene()->setDirtyFlag(true);
 }
 
@@ -49,10 +49,14 @@ enum InbetweenInterpolation { II_Linear,
 							  II_EaseIn,
 							  II_EaseOut,
 							  II_EaseInOut };
-void inbetweenWithoutUndo(TXshSimpleLevel *sl,
+//! Replaces the frames between fid0 and fid1 with their inbetweens. Returns false
+//! if the level was not modified - including when the user canceled the progress
+//! dialog shown with showProgress.
+bool inbetweenWithoutUndo(TXshSimpleLevel *sl,
 						  const TFrameId &fid0,
 						  const TFrameId &fid1,
-						  InbetweenInterpolation interpolation);
+						  InbetweenInterpolation interpolation,
+						  bool showProgress = false);
 void inbetween(TXshSimpleLevel *sl,
 			   const TFrameId &fid0,
 			   const TFrameId &fid1,
@@ -41,6 +41,7 @@
 #include "toutputproperties.h"
 #include "toonz/txsheethandle.h"
 #include "toonz/txshsimplelevel.h"
+#include "toonz/frameprefetcher.h"
 #include "toonz/levelproperties.h"
 #include "toonz/tscenehandle.h"
 #include "toonz/toonzscene.h"
@@ -1494,6 +1495,10 @@ TImageP FlipBook::getCurrentImage(int frame)
 	{
 		if (m_xl->getFrameCount() <= 0)
 			return 0;
+
+		// Load the following frames in background
+		FramePrefetcher::instance()->prefetch(m_xl, frame - 1, 1, c_prefetchedFramesCount);
+
 		return m_xl->getFrame(m_xl->index2fid(frame - 1), false);
 	} else if (!m_levels.empty()) //is a viewfile or a previewFx
 	{
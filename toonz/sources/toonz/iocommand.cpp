@@ -1510,6 +1510,32 @@ bool IoCmd::saveScene()
 #endif
 }
 
+//===========================================================================
+// IoCmd::saveSceneSnapshot()
+//---------------------------------------------------------------------------
+
+bool IoCmd::saveSceneSnapshot(int unchangedSections)
+{
+	ToonzScene *scene = TApp::instance()->getCurrentScene()->getScene();
+	if (scene->isUntitled())
+		return false;
+
+	// as in saveScene()
+	CleanupParameters *cp = scene->getProperties()->getCleanupParameters();
+	CleanupParameters oldCP(*cp);
+	cp->assign(&CleanupParameters::GlobalParameters);
+
+	bool ret = true;
+	try {
+		scene->saveSnapshot(ToonzScene::getSnapshotPath(scene->getScenePath()), unchangedSections);
+	} catch (...) {
+		ret = false;
+	}
+
+	cp->assign(&oldCP);
+	return ret;
+}
+
 //===========================================================================
 // IoCmd::saveLevel(levelPath)
 //---------------------------------------------------------------------------
@@ -1843,6 +1869,23 @@ bool IoCmd::loadScene(const TFilePath &path, bool updateRecentFile, bool checkSa
 		else
 			importScene = true;
 	}
+
+	// An autosave snapshot newer than the scene holds changes which weren't saved
+	TFilePath snapshotPath = ToonzScene::getSnapshotPath(scenePath);
+	bool recovered = false;
+	if (TFileStatus(snapshotPath).doesExist() &&
+		TFileStatus(snapshotPath).getLastModificationTime() > TFileStatus(scenePath).getLastModificationTime()) {
+		QString question = QObject::tr("The scene %1 was autosaved after it was last saved, and may hold unsaved changes.\nDo you want to recover the autosaved scene?").arg(QString::fromStdWString(scenePath.getWideString()));
+		int ret = MsgBox(question, QObject::tr("Recover"), QObject::tr("Load Saved Scene"), 0);
+		recovered = (ret == 1);
+		if (ret == 2) {
+			try {
+				TSystem::deleteFile(snapshotPath);
+			} catch (...) {
+			}
+		}
+	}
+
 	QApplication::setOverrideCursor(Qt::WaitCursor);
 
 	TUndoManager::manager()->reset();
@@ -1862,7 +1905,16 @@ bool IoCmd::loadScene(const TFilePath &path, bool updateRecentFile, bool checkSa
 	printf("%s:%s Progressing:\n", __FILE__, __FUNCTION__);
 	try {
 		/*-- プログレス表示を行いながらLoad --*/
-		scene->load(scenePath);
+		if (recovered) {
+			try {
+				scene->loadSnapshot(snapshotPath, scenePath);
+			} catch (...) {
+				MsgBox(WARNING, QObject::tr("The autosaved scene %1 could not be recovered: the saved scene will be loaded.").arg(QString::fromStdWString(scenePath.getWideString())));
+				recovered = false;
+			}
+		}
+		if (!recovered)
+			scene->load(scenePath);
 		// import if needed
 		TProjectManager *pm = TProjectManager::instance();
 		TProjectP currentProject = pm->getCurrentProject();
@@ -1928,7 +1980,7 @@ bool IoCmd::loadScene(const TFilePath &path, bool updateRecentFile, bool checkSa
 	UnitParameters::setFieldGuideAspectRatio(scene->getProperties()->getFieldGuideAspectRatio());
 	IconGenerator::instance()->invalidateSceneIcon();
 	DvDirModel::instance()->refreshFolder(scenePath.getParentDir());
-	TApp::instance()->getCurrentScene()->setDirtyFlag(false);
+	TApp::instance()->getCurrentScene()->setDirtyFlag(recovered);
 	History::instance()->addItem(scenePath);
 	if (updateRecentFile)
 		RecentFiles::instance()->addFilePath(toQString(scenePath), RecentFiles::Scene);
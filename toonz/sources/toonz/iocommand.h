@@ -168,6 +168,11 @@ enum SaveSceneFlags {
 bool saveScene(const TFilePath &fp, int flags);
 bool saveScene();
 
+// saves the current scene's autosave snapshot, leaving the scene file untouched.
+// unchangedSections are ToonzScene::SnapshotSection values, unchanged since the
+// previous snapshot
+bool saveSceneSnapshot(int unchangedSections);
+
 bool saveLevel(const TFilePath &fp);
 bool saveLevel();
 
@@ -470,11 +470,19 @@ void PreferencesPopup::onDefaultViewerChanged(int index)
 void PreferencesPopup::onAutoSaveChanged(int index)
 {
 	m_minuteFld->setEnabled(index == Qt::Checked);
+	m_autosaveSnapshots->setEnabled(index == Qt::Checked);
 	m_pref->enableAutosave(index == Qt::Checked);
 }
 
 //-----------------------------------------------------------------------------
 
+void PreferencesPopup::onAutoSaveSnapshotsChanged(int index)
+{
+	m_pref->enableAutosaveSnapshots(index == Qt::Checked);
+}
+
+//-----------------------------------------------------------------------------
+
 void PreferencesPopup::onKeyframeTypeChanged(int index)
 {
 	m_pref->setKeyframeType(index + 2);
@@ -696,6 +704,13 @@ void PreferencesPopup::onLevelsBackupChanged(int index)
 
 //-----------------------------------------------------------------------------
 
+void PreferencesPopup::onLevelProxiesChanged(int index)
+{
+	m_pref->enableLevelProxies(index == Qt::Checked);
+}
+
+//-----------------------------------------------------------------------------
+
 void PreferencesPopup::onSceneNumberingChanged(int index)
 {
 	m_pref->enableSceneNumbering(index == Qt::Checked);
@@ -840,11 +855,13 @@ PreferencesPopup::PreferencesPopup()
 	CheckBox *minimizeRasterMemoryCB = new CheckBox(tr("Minimize Raster Memory Fragmentation *"), this);
 	CheckBox *autoSaveCB = new CheckBox(tr("Save Automatically Every Minutes"));
 	m_minuteFld = new IntLineEdit(this, 15, 1, 60);
+	m_autosaveSnapshots = new CheckBox(tr("Autosave to Recovery Snapshots, Leaving the Scene File Untouched"), this);
 	CheckBox *replaceAfterSaveLevelAsCB = new CheckBox(tr("Replace Toonz Level after SaveLevelAs command"), this);
 
 	m_cellsDragBehaviour = new QComboBox();
 	m_undoMemorySize = new DVGui::IntLineEdit(this, m_pref->getUndoMemorySize(), 0, 2000);
 	m_levelsBackup = new CheckBox(tr("Backup Animation Levels when Saving"));
+	CheckBox *levelProxiesCB = new CheckBox(tr("Generate Reduced Resolution Proxies of Raster Levels"));
 	m_chunkSizeFld = new DVGui::IntLineEdit(this, m_pref->getDefaultTaskChunkSize(), 1, 2000);
 	CheckBox *sceneNumberingCB = new CheckBox(tr("Show Info in Rendered Frames"));
 
@@ -1001,6 +1018,8 @@ PreferencesPopup::PreferencesPopup()
 	autoSaveCB->setChecked(m_pref->isAutosaveEnabled());
 	m_minuteFld->setValue(m_pref->getAutosavePeriod());
 	m_minuteFld->setEnabled(m_pref->isAutosaveEnabled());
+	m_autosaveSnapshots->setChecked(m_pref->isAutosaveSnapshotsEnabled());
+	m_autosaveSnapshots->setEnabled(m_pref->isAutosaveEnabled());
 	replaceAfterSaveLevelAsCB->setChecked(m_pref->isReplaceAfterSaveLevelAsEnabled());
 
 	QStringList dragCellsBehaviourList;
@@ -1008,6 +1027,7 @@ PreferencesPopup::PreferencesPopup()
 	m_cellsDragBehaviour->addItems(dragCellsBehaviourList);
 	m_cellsDragBehaviour->setCurrentIndex(m_pref->getDragCellsBehaviour());
 	m_levelsBackup->setChecked(m_pref->isLevelsBackupEnabled());
+	levelProxiesCB->setChecked(m_pref->isLevelProxiesEnabled());
 	sceneNumberingCB->setChecked(m_pref->isSceneNumberingEnabled());
 
 	//--- Interface ------------------------------
@@ -1192,6 +1212,7 @@ PreferencesPopup::PreferencesPopup()
 				saveAutoLay->addStretch(1);
 			}
 			generalFrameLay->addLayout(saveAutoLay, 0);
+			generalFrameLay->addWidget(m_autosaveSnapshots, 0, Qt::AlignLeft | Qt::AlignVCenter);
 
 			//Unit, CameraUnit
 			QGridLayout *unitLay = new QGridLayout();
@@ -1213,6 +1234,7 @@ PreferencesPopup::PreferencesPopup()
 
 			generalFrameLay->addWidget(replaceAfterSaveLevelAsCB, 0, Qt::AlignLeft | Qt::AlignVCenter);
 			generalFrameLay->addWidget(m_levelsBackup, 0, Qt::AlignLeft | Qt::AlignVCenter);
+			generalFrameLay->addWidget(levelProxiesCB, 0, Qt::AlignLeft | Qt::AlignVCenter);
 			generalFrameLay->addWidget(sceneNumberingCB, 0, Qt::AlignLeft | Qt::AlignVCenter);
 			generalFrameLay->addStretch(1);
 
@@ -1560,10 +1582,12 @@ PreferencesPopup::PreferencesPopup()
 	ret = ret && connect(useDefaultViewerCB, SIGNAL(stateChanged(int)), this, SLOT(onDefaultViewerChanged(int)));
 	ret = ret && connect(minimizeRasterMemoryCB, SIGNAL(stateChanged(int)), this, SLOT(onRasterOptimizedMemoryChanged(int)));
 	ret = ret && connect(autoSaveCB, SIGNAL(stateChanged(int)), SLOT(onAutoSaveChanged(int)));
+	ret = ret && connect(m_autosaveSnapshots, SIGNAL(stateChanged(int)), SLOT(onAutoSaveSnapshotsChanged(int)));
 	ret = ret && connect(m_minuteFld, SIGNAL(editingFinished()), SLOT(onMinuteChanged()));
 	ret = ret && connect(m_cellsDragBehaviour, SIGNAL(currentIndexChanged(int)), SLOT(onDragCellsBehaviourChanged(int)));
 	ret = ret && connect(m_undoMemorySize, SIGNAL(editingFinished()), SLOT(onUndoMemorySizeChanged()));
 	ret = ret && connect(m_levelsBackup, SIGNAL(stateChanged(int)), SLOT(onLevelsBackupChanged(int)));
+	ret = ret && connect(levelProxiesCB, SIGNAL(stateChanged(int)), SLOT(onLevelProxiesChanged(int)));
 	ret = ret && connect(sceneNumberingCB, SIGNAL(stateChanged(int)), SLOT(onSceneNumberingChanged(int)));
 	ret = ret && connect(m_chunkSizeFld, SIGNAL(editingFinished()), this, SLOT(onChunkSizeChanged()));
 
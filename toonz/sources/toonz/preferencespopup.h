@@ -89,6 +89,7 @@ private:
 	DVGui::CheckBox *m_inksOnly,
 		*m_enableVersionControl,
 		*m_levelsBackup,
+		*m_autosaveSnapshots,
 		*m_onionSkinVisibility;
 
 private:
@@ -115,6 +116,7 @@ private slots:
 	void onSaveUnpaintedInCleanupChanged(int index);
 	void onMinimizeSaveboxAfterEditing(int index);
 	void onAutoSaveChanged(int index);
+	void onAutoSaveSnapshotsChanged(int index);
 	void onDefaultViewerChanged(int index);
 	void onBlankCountChanged();
 	void onBlankColorChanged(const TPixel32 &, bool isDragging);
@@ -133,6 +135,7 @@ private slots:
 	void onAutomaticSVNRefreshChanged(int);
 	void onDragCellsBehaviourChanged(int);
 	void onLevelsBackupChanged(int);
+	void onLevelProxiesChanged(int);
 	void onSceneNumberingChanged(int);
 	void onChunkSizeChanged();
 	void onDefLevelTypeChanged(int);
@@ -81,7 +81,7 @@ std::pair<double, double> getCurrentDpi()
 //-----------------------------------------------------------------------------
 
 TApp::TApp()
-	: m_currentScene(0), m_currentXsheet(0), m_currentFrame(0), m_currentColumn(0), m_currentLevel(0), m_currentTool(0), m_currentObject(0), m_currentSelection(0), m_currentOnionSkinMask(0), m_currentFx(0), m_mainWindow(0), m_autosaveTimer(0), m_autosaveSuspended(false), m_isStarting(false), m_isPenCloseToTablet(false)
+	: m_currentScene(0), m_currentXsheet(0), m_currentFrame(0), m_currentColumn(0), m_currentLevel(0), m_currentTool(0), m_currentObject(0), m_currentSelection(0), m_currentOnionSkinMask(0), m_currentFx(0), m_mainWindow(0), m_autosaveTimer(0), m_changedSnapshotSections(ToonzScene::LevelSetSection | ToonzScene::XsheetSection), m_autosaveSuspended(false), m_isStarting(false), m_isPenCloseToTablet(false)
 {
 	m_currentScene = new TSceneHandle();
 	m_currentXsheet = new TXsheetHandle();
@@ -158,6 +158,22 @@ TApp::TApp()
 					 m_currentObject, SIGNAL(splineChanged()),
 					 this, SLOT(onSplineChanged()));
 
+	ret = ret && QObject::connect(
+					 m_currentObject, SIGNAL(objectChanged(bool)),
+					 this, SLOT(onObjectChanged()));
+
+	ret = ret && QObject::connect(
+					 m_currentFx, SIGNAL(fxChanged()),
+					 this, SLOT(onFxChanged()));
+
+	ret = ret && QObject::connect(
+					 m_currentScene, SIGNAL(castChanged()),
+					 this, SLOT(onCastChanged()));
+
+	ret = ret && QObject::connect(
+					 m_currentLevel, SIGNAL(xshLevelTitleChanged()),
+					 this, SLOT(onCastChanged()));
+
 	ret = ret && QObject::connect(
 					 m_paletteController->getCurrentLevelPalette(), SIGNAL(paletteChanged()),
 					 this, SLOT(onPaletteChanged()));
@@ -401,6 +417,8 @@ void TApp::updateCurrentFrame()
 
 void TApp::onSceneSwitched()
 {
+	m_changedSnapshotSections = ToonzScene::LevelSetSection | ToonzScene::XsheetSection;
+
 	//update XSheet
 	m_currentXsheet->setXsheet(m_currentScene->getScene()->getXsheet());
 
@@ -448,6 +466,8 @@ void TApp::onXsheetSwitched()
 
 void TApp::onXsheetChanged()
 {
+	m_changedSnapshotSections |= ToonzScene::XsheetSection;
+
 	updateXshLevel();
 	updateCurrentFrame();
 	//update current tool
@@ -458,6 +478,7 @@ void TApp::onXsheetChanged()
 
 void TApp::onXsheetSoundChanged()
 {
+	m_changedSnapshotSections |= ToonzScene::XsheetSection;
 	m_currentXsheet->getXsheet()->invalidateSound();
 }
 
@@ -533,6 +554,8 @@ void TApp::onXshLevelSwitched(TXshLevel *)
 
 void TApp::onXshLevelChanged()
 {
+	m_changedSnapshotSections |= ToonzScene::LevelSetSection;
+
 	TXshLevel *level = m_currentLevel->getLevel();
 	std::vector<TFrameId> fids;
 	if (level != 0)
@@ -559,6 +582,8 @@ void TApp::onObjectSwitched()
 
 void TApp::onSplineChanged()
 {
+	m_changedSnapshotSections |= ToonzScene::XsheetSection;
+
 	if (m_currentObject->isSpline()) {
 		TXsheet *xsh = m_currentXsheet->getXsheet();
 		TStageObject *currentObject = xsh->getStageObject(m_currentObject->getObjectId());
@@ -568,8 +593,31 @@ void TApp::onSplineChanged()
 
 //-----------------------------------------------------------------------------
 
+void TApp::onObjectChanged()
+{
+	m_changedSnapshotSections |= ToonzScene::XsheetSection;
+}
+
+//-----------------------------------------------------------------------------
+
+void TApp::onFxChanged()
+{
+	m_changedSnapshotSections |= ToonzScene::XsheetSection;
+}
+
+//-----------------------------------------------------------------------------
+
+void TApp::onCastChanged()
+{
+	m_changedSnapshotSections |= ToonzScene::LevelSetSection;
+}
+
+//-----------------------------------------------------------------------------
+
 void TApp::onSceneChanged()
 {
+	m_changedSnapshotSections = ToonzScene::LevelSetSection | ToonzScene::XsheetSection;
+
 	updateCurrentFrame();
 	m_currentTool->updateMatrix();
 }
@@ -678,7 +726,13 @@ void TApp::autosave()
 
 	DVGui::ProgressDialog pb("Autosaving scene..." + toQString(scene->getScenePath()), 0, 0, 1);
 	pb.show();
-	IoCmd::saveScene();
+	if (Preferences::instance()->isAutosaveSnapshotsEnabled()) {
+		// The scene file is left untouched: the snapshot is offered for recovery on load
+		int sections = ToonzScene::LevelSetSection | ToonzScene::XsheetSection;
+		if (IoCmd::saveSceneSnapshot(sections & ~m_changedSnapshotSections))
+			m_changedSnapshotSections = 0;
+	} else
+		IoCmd::saveScene();
 	pb.setValue(1);
 }
 
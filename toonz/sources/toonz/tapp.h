@@ -77,6 +77,8 @@ class TApp : public QObject, public TTool::Application //Singleton
 	int m_autosavePeriod; // minutes
 	bool m_autosaveSuspended;
 	QTimer *m_autosaveTimer;
+	int m_changedSnapshotSections; // ToonzScene::SnapshotSection values changed since
+								   // the last autosave snapshot
 
 	TApp();
 
@@ -196,6 +198,9 @@ protected slots:
 	void onXshLevelChanged();
 	void onObjectSwitched();
 	void onSplineChanged();
+	void onObjectChanged();
+	void onFxChanged();
+	void onCastChanged();
 	void onSceneChanged();
 
 	void onImageChanged();
@@ -38,7 +38,7 @@ namespace
 {
 bool isMovieType(string type)
 {
-	return (type == "mov" || type == "avi" || type == "3gp");
+	return (type == "mov" || type == "avi" || type == "3gp" || type == "mp4");
 }
 };
 
@@ -33,7 +33,7 @@ public:
 	virtual ~TFarmExecutor() {}
 
 	// TTcpIpServer overrides
-	void onReceive(int socket, const QString &data);
+	QString onReceive(const vector<QString> &argv);
 
 protected:
 	virtual QString execute(const vector<QString> &argv) = 0;
@@ -37,6 +37,9 @@ public:
 	virtual ~TFarmProxy() {}
 
 	QString sendToStub(const QString &data);
+
+	// sends a message requiring no reply, without waiting for the stub to process it
+	void postToStub(const QString &data);
 	static int extractArgs(const QString &s, vector<QString> &argv);
 
 protected:
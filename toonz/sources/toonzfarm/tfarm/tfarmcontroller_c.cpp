@@ -375,7 +375,8 @@ void Controller::taskProgress(
 	data += ",";
 	data += QString::number(state);
 
-	QString reply = sendToStub(data);
+	// progress notifications are pushed without waiting for the controller
+	postToStub(data);
 }
 
 //------------------------------------------------------------------------------
@@ -1,7 +1,7 @@
 
 
 #include "tfarmexecutor.h"
-#include <QStringList>
+
 //------------------------------------------------------------------------------
 
 TFarmExecutor::TFarmExecutor(int port)
@@ -11,32 +11,14 @@ TFarmExecutor::TFarmExecutor(int port)
 
 //------------------------------------------------------------------------------
 
-int extractArgs(const QString &s, vector<QString> &argv)
-{
-	argv.clear();
-	if (s == "")
-		return 0;
-
-	QStringList sl = s.split(',');
-	int i;
-	for (i = 0; i < sl.size(); i++)
-		argv.push_back(sl.at(i));
-
-	return argv.size();
-}
-
-//------------------------------------------------------------------------------
-
-void TFarmExecutor::onReceive(int socket, const QString &data)
+QString TFarmExecutor::onReceive(const vector<QString> &argv)
 {
 	QString reply;
 
 	try {
-		vector<QString> argv;
-		extractArgs(data, argv);
 		reply = execute(argv);
 	} catch (...) {
 	}
 
-	sendReply(socket, reply);
+	return reply;
 }
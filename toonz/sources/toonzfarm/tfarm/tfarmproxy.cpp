@@ -9,27 +9,33 @@
 
 QString TFarmProxy::sendToStub(const QString &data)
 {
-	TTcpIpClient client;
+	vector<QString> argv;
+	extractArgs(data, argv);
 
-	int sock;
-	int ret = client.connect(m_hostName, m_addr, m_port, sock);
-	if (ret != OK) {
-		throw CantConnectToStub(m_hostName, m_addr, m_port);
-	}
+	// requests from all the proxies to the same stub share a persistent connection
+	TTcpIpConnection *connection = TTcpIpConnection::instance(m_hostName, m_addr, m_port);
 
 	QString reply;
-	ret = client.send(sock, data, reply);
-	if (ret != OK) {
-		client.disconnect(sock);
+	if (connection->send(argv, reply) != OK)
 		throw CantConnectToStub(m_hostName, m_addr, m_port);
-	}
 
-	client.disconnect(sock);
 	return reply;
 }
 
 //------------------------------------------------------------------------------
 
+void TFarmProxy::postToStub(const QString &data)
+{
+	vector<QString> argv;
+	extractArgs(data, argv);
+
+	TTcpIpConnection *connection = TTcpIpConnection::instance(m_hostName, m_addr, m_port);
+	if (connection->post(argv) != OK)
+		throw CantConnectToStub(m_hostName, m_addr, m_port);
+}
+
+//------------------------------------------------------------------------------
+
 int TFarmProxy::extractArgs(const QString &s, vector<QString> &argv)
 {
 	argv.clear();
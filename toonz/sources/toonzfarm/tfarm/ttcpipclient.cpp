@@ -1,7 +1,15 @@
 
 
 #include "ttcpip.h"
+#include "ttcpipprotocol.h"
 #include "tconvert.h"
+#include "tthread.h"
+
+#include <QMutex>
+#include <QWaitCondition>
+#include <QElapsedTimer>
+
+#include <map>
 
 #ifdef WIN32
 #include <Winsock2.h>
@@ -379,3 +387,288 @@ int TTcpIpClient::send(int sock, const string &data, string &reply)
   return ret;
 }
 */
+
+//==============================================================================
+
+class TTcpIpConnectionImp
+{
+public:
+	struct Request {
+		QString m_reply;
+		bool m_done, m_failed;
+
+		Request() : m_done(false), m_failed(false) {}
+	};
+
+	QString m_hostName, m_addr;
+	int m_port;
+
+	int m_sock;			  // -1 when not connected
+	bool m_readerRunning; // whether a ReplyReader is serving m_sock
+
+	quint32 m_lastId;
+	std::map<quint32, Request *> m_requests; // requests waiting for a reply, by id
+
+	QMutex m_mutex; // guards all the above
+	QMutex m_writeMutex;
+	QWaitCondition m_changed;
+
+public:
+	TTcpIpConnectionImp(const QString &hostName, const QString &addr, int port)
+		: m_hostName(hostName), m_addr(addr), m_port(port), m_sock(-1), m_readerRunning(false), m_lastId(0)
+	{
+#ifdef WIN32
+		WSADATA wsaData;
+		WSAStartup(MAKEWORD(1, 1), &wsaData);
+#endif
+	}
+
+	~TTcpIpConnectionImp()
+	{
+#ifdef WIN32
+		WSACleanup();
+#endif
+	}
+
+	int connect();
+	int write(int sock, quint32 id, const QByteArray &payload);
+	void close(int sock);
+};
+
+//------------------------------------------------------------------------------
+
+namespace
+{
+
+// Reads the replies arriving on a connection's socket. The socket is closed only
+// here, once unreadable - so that it can't be reused while someone is writing.
+class ReplyReader : public TThread::Runnable
+{
+	TTcpIpConnectionImp *m_imp;
+	int m_sock;
+
+public:
+	ReplyReader(TTcpIpConnectionImp *imp, int sock) : m_imp(imp), m_sock(sock) {}
+
+	void run()
+	{
+		quint32 id;
+		QByteArray payload;
+
+		while (TTcpIpProtocol::readMessage(m_sock, id, payload)) {
+			QMutexLocker sl(&m_imp->m_mutex);
+
+			std::map<quint32, TTcpIpConnectionImp::Request *>::iterator it = m_imp->m_requests.find(id);
+			if (it != m_imp->m_requests.end()) {
+				it->second->m_reply = QString::fromUtf8(payload);
+				it->second->m_done = true;
+				m_imp->m_changed.wakeAll();
+			}
+		}
+
+		m_imp->close(m_sock);
+	}
+};
+
+} // namespace
+
+//------------------------------------------------------------------------------
+
+// Called with m_mutex locked
+int TTcpIpConnectionImp::connect()
+{
+	// wait for the reader of a failed connection to release it
+	while (m_sock == -1 && m_readerRunning)
+		m_changed.wait(&m_mutex);
+
+	if (m_sock != -1)
+		return OK;
+
+	TTcpIpClient client;
+
+	int sock;
+	int ret = client.connect(m_hostName, m_addr, m_port, sock);
+	if (ret != OK)
+		return ret;
+
+	TTcpIpProtocol::configureSocket(sock);
+
+	m_sock = sock;
+	m_readerRunning = true;
+
+	TThread::Executor executor;
+	executor.addTask(new ReplyReader(this, sock));
+
+	return OK;
+}
+
+//------------------------------------------------------------------------------
+
+int TTcpIpConnectionImp::write(int sock, quint32 id, const QByteArray &payload)
+{
+	QMutexLocker wl(&m_writeMutex);
+
+	{
+		QMutexLocker sl(&m_mutex);
+		if (m_sock != sock)
+			return SEND_FAILED;
+	}
+
+	if (!TTcpIpProtocol::writeMessage(sock, id, payload)) {
+		// let the reader find out and release the connection
+		::shutdown(sock, 2);
+		return SEND_FAILED;
+	}
+
+	return OK;
+}
+
+//------------------------------------------------------------------------------
+
+void TTcpIpConnectionImp::close(int sock)
+{
+	QMutexLocker wl(&m_writeMutex);
+	QMutexLocker sl(&m_mutex);
+
+	std::map<quint32, Request *>::iterator it = m_requests.begin();
+	for (; it != m_requests.end(); ++it)
+		it->second->m_failed = true;
+
+	if (m_sock == sock)
+		m_sock = -1;
+	m_readerRunning = false;
+
+#ifdef WIN32
+	closesocket(sock);
+#else
+	::close(sock);
+#endif
+
+	m_changed.wakeAll();
+}
+
+//==============================================================================
+
+TTcpIpConnection::TTcpIpConnection(const QString &hostName, const QString &addr, int port)
+	: m_imp(new TTcpIpConnectionImp(hostName, addr, port))
+{
+}
+
+//------------------------------------------------------------------------------
+
+TTcpIpConnection::~TTcpIpConnection()
+{
+	{
+		QMutexLocker sl(&m_imp->m_mutex);
+		if (m_imp->m_sock != -1)
+			::shutdown(m_imp->m_sock, 2);
+
+		while (m_imp->m_readerRunning)
+			m_imp->m_changed.wait(&m_imp->m_mutex);
+	}
+
+	delete m_imp;
+}
+
+//------------------------------------------------------------------------------
+
+TTcpIpConnection *TTcpIpConnection::instance(const QString &hostName, const QString &addr, int port)
+{
+	static QMutex mutex;
+	static std::map<QString, TTcpIpConnection *> connections;
+
+	QMutexLocker sl(&mutex);
+
+	QString key = hostName + "|" + addr + "|" + QString::number(port);
+
+	TTcpIpConnection *&connection = connections[key];
+	if (!connection)
+		connection = new TTcpIpConnection(hostName, addr, port);
+
+	return connection;
+}
+
+//------------------------------------------------------------------------------
+
+bool TTcpIpConnection::isConnected() const
+{
+	QMutexLocker sl(&m_imp->m_mutex);
+	return m_imp->m_sock != -1;
+}
+
+//------------------------------------------------------------------------------
+
+int TTcpIpConnection::send(const std::vector<QString> &argv, QString &reply, int timeout)
+{
+	QByteArray payload(TTcpIpProtocol::packArgs(argv));
+	TTcpIpConnectionImp::Request request;
+
+	quint32 id;
+	int sock;
+	{
+		QMutexLocker sl(&m_imp->m_mutex);
+
+		int ret = m_imp->connect();
+		if (ret != OK)
+			return ret;
+
+		// 0 is reserved to posted messages
+		id = ++m_imp->m_lastId;
+		if (id == 0)
+			id = ++m_imp->m_lastId;
+
+		m_imp->m_requests[id] = &request;
+		sock = m_imp->m_sock;
+	}
+
+	int ret = m_imp->write(sock, id, payload);
+
+	QMutexLocker sl(&m_imp->m_mutex);
+
+	if (ret == OK) {
+		QElapsedTimer timer;
+		timer.start();
+
+		while (!request.m_done && !request.m_failed) {
+			qint64 remaining = timeout - timer.elapsed();
+			if (remaining <= 0 || !m_imp->m_changed.wait(&m_imp->m_mutex, (unsigned long)remaining)) {
+				if (request.m_done || request.m_failed)
+					break;
+
+				// the server is unresponsive - drop the connection, letting the reader
+				// fail the other pending requests as well
+				request.m_failed = true;
+				if (m_imp->m_sock == sock)
+					::shutdown(sock, 2);
+			}
+		}
+
+		if (!request.m_done)
+			ret = RECEIVE_FAILED;
+	}
+
+	m_imp->m_requests.erase(id);
+
+	if (ret == OK)
+		reply = request.m_reply;
+
+	return ret;
+}
+
+//------------------------------------------------------------------------------
+
+int TTcpIpConnection::post(const std::vector<QString> &argv)
+{
+	int sock;
+	{
+		QMutexLocker sl(&m_imp->m_mutex);
+
+		int ret = m_imp->connect();
+		if (ret != OK)
+			return ret;
+
+		sock = m_imp->m_sock;
+	}
+
+	return m_imp->write(sock, 0, TTcpIpProtocol::packArgs(argv));
+}
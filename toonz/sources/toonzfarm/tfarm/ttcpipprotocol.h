@@ -0,0 +1,214 @@
+#ifndef TTCPIPPROTOCOL_H
+#define TTCPIPPROTOCOL_H
+
+#include <QByteArray>
+#include <QString>
+#include <QtEndian>
+
+#include <vector>
+#include <string.h>
+
+#ifdef WIN32
+#include <Winsock2.h>
+#else
+#include <errno.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#endif
+
+//==============================================================================
+
+/*
+  Wire format shared by TTcpIpConnection and TTcpIpServer - internal to tfarm.
+
+  Binary messages are made of a 12 bytes header - the magic, the message id and
+  the payload size, as big endian 32-bit integers - followed by the payload.
+  Requests carry their arguments as a count followed by length-prefixed UTF-8
+  strings, replies carry the UTF-8 reply to the request with the same id.
+  Messages with a 0 id are posted - they get no reply.
+
+  Legacy text messages, still accepted by servers, start with LegacyMagic
+  followed by the payload size and LegacyEnd.
+*/
+
+namespace TTcpIpProtocol
+{
+
+const char Magic[4] = {'T', 'F', 'B', '1'};
+const int HeaderSize = 12;
+const int MaxPayloadSize = 64 << 20;
+
+const char LegacyMagic[] = "#$#THS01.00";
+const char LegacyEnd[] = "#$#THE";
+
+//------------------------------------------------------------------------------
+
+inline int readSome(int sock, char *buf, int size)
+{
+	for (;;) {
+#ifdef WIN32
+		int ret = ::recv(sock, buf, size, 0);
+#else
+		int ret = ::read(sock, buf, size);
+		if (ret < 0 && errno == EINTR)
+			continue;
+#endif
+		return ret;
+	}
+}
+
+//------------------------------------------------------------------------------
+
+inline bool readBytes(int sock, char *buf, int size)
+{
+	while (size > 0) {
+		int ret = readSome(sock, buf, size);
+		if (ret <= 0)
+			return false;
+
+		buf += ret;
+		size -= ret;
+	}
+
+	return true;
+}
+
+//------------------------------------------------------------------------------
+
+inline bool writeBytes(int sock, const char *buf, int size)
+{
+#if defined(MSG_NOSIGNAL)
+	const int flags = MSG_NOSIGNAL;
+#else
+	const int flags = 0;
+#endif
+
+	while (size > 0) {
+		int ret = ::send(sock, buf, size, flags);
+		if (ret < 0) {
+#ifndef WIN32
+			if (errno == EINTR)
+				continue;
+#endif
+			return false;
+		}
+
+		buf += ret;
+		size -= ret;
+	}
+
+	return true;
+}
+
+//------------------------------------------------------------------------------
+
+//! Prepares a socket for the exchange of small, pipelined messages.
+inline void configureSocket(int sock)
+{
+	int on = 1;
+	::setsockopt(sock, IPPROTO_TCP, TCP_NODELAY, (const char *)&on, sizeof(on));
+
+	// persistent connections must find out about peers which vanished silently
+	::setsockopt(sock, SOL_SOCKET, SO_KEEPALIVE, (const char *)&on, sizeof(on));
+
+#if defined(SO_NOSIGPIPE)
+	::setsockopt(sock, SOL_SOCKET, SO_NOSIGPIPE, (const char *)&on, sizeof(on));
+#endif
+}
+
+//------------------------------------------------------------------------------
+
+inline bool writeMessage(int sock, quint32 id, const QByteArray &payload)
+{
+	QByteArray message(HeaderSize + payload.size(), Qt::Uninitialized);
+	memcpy(message.data(), Magic, 4);
+	qToBigEndian(id, (uchar *)message.data() + 4);
+	qToBigEndian((quint32)payload.size(), (uchar *)message.data() + 8);
+	memcpy(message.data() + HeaderSize, payload.constData(), payload.size());
+
+	return writeBytes(sock, message.constData(), message.size());
+}
+
+//------------------------------------------------------------------------------
+
+//! Reads the id and payload of the next binary message, whose magic has been
+//! read already.
+inline bool readMessageBody(int sock, quint32 &id, QByteArray &payload)
+{
+	char header[HeaderSize - 4];
+	if (!readBytes(sock, header, HeaderSize - 4))
+		return false;
+
+	id = qFromBigEndian<quint32>((const uchar *)header);
+	quint32 size = qFromBigEndian<quint32>((const uchar *)header + 4);
+	if (size > (quint32)MaxPayloadSize)
+		return false;
+
+	payload.resize(size);
+	return readBytes(sock, payload.data(), size);
+}
+
+//------------------------------------------------------------------------------
+
+inline bool readMessage(int sock, quint32 &id, QByteArray &payload)
+{
+	char magic[4];
+	return readBytes(sock, magic, 4) && memcmp(magic, Magic, 4) == 0 &&
+		   readMessageBody(sock, id, payload);
+}
+
+//------------------------------------------------------------------------------
+
+inline QByteArray packArgs(const std::vector<QString> &argv)
+{
+	QByteArray payload;
+	uchar num[4];
+
+	qToBigEndian((quint32)argv.size(), num);
+	payload.append((const char *)num, 4);
+
+	for (int i = 0; i < (int)argv.size(); ++i) {
+		QByteArray arg(argv[i].toUtf8());
+
+		qToBigEndian((quint32)arg.size(), num);
+		payload.append((const char *)num, 4);
+		payload.append(arg);
+	}
+
+	return payload;
+}
+
+//------------------------------------------------------------------------------
+
+inline bool unpackArgs(const QByteArray &payload, std::vector<QString> &argv)
+{
+	const uchar *data = (const uchar *)payload.constData();
+	int size = payload.size(), pos = 4;
+
+	argv.clear();
+	if (size < 4)
+		return false;
+
+	quint32 count = qFromBigEndian<quint32>(data);
+	for (quint32 i = 0; i < count; ++i) {
+		if (size - pos < 4)
+			return false;
+
+		quint32 length = qFromBigEndian<quint32>(data + pos);
+		pos += 4;
+		if (length > (quint32)(size - pos))
+			return false;
+
+		argv.push_back(QString::fromUtf8(payload.constData() + pos, length));
+		pos += length;
+	}
+
+	return true;
+}
+
+} // namespace TTcpIpProtocol
+
+#endif
@@ -1,7 +1,9 @@
 
 
 #include "ttcpip.h"
+#include "ttcpipprotocol.h"
 #include "tconvert.h"
+#include "tsmartpointer.h"
 
 #ifdef WIN32
 #include <Winsock2.h>
@@ -19,6 +21,9 @@
 
 #include "tthreadmessage.h"
 #include "tthread.h"
+
+#include <QStringList>
+
 #ifndef WIN32
 #define SOCKET_ERROR -1
 #endif
@@ -44,8 +49,8 @@ class TTcpIpServerImp
 public:
 	TTcpIpServerImp(int port) : m_port(port), m_s(-1), m_server(0) {}
 
-	int readData(int sock, QString &data);
-	void onReceive(int sock, const QString &data);
+	QString onReceive(const vector<QString> &argv);
+	void stop();
 
 	int m_s; // socket id
 	int m_port;
@@ -56,187 +61,27 @@ public:
 
 //---------------------------------------------------------------------
 
-int TTcpIpServerImp::readData(int sock, QString &data)
+QString TTcpIpServerImp::onReceive(const vector<QString> &argv)
 {
-	int cnt = 0;
-	char buff[1025];
-	memset(buff, 0, sizeof(buff));
-
-#ifdef WIN32
-	if ((cnt = recv(sock, buff, sizeof(buff) - 1, 0)) < 0) {
-		int err = WSAGetLastError();
-		// GESTIRE L'ERRORE SPECIFICO
-		return -1;
-	}
-#else
-	if ((cnt = read(sock, buff, sizeof(buff) - 1)) < 0) {
-		printf("socket read failure %d\n", errno);
-		perror("network server");
-		close(sock);
-		return -1;
-	}
-#endif
-
-	if (cnt == 0)
-		return 0;
-
-#ifdef TRACE
-	cout << buff << endl
-		 << endl;
-#endif
-
-	string aa(buff);
-	int x1 = aa.find("#$#THS01.00");
-	x1 += sizeof("#$#THS01.00") - 1;
-	int x2 = aa.find("#$#THE");
-
-	string ssize;
-	for (int i = x1; i < x2; ++i)
-		ssize.push_back(buff[i]);
-
-	int dataSize = toInt(ssize);
-
-	unsigned long size = dataSize;
-	data = QString(buff + x2 + sizeof("#$#THE") - 1);
-	size -= data.size();
-
-	while (size > 0) {
-		memset(buff, 0, sizeof(buff));
-
-#ifdef WIN32
-		if ((cnt = recv(sock, buff, sizeof(buff) - 1, 0)) < 0) {
-			int err = WSAGetLastError();
-			// GESTIRE L'ERRORE SPECIFICO
-			return -1;
-		}
-#else
-		if ((cnt = read(sock, buff, sizeof(buff) - 1)) < 0) {
-			printf("socket read failure %d\n", errno);
-			perror("network server");
-			close(sock);
-			return -1;
-		}
-#endif
-		else if (cnt == 0) {
-			break; // break out of loop
-		} else if (cnt < (int)sizeof(buff)) {
-			buff[cnt] = '\0';
-			data += QString(buff);
-			//break;  // break out of loop
-		} else {
-			data += QString(buff);
-		}
-
-#ifdef TRACE
-		cout << buff << endl
-			 << endl;
-#endif
-
-		size -= cnt;
-	}
-
-#ifdef TRACE
-	cout << "read " << toString((int)data.length()) << " on " << toString((int)dataSize) << endl
-		 << endl;
-#endif
-
-	if (data.size() < dataSize)
-		return -1;
-
-#ifdef TRACE
-	cout << data.toStdString() << endl;
-#endif
-
-	return 0;
-}
-
-#if 0
-
-int TTcpIpServerImp::readData(int sock, string &data)
-{
-  int cnt = 0;
-  char buff[1024];
-
-  do
-  {
-    memset (buff,0,sizeof(buff));
-
-#ifdef WIN32
-    if (( cnt = recv(sock, buff, sizeof(buff), 0)) < 0 )
-    {
-      int err = WSAGetLastError();
-      // GESTIRE L'ERRORE SPECIFICO
-      return -1;
-    }
-#else
-    if (( cnt = read (sock, buff, sizeof(buff))) < 0 )
-    {
-      printf("socket read failure %d\n", errno);
-      perror("network server");
-      close(sock);
-      return -1;
-    }
-#endif
-    else
-    if (cnt == 0)
-      break;  // break out of loop
-
-    data += string(buff);
-  }
-  while (cnt != 0);  // do loop condition
-
-  return 0;
+	QMutexLocker sl(&m_mutex);
+	return m_server->onReceive(argv);
 }
 
-#endif
-
-//#define PRIMA
-
-#ifdef PRIMA
+//---------------------------------------------------------------------
 
-int TTcpIpServerImp::readData(int sock, string &data)
+void TTcpIpServerImp::stop()
 {
-	int cnt = 0;
-	char buff[1024];
-
-	do {
-		memset(buff, 0, sizeof(buff));
+	Sthutdown = true;
 
+	// wakes up the connections loop
+	if (m_s != -1) {
 #ifdef WIN32
-		if ((cnt = recv(sock, buff, sizeof(buff), 0)) < 0) {
-			int err = WSAGetLastError();
-			// GESTIRE L'ERRORE SPECIFICO
-			return -1;
-		}
+		closesocket(m_s);
+		m_s = -1;
 #else
-		if ((cnt = read(sock, buff, sizeof(buff))) < 0) {
-			printf("socket read failure %d\n", errno);
-			perror("network server");
-			close(sock);
-			return -1;
-		}
+		::shutdown(m_s, 2);
 #endif
-		else if (cnt == 0) {
-			break; // break out of loop
-		} else if (cnt < sizeof(buff)) {
-			data += string(buff);
-			//break;  // break out of loop
-		} else {
-			data += string(buff);
-		}
-	} while (cnt != 0); // do loop condition
-
-	return 0;
-}
-
-#endif
-
-//---------------------------------------------------------------------
-
-void TTcpIpServerImp::onReceive(int sock, const QString &data)
-{
-	QMutexLocker sl(&m_mutex);
-	m_server->onReceive(sock, data);
+	}
 }
 
 //---------------------------------------------------------------------
@@ -287,108 +132,205 @@ static void shutdown_cb(int)
 
 //---------------------------------------------------------------------
 
-class DataReader : public TThread::Runnable
+namespace
 {
-public:
-	DataReader(int clientSocket, TTcpIpServer *server, TTcpIpServerImp *serverImp)
-		: m_clientSocket(clientSocket), m_server(server), m_serverImp(serverImp) {}
 
-	void run();
+// A client connection, shared by its reader and the requests being served
+class ClientConnection : public TSmartObject
+{
+public:
+	int m_sock;
+	QMutex m_writeMutex;
 
-	int m_clientSocket;
-	TTcpIpServer *m_server;
-	TTcpIpServerImp *m_serverImp;
-};
+	ClientConnection(int sock) : m_sock(sock) {}
 
-void DataReader::run()
-{
-	QString data;
-	int ret = m_serverImp->readData(m_clientSocket, data);
-	if (ret != -1) {
-		if (data == QString("shutdown"))
-			Sthutdown = true;
-		else
-			m_serverImp->onReceive(m_clientSocket, data);
+	~ClientConnection()
+	{
 #ifdef WIN32
-		closesocket(m_clientSocket);
+		closesocket(m_sock);
 #else
-		close(m_clientSocket);
+		close(m_sock);
 #endif
 	}
+
+	void reply(quint32 id, const QString &reply)
+	{
+		QMutexLocker sl(&m_writeMutex);
+		TTcpIpProtocol::writeMessage(m_sock, id, reply.toUtf8());
+	}
+};
+
+typedef TSmartPointerT<ClientConnection> ClientConnectionP;
+
+//---------------------------------------------------------------------
+
+// Reads the single legacy text message of a connection, whose first bytes
+// have been read already
+bool readLegacyMessage(int sock, QByteArray &data, QString &message)
+{
+	const int magicSize = sizeof(TTcpIpProtocol::LegacyMagic) - 1;
+	const int endSize = sizeof(TTcpIpProtocol::LegacyEnd) - 1;
+
+	char buff[1024];
+
+	int end;
+	while ((end = data.indexOf(TTcpIpProtocol::LegacyEnd)) < 0) {
+		if (data.size() > 64)
+			return false;
+
+		int cnt = TTcpIpProtocol::readSome(sock, buff, sizeof(buff));
+		if (cnt <= 0)
+			return false;
+
+		data.append(buff, cnt);
+	}
+
+	if (!data.startsWith(TTcpIpProtocol::LegacyMagic))
+		return false;
+
+	bool ok;
+	int size = data.mid(magicSize, end - magicSize).toInt(&ok);
+	if (!ok || size < 0 || size > TTcpIpProtocol::MaxPayloadSize)
+		return false;
+
+	data.remove(0, end + endSize);
+	while (data.size() < size) {
+		int cnt = TTcpIpProtocol::readSome(sock, buff, sizeof(buff));
+		if (cnt <= 0)
+			return false;
+
+		data.append(buff, cnt);
+	}
+
+	message = QString::fromUtf8(data.constData(), size);
+	return true;
+}
+
+//---------------------------------------------------------------------
+
+void sendLegacyReply(int sock, const QString &reply)
+{
+	QByteArray replyUtf8 = reply.toUtf8();
+
+	QByteArray packet(TTcpIpProtocol::LegacyMagic);
+	packet += QByteArray::number(replyUtf8.size());
+	packet += TTcpIpProtocol::LegacyEnd;
+	packet += replyUtf8;
+
+	TTcpIpProtocol::writeBytes(sock, packet.constData(), packet.size());
+	::shutdown(sock, 1);
 }
 
 //---------------------------------------------------------------------
 
-class DataReceiver : public TThread::Runnable
+class RequestServer : public TThread::Runnable
 {
 public:
-	DataReceiver(int clientSocket, const QString &data, TTcpIpServer *server, TTcpIpServerImp *serverImp)
-		: m_clientSocket(clientSocket), m_data(data), m_server(server), m_serverImp(serverImp) {}
+	RequestServer(const ClientConnectionP &connection, TTcpIpServerImp *serverImp,
+				  quint32 id, const vector<QString> &argv)
+		: m_connection(connection), m_serverImp(serverImp), m_id(id), m_argv(argv) {}
 
-	void run();
+	void run()
+	{
+		QString reply;
+		try {
+			reply = m_serverImp->onReceive(m_argv);
+		} catch (...) {
+		}
 
-	int m_clientSocket;
-	QString m_data;
-	TTcpIpServer *m_server;
+		if (m_id != 0)
+			m_connection->reply(m_id, reply);
+	}
+
+	ClientConnectionP m_connection;
 	TTcpIpServerImp *m_serverImp;
+	quint32 m_id;
+	vector<QString> m_argv;
 };
 
 //---------------------------------------------------------------------
 
-void DataReceiver::run()
+class ConnectionReader : public TThread::Runnable
 {
-	m_serverImp->onReceive(m_clientSocket, m_data);
-#ifdef WIN32
-	closesocket(m_clientSocket);
-#else
-	close(m_clientSocket);
-#endif
-}
+public:
+	ConnectionReader(const ClientConnectionP &connection, TTcpIpServerImp *serverImp)
+		: m_connection(connection), m_serverImp(serverImp) {}
+
+	void run();
+
+	ClientConnectionP m_connection;
+	TTcpIpServerImp *m_serverImp;
+};
 
 //---------------------------------------------------------------------
 
-void TTcpIpServer::run()
+void ConnectionReader::run()
 {
-	try {
-#ifdef WIN32
+	int sock = m_connection->m_sock;
 
-		int err = establish(m_imp->m_port, m_imp->m_s);
-		if (!err && m_imp->m_s != -1) {
-			int t; // client socket
+	char magic[4];
+	if (!TTcpIpProtocol::readBytes(sock, magic, 4))
+		return;
 
-			while (!Sthutdown) /* loop for connections */
-			{
-				if ((t = get_connection(m_imp->m_s)) < 0) /* get a connection */
-				{
-					m_exitCode = WSAGetLastError();
-					// GESTIRE LA CONDIZIONE DI ERRORE
-					return;
-				}
+	if (memcmp(magic, TTcpIpProtocol::Magic, 4) != 0) {
+		QByteArray data(magic, 4);
+		QString message;
+		if (!readLegacyMessage(sock, data, message))
+			return;
 
-				QString data;
-				int ret = m_imp->readData(t, data);
-				if (ret != -1 && data != "") {
-					if (data == QString("shutdown")) {
-						//DebugBreak();
-						Sthutdown = true;
-					} else {
-						// creo un nuovo thread per la gestione dei dati ricevuti
-						TThread::Executor executor;
-						executor.addTask(new DataReceiver(t, data, this, m_imp));
-					}
-				} else {
-					::shutdown(t, 1);
-				}
+		if (message == QString("shutdown"))
+			m_serverImp->stop();
+		else {
+			vector<QString> argv;
+			if (message != "") {
+				QStringList sl = message.split(',');
+				for (int i = 0; i < sl.size(); ++i)
+					argv.push_back(sl.at(i));
 			}
-		} else {
-			m_exitCode = err;
-			return;
+
+			QString reply;
+			try {
+				reply = m_serverImp->onReceive(argv);
+			} catch (...) {
+			}
+
+			sendLegacyReply(sock, reply);
+		}
+
+		return;
+	}
+
+	// requests are served in parallel with the reading of the following ones
+	TThread::Executor executor;
+
+	quint32 id;
+	QByteArray payload;
+	vector<QString> argv;
+
+	while (TTcpIpProtocol::readMessageBody(sock, id, payload) &&
+		   TTcpIpProtocol::unpackArgs(payload, argv)) {
+		if (argv.size() == 1 && argv[0] == QString("shutdown")) {
+			m_serverImp->stop();
+			break;
 		}
 
-#else // !WIN32
+		executor.addTask(new RequestServer(m_connection, m_serverImp, id, argv));
 
+		if (!TTcpIpProtocol::readBytes(sock, magic, 4) || memcmp(magic, TTcpIpProtocol::Magic, 4) != 0)
+			break;
+	}
+}
+
+} // namespace
+
+//---------------------------------------------------------------------
+
+void TTcpIpServer::run()
+{
+	try {
 		int err = establish(m_imp->m_port, m_imp->m_s);
 		if (!err && m_imp->m_s != -1) {
+#ifndef WIN32
 //      signal(SIGCHLD, fireman);           /* this eliminates zombies */
 
 #ifdef MACOSX
@@ -397,30 +339,40 @@ void TTcpIpServer::run()
 			sigaction(SIGUSR1, &sact, 0);
 #else
 			sigset(SIGUSR1, shutdown_cb);
+#endif
 #endif
 
-			int t;
+			int t; // client socket
 
 			while (!Sthutdown) /* loop for connections */
 			{
 				if ((t = get_connection(m_imp->m_s)) < 0) /* get a connection */
 				{
+					if (Sthutdown)
+						break;
+
+#ifdef WIN32
+					m_exitCode = WSAGetLastError();
+					// GESTIRE LA CONDIZIONE DI ERRORE
+#else
 					if (errno == EINTR) /* EINTR might happen on accept(), */
 						continue;		/* try again */
 					perror("accept");   /* bad */
 					m_exitCode = errno;
+#endif
 					return;
 				}
 
+				TTcpIpProtocol::configureSocket(t);
+
+				// ogni connessione e' servita dal proprio thread
 				TThread::Executor executor;
-				executor.addTask(new DataReader(t, this, m_imp));
+				executor.addTask(new ConnectionReader(new ClientConnection(t), m_imp));
 			}
 		} else {
 			m_exitCode = err;
 			return;
 		}
-
-#endif // WIN32
 	} catch (...) {
 		m_exitCode = 2000;
 		return;
@@ -436,39 +388,6 @@ int TTcpIpServer::getExitCode() const
 	return m_exitCode;
 }
 
-//---------------------------------------------------------------------
-
-void TTcpIpServer::sendReply(int socket, const QString &reply)
-{
-	string replyUtf8 = reply.toStdString();
-
-	QString header("#$#THS01.00");
-	header += QString::number((int)replyUtf8.size());
-	header += QString("#$#THE");
-
-	string packet = header.toStdString() + replyUtf8;
-
-	//  string packet = reply;;
-
-	int nLeft = packet.size();
-	int idx = 0;
-	while (nLeft > 0) {
-#ifdef WIN32
-		int ret = send(socket, packet.c_str() + idx, nLeft, 0);
-#else
-		int ret = write(socket, packet.c_str() + idx, nLeft);
-#endif
-
-		if (ret == SOCKET_ERROR) {
-			// Error
-		}
-		nLeft -= ret;
-		idx += ret;
-	}
-
-	::shutdown(socket, 1);
-}
-
 //---------------------------------------------------------------------
 //---------------------------------------------------------------------
 
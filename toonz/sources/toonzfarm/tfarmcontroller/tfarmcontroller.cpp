@@ -17,10 +17,13 @@
 #include <QObject>
 #include <QCoreApplication>
 #include <QEventLoop>
+#include <QFile>
+#include <QTextStream>
 
 #include "tthread.h"
 
 #include <string>
+#include <algorithm>
 using namespace std;
 
 #ifndef WIN32
@@ -227,6 +230,8 @@ public:
 	int m_failureCount;
 
 	vector<QString> m_failedOnServers;
+
+	QDateTime m_lastProgressDate; //!< Time of the task's start or latest frame report
 };
 
 namespace
@@ -376,7 +381,7 @@ class FarmServerProxy
 {
 public:
 	FarmServerProxy(const QString &hostName, const QString &addr, int port, int maxTaskCount = 1)
-		: m_hostName(hostName), m_addr(addr), m_port(port), m_offline(false), m_attached(false), m_maxTaskCount(maxTaskCount), m_platform(NoPlatform)
+		: m_hostName(hostName), m_addr(addr), m_port(port), m_offline(false), m_attached(false), m_maxTaskCount(maxTaskCount), m_platform(NoPlatform), m_cpuCount(0), m_totPhysMem(0)
 	{
 		TFarmServerFactory serverFactory;
 		serverFactory.create(m_hostName, m_addr, m_port, &m_server);
@@ -422,6 +427,23 @@ public:
 		m_server->queryHwInfo(hwInfo);
 	}
 
+	void setHwInfo(const TFarmServer::HwInfo &hwInfo)
+	{
+		m_cpuCount = hwInfo.m_cpuCount;
+		m_totPhysMem = hwInfo.m_totPhysMem;
+	}
+
+	// Returns the rendering power of the server relative to a single core
+	// with enough memory - cores short of memory count proportionally less
+	double getWeight() const
+	{
+		if (m_cpuCount <= 0)
+			return 1.0;
+
+		const double memoryPerCore = 1024.0 * 1024.0; // 1 GB, in KB
+		return m_cpuCount * tmin(1.0, m_totPhysMem / (m_cpuCount * memoryPerCore));
+	}
+
 	void attachController(const QString &name, const QString &addr, int port)
 	{
 		m_server->attachController(name, addr, port);
@@ -441,6 +463,10 @@ public:
 	int m_maxTaskCount;
 	TFarmPlatform m_platform;
 
+	// hardware infoes, as returned by queryHwInfo
+	int m_cpuCount;
+	unsigned int m_totPhysMem; // KB
+
 	// vettore dei taskId assegnato al server
 	vector<QString> m_tasks;
 
@@ -521,6 +547,16 @@ void ConnectionTest::run()
 
 bool FarmServerProxy::testConnection(int timeout)
 {
+	// servers already talking to the controller are probed through their connection:
+	// an answer within the timeout proves they are alive, while a missing one drops
+	// the connection
+	TTcpIpConnection *connection = TTcpIpConnection::instance(m_hostName, m_addr, m_port);
+	if (connection->isConnected()) {
+		vector<QString> argv(1, QString("queryHwInfo"));
+		QString reply;
+		return connection->send(argv, reply, timeout) == OK;
+	}
+
 #ifdef WIN32
 
 	HANDLE hEvent = CreateEvent(NULL, TRUE, FALSE, NULL);
@@ -693,6 +729,11 @@ public:
 
 	void startTask(CtrlFarmTask *task, FarmServerProxy *server);
 
+	// splits the frames range of a waiting chunk that is about to be started
+	// on server when other servers would otherwise stay idle - the returned
+	// new sibling chunk holds the frames not kept by task
+	CtrlFarmTask *splitTask(CtrlFarmTask *task, FarmServerProxy *server);
+
 	CtrlFarmTask *getTaskToStart(FarmServerProxy *server = 0);
 	CtrlFarmTask *getNextTaskToStart(CtrlFarmTask *task, FarmServerProxy *server);
 
@@ -711,6 +752,18 @@ public:
 
 	void activateReadyServers();
 
+	// render times history, used to predict the cost of the tasks
+
+	void loadFrameCosts();
+	void saveFrameCosts() const;
+
+	// returns the expected cost of a frame of task, in seconds on a server of
+	// unit weight
+	double getFrameCost(const CtrlFarmTask *task) const;
+
+	// returns the expected cost of the frames still to be rendered by task
+	double getPredictedCost(const CtrlFarmTask *task) const;
+
 	// controller name, address and port
 	QString m_hostName;
 	QString m_addr;
@@ -722,6 +775,9 @@ public:
 
 	TThread::Mutex m_mutex;
 
+	// per-frame render costs, by scene path and shrink
+	map<QString, double> m_frameCosts;
+
 	static int NextTaskId;
 };
 
@@ -737,6 +793,8 @@ FarmController::FarmController(const QString &hostName, const QString &addr, int
 	Tifstream is(lastUsedIdFilePath);
 	if (is.good())
 		is >> NextTaskId;
+
+	loadFrameCosts();
 }
 
 //------------------------------------------------------------------------------
@@ -778,6 +836,118 @@ void FarmController::loadServersData(const TFilePath &globalRoot)
 namespace
 {
 
+// weight of the latest sample in the per-frame costs average
+const double FrameCostSmoothing = 0.3;
+
+TFilePath getFrameCostsPath()
+{
+	return getGlobalRoot() + "config" + "rendertimes.txt";
+}
+
+// render times are recorded by scene and shrink - the only task data
+// affecting them that is known to the controller
+QString getFrameCostKey(const TFarmTask *task)
+{
+	if (!task->m_isComposerTask || task->m_taskFilePath.isEmpty())
+		return QString();
+
+	return QString::number(task->m_shrink) + " " +
+		   QString::fromStdWString(task->m_taskFilePath.getWideString());
+}
+
+int getFramesCount(const TFarmTask *task)
+{
+	if (task->m_isComposerTask && task->m_from >= 0 && task->m_to >= task->m_from)
+		return (task->m_to - task->m_from) / tmax(task->m_step, 1) + 1;
+
+	return tmax(task->m_stepCount, 1);
+}
+
+} // anonymous namespace
+
+//------------------------------------------------------------------------------
+
+void FarmController::loadFrameCosts()
+{
+	QFile file(QString::fromStdWString(getFrameCostsPath().getWideString()));
+	if (!file.open(QIODevice::ReadOnly | QIODevice::Text))
+		return;
+
+	// each line holds a cost followed by its key
+	QTextStream is(&file);
+	is.setCodec("UTF-8");
+	while (!is.atEnd()) {
+		QString line = is.readLine();
+
+		int pos = line.indexOf(' ');
+		if (pos <= 0)
+			continue;
+
+		bool ok;
+		double cost = line.left(pos).toDouble(&ok);
+		if (ok && cost > 0)
+			m_frameCosts[line.mid(pos + 1)] = cost;
+	}
+}
+
+//------------------------------------------------------------------------------
+
+void FarmController::saveFrameCosts() const
+{
+	QFile file(QString::fromStdWString(getFrameCostsPath().getWideString()));
+	if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate | QIODevice::Text))
+		return;
+
+	QTextStream os(&file);
+	os.setCodec("UTF-8");
+	map<QString, double>::const_iterator it = m_frameCosts.begin();
+	for (; it != m_frameCosts.end(); ++it)
+		os << QString::number(it->second) << " " << it->first << "\n";
+}
+
+//------------------------------------------------------------------------------
+
+double FarmController::getFrameCost(const CtrlFarmTask *task) const
+{
+	map<QString, double>::const_iterator it = m_frameCosts.find(getFrameCostKey(task));
+	if (it != m_frameCosts.end())
+		return it->second;
+
+	// unknown scenes are expected to cost as much as the average one
+	if (m_frameCosts.empty())
+		return 1.0;
+
+	double sum = 0.0;
+	for (it = m_frameCosts.begin(); it != m_frameCosts.end(); ++it)
+		sum += it->second;
+
+	return sum / m_frameCosts.size();
+}
+
+//------------------------------------------------------------------------------
+
+double FarmController::getPredictedCost(const CtrlFarmTask *task) const
+{
+	if (task->m_subTasks.empty())
+		return getFramesCount(task) * getFrameCost(task);
+
+	double cost = 0.0;
+
+	vector<QString>::const_iterator itSubTaskId = task->m_subTasks.begin();
+	for (; itSubTaskId != task->m_subTasks.end(); ++itSubTaskId) {
+		map<TaskId, CtrlFarmTask *>::const_iterator itSubTask = m_tasks.find(TaskId(*itSubTaskId));
+		if (itSubTask != m_tasks.end() && itSubTask->second->m_status == Waiting)
+			cost += getPredictedCost(itSubTask->second);
+	}
+
+	return cost;
+}
+
+//------------------------------------------------------------------------------
+
+namespace
+{
+
 inline QString toString(const TFarmTask &task, int ver)
 {
 
@@ -1125,6 +1295,36 @@ CtrlFarmTask *FarmController::doAddTask(
 
 //------------------------------------------------------------------------------
 
+class TaskStarter : public TThread::Runnable
+{
+public:
+	TaskStarter(
+		FarmController *controller,
+		CtrlFarmTask *task,
+		FarmServerProxy *server = 0)
+		: m_controller(controller), m_task(task), m_server(server) {}
+
+	void run();
+
+	FarmController *m_controller;
+	CtrlFarmTask *m_task;
+	FarmServerProxy *m_server;
+};
+
+void TaskStarter::run()
+{
+
+	if (m_task->m_status != Suspended) {
+		if (m_server)
+			m_controller->startTask(m_task, m_server);
+		else {
+			m_controller->tryToStartTask(m_task);
+		}
+	}
+}
+
+//------------------------------------------------------------------------------
+
 void FarmController::startTask(CtrlFarmTask *task, FarmServerProxy *server)
 {
 	QMutexLocker sl(&m_mutex);
@@ -1144,7 +1344,9 @@ void FarmController::startTask(CtrlFarmTask *task, FarmServerProxy *server)
 	} else {
 		taskToBeSubmittedParent = task;
 
-		// cerca il primo subtask WAITING
+		// cerca il subtask WAITING piu' costoso (il primo, a parita' di costo)
+		double maxCost = 0.0;
+
 		std::vector<QString>::iterator itSubTaskId = task->m_subTasks.begin();
 		for (; itSubTaskId != task->m_subTasks.end(); ++itSubTaskId) {
 			QString subTaskId = *itSubTaskId;
@@ -1154,13 +1356,21 @@ void FarmController::startTask(CtrlFarmTask *task, FarmServerProxy *server)
 			if (itSubTask != m_tasks.end()) {
 				CtrlFarmTask *subTask = itSubTask->second;
 				if (subTask->m_status == Waiting) {
-					taskToBeSubmitted = subTask;
-					break;
+					double cost = getPredictedCost(subTask);
+					if (!taskToBeSubmitted || cost > maxCost) {
+						taskToBeSubmitted = subTask;
+						maxCost = cost;
+					}
 				}
 			}
 		}
 	}
 
+	if (!taskToBeSubmitted)
+		return;
+
+	CtrlFarmTask *splitChunk = splitTask(taskToBeSubmitted, server);
+
 	int rc = 0;
 	try {
 		server->addTask(taskToBeSubmitted);
@@ -1178,6 +1388,7 @@ void FarmController::startTask(CtrlFarmTask *task, FarmServerProxy *server)
 
 		taskToBeSubmitted->m_status = Running;
 		taskToBeSubmitted->m_startDate = startDate;
+		taskToBeSubmitted->m_lastProgressDate = startDate;
 
 		taskToBeSubmitted->m_serverId = server->getId();
 
@@ -1186,6 +1397,103 @@ void FarmController::startTask(CtrlFarmTask *task, FarmServerProxy *server)
 		msg += "\n\n";
 		m_userLog->info(msg);
 	}
+
+	if (splitChunk) {
+		// the new chunk is assigned once the controller is released
+		TThread::Executor executor;
+		executor.addTask(new TaskStarter(this, splitChunk));
+	}
+}
+
+//------------------------------------------------------------------------------
+
+CtrlFarmTask *FarmController::splitTask(CtrlFarmTask *task, FarmServerProxy *server)
+{
+	if (task->m_parentId == "" || !task->m_isComposerTask || task->m_status != Waiting)
+		return 0;
+
+	int framesCount = getFramesCount(task);
+	if (framesCount < 2)
+		return 0;
+
+	map<TaskId, CtrlFarmTask *>::iterator itParent = m_tasks.find(TaskId(task->m_parentId));
+	if (itParent == m_tasks.end())
+		return 0;
+
+	CtrlFarmTask *parent = itParent->second;
+
+	// a split is worth it only if servers would otherwise stay idle
+	int waitingCount = 0;
+
+	vector<QString>::iterator itSubTaskId = parent->m_subTasks.begin();
+	for (; itSubTaskId != parent->m_subTasks.end(); ++itSubTaskId) {
+		map<TaskId, CtrlFarmTask *>::iterator itSubTask = m_tasks.find(TaskId(*itSubTaskId));
+		if (itSubTask != m_tasks.end() && itSubTask->second != task &&
+			itSubTask->second->m_status == Waiting)
+			++waitingCount;
+	}
+
+	int idleCount = 0;
+	double idleWeight = 0.0;
+
+	map<QString, FarmServerProxy *>::iterator itServer = m_servers.begin();
+	for (; itServer != m_servers.end(); ++itServer) {
+		FarmServerProxy *idleServer = itServer->second;
+		if (idleServer == server || !idleServer->m_attached || idleServer->m_offline ||
+			!idleServer->getTasks().empty())
+			continue;
+
+		if (!(task->m_platform == NoPlatform || task->m_platform == idleServer->m_platform))
+			continue;
+
+		++idleCount;
+		idleWeight += idleServer->getWeight();
+	}
+
+	if (idleCount <= waitingCount)
+		return 0;
+
+	// server keeps a share of the frames proportional to its weight, compared
+	// to the average idle one - the remainder is split further as it starts
+	double weight = server->getWeight();
+	double share = weight / (weight + idleWeight / idleCount);
+
+	int keptCount = tcrop((int)(framesCount * share + 0.5), 1, framesCount - 1);
+
+	int step = tmax(task->m_step, 1);
+	int splitFrame = task->m_from + keptCount * step;
+
+	int subIndex = parent->m_subTasks.size();
+	QString id = parent->m_id + "." + QString::number(subIndex);
+	while (m_tasks.find(TaskId(id)) != m_tasks.end())
+		id = parent->m_id + "." + QString::number(++subIndex);
+
+	CtrlFarmTask *chunk = doAddTask(
+		id, parent->m_id,
+		parent->m_name + " " + QString::number(splitFrame).rightJustified(2, '0') + "-" +
+			QString::number(task->m_to).rightJustified(2, '0'),
+		task->getCommandLine(),
+		task->m_user, task->m_hostName,
+		false, task->m_to - splitFrame + 1,
+		task->m_priority, task->m_platform);
+
+	chunk->m_from = splitFrame;
+	if (task->m_dependencies) {
+		delete chunk->m_dependencies;
+		chunk->m_dependencies = new TFarmTask::Dependencies(*task->m_dependencies);
+	}
+
+	task->m_to = splitFrame - step;
+	task->m_stepCount = task->m_to - task->m_from + 1;
+	task->m_name = parent->m_name + " " + QString::number(task->m_from).rightJustified(2, '0') + "-" +
+				   QString::number(task->m_to).rightJustified(2, '0');
+
+	parent->m_subTasks.push_back(id);
+
+	m_userLog->info("Task " + task->m_id + " split, frames from " + QString::number(splitFrame) +
+					" moved to task " + id + "\n");
+
+	return chunk;
 }
 
 //------------------------------------------------------------------------------
@@ -1195,13 +1503,25 @@ CtrlFarmTask *FarmController::getTaskToStart(FarmServerProxy *server)
 	QMutexLocker sl(&m_mutex);
 
 	int maxPriority = 0;
+	double maxCost = 0.0;
 	CtrlFarmTask *candidate = 0;
 
 	map<TaskId, CtrlFarmTask *>::iterator itTask = m_tasks.begin();
 	for (; itTask != m_tasks.end(); ++itTask) {
 		CtrlFarmTask *task = itTask->second;
+
+		// a parita' di priorita' si preferisce il task piu' costoso, cosi' che
+		// la coda di un job non resti su un solo server
+		double cost = 0.0;
+		bool longer = false;
+		if (task->m_status == Waiting && task->m_priority == maxPriority &&
+			candidate && candidate->m_status == Waiting) {
+			cost = getPredictedCost(task);
+			longer = cost > maxCost;
+		}
+
 		if ((!server || (task->m_platform == NoPlatform || task->m_platform == server->m_platform)) &&
-			((task->m_status == Waiting && task->m_priority > maxPriority) ||
+			((task->m_status == Waiting && (task->m_priority > maxPriority || longer)) ||
 			 (task->m_status == Aborted && task->m_failureCount < 3) && task->m_parentId != "")) {
 			bool dependenciesCompleted = true;
 
@@ -1222,6 +1542,7 @@ CtrlFarmTask *FarmController::getTaskToStart(FarmServerProxy *server)
 
 			if (dependenciesCompleted) {
 				maxPriority = task->m_priority;
+				maxCost = longer ? cost : getPredictedCost(task);
 				candidate = task;
 			}
 		}
@@ -1240,6 +1561,7 @@ CtrlFarmTask *FarmController::getNextTaskToStart(CtrlFarmTask *except, FarmServe
 	QMutexLocker sl(&m_mutex);
 
 	int maxPriority = 0;
+	double maxCost = 0.0;
 	CtrlFarmTask *candidate = 0;
 
 	map<TaskId, CtrlFarmTask *>::iterator itTask = m_tasks.begin();
@@ -1247,8 +1569,16 @@ CtrlFarmTask *FarmController::getNextTaskToStart(CtrlFarmTask *except, FarmServe
 		CtrlFarmTask *task = itTask->second;
 		if (except == task)
 			continue;
+
+		double cost = 0.0;
+		bool longer = false;
+		if (task->m_status == Waiting && task->m_priority == maxPriority && candidate) {
+			cost = getPredictedCost(task);
+			longer = cost > maxCost;
+		}
+
 		if ((task->m_platform == NoPlatform || task->m_platform == server->m_platform) &&
-			task->m_status == Waiting && task->m_priority > maxPriority) {
+			task->m_status == Waiting && (task->m_priority > maxPriority || longer)) {
 			bool dependenciesCompleted = true;
 
 			if (task->m_dependencies) {
@@ -1268,6 +1598,7 @@ CtrlFarmTask *FarmController::getNextTaskToStart(CtrlFarmTask *except, FarmServe
 
 			if (dependenciesCompleted) {
 				maxPriority = task->m_priority;
+				maxCost = longer ? cost : getPredictedCost(task);
 				candidate = task;
 			}
 		}
@@ -1278,6 +1609,18 @@ CtrlFarmTask *FarmController::getNextTaskToStart(CtrlFarmTask *except, FarmServe
 
 //------------------------------------------------------------------------------
 
+namespace
+{
+
+bool isHeavierServer(const FarmServerProxy *a, const FarmServerProxy *b)
+{
+	return a->getWeight() > b->getWeight();
+}
+
+} // anonymous namespace
+
+//------------------------------------------------------------------------------
+
 bool FarmController::tryToStartTask(CtrlFarmTask *task)
 {
 	QMutexLocker sl(&m_mutex);
@@ -1303,7 +1646,12 @@ bool FarmController::tryToStartTask(CtrlFarmTask *task)
 		return false;
 
 	if (task->m_subTasks.empty()) {
+		// the task may have been started meanwhile, see splitTask()
+		if (task->m_status == Running || task->m_status == Completed)
+			return false;
+
 		vector<FarmServerProxy *> m_partiallyBusyServers;
+		vector<FarmServerProxy *> idleServers;
 
 		map<QString, FarmServerProxy *>::iterator it = m_servers.begin();
 		for (; it != m_servers.end(); ++it) {
@@ -1319,18 +1667,27 @@ bool FarmController::tryToStartTask(CtrlFarmTask *task)
 				if (its != task->m_failedOnServers.end())
 					continue;
 
-				if (server->testConnection(500)) {
-					if (server->getTasks().size() == 0) {
-						try {
-							startTask(task, server);
-						} catch (TException & /*e*/) {
-							continue;
-						}
+				if (server->getTasks().size() == 0)
+					idleServers.push_back(server);
+				else
+					m_partiallyBusyServers.push_back(server);
+			}
+		}
 
-						return true;
-					} else
-						m_partiallyBusyServers.push_back(server);
+		// i server piu' potenti vengono provati per primi
+		std::stable_sort(idleServers.begin(), idleServers.end(), isHeavierServer);
+
+		vector<FarmServerProxy *>::iterator it1 = idleServers.begin();
+		for (; it1 != idleServers.end(); ++it1) {
+			FarmServerProxy *server = *it1;
+			if (server->testConnection(500)) {
+				try {
+					startTask(task, server);
+				} catch (TException & /*e*/) {
+					continue;
 				}
+
+				return true;
 			}
 		}
 
@@ -1353,9 +1710,12 @@ bool FarmController::tryToStartTask(CtrlFarmTask *task)
 		// un task composto e' considerato started sse e' started almeno uno
 		// dei task che lo compongono
 
+		// starting a subtask may add new ones to the task, see splitTask()
+		vector<QString> subTasks(task->m_subTasks);
+
 		bool started = false;
-		vector<QString>::iterator itSubTaskId = task->m_subTasks.begin();
-		for (; itSubTaskId != task->m_subTasks.end(); ++itSubTaskId) {
+		vector<QString>::iterator itSubTaskId = subTasks.begin();
+		for (; itSubTaskId != subTasks.end(); ++itSubTaskId) {
 			map<TaskId, CtrlFarmTask *>::iterator itSubTask = m_tasks.find(TaskId(*itSubTaskId));
 			if (itSubTask != m_tasks.end()) {
 				CtrlFarmTask *subTask = itSubTask->second;
@@ -1411,6 +1771,7 @@ public:
 		m_server->m_attached = true;
 		//m_server->m_maxTaskCount = hwInfo.m_cpuCount;
 		m_server->m_maxTaskCount = 1;
+		m_server->setHwInfo(hwInfo);
 	}
 
 	FarmServerProxy *m_server;
@@ -1432,6 +1793,7 @@ void FarmController::initServer(FarmServerProxy *server)
 	server->m_attached = true;
 	//server->m_maxTaskCount = hwInfo.m_cpuCount;
 	server->m_maxTaskCount = 1;
+	server->setHwInfo(hwInfo);
 
 	server->m_platform = hwInfo.m_type;
 }
@@ -1454,36 +1816,6 @@ QString FarmController::addTask(
 
 //------------------------------------------------------------------------------
 
-class TaskStarter : public TThread::Runnable
-{
-public:
-	TaskStarter(
-		FarmController *controller,
-		CtrlFarmTask *task,
-		FarmServerProxy *server = 0)
-		: m_controller(controller), m_task(task), m_server(server) {}
-
-	void run();
-
-	FarmController *m_controller;
-	CtrlFarmTask *m_task;
-	FarmServerProxy *m_server;
-};
-
-void TaskStarter::run()
-{
-
-	if (m_task->m_status != Suspended) {
-		if (m_server)
-			m_controller->startTask(m_task, m_server);
-		else {
-			m_controller->tryToStartTask(m_task);
-		}
-	}
-}
-
-//------------------------------------------------------------------------------
-
 QString FarmController::addTask(const TFarmTask &task, bool suspended)
 {
 	QString id = QString::number(NextTaskId++);
@@ -1916,6 +2248,8 @@ void FarmController::taskProgress(
 	int frameNumber,
 	FrameState state)
 {
+	QMutexLocker sl(&m_mutex);
+
 	map<TaskId, CtrlFarmTask *>::iterator itTask = m_tasks.find(TaskId(taskId));
 	if (itTask != m_tasks.end()) {
 		CtrlFarmTask *task = itTask->second;
@@ -1924,6 +2258,25 @@ void FarmController::taskProgress(
 		else
 			++task->m_failedSteps;
 
+		// the time elapsed since the previous report is the frame's render time,
+		// which is normalized to a server of unit weight
+		QDateTime now = QDateTime::currentDateTime();
+		QString key = getFrameCostKey(task);
+		if (state == FrameDone && !key.isEmpty() && task->m_lastProgressDate.isValid()) {
+			map<QString, FarmServerProxy *>::iterator itServer = m_servers.find(task->m_serverId);
+			double weight = (itServer != m_servers.end()) ? itServer->second->getWeight() : 1.0;
+			double cost = task->m_lastProgressDate.msecsTo(now) * 0.001 * weight;
+
+			if (cost > 0) {
+				map<QString, double>::iterator itCost = m_frameCosts.find(key);
+				if (itCost == m_frameCosts.end())
+					m_frameCosts[key] = cost;
+				else
+					itCost->second += FrameCostSmoothing * (cost - itCost->second);
+			}
+		}
+		task->m_lastProgressDate = now;
+
 		if (task->m_parentId != "") {
 			map<TaskId, CtrlFarmTask *>::iterator itParentTask = m_tasks.find(TaskId(task->m_parentId));
 			CtrlFarmTask *parentTask = itParentTask->second;
@@ -1973,6 +2326,11 @@ void FarmController::taskCompleted(const QString &taskId, int exitCode)
 
 		task->m_completionDate = QDateTime::currentDateTime();
 
+		if (task->m_status == Completed && !getFrameCostKey(task).isEmpty()) {
+			QMutexLocker sl(&m_mutex);
+			saveFrameCosts();
+		}
+
 		if (task->m_status == Aborted) {
 			task->m_failedOnServers.push_back(task->m_serverId);
 			++task->m_failureCount;
@@ -11,6 +11,7 @@
 #include "tlog.h"
 #include "tfilepath_io.h"
 #include "tcli.h"
+#include "tipc.h"
 
 #include <string>
 #include <map>
@@ -19,6 +20,9 @@
 #include <QProcess>
 #include <QCoreApplication>
 #include <QEventLoop>
+#include <QLocalSocket>
+#include <QThread>
+#include <QTime>
 
 #include "tthread.h"
 
@@ -193,6 +197,93 @@ inline bool isBlank(char c)
 	return c == ' ' || c == '\t' || c == '\n';
 }
 
+//-----------------------------------------------------------------------------
+
+// Time allowed to a starting tcomposer worker to initialize
+const int WorkerStartTimeout = 2 * 60 * 1000;
+
+//-----------------------------------------------------------------------------
+
+//! Returns the name of the local server of the tcomposer worker serving this farm server.
+QString workerName()
+{
+	static QString name(tipc::applicationSpecificServerName("tcomposerworker"));
+	return name;
+}
+
+//-----------------------------------------------------------------------------
+
+//! Returns the executable path of the specified command line.
+QString getExecutable(const QString &cmdline)
+{
+	QString line = cmdline.trimmed();
+	if (line.startsWith('"'))
+		return line.mid(1, line.indexOf('"', 1) - 1);
+
+	return line.left(line.indexOf(' '));
+}
+
+//-----------------------------------------------------------------------------
+
+/*!
+  Makes the tcomposer worker execute the specified tcomposer command line, starting
+  the worker if needed. The worker keeps the scene loaded between the chunks of a task,
+  sparing their startup and loading times.
+  Returns false if the worker could not be reached - in which case the command line
+  should be run in a process of its own.
+*/
+bool runOnWorker(const QString &cmdline, int &exitCode)
+{
+	QLocalSocket socket;
+	socket.connectToServer(workerName());
+
+	if (!socket.waitForConnected(1000)) {
+		QStringList args;
+		args << "-worker" << workerName();
+		if (!QProcess::startDetached(getExecutable(cmdline), args))
+			return false;
+
+		QTime time;
+		time.start();
+
+		do {
+			QThread::msleep(100);
+			socket.connectToServer(workerName());
+		} while (!socket.waitForConnected(1000) && time.elapsed() < WorkerStartTimeout);
+
+		if (socket.state() != QLocalSocket::ConnectedState)
+			return false;
+	}
+
+	tipc::Stream stream(&socket);
+	tipc::Message msg;
+
+	stream << (msg << QString("$compose") << cmdline);
+
+	//A worker crashing mid-task fails the task like a crashing process would
+	exitCode = -1;
+	if (tipc::readMessage(stream, msg) == "ok")
+		msg >> exitCode;
+
+	return true;
+}
+
+//-----------------------------------------------------------------------------
+
+void quitWorker()
+{
+	QLocalSocket socket;
+	socket.connectToServer(workerName());
+	if (!socket.waitForConnected(1000))
+		return;
+
+	tipc::Stream stream(&socket);
+	tipc::Message msg;
+
+	stream << (msg << QString("$quit"));
+	stream.flush();
+}
+
 } // anonymous namespace
 
 //==============================================================================
@@ -457,14 +548,21 @@ void Task::run()
 	//cout << exename << endl;
 	//cout << cmdline << endl;
 
-	QProcess process;
+	int exitCode = 0;
+	bool ret;
 
-	process.start(cmdline);
-	process.waitForFinished(-1);
+	if (m_cmdline.contains("tcomposer") && !m_cmdline.contains(".bat") && runOnWorker(cmdline, exitCode))
+		ret = (exitCode != 0);
+	else {
+		QProcess process;
 
-	int exitCode = process.exitCode();
-	int errorCode = process.error();
-	bool ret = (errorCode != QProcess::UnknownError) || exitCode;
+		process.start(cmdline);
+		process.waitForFinished(-1);
+
+		exitCode = process.exitCode();
+		int errorCode = process.error();
+		ret = (errorCode != QProcess::UnknownError) || exitCode;
+	}
 
 	//int ret=QProcess::execute(/*"C:\\depot\\vincenzo\\toonz\\main\\x86_debug\\" +*/cmdline);
 
@@ -509,6 +607,7 @@ FarmServer::FarmServer(int port, TUserLog *log)
 FarmServer::~FarmServer()
 {
 	delete m_executor;
+	quitWorker();
 }
 
 //------------------------------------------------------------------------------
@@ -0,0 +1,379 @@
+
+
+// TnzCore includes
+#include "tsystem.h"
+#include "tthread.h"
+
+// TFarm includes
+#include "tfarmserver.h"
+#include "tfarmproxy.h"
+#include "ttcpip.h"
+
+// Qt includes
+#include <QCoreApplication>
+#include <QStringList>
+#include <QProcess>
+#include <QThread>
+#include <QMutex>
+
+// STD includes
+#include <iostream>
+#include <vector>
+#include <set>
+#include <algorithm>
+
+//! tfarmtest exercises the farm's shared connections across processes.
+/*!
+  Run with no arguments (or with -servers, -threads and -requests), the program
+  plays the controller: it starts the specified number of simulated servers as
+  child processes - the same executable, run with "-server <port>" - and talks to
+  them the way the controller does, through TFarmServer proxies sharing a single
+  connection per server. It checks that:
+
+    - concurrent requests pipelined on a connection receive their own replies;
+    - a request whose reply is late fails, dropping the connection along with the
+      requests pending on it, and the next request connects again;
+    - requests to a server which died fail instead of hanging.
+
+  The exit code is 0 when all checks succeed.
+*/
+
+//******************************************************************************
+//    Local namespace
+//******************************************************************************
+
+namespace
+{
+
+const int c_defaultBasePort = 18150;
+
+bool l_failed = false;
+QMutex l_outputMutex;
+
+//------------------------------------------------------------------
+
+void check(bool condition, const QString &what)
+{
+	if (condition)
+		return;
+
+	QMutexLocker sl(&l_outputMutex);
+	std::cout << "*error* " << what.toStdString() << std::endl;
+	l_failed = true;
+}
+
+//------------------------------------------------------------------
+
+int intArg(const QStringList &args, const QString &name, int defaultValue)
+{
+	int i = args.indexOf(name);
+	return (i >= 0 && i + 1 < args.size()) ? args[i + 1].toInt() : defaultValue;
+}
+
+//==================================================================
+
+//! A server accepting any task, without executing it. Replies carry data which
+//! the test can match against its requests.
+class SimulatedServer : public TFarmServer
+{
+	int m_port;
+
+	QMutex m_mutex;
+	std::vector<QString> m_tasks;
+
+public:
+	SimulatedServer(int port) : m_port(port) {}
+
+	// Returns the task id, as a number. "sleep <ms>" commands delay the reply.
+	int addTask(const QString &taskid, const QString &cmdline)
+	{
+		if (cmdline.startsWith("sleep "))
+			TSystem::sleep(cmdline.mid(6).toInt());
+
+		QMutexLocker sl(&m_mutex);
+		m_tasks.push_back(taskid);
+
+		return taskid.toInt();
+	}
+
+	int terminateTask(const QString &taskid)
+	{
+		QMutexLocker sl(&m_mutex);
+
+		std::vector<QString>::iterator it = std::find(m_tasks.begin(), m_tasks.end(), taskid);
+		if (it == m_tasks.end())
+			return -1;
+
+		m_tasks.erase(it);
+		return 0;
+	}
+
+	int getTasks(std::vector<QString> &tasks)
+	{
+		QMutexLocker sl(&m_mutex);
+		tasks = m_tasks;
+		return (int)tasks.size();
+	}
+
+	// The cpu count identifies the server
+	void queryHwInfo(HwInfo &hwInfo)
+	{
+		hwInfo.m_cpuCount = m_port;
+		hwInfo.m_totPhysMem = hwInfo.m_availPhysMem = 1024 * 1024;
+		hwInfo.m_totVirtMem = hwInfo.m_availVirtMem = 1024 * 1024;
+	}
+
+	void attachController(const QString &name, const QString &addr, int port) {}
+	void detachController(const QString &name, const QString &addr, int port) {}
+};
+
+//==================================================================
+
+//! Sends requests to a server through a proxy of its own, checking the replies.
+class Client : public QThread
+{
+	int m_port, m_index, m_requestCount;
+
+public:
+	Client(int port, int index, int requestCount)
+		: m_port(port), m_index(index), m_requestCount(requestCount) {}
+
+	void run()
+	{
+		TFarmServer *server;
+		TFarmServerFactory().create(TSystem::getHostName(), "", m_port, &server);
+
+		try {
+			for (int r = 0; r < m_requestCount; ++r) {
+				int id = m_index * m_requestCount + r + 1;
+
+				int ret = server->addTask(QString::number(id), "render");
+				check(ret == id, QString("server %1: reply %2 to addTask %3").arg(m_port).arg(ret).arg(id));
+
+				TFarmServer::HwInfo hwInfo;
+				server->queryHwInfo(hwInfo);
+				check(hwInfo.m_cpuCount == m_port, QString("server %1: queryHwInfo answered by %2").arg(m_port).arg(hwInfo.m_cpuCount));
+			}
+		} catch (TFarmProxyException &) {
+			check(false, QString("server %1: can't connect").arg(m_port));
+		}
+
+		delete server;
+	}
+};
+
+//==================================================================
+
+//! Sends a single request with the specified reply timeout.
+class TimedRequest : public QThread
+{
+	int m_port, m_timeout;
+	QString m_cmdline;
+
+public:
+	int m_ret;
+
+public:
+	TimedRequest(int port, const QString &cmdline, int timeout)
+		: m_port(port), m_timeout(timeout), m_cmdline(cmdline), m_ret(-1) {}
+
+	void run()
+	{
+		std::vector<QString> argv;
+		argv.push_back("addTask");
+		argv.push_back("0");
+		argv.push_back(m_cmdline);
+
+		QString reply;
+		m_ret = TTcpIpConnection::instance(TSystem::getHostName(), "", m_port)->send(argv, reply, m_timeout);
+	}
+};
+
+//------------------------------------------------------------------
+
+//! Waits until the server on the specified port answers, or the timeout expires.
+bool waitForServer(int port, int timeout)
+{
+	TTcpIpConnection *connection = TTcpIpConnection::instance(TSystem::getHostName(), "", port);
+
+	std::vector<QString> argv(1, QString("queryHwInfo"));
+	QString reply;
+
+	for (int elapsed = 0; elapsed < timeout; elapsed += 100) {
+		if (connection->send(argv, reply, 1000) == OK)
+			return true;
+
+		TSystem::sleep(100);
+	}
+
+	return false;
+}
+
+//==================================================================
+
+void testPipelining(const std::vector<int> &ports, int threadCount, int requestCount)
+{
+	std::vector<Client *> clients;
+	for (int s = 0; s < (int)ports.size(); ++s)
+		for (int t = 0; t < threadCount; ++t)
+			clients.push_back(new Client(ports[s], t, requestCount));
+
+	for (int c = 0; c < (int)clients.size(); ++c)
+		clients[c]->start();
+
+	for (int c = 0; c < (int)clients.size(); ++c) {
+		clients[c]->wait();
+		delete clients[c];
+	}
+
+	// Every server must have received each task exactly once
+	for (int s = 0; s < (int)ports.size(); ++s) {
+		TFarmServer *server;
+		TFarmServerFactory().create(TSystem::getHostName(), "", ports[s], &server);
+
+		try {
+			std::vector<QString> tasks;
+			server->getTasks(tasks);
+
+			std::set<QString> uniqueTasks(tasks.begin(), tasks.end());
+			check((int)tasks.size() == threadCount * requestCount && uniqueTasks.size() == tasks.size(),
+				  QString("server %1: %2 tasks received").arg(ports[s]).arg(tasks.size()));
+
+			for (int t = 0; t < (int)tasks.size(); ++t)
+				server->terminateTask(tasks[t]);
+		} catch (TFarmProxyException &) {
+			check(false, QString("server %1: can't connect").arg(ports[s]));
+		}
+
+		delete server;
+	}
+}
+
+//------------------------------------------------------------------
+
+void testTimeout(int port)
+{
+	// The slow request times out while another one is pending behind it - both fail
+	TimedRequest slow(port, "sleep 2000", 500);
+	slow.start();
+	TSystem::sleep(100);
+
+	TimedRequest pending(port, "render", TTcpIpConnection::DefaultReplyTimeout);
+	pending.start();
+
+	slow.wait();
+	pending.wait();
+
+	check(slow.m_ret == RECEIVE_FAILED, QString("server %1: late reply not detected").arg(port));
+	check(pending.m_ret == RECEIVE_FAILED, QString("server %1: request pending on a dropped connection didn't fail").arg(port));
+
+	// The next request connects again
+	check(waitForServer(port, 5000), QString("server %1: can't reconnect after a timeout").arg(port));
+}
+
+//------------------------------------------------------------------
+
+void testDeadServer(int port, QProcess *process)
+{
+	process->kill();
+	process->waitForFinished();
+
+	TFarmServer *server;
+	TFarmServerFactory().create(TSystem::getHostName(), "", port, &server);
+
+	bool failed = false;
+	try {
+		TFarmServer::HwInfo hwInfo;
+		server->queryHwInfo(hwInfo);
+	} catch (TFarmProxyException &) {
+		failed = true;
+	}
+
+	check(failed, QString("server %1: request to a dead server didn't fail").arg(port));
+	delete server;
+}
+
+//------------------------------------------------------------------
+
+int runServer(int port)
+{
+	SimulatedServer server(port);
+	TFarmServerStub stub(&server, port);
+
+	return stub.run();
+}
+
+//------------------------------------------------------------------
+
+int runController(const QStringList &args)
+{
+	int serverCount = intArg(args, "-servers", 4);
+	int threadCount = intArg(args, "-threads", 8);
+	int requestCount = intArg(args, "-requests", 100);
+	int basePort = intArg(args, "-port", c_defaultBasePort);
+
+	std::vector<int> ports;
+	std::vector<QProcess *> processes;
+
+	for (int s = 0; s < serverCount; ++s) {
+		int port = basePort + s;
+
+		QProcess *process = new QProcess;
+		process->setProcessChannelMode(QProcess::ForwardedChannels);
+		process->start(QCoreApplication::applicationFilePath(), QStringList() << "-server" << QString::number(port));
+
+		ports.push_back(port);
+		processes.push_back(process);
+	}
+
+	for (int s = 0; s < serverCount; ++s)
+		check(waitForServer(ports[s], 10000), QString("server %1 didn't start").arg(ports[s]));
+
+	if (!l_failed) {
+		std::cout << "Pipelining " << threadCount * requestCount << " requests per server..." << std::endl;
+		testPipelining(ports, threadCount, requestCount);
+
+		std::cout << "Timing out late replies..." << std::endl;
+		testTimeout(ports[0]);
+
+		std::cout << "Detecting dead servers..." << std::endl;
+		testDeadServer(ports.back(), processes.back());
+	}
+
+	for (int s = 0; s < serverCount; ++s) {
+		QProcess *process = processes[s];
+		if (process->state() != QProcess::NotRunning) {
+			TTcpIpConnection::instance(TSystem::getHostName(), "", ports[s])->post(std::vector<QString>(1, QString("shutdown")));
+			if (!process->waitForFinished(5000))
+				process->kill();
+		}
+
+		process->waitForFinished();
+		delete process;
+	}
+
+	std::cout << (l_failed ? "FAILED" : "OK") << std::endl;
+	return l_failed ? 1 : 0;
+}
+
+} // namespace
+
+//******************************************************************************
+//    Main
+//******************************************************************************
+
+int main(int argc, char *argv[])
+{
+	QCoreApplication a(argc, argv);
+
+	// Initialize thread components
+	TThread::init();
+
+	QStringList args = a.arguments();
+
+	int ret = args.contains("-server") ? runServer(intArg(args, "-server", c_defaultBasePort))
+									   : runController(args);
+
+	TThread::shutdown();
+	return ret;
+}
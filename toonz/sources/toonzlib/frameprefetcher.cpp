@@ -0,0 +1,152 @@
+
+
+// TnzLib includes
+#include "toonz/imagemanager.h"
+#include "toonz/txsheet.h"
+#include "toonz/txshcell.h"
+#include "toonz/txshcolumn.h"
+#include "toonz/txshsimplelevel.h"
+
+#include "toonz/frameprefetcher.h"
+
+// TnzCore includes
+#include "tcommon.h"
+
+// STD includes
+#include <set>
+
+//***************************************************************************************
+//    Local namespace
+//***************************************************************************************
+
+namespace
+{
+
+class PrefetchTask : public TThread::Runnable
+{
+	TXshSimpleLevelP m_sl;
+	TFrameId m_fid;
+	int m_subsampling;
+	int m_priority;
+
+public:
+	PrefetchTask(TXshSimpleLevel *sl, const TFrameId &fid, int subsampling, int priority)
+		: m_sl(sl), m_fid(fid), m_subsampling(subsampling), m_priority(priority) {}
+
+	// Below the default priority, so that prefetches never delay other tasks
+	int schedulingPriority() { return m_priority; }
+	QThread::Priority runningPriority() { return QThread::LowPriority; }
+
+	void run()
+	{
+		try {
+			if (!ImageManager::instance()->isCached(m_sl->getImageId(m_fid)))
+				m_sl->getFrame(m_fid, ImageManager::none, m_subsampling);
+		} catch (...) {
+			// The frame will be loaded - and the error reported - on use
+		}
+	}
+};
+
+} // namespace
+
+//***************************************************************************************
+//    FramePrefetcher implementation
+//***************************************************************************************
+
+FramePrefetcher::FramePrefetcher()
+{
+	m_executor.setMaxActiveTasks(2);
+}
+
+//-----------------------------------------------------------------------------
+
+FramePrefetcher::~FramePrefetcher()
+{
+}
+
+//-----------------------------------------------------------------------------
+
+FramePrefetcher *FramePrefetcher::instance()
+{
+	static FramePrefetcher theInstance;
+	return &theInstance;
+}
+
+//-----------------------------------------------------------------------------
+
+void FramePrefetcher::setThreadsCount(int count)
+{
+	m_executor.setMaxActiveTasks(tmax(count, 1));
+}
+
+//-----------------------------------------------------------------------------
+
+void FramePrefetcher::prefetch(TXshSimpleLevel *sl, const std::vector<TFrameId> &fids, int subsampling)
+{
+	m_executor.cancelAll();
+
+	ImageManager *im = ImageManager::instance();
+
+	for (int i = 0; i < (int)fids.size(); ++i) {
+		if (!im->isCached(sl->getImageId(fids[i])))
+			m_executor.addTask(new PrefetchTask(sl, fids[i], subsampling, -i));
+	}
+}
+
+//-----------------------------------------------------------------------------
+
+void FramePrefetcher::prefetch(TXshSimpleLevel *sl, int index, int direction, int framesCount, int subsampling)
+{
+	std::vector<TFrameId> fids;
+
+	int frameCount = sl->getFrameCount();
+	for (int i = 1; i <= framesCount; ++i) {
+		int idx = index + i * direction;
+		if (idx < 0 || idx >= frameCount)
+			break;
+
+		fids.push_back(sl->index2fid(idx));
+	}
+
+	prefetch(sl, fids, subsampling);
+}
+
+//-----------------------------------------------------------------------------
+
+void FramePrefetcher::prefetch(TXsheet *xsh, int row, int direction, int rowsCount, int subsampling)
+{
+	m_executor.cancelAll();
+
+	ImageManager *im = ImageManager::instance();
+	std::set<std::pair<TXshSimpleLevel *, TFrameId>> queued;
+
+	int c, cCount = xsh->getColumnCount();
+	for (int i = 1; i <= rowsCount; ++i) {
+		int r = row + i * direction;
+		if (r < 0)
+			break;
+
+		for (c = 0; c < cCount; ++c) {
+			TXshColumn *column = xsh->getColumn(c);
+			if (!column || column->isEmpty() || !column->isCamstandVisible())
+				continue;
+
+			const TXshCell &cell = xsh->getCell(r, c);
+
+			TXshSimpleLevel *sl = cell.getSimpleLevel();
+			if (!sl || !queued.insert(std::make_pair(sl, cell.getFrameId())).second)
+				continue;
+
+			if (!im->isCached(sl->getImageId(cell.getFrameId())))
+				m_executor.addTask(new PrefetchTask(sl, cell.getFrameId(), subsampling, -i));
+		}
+	}
+}
+
+//-----------------------------------------------------------------------------
+
+void FramePrefetcher::cancel()
+{
+	m_executor.cancelAll();
+}
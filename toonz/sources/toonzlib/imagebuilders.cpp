@@ -24,6 +24,7 @@
 #include "toonz/levelproperties.h"
 #include "toonz/txshsimplelevel.h"
 #include "toonz/fill.h"
+#include "toonz/levelproxies.h"
 
 // Qt includes
 #include <QGLContext>
@@ -90,71 +91,97 @@ inline int ImageLoader::buildSubsampling(int imFlags, BuildExtData *data)
 
 //-------------------------------------------------------------------------
 
-TImageP ImageLoader::build(int imFlags, void *extData)
+namespace
 {
-	assert(extData);
-
-	// Extract external data
-	BuildExtData *data = static_cast<BuildExtData *>(extData);
-
-	int subsampling = buildSubsampling(imFlags, data);
 
+//! Loads the specified frame of the level at path - returns 0 on failure.
+TImageP loadFrame(const TFilePath &path, const TFrameId &fid, int shrink, bool icon, bool enable64bit)
+{
 	try {
 		// Initialize level reader
-		TLevelReaderP lr(m_path);
+		TLevelReaderP lr(path);
 		if (!lr)
 			return TImageP();
 
 		// Load info in cases where it's required first
 		lr->doReadPalette(false);
 
-		if ((m_path.getType() == "pli") || (m_path.getType() == "svg") || (m_path.getType() == "psd"))
+		if ((path.getType() == "pli") || (path.getType() == "svg") || (path.getType() == "psd"))
 			lr->loadInfo();
 
 		lr->doReadPalette(true); // Allow palette loading
 
-		TImageReaderP ir = lr->getFrameReader(m_fid);
-
-		bool enable64bit = (imFlags & ImageManager::is64bitEnabled);
+		TImageReaderP ir = lr->getFrameReader(fid);
 		ir->enable16BitRead(enable64bit); // Set 64-bit loading if required
 
 		// Load the image
 		TImageP img;
 
-		if (data->m_icon && m_path.getType() == "tlv")
+		if (icon && path.getType() == "tlv")
 			img = ir->loadIcon(); // TODO: Why just in the tlv case??
 		else {
-			ir->setShrink(subsampling);
+			ir->setShrink(shrink);
 			img = ir->load();
 		}
 
 		ir->enable16BitRead(false);
+		return img;
+	} catch (...) {
+		return TImageP();
+	}
+}
 
-		if (!img)
-			return img; // There was an error loading the image.
+} // namespace
 
-		TPalette *palette = data->m_sl->getPalette();
-		if (palette)
-			img->setPalette(palette);
+//-------------------------------------------------------------------------
 
-		if (subsampling > 1) {
-			// Store the subsampling info in the image
-			if (TRasterImageP ri = img)
-				ri->setSubsampling(subsampling);
-			else if (TToonzImageP ti = img)
-				ti->setSubsampling(subsampling);
-		}
+TImageP ImageLoader::build(int imFlags, void *extData)
+{
+	assert(extData);
 
-		// In case the image will be cached, store its subsampling and 64 bit compatibility
-		if (!(imFlags & ImageManager::dontPutInCache)) {
-			m_subsampling = subsampling;
-			m_64bitCompatible = data->m_sl->is16BitChannelLevel() ? enable64bit : true;
-		}
+	// Extract external data
+	BuildExtData *data = static_cast<BuildExtData *>(extData);
 
-		return img;
-	} catch (...) {
-		return TImageP();
+	int subsampling = buildSubsampling(imFlags, data);
+	bool enable64bit = (imFlags & ImageManager::is64bitEnabled);
+
+	TImageP img;
+
+	// Subsampled images are read from the level's proxies, when available. Proxies
+	// may be replaced in background, in which case the level is read instead.
+	if (subsampling > 1 && !data->m_icon && !enable64bit &&
+		!data->m_sl->getProperties()->getDirtyFlag()) {
+		int proxyShrink;
+		TFilePath proxyPath = LevelProxies::instance()->getProxyPath(m_path, m_fid, subsampling, proxyShrink);
+		if (!proxyPath.isEmpty())
+			img = loadFrame(proxyPath, m_fid, subsampling / proxyShrink, false, false);
 	}
+
+	if (!img)
+		img = loadFrame(m_path, m_fid, subsampling, data->m_icon, enable64bit);
+
+	if (!img)
+		return img; // There was an error loading the image.
+
+	TPalette *palette = data->m_sl->getPalette();
+	if (palette)
+		img->setPalette(palette);
+
+	if (subsampling > 1) {
+		// Store the subsampling info in the image
+		if (TRasterImageP ri = img)
+			ri->setSubsampling(subsampling);
+		else if (TToonzImageP ti = img)
+			ti->setSubsampling(subsampling);
+	}
+
+	// In case the image will be cached, store its subsampling and 64 bit compatibility
+	if (!(imFlags & ImageManager::dontPutInCache)) {
+		m_subsampling = subsampling;
+		m_64bitCompatible = data->m_sl->is16BitChannelLevel() ? enable64bit : true;
+	}
+
+	return img;
 }
 
 //-------------------------------------------------------------------------
@@ -0,0 +1,290 @@
+
+
+// TnzLib includes
+#include "toonz/txshsimplelevel.h"
+#include "toonz/txshleveltypes.h"
+#include "toonz/toonzscene.h"
+#include "toonz/tproject.h"
+#include "toonz/levelproperties.h"
+
+#include "toonz/levelproxies.h"
+
+// TnzCore includes
+#include "tlevel_io.h"
+#include "timage_io.h"
+#include "tsystem.h"
+#include "tconvert.h"
+
+// Qt includes
+#include <QDir>
+#include <QDateTime>
+#include <QHash>
+
+//***************************************************************************************
+//    Local namespace
+//***************************************************************************************
+
+namespace
+{
+
+const int c_proxyShrinks[] = {4, 2};
+const std::vector<int> c_proxyShrinksVec(c_proxyShrinks, c_proxyShrinks + sizeof(c_proxyShrinks) / sizeof(int));
+
+//-----------------------------------------------------------------------------
+
+//! Returns the latest modification time among the files of the specified level.
+QDateTime getModificationTime(const TFilePath &levelPath, const TLevelP &level)
+{
+	if (!levelPath.isLevelName())
+		return TFileStatus(levelPath).getLastModificationTime();
+
+	QDateTime modTime;
+	for (TLevel::Iterator it = level->begin(); it != level->end(); ++it) {
+		QDateTime frameModTime = TFileStatus(levelPath.withFrame(it->first)).getLastModificationTime();
+		if (modTime.isNull() || frameModTime > modTime)
+			modTime = frameModTime;
+	}
+
+	return modTime;
+}
+
+//-----------------------------------------------------------------------------
+
+//! Returns the name of the specified level's proxy, of the specified shrink.
+TFilePath getProxyName(const TFilePath &levelPath, int shrink)
+{
+	std::wstring name = levelPath.getWideName() + L"_" + toWideString(shrink) + L"x";
+
+	if (levelPath.getType() == "tlv")
+		return TFilePath(name + L".tlv");
+
+	// Sequences are written as png sequences, single images as single pngs
+	return TFilePath(name + (levelPath.isLevelName() ? L"..png" : L".png"));
+}
+
+//-----------------------------------------------------------------------------
+
+void writeProxy(const TFilePath &proxyPath, const TLevelReaderP &lr, const TLevelP &level, int shrink)
+{
+	TLevelWriterP lw(proxyPath);
+	if (level->getPalette())
+		lw->setPalette(level->getPalette());
+
+	for (TLevel::Iterator it = level->begin(); it != level->end(); ++it) {
+		TImageReaderP ir = lr->getFrameReader(it->first);
+		ir->setShrink(shrink);
+
+		TImageP img = ir->load();
+		if (!img)
+			throw TException("Loading level: can't read frame.");
+
+		lw->getFrameWriter(it->first)->save(img);
+	}
+}
+
+} // namespace
+
+//***************************************************************************************
+//    LevelProxies::BuildTask  definition
+//***************************************************************************************
+
+class LevelProxies::BuildTask : public TThread::Runnable
+{
+	TFilePath m_levelPath, m_proxiesFolder;
+
+public:
+	BuildTask(const TFilePath &levelPath, const TFilePath &proxiesFolder)
+		: m_levelPath(levelPath), m_proxiesFolder(proxiesFolder) {}
+
+	QThread::Priority runningPriority() { return QThread::LowestPriority; }
+
+	void run();
+};
+
+//-----------------------------------------------------------------------------
+
+void LevelProxies::BuildTask::run()
+{
+	TFilePath tempFolder;
+
+	try {
+		TLevelReaderP lr(m_levelPath);
+		if (!lr)
+			return;
+
+		TLevelP level = lr->loadInfo();
+		if (!level || level->getFrameCount() == 0)
+			return;
+
+		QDateTime modTime = getModificationTime(m_levelPath, level);
+
+		// Proxies are stored in a folder named after the level's modification time, inside
+		// a folder specific to the level
+		QString levelKey = QString::fromStdWString(m_levelPath.getWideName()) + "_" +
+						   QString::number(qHash(QString::fromStdWString(m_levelPath.getWideString())), 16);
+
+		TFilePath levelFolder = m_proxiesFolder + TFilePath(levelKey.toStdWString());
+		TFilePath folder = levelFolder + TFilePath(QString::number(modTime.toTime_t()).toStdWString());
+
+		std::map<int, TFilePath> proxyPaths;
+
+		const std::vector<int> &shrinks = LevelProxies::getShrinks();
+		for (int s = 0; s < (int)shrinks.size(); ++s)
+			proxyPaths[shrinks[s]] = folder + getProxyName(m_levelPath, shrinks[s]);
+
+		if (!TFileStatus(folder).doesExist()) {
+			// Replace outdated proxies, if any - withdrawing them first. Loads which
+			// already retrieved their paths fall back to the level.
+			LevelProxies::instance()->invalidate(m_levelPath);
+
+			if (TFileStatus(levelFolder).doesExist())
+				TSystem::rmDirTree(levelFolder);
+
+			// Proxies are written to a temporary folder which is renamed once complete - so
+			// that interrupted generations are never mistaken for valid proxies
+			tempFolder = levelFolder + TFilePath("building");
+			TSystem::mkDir(tempFolder);
+
+			for (int s = 0; s < (int)shrinks.size(); ++s)
+				writeProxy(tempFolder + getProxyName(m_levelPath, shrinks[s]), lr, level, shrinks[s]);
+
+			if (!QDir().rename(QString::fromStdWString(tempFolder.getWideString()),
+							   QString::fromStdWString(folder.getWideString())))
+				throw TException("Can't rename the proxies folder.");
+		}
+
+		LevelProxies::instance()->setProxies(m_levelPath, proxyPaths, modTime);
+	} catch (...) {
+		// Proxies are just an optimization - the level will be read directly
+		if (!tempFolder.isEmpty() && TFileStatus(tempFolder).doesExist()) {
+			try {
+				TSystem::rmDirTree(tempFolder);
+			} catch (...) {
+			}
+		}
+	}
+}
+
+//***************************************************************************************
+//    LevelProxies implementation
+//***************************************************************************************
+
+LevelProxies::LevelProxies()
+{
+	// A single generation at a time, not to hog the disks
+	m_executor.setMaxActiveTasks(1);
+}
+
+//-----------------------------------------------------------------------------
+
+LevelProxies::~LevelProxies()
+{
+}
+
+//-----------------------------------------------------------------------------
+
+LevelProxies *LevelProxies::instance()
+{
+	static LevelProxies theInstance;
+	return &theInstance;
+}
+
+//-----------------------------------------------------------------------------
+
+const std::vector<int> &LevelProxies::getShrinks()
+{
+	return c_proxyShrinksVec;
+}
+
+//-----------------------------------------------------------------------------
+
+bool LevelProxies::canHaveProxies(TXshSimpleLevel *sl)
+{
+	if (!sl || !sl->getScene() || !sl->getScene()->getProject())
+		return false;
+
+	// Proxies reflect the saved level - not the unsaved edits
+	if (sl->getProperties()->getDirtyFlag())
+		return false;
+
+	const TFilePath &path = sl->getPath();
+	switch (sl->getType()) {
+	case TZP_XSHLEVEL:
+		return path.getType() == "tlv";
+	case OVL_XSHLEVEL:
+		return !isMovieType(path) && path.getType() != "psd";
+	default:
+		return false;
+	}
+}
+
+//-----------------------------------------------------------------------------
+
+void LevelProxies::build(TXshSimpleLevel *sl)
+{
+	if (!canHaveProxies(sl))
+		return;
+
+	TFilePath levelPath = sl->getScene()->decodeFilePath(sl->getPath());
+	TFilePath proxiesFolder = sl->getScene()->getProject()->getProjectFolder() + "proxies";
+
+	m_executor.addTask(new BuildTask(levelPath, proxiesFolder));
+}
+
+//-----------------------------------------------------------------------------
+
+void LevelProxies::invalidate(const TFilePath &levelPath)
+{
+	QMutexLocker locker(&m_mutex);
+	m_proxies.erase(levelPath);
+}
+
+//-----------------------------------------------------------------------------
+
+TFilePath LevelProxies::getProxyPath(const TFilePath &levelPath, const TFrameId &fid,
+									 int shrink, int &proxyShrink) const
+{
+	proxyShrink = 1;
+
+	Proxies proxies;
+	{
+		QMutexLocker locker(&m_mutex);
+
+		std::map<TFilePath, Proxies>::const_iterator it = m_proxies.find(levelPath);
+		if (it == m_proxies.end())
+			return TFilePath();
+
+		proxies = it->second;
+	}
+
+	// The level may have been overwritten since the proxies were generated
+	TFilePath framePath = levelPath.isLevelName() ? levelPath.withFrame(fid) : levelPath;
+	if (TFileStatus(framePath).getLastModificationTime() > proxies.m_modTime)
+		return TFilePath();
+
+	const std::vector<int> &shrinks = getShrinks();
+	for (int s = 0; s < (int)shrinks.size(); ++s) {
+		if (shrink % shrinks[s] != 0)
+			continue;
+
+		std::map<int, TFilePath>::const_iterator pt = proxies.m_paths.find(shrinks[s]);
+		if (pt != proxies.m_paths.end()) {
+			proxyShrink = shrinks[s];
+			return pt->second;
+		}
+	}
+
+	return TFilePath();
+}
+
+//-----------------------------------------------------------------------------
+
+void LevelProxies::setProxies(const TFilePath &levelPath, const std::map<int, TFilePath> &proxyPaths,
+							  const QDateTime &modTime)
+{
+	QMutexLocker locker(&m_mutex);
+
+	Proxies &proxies = m_proxies[levelPath];
+	proxies.m_paths = proxyPaths;
+	proxies.m_modTime = modTime;
+}
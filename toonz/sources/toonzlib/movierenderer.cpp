@@ -4,6 +4,7 @@
 #include "tsystem.h"
 #include "tstopwatch.h"
 #include "tthreadmessage.h"
+#include "tthread.h"
 #include "timagecache.h"
 #include "tlevel_io.h"
 #include "trasterimage.h"
@@ -26,6 +27,7 @@
 
 // Qt includes
 #include <QCoreApplication>
+#include <QWaitCondition>
 
 #include "toonz/movierenderer.h"
 
@@ -38,6 +40,13 @@ namespace
 
 int RenderSessionId = 0;
 
+//! Maximum number of rendered frames waiting in the saving queue, before the
+//! render threads are stopped
+const int c_maxSavingFrames = 4;
+
+//! Number of frames saved concurrently in the image sequence case
+const int c_maxSavingThreads = 2;
+
 //---------------------------------------------------------
 
 void addMark(const TRasterP &mark, TRasterImageP img)
@@ -115,13 +124,15 @@ public:
 	std::map<double, std::pair<TRasterP, TRasterP>> m_toBeSaved;
 	std::vector<pair<double, TFxPair>> m_framesToBeRendered;
 	std::string m_renderCacheId;
-	/*--- 同じラスタのキャッシュを使いまわすとき、
-		最初のものだけガンマをかけ、以降はそれを使いまわすようにする。
-	---*/
-	std::map<double, bool> m_toBeAppliedGamma;
 
 	TThread::Mutex m_mutex;
 
+	// Saving stage. Frames are saved on m_savingExecutor - in order for movie types
+	TThread::Executor m_savingExecutor;
+	QMutex m_savingMutex; //!< Not recursive, unlike m_mutex - needed by m_savingCondition
+	QWaitCondition m_savingCondition;
+	int m_savingFramesCount; //!< Frames submitted to m_savingExecutor, and not saved yet
+
 	int m_renderSessionId;
 	long m_whiteSample;
 
@@ -132,6 +143,7 @@ public:
 	bool m_cacheResults;
 	bool m_preview;
 	bool m_movieType;
+	bool m_savingCanceled;
 
 public:
 	Imp(ToonzScene *scene, const TFilePath &moviePath, int threadCount, bool cacheResults);
@@ -158,6 +170,39 @@ public:
 	//! the associated time-adjusted level frame.
 	std::pair<bool, int> saveFrame(double frame, const std::pair<TRasterP, TRasterP> &rasters);
 	std::string getRenderCacheId();
+
+	// Saving stage methods
+
+	//! Queues the specified rasters for saving on m_savingExecutor. Requires m_mutex.
+	void submitFrame(double frame, const std::pair<TRasterP, TRasterP> &rasters);
+	//! Waits until at most the specified number of frames is waiting to be saved.
+	void waitForSaving(int maxSavingFrames);
+	//! Saves a frame submitted to the saving stage, and reports it to the listeners.
+	void doSaveFrame(double frame, const std::pair<TRasterP, TRasterP> &rasters);
+
+	class SaveFrameTask;
+};
+
+//---------------------------------------------------------
+
+class MovieRenderer::Imp::SaveFrameTask : public TThread::Runnable
+{
+	TSmartPointerT<MovieRenderer::Imp> m_imp;
+	double m_frame;
+	std::pair<TRasterP, TRasterP> m_rasters;
+
+public:
+	SaveFrameTask(MovieRenderer::Imp *imp, double frame, const std::pair<TRasterP, TRasterP> &rasters)
+		: m_imp(imp), m_frame(frame), m_rasters(rasters) {}
+
+	void run() { m_imp->doSaveFrame(m_frame, m_rasters); }
+
+	// Saving tasks share the global tasks queue with the render tasks, which are all
+	// queued when the render starts. Render threads wait for the saving stage in
+	// doRenderRasterCompleted() - so frames to be saved must be dispatched first, or
+	// the render tasks ahead of them in the queue would never let them start.
+	// The (default) 0 load ensures they are started immediately.
+	int schedulingPriority() { return 10; }
 };
 
 //---------------------------------------------------------
@@ -170,8 +215,11 @@ MovieRenderer::Imp::Imp(ToonzScene *scene,
 	  ,
 	  m_failure(false) //  AFTER the first completed raster gets processed
 	  ,
-	  m_cacheResults(cacheResults), m_preview(moviePath.isEmpty()), m_movieType(isMovieType(moviePath))
+	  m_cacheResults(cacheResults), m_preview(moviePath.isEmpty()), m_movieType(isMovieType(moviePath)), m_savingFramesCount(0), m_savingCanceled(false)
 {
+	// Movie frames must be written sequentially, image sequences can be written out of order
+	m_savingExecutor.setMaxActiveTasks(m_movieType ? 1 : c_maxSavingThreads);
+
 	m_renderCacheId = m_fp.withName(m_fp.getName() + "#RENDERID" + QString::number(m_renderSessionId).toStdString())
 						  .getLevelName();
 
@@ -364,15 +412,6 @@ std::pair<bool, int> MovieRenderer::Imp::saveFrame(double frame, const std::pair
 		TRasterP rasterA = rasters.first, rasterB = rasters.second;
 		assert(rasterA);
 
-		/*--- 同じラスタのキャッシュを使いまわすとき、
-		最初のものだけガンマをかけ、以降はそれを使いまわすようにする。
-	---*/
-		if (m_renderSettings.m_gamma != 1.0 && m_toBeAppliedGamma[frame]) {
-			TRop::gammaCorrect(rasterA, m_renderSettings.m_gamma);
-			if (rasterB)
-				TRop::gammaCorrect(rasterB, m_renderSettings.m_gamma);
-		}
-
 		// Flush images
 		try {
 			TRasterImageP imgA(rasterA);
@@ -417,127 +456,165 @@ void MovieRenderer::Imp::doRenderRasterCompleted(const RenderData &renderData)
 {
 	assert(!(m_cacheResults && m_levelUpdaterB.get())); // Cannot cache results on stereoscopy
 
-	QMutexLocker locker(&m_mutex);
+	{
+		QMutexLocker locker(&m_mutex);
 
-	// Build soundtrack at the first time a frame is completed - and the filetype is that of a movie.
-	if (m_firstCompletedRaster && m_movieType && !m_st) {
-		int from, to;
-		getRange(m_scene, false, from, to);
+		// Build soundtrack at the first time a frame is completed - and the filetype is that of a movie.
+		if (m_firstCompletedRaster && m_movieType && !m_st) {
+			int from, to;
+			getRange(m_scene, false, from, to);
+
+			TLevelP oldLevel(m_levelUpdaterA->getInputLevel());
+			if (oldLevel) {
+				from = tmin(from, oldLevel->begin()->first.getNumber() - 1);
+				to = tmax(to, (--oldLevel->end())->first.getNumber() - 1);
+			}
 
-		TLevelP oldLevel(m_levelUpdaterA->getInputLevel());
-		if (oldLevel) {
-			from = tmin(from, oldLevel->begin()->first.getNumber() - 1);
-			to = tmax(to, (--oldLevel->end())->first.getNumber() - 1);
+			addSoundtrack(from, to, m_scene->getProperties()->getOutputProperties()->getFrameRate());
+
+			if (m_st) {
+				m_levelUpdaterA->getLevelWriter()->saveSoundTrack(m_st.getPointer());
+				if (m_levelUpdaterB.get())
+					m_levelUpdaterB->getLevelWriter()->saveSoundTrack(m_st.getPointer());
+			}
 		}
 
-		addSoundtrack(from, to, m_scene->getProperties()->getOutputProperties()->getFrameRate());
+		// Output frames must be *cloned*, since the supplied rasters will be overwritten by m_renderer
+		TRasterP toBeSavedRasA = renderData.m_rasA->clone();
+		TRasterP toBeSavedRasB = renderData.m_rasB ? renderData.m_rasB->clone() : TRasterP();
 
-		if (m_st) {
-			m_levelUpdaterA->getLevelWriter()->saveSoundTrack(m_st.getPointer());
-			if (m_levelUpdaterB.get())
-				m_levelUpdaterB->getLevelWriter()->saveSoundTrack(m_st.getPointer());
+		// Apply gamma here, once for the whole cluster - its frames share the same rasters
+		if (m_renderSettings.m_gamma != 1.0) {
+			TRop::gammaCorrect(toBeSavedRasA, m_renderSettings.m_gamma);
+			if (toBeSavedRasB)
+				TRop::gammaCorrect(toBeSavedRasB, m_renderSettings.m_gamma);
 		}
-	}
 
-	// Output frames must be *cloned*, since the supplied rasters will be overwritten by m_renderer
-	TRasterP toBeSavedRasA = renderData.m_rasA->clone();
-	TRasterP toBeSavedRasB = renderData.m_rasB ? renderData.m_rasB->clone() : TRasterP();
+		// Prepare the cluster's frames to be saved (possibly in the future)
+		std::vector<double>::const_iterator jt;
+		for (jt = renderData.m_frames.begin(); jt != renderData.m_frames.end(); ++jt)
+			m_toBeSaved[*jt] = std::make_pair(toBeSavedRasA, toBeSavedRasB);
+
+		// Submit as many frames as possible to the saving stage
+		while (!m_toBeSaved.empty()) {
+			std::map<double, std::pair<TRasterP, TRasterP>>::iterator ft = m_toBeSaved.begin();
+
+			// In the *movie type* case, frames must be saved sequentially.
+			// If the frame is not the next one in the sequence, wait until *that* frame is available.
+			if (m_movieType && (ft->first != m_framesToBeRendered[m_nextFrameIdxToSave].first))
+				break;
 
-	m_toBeSaved[renderData.m_frames[0]] = std::make_pair(toBeSavedRasA, toBeSavedRasB);
+			submitFrame(ft->first, ft->second);
 
-	m_toBeAppliedGamma[renderData.m_frames[0]] = true;
+			++m_nextFrameIdxToSave;
+			m_toBeSaved.erase(ft);
+		}
 
-	// Prepare the cluster's frames to be saved (possibly in the future)
-	std::vector<double>::const_iterator jt;
-	for (jt = renderData.m_frames.begin(), ++jt; jt != renderData.m_frames.end(); ++jt) {
-		m_toBeSaved[*jt] = std::make_pair(toBeSavedRasA, toBeSavedRasB);
-		m_toBeAppliedGamma[*jt] = false;
+		m_firstCompletedRaster = false;
 	}
 
-	// Attempt flushing as many frames as possible to the level updater(s)
-	while (!m_toBeSaved.empty()) {
-		std::map<double, std::pair<TRasterP, TRasterP>>::iterator ft = m_toBeSaved.begin();
+	// Hold this render thread while too many frames are waiting to be saved. Note that frames
+	// waiting for their predecessors in a movie are not counted - they need more rendering.
+	waitForSaving(c_maxSavingFrames);
+}
 
-		// In the *movie type* case, frames must be saved sequentially.
-		// If the frame is not the next one in the sequence, wait until *that* frame is available.
-		if (m_movieType && (ft->first != m_framesToBeRendered[m_nextFrameIdxToSave].first))
-			break;
+//---------------------------------------------------------
 
-		// This thread will be the one processing ft - remove it from the map to prevent another
-		// thread from interfering
-		double frame = ft->first;
-		std::pair<TRasterP, TRasterP> rasters = ft->second;
+void MovieRenderer::Imp::submitFrame(double frame, const std::pair<TRasterP, TRasterP> &rasters)
+{
+	{
+		QMutexLocker sl(&m_savingMutex);
+		++m_savingFramesCount;
+	}
 
-		++m_nextFrameIdxToSave;
-		m_toBeSaved.erase(ft);
+	m_savingExecutor.addTask(new SaveFrameTask(this, frame, rasters));
+}
 
-		// Save current frame
-		std::pair<bool, int> savedFrame;
-		{
-			// Time the saving procedure
-			struct SaveTimer {
-				int &m_count;
-				SaveTimer(int &count) : m_count(count)
-				{
-					if (m_count++ == 0)
-						TStopWatch::global(0).start();
-				}
-				~SaveTimer()
-				{
-					if (--m_count == 0)
-						TStopWatch::global(0).stop();
-				}
-			} saveTimer(m_savingThreadsCount);
+//---------------------------------------------------------
 
-			// Unlock the mutex only in case this is NOT a movie type. Single images can be saved concurrently.
-			struct MutexUnlocker {
-				QMutexLocker *m_locker;
-				~MutexUnlocker()
-				{
-					if (m_locker)
-						m_locker->relock();
-				}
-			} unlocker = {m_movieType ? (QMutexLocker *)0 : (locker.unlock(), &locker)};
+void MovieRenderer::Imp::waitForSaving(int maxSavingFrames)
+{
+	QMutexLocker sl(&m_savingMutex);
+	while (m_savingFramesCount > maxSavingFrames)
+		m_savingCondition.wait(&m_savingMutex);
+}
 
-			savedFrame = saveFrame(frame, rasters);
-		}
+//---------------------------------------------------------
+
+void MovieRenderer::Imp::doSaveFrame(double frame, const std::pair<TRasterP, TRasterP> &rasters)
+{
+	bool canceled;
+	{
+		QMutexLocker locker(&m_mutex);
+		canceled = m_savingCanceled;
+	}
+
+	// Save current frame
+	std::pair<bool, int> savedFrame(false, 0);
+	if (!canceled) {
+		// Time the saving procedure
+		struct SaveTimer {
+			MovieRenderer::Imp *m_imp;
+			SaveTimer(MovieRenderer::Imp *imp) : m_imp(imp)
+			{
+				QMutexLocker sl(&m_imp->m_savingMutex);
+				if (m_imp->m_savingThreadsCount++ == 0)
+					TStopWatch::global(0).start();
+			}
+			~SaveTimer()
+			{
+				QMutexLocker sl(&m_imp->m_savingMutex);
+				if (--m_imp->m_savingThreadsCount == 0)
+					TStopWatch::global(0).stop();
+			}
+		} saveTimer(this);
+
+		savedFrame = saveFrame(frame, rasters);
+	}
+
+	{
+		QMutexLocker locker(&m_mutex);
 
 		// Report status and deal with responses
-		bool okToContinue = true;
+		if (!m_savingCanceled) {
+			bool okToContinue = true;
 
-		std::set<MovieRenderer::Listener *>::iterator lt = m_listeners.begin();
+			std::set<MovieRenderer::Listener *>::iterator lt = m_listeners.begin();
 
-		if (savedFrame.first) {
-			for (; lt != m_listeners.end(); ++lt)
-				okToContinue &= (*lt)->onFrameCompleted(savedFrame.second);
-		} else {
-			for (; lt != m_listeners.end(); ++lt) {
-				TException e;
-				okToContinue &= (*lt)->onFrameFailed(savedFrame.second, e);
+			if (savedFrame.first) {
+				for (; lt != m_listeners.end(); ++lt)
+					okToContinue &= (*lt)->onFrameCompleted(savedFrame.second);
+			} else {
+				for (; lt != m_listeners.end(); ++lt) {
+					TException e;
+					okToContinue &= (*lt)->onFrameFailed(savedFrame.second, e);
+				}
 			}
-		}
 
-		if (!okToContinue) {
-			// Some listener invoked termination of the render procedure. It seems it's their right
-			// to do so. I wonder what happens if two listeners would disagree on the matter...
-			// BTW stop the rendering, alright.
+			if (!okToContinue) {
+				// Some listener invoked termination of the render procedure. It seems it's their right
+				// to do so. I wonder what happens if two listeners would disagree on the matter...
+				// BTW stop the rendering, alright.
 
-			{
-				int from, to;
-				getRange(m_scene, false, from, to); // It's ok since cancels can only happen from Toonz...
+				{
+					int from, to;
+					getRange(m_scene, false, from, to); // It's ok since cancels can only happen from Toonz...
 
-				for (int i = from; i < to; i++)
-					TImageCache::instance()->remove(m_renderCacheId + toString(i + 1));
-			}
+					for (int i = from; i < to; i++)
+						TImageCache::instance()->remove(m_renderCacheId + toString(i + 1));
+				}
 
-			m_renderer.stopRendering();
+				m_renderer.stopRendering();
 
-			m_levelUpdaterA.reset(); // No more saving. Further attempts to save images
-			m_levelUpdaterB.reset(); // will be rejected and treated as failures.
+				m_savingCanceled = true; // No more saving. Frames still in the saving queue are discarded,
+										 // and the level updaters are closed in onRenderFinished().
+			}
 		}
 	}
 
-	m_firstCompletedRaster = false;
+	QMutexLocker sl(&m_savingMutex);
+	--m_savingFramesCount;
+	m_savingCondition.wakeAll();
 }
 
 //---------------------------------------------------------
@@ -617,7 +694,7 @@ void MovieRenderer::Imp::onRenderFailure(const RenderData &renderData, TExceptio
 
 	// If the saver object has already been destroyed - or it was never
 	// created to begin with, nothing to be done
-	if (!m_levelUpdaterA.get())
+	if (!m_levelUpdaterA.get() || m_savingCanceled)
 		return; // The preview case would fall here
 
 	// Flush out as much as we can of the frames that were already rendered
@@ -660,7 +737,10 @@ void MovieRenderer::Imp::onRenderFailure(const RenderData &renderData, TExceptio
 
 void MovieRenderer::Imp::onRenderFinished(bool isCanceled)
 {
-	TFilePath levelName(m_levelUpdaterA.get() ? m_fp : TFilePath(getPreviewName(m_renderSessionId).toStdWString()));
+	// Let the saving stage complete
+	waitForSaving(0);
+
+	TFilePath levelName(m_levelUpdaterA.get() && !m_savingCanceled ? m_fp : TFilePath(getPreviewName(m_renderSessionId).toStdWString()));
 
 	// Close updaters. After this, the output levels should be finalized on disk.
 	m_levelUpdaterA.reset();
@@ -13,6 +13,7 @@
 #include "tvectorimage.h"
 #include "timagecache.h"
 #include "timageinfo.h"
+#include "trop.h"
 #include "tropcm.h"
 #include "tofflinegl.h"
 #include "tvectorrenderdata.h"
@@ -49,6 +50,7 @@
 #include "toonz/tvectorimageutils.h"
 #include "toonz/preferences.h"
 #include "toonz/dpiscale.h"
+#include "toonz/levelproxies.h"
 #include "imagebuilders.h"
 
 // 4.6 compatibility - sandor fxs
@@ -184,6 +186,53 @@ std::string getAlias(TXsheet *xsh, double frame, const TRenderSettings &info)
 	return alias;
 }
 
+//-------------------------------------------------------------------
+
+inline int getSubsampling(const TImageP &img)
+{
+	if (TRasterImageP ri = img)
+		return ri->getSubsampling();
+	if (TToonzImageP ti = img)
+		return ti->getSubsampling();
+	return 1;
+}
+
+//-------------------------------------------------------------------
+
+//! Reduces the specified raster image by point-sampling it - as level proxies are.
+TImageP shrinkImage(const TImageP &img, int shrink)
+{
+	if (shrink <= 1)
+		return img;
+
+	if (TRasterImageP ri = img) {
+		TRasterImageP shrunkRi(TRop::shrink(ri->getRaster(), shrink));
+		double dpix, dpiy;
+		ri->getDpi(dpix, dpiy);
+		shrunkRi->setDpi(dpix, dpiy);
+		shrunkRi->setSubsampling(ri->getSubsampling() * shrink);
+		return shrunkRi;
+	}
+
+	if (TToonzImageP ti = img) {
+		TRasterCM32P ras(TRop::shrink(ti->getRaster(), shrink));
+		TRect saveBox(ti->getSavebox());
+		saveBox = TRect(saveBox.x0 / shrink, saveBox.y0 / shrink,
+						saveBox.x1 / shrink, saveBox.y1 / shrink) *
+				  ras->getBounds();
+
+		TToonzImageP shrunkTi(ras, saveBox);
+		double dpix, dpiy;
+		ti->getDpi(dpix, dpiy);
+		shrunkTi->setDpi(dpix, dpiy);
+		shrunkTi->setPalette(ti->getPalette());
+		shrunkTi->setSubsampling(ti->getSubsampling() * shrink);
+		return shrunkTi;
+	}
+
+	return img;
+}
+
 } // namespace
 
 //****************************************************************************************
@@ -806,8 +855,18 @@ TAffine TLevelColumnFx::handledAffine(const TRenderSettings &info, double frame)
 	TPointD pixelsOrigin(-0.5 * imageInfo.m_lx, -0.5 * imageInfo.m_ly);
 
 	const TAffine &aff = info.m_affine;
-	if (aff.a11 != 1.0 || aff.a22 != 1.0 || aff.a12 != 0.0 || aff.a21 != 0.0)
+	if (aff.a11 != 1.0 || aff.a22 != 1.0 || aff.a12 != 0.0 || aff.a21 != 0.0) {
+		int proxyShrink = getProxyShrink(sl, cell.m_frameId, info);
+		if (proxyShrink > 1) {
+			// Shrunk renders are computed on the level's proxies. The translation maps the
+			// centers of the sampled pixels to the proxy pixels' centers.
+			TPointD proxyOrigin(-0.5 * (imageInfo.m_lx - 1) / proxyShrink - 0.5,
+								-0.5 * (imageInfo.m_ly - 1) / proxyShrink - 0.5);
+			return TTranslation(-proxyOrigin) * TScale(1.0 / proxyShrink);
+		}
+
 		return TTranslation(-pixelsOrigin);
+	}
 
 	// This is a translation, ok. Just ensure it is consistent.
 	TAffine consistentAff(aff);
@@ -821,6 +880,33 @@ TAffine TLevelColumnFx::handledAffine(const TRenderSettings &info, double frame)
 
 //-------------------------------------------------------------------
 
+int TLevelColumnFx::getProxyShrink(TXshSimpleLevel *sl, const TFrameId &fid, const TRenderSettings &info)
+{
+	// Proxies are point-sampled, so they are not used by high quality renders
+	bool fastQuality = (info.m_quality == TRenderSettings::StandardResampleQuality ||
+						info.m_quality == TRenderSettings::ClosestPixel_FilterResampleQuality ||
+						info.m_quality == TRenderSettings::Bilinear_FilterResampleQuality);
+	if (!fastQuality || info.m_bpp == 64 || !LevelProxies::canHaveProxies(sl))
+		return 1;
+
+	double scale = sqrt(fabs(info.m_affine.det()));
+	TFilePath levelPath = sl->getScene()->decodeFilePath(sl->getPath());
+
+	const std::vector<int> &shrinks = LevelProxies::getShrinks();
+	for (int s = 0; s < (int)shrinks.size(); ++s) {
+		if (shrinks[s] * scale > 1.0 + TConsts::epsilon)
+			continue;
+
+		int proxyShrink;
+		if (!LevelProxies::instance()->getProxyPath(levelPath, fid, shrinks[s], proxyShrink).isEmpty())
+			return proxyShrink;
+	}
+
+	return 1;
+}
+
+//-------------------------------------------------------------------
+
 TFilePath TLevelColumnFx::getPalettePath(int frame) const
 {
 	if (!m_levelColumn)
@@ -895,6 +981,10 @@ void TLevelColumnFx::doDryCompute(TRectD &rect, double frame, const TRenderSetti
 
 	int renderStatus = TRenderer::instance().getRenderStatus(TRenderer::renderId());
 
+	//Renders on the level's proxies (see handledAffine()) do not share the loaded image
+	if (!info.m_affine.isTranslation())
+		return;
+
 	string alias = getAlias(frame, TRenderSettings()) + "_image";
 
 	TImageInfo imageInfo;
@@ -948,9 +1038,30 @@ void TLevelColumnFx::doCompute(TTile &tile, double frame, const TRenderSettings
 
 	TImageP img;
 	TImageInfo imageInfo;
+	int subsampling = 1;
 
 	// Now, fetch the image
-	if (sl->getType() != PLI_XSHLEVEL) {
+	if (sl->getType() != PLI_XSHLEVEL && !info.m_affine.isTranslation()) {
+		// Render on the level's proxies (see handledAffine()). The image is loaded
+		// subsampled, which reads the proxies when available.
+		subsampling = tround(1.0 / info.m_affine.a11);
+
+		getImageInfo(imageInfo, sl, fid);
+		img = sl->getFrame(fid, ImageManager::dontPutInCache, subsampling);
+
+		// The image may come at another subsampling - eg if it was edited in the
+		// meantime, the full resolution one in memory is returned. Placement
+		// expects the requested one, so bring it there.
+		int imgSubsampling = getSubsampling(img);
+		if (img && imgSubsampling != subsampling) {
+			if (subsampling % imgSubsampling != 0) {
+				img = sl->getFullsampledFrame(fid, ImageManager::dontPutInCache);
+				imgSubsampling = 1;
+			}
+
+			img = shrinkImage(img, subsampling / imgSubsampling);
+		}
+	} else if (sl->getType() != PLI_XSHLEVEL) {
 		// Raster case
 		LevelFxBuilder builder(getAlias(frame, TRenderSettings()) + "_image",
 							   frame, info, sl, fid);
@@ -1135,11 +1246,19 @@ void TLevelColumnFx::doCompute(TTile &tile, double frame, const TRenderSettings
 			double ly_2 = ras->getLy() / 2.0;
 
 			TRenderSettings infoAux(info);
-			assert(info.m_affine.isTranslation());
+			assert(info.m_affine.isTranslation() || subsampling > 1);
 			infoAux.m_data.clear();
 
+			if (subsampling > 1) {
+				// The scale is applied by subsampling. Translate to where the affine brings
+				// the subsampled image's center - which is not the original image's one.
+				TPointD center((lx_2 - 0.5) * subsampling + 0.5 - 0.5 * imageInfo.m_lx,
+							   (ly_2 - 0.5) * subsampling + 0.5 - 0.5 * imageInfo.m_ly);
+				infoAux.m_affine = TTranslation(info.m_affine * center);
+			}
+
 			//Place the output rect in the image's reference
-			tileRectD += TPointD(lx_2 - info.m_affine.a13, ly_2 - info.m_affine.a23);
+			tileRectD += TPointD(lx_2 - infoAux.m_affine.a13, ly_2 - infoAux.m_affine.a23);
 
 			//Then, retrieve loaded image's interesting region
 			TRectD inTileRectD;
@@ -363,6 +363,7 @@ void ToonzScene::clear()
 	m_properties = new TSceneProperties();
 	delete properties;
 	m_levelSet->clear();
+	m_deferredLevels.clear();
 }
 
 //-----------------------------------------------------------------------------
@@ -447,18 +448,29 @@ int ToonzScene::loadFrameCount(const TFilePath &fp)
 //-----------------------------------------------------------------------------
 
 void ToonzScene::loadNoResources(const TFilePath &fp)
+{
+	loadNoResources(fp, fp);
+}
+
+//-----------------------------------------------------------------------------
+
+void ToonzScene::loadNoResources(const TFilePath &fp, const TFilePath &scenePath)
 {
 	clear();
 
 	TProjectManager *pm = TProjectManager::instance();
-	TProjectP sceneProject = pm->loadSceneProject(fp);
+	TProjectP sceneProject = pm->loadSceneProject(scenePath);
 	if (!sceneProject)
 		return;
 
 	setProject(sceneProject.getPointer());
 
 	loadTnzFile(fp);
+	setScenePath(scenePath);
 	getXsheet()->updateFrameCount();
+
+	for (int i = 0; i < m_levelSet->getLevelCount(); i++)
+		m_deferredLevels.insert(m_levelSet->getLevel(i));
 }
 
 //-----------------------------------------------------------------------------
@@ -489,6 +501,41 @@ void ToonzScene::loadResources(bool withProgressDialog)
 		} catch (...) {
 		}
 	}
+	m_deferredLevels.clear();
+	getXsheet()->updateFrameCount();
+}
+
+//-----------------------------------------------------------------------------
+
+void ToonzScene::loadResources(int r0, int r1)
+{
+	if (m_deferredLevels.empty())
+		return;
+
+	std::set<TXshLevel *> usedLevels;
+	getTopXsheet()->getUsedLevels(usedLevels, r0, r1);
+
+	for (int i = 0; i < m_levelSet->getLevelCount(); i++) {
+		TXshLevel *level = m_levelSet->getLevel(i);
+		if (m_deferredLevels.count(level) == 0)
+			continue;
+
+		// Only image levels are worth deferring - the others are cheap, and may
+		// be needed outside their cells (eg sound, palettes)
+		if (level->getSimpleLevel() && usedLevels.count(level) == 0)
+			continue;
+
+		m_deferredLevels.erase(level);
+		try {
+			level->load();
+		} catch (...) {
+		}
+	}
+
+	// Deferred levels still need the version number of the loaded file
+	if (m_deferredLevels.empty())
+		setVersionNumber(VersionNumber());
+
 	getXsheet()->updateFrameCount();
 }
 
@@ -674,6 +721,25 @@ void ToonzScene::save(const TFilePath &fp, TXsheet *subxsh)
 	if (!os.checkStatus())
 		throw TException("Could not open file");
 
+	saveTnzFile(os, subxsh);
+	bool status = os.checkStatus();
+	if (!status)
+		throw TException("Could not complete the save");
+
+	if (subxsh) {
+		setScenePath(oldScenePath);
+		if (wasUntitled)
+			setUntitled();
+	} else {
+		if (wasUntitled)
+			deleteUntitledScene(oldScenePath.getParentDir());
+	}
+}
+
+//-----------------------------------------------------------------------------
+
+void ToonzScene::saveTnzFile(TOStream &os, TXsheet *subxsh, int unchangedSections)
+{
 	TXsheet *xsh = subxsh;
 	if (xsh == 0)
 		xsh = m_childStack->getTopXsheet();
@@ -698,15 +764,19 @@ void ToonzScene::save(const TFilePath &fp, TXsheet *subxsh)
 		subxsh->getUsedLevels(saveSet);
 		m_levelSet->setSaveSet(saveSet);
 	}
-	os.openChild("levelSet");
-	m_levelSet->saveData(os);
-	os.closeChild();
+	if (!(unchangedSections & LevelSetSection) || !os.reuseSection("levelSet")) {
+		os.openChild("levelSet");
+		m_levelSet->saveData(os);
+		os.closeChild();
+	}
 	std::set<TXshLevel *> emptySaveSet;
 	m_levelSet->setSaveSet(emptySaveSet);
 
-	os.openChild("xsheet");
-	os << *xsh;
-	os.closeChild();
+	if (!(unchangedSections & XsheetSection) || !os.reuseSection("xsheet")) {
+		os.openChild("xsheet");
+		os << *xsh;
+		os.closeChild();
+	}
 
 	if (getContentHistory()) {
 		os.openChild("history");
@@ -724,18 +794,38 @@ void ToonzScene::save(const TFilePath &fp, TXsheet *subxsh)
 	}
 
 	os.closeChild();
-	bool status = os.checkStatus();
-	if (!status)
-		throw TException("Could not complete the save");
+}
 
-	if (subxsh) {
-		setScenePath(oldScenePath);
-		if (wasUntitled)
-			setUntitled();
-	} else {
-		if (wasUntitled)
-			deleteUntitledScene(oldScenePath.getParentDir());
-	}
+//-----------------------------------------------------------------------------
+
+void ToonzScene::saveSnapshot(const TFilePath &fp, int unchangedSections)
+{
+	TFilePath snapshotPath = decodeFilePath(fp);
+	TSystem::touchParentDir(snapshotPath);
+
+	TOStream os(snapshotPath, false, true);
+	saveTnzFile(os, 0, unchangedSections);
+
+	if (!os.checkStatus())
+		throw TException("Could not complete the snapshot");
+}
+
+//-----------------------------------------------------------------------------
+
+void ToonzScene::loadSnapshot(const TFilePath &fp, const TFilePath &scenePath)
+{
+	// The scene path, rather than the snapshot's, decodes the resources
+	loadNoResources(fp, scenePath);
+	loadResources();
+
+	setVersionNumber(VersionNumber());
+}
+
+//-----------------------------------------------------------------------------
+
+TFilePath ToonzScene::getSnapshotPath(const TFilePath &scenePath)
+{
+	return scenePath.getParentDir() + "backups" + scenePath.withType("snapshot").withoutParentDir();
 }
 
 //-----------------------------------------------------------------------------
@@ -28,6 +28,8 @@
 
 // Qt includes
 #include <QMetaObject>
+#include <QMutexLocker>
+#include <QAtomicInt>
 
 // tcg includes
 #include "tcg/tcg_function_types.h"
@@ -75,6 +77,24 @@ const int StageObjectTypeShift = 28;
 const int StageObjectMaxIndex = ((1 << StageObjectTypeShift) - 1);
 const int StageObjectIndexMask = ((1 << StageObjectTypeShift) - 1);
 
+const int MaxMemoizedPlacements = 512; //!< Per object
+
+QAtomicInt l_ikEvaluations; //!< Inverse kinematics evaluations in progress
+
+//-----------------------------------------------------------------------------
+
+struct IkEvaluation {
+	IkEvaluation() { l_ikEvaluations.ref(); }
+	~IkEvaluation() { l_ikEvaluations.deref(); }
+};
+
+//-----------------------------------------------------------------------------
+
+inline bool isHookHandle(const std::string &handle)
+{
+	return handle.length() > 1 && handle[0] == 'H';
+}
+
 } // namespace
 
 //************************************************************************************************
@@ -351,7 +371,7 @@ bool touchEaseAndCompare(const TDoubleKeyframe &kf,
 //************************************************************************************************
 
 TStageObject::LazyData::LazyData()
-	: m_time(-1.0)
+	: m_time(-1.0), m_notifiedValues(true)
 {
 }
 
@@ -360,7 +380,7 @@ TStageObject::LazyData::LazyData()
 //************************************************************************************************
 
 TStageObject::TStageObject(TStageObjectTree *tree, TStageObjectId id)
-	: m_tree(tree), m_id(id), m_parent(0), m_name(""), m_isOpened(false), m_spline(0), m_status(XY), m_x(new TDoubleParam()), m_y(new TDoubleParam()), m_z(new TDoubleParam()), m_so(new TDoubleParam()), m_rot(new TDoubleParam()), m_scalex(new TDoubleParam(1.0)), m_scaley(new TDoubleParam(1.0)), m_scale(new TDoubleParam(1.0)), m_posPath(new TDoubleParam()), m_shearx(new TDoubleParam()), m_sheary(new TDoubleParam()), m_center(), m_offset(), m_cycleEnabled(false), m_handle("B"), m_parentHandle("B"), m_dagNodePos(TConst::nowhere), m_camera(0), m_locked(false), m_noScaleZ(0), m_pinnedRangeSet(0), m_ikflag(0), m_groupSelector(-1)
+	: m_tree(tree), m_id(id), m_parent(0), m_name(""), m_isOpened(false), m_spline(0), m_status(XY), m_x(new TDoubleParam()), m_y(new TDoubleParam()), m_z(new TDoubleParam()), m_so(new TDoubleParam()), m_rot(new TDoubleParam()), m_scalex(new TDoubleParam(1.0)), m_scaley(new TDoubleParam(1.0)), m_scale(new TDoubleParam(1.0)), m_posPath(new TDoubleParam()), m_shearx(new TDoubleParam()), m_sheary(new TDoubleParam()), m_center(), m_offset(), m_cycleEnabled(false), m_handle("B"), m_parentHandle("B"), m_dagNodePos(TConst::nowhere), m_camera(0), m_locked(false), m_noScaleZ(0), m_pinnedRangeSet(0), m_ikflag(0), m_groupSelector(-1), m_placementsRevision(0), m_placementsSplineRevision(0)
 {
 	// NOTA: per le unita' di misura controlla anche tooloptions.cpp
 	m_x->setName("W_EW");
@@ -506,9 +526,10 @@ void TStageObject::onChange(const class TParamChange &c)
 	// whenever the scheduled datas are accessed.
 
 	if (c.m_keyframeChanged)
-		m_lazyData.invalidate(); // Both invalidate placement AND keyframes
-	else
-		invalidate(); // Invalidate placement only
+		m_lazyData.invalidate(); // Invalidate keyframes too
+
+	invalidate(); // Invalidate placement, memoized frames included - they must not
+				  // survive until the next access
 }
 
 //-----------------------------------------------------------------------------
@@ -1317,7 +1338,10 @@ bool TStageObject::isCycleEnabled() const
 
 void TStageObject::enableCycle(bool on)
 {
+	if (m_cycleEnabled == on)
+		return;
 	m_cycleEnabled = on;
+	invalidate();
 }
 
 //-----------------------------------------------------------------------------
@@ -1358,6 +1382,9 @@ TAffine TStageObject::computeIkRootOffset(int t)
 	if (m_ikflag > 0)
 		return TAffine();
 
+	// Objects are temporarily re-configured below: nothing gets memoized meanwhile
+	IkEvaluation ikEvaluation;
+
 	// get normal movement (which will be left-multiplied to the IK-part)
 	setStatus(XY);
 	invalidate();
@@ -1470,17 +1497,95 @@ TAffine TStageObject::computeLocalPlacement(double frame)
 
 //-----------------------------------------------------------------------------
 
+bool TStageObject::canMemoizePlacement(bool refresh)
+{
+	// Hooks and inverse kinematics depend on data (level hooks, pinned ranges)
+	// whose changes are not notified to the object
+	if (l_ikEvaluations.load() > 0)
+		return false;
+
+	for (TStageObject *obj = this; obj; obj = obj->m_parent) {
+		if ((obj->m_status & STATUS_MASK) == IK ||
+			isHookHandle(obj->m_handle) || isHookHandle(obj->m_parentHandle))
+			return false;
+
+		// Expression and similar shape values change with other params, units and
+		// xsheet cells - without notifying the object. Placements are stored only
+		// under the evaluation lock, which the lazy data require; a keyframe turned
+		// into an expression is notified, clearing the placements stored before.
+		if (refresh && !obj->lazyData().m_notifiedValues)
+			return false;
+
+		// Motion paths are edited without notifying the objects using them
+		int revision = (obj->isPathEnabled() && obj->m_spline) ? obj->m_spline->getRevision() : 0;
+		if (revision != obj->m_placementsSplineRevision) {
+			if (!refresh)
+				return false;
+
+			obj->invalidate();
+			obj->m_placementsSplineRevision = revision;
+		}
+	}
+
+	return true;
+}
+
+//-----------------------------------------------------------------------------
+
+void TStageObject::memoizePlacement(double frame, const TAffine &placement, int revision)
+{
+	QMutexLocker locker(&m_placementsMutex);
+
+	// Don't store placements computed before an invalidation
+	if (revision != m_placementsRevision)
+		return;
+
+	if ((int)m_placements.size() >= MaxMemoizedPlacements) {
+		// Drop the farthest frame - playback and onion skins query nearby ones
+		if (frame - m_placements.begin()->first > m_placements.rbegin()->first - frame)
+			m_placements.erase(m_placements.begin());
+		else
+			m_placements.erase(--m_placements.end());
+	}
+
+	m_placements[frame] = placement;
+}
+
+//-----------------------------------------------------------------------------
+
 TAffine TStageObject::getPlacement(double t)
 {
+	// Memoized placements are read under the object's own lock only
+	if (canMemoizePlacement(false)) {
+		QMutexLocker locker(&m_placementsMutex);
+
+		PlacementsMap::const_iterator pt = m_placements.find(t);
+		if (pt != m_placements.end())
+			return pt->second;
+	}
+
+	// The evaluation walks lazily updated data up the parent chain, shared
+	// among all objects of the tree
+	QMutexLocker evaluationLocker(m_tree->getEvaluationMutex());
+
+	bool memoize = canMemoizePlacement(true);
+
 	double &time = lazyData().m_time;
 
 	if (time == t)
 		return m_absPlacement;
 	if (time != -1) {
+		// Another frame: the memoized placements stay valid
 		if (!m_parent)
-			invalidate();
+			resetPlacementTime();
 		else
-			findRoot(t)->invalidate();
+			findRoot(t)->resetPlacementTime();
+	}
+
+	int revision;
+	{
+		QMutexLocker locker(&m_placementsMutex);
+		revision = m_placementsRevision;
 	}
 
 	double tt = paramsTime(t);
@@ -1492,6 +1597,10 @@ TAffine TStageObject::getPlacement(double t)
 		place = computeLocalPlacement(tt);
 	m_absPlacement = place;
 	time = t;
+
+	if (memoize && l_ikEvaluations.load() == 0)
+		memoizePlacement(t, place, revision);
+
 	return place;
 }
 
@@ -1549,6 +1658,12 @@ void TStageObject::invalidate(LazyData &ld) const
 	// not trigger a data update
 	ld.m_time = -1;
 
+	{
+		QMutexLocker locker(&m_placementsMutex);
+		m_placements.clear();
+		++m_placementsRevision;
+	}
+
 	std::list<TStageObject *>::const_iterator cit = m_children.begin();
 	for (; cit != m_children.end(); ++cit)
 		(*cit)->invalidate();
@@ -1563,6 +1678,17 @@ void TStageObject::invalidate()
 
 //-----------------------------------------------------------------------------
 
+void TStageObject::resetPlacementTime()
+{
+	m_lazyData(tcg::direct_access).m_time = -1;
+
+	std::list<TStageObject *>::const_iterator cit = m_children.begin();
+	for (; cit != m_children.end(); ++cit)
+		(*cit)->resetPlacementTime();
+}
+
+//-----------------------------------------------------------------------------
+
 TAffine TStageObject::getParentPlacement(double t) const
 {
 	return m_parent ? m_parent->getPlacement(t) : TAffine();
@@ -1577,6 +1703,7 @@ void TStageObject::updateKeyframes(LazyData &ld) const
 
 	// Clear the map
 	keyframes.clear();
+	ld.m_notifiedValues = true;
 
 	// Gather all sensible parameters in a vector
 	std::vector<TDoubleParam *> params;
@@ -1623,6 +1750,9 @@ void TStageObject::updateKeyframes(LazyData &ld) const
 		for (k = 0; k < kCount; ++k) {
 			const TDoubleKeyframe &kf = param->getKeyframe(k);
 			frames.insert((int)kf.m_frame);
+
+			if (kf.m_type == TDoubleKeyframe::Expression || kf.m_type == TDoubleKeyframe::SimilarShape)
+				ld.m_notifiedValues = false;
 		}
 	}
 
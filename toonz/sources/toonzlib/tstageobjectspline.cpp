@@ -19,6 +19,7 @@ DEFINE_CLASS_CODE(TStageObjectSpline, 19)
 namespace
 {
 int idBaseCode = 1;
+int strokeRevision = 0;
 }
 
 //=============================================================================
@@ -112,7 +113,7 @@ void PosPathKeyframesUpdater::update(double &s)
 // TStageObjectSpline
 
 TStageObjectSpline::TStageObjectSpline()
-	: TSmartObject(m_classCode), m_stroke(0), m_dagNodePos(TConst::nowhere), m_id(-1), m_idBase(toString(idBaseCode++)), m_name(""), m_isOpened(false)
+	: TSmartObject(m_classCode), m_stroke(0), m_dagNodePos(TConst::nowhere), m_id(-1), m_idBase(toString(idBaseCode++)), m_name(""), m_isOpened(false), m_revision(++strokeRevision)
 {
 	double d = 30;
 	vector<TThickPoint> points;
@@ -173,6 +174,7 @@ void TStageObjectSpline::setStroke(TStroke *stroke)
 			updatePosPathKeyframes(m_stroke, stroke);
 		delete m_stroke;
 		m_stroke = stroke;
+		m_revision = ++strokeRevision;
 	}
 }
 
@@ -215,6 +217,7 @@ void TStageObjectSpline::loadData(TIStream &is)
 	}
 	delete m_stroke;
 	m_stroke = new TStroke(points);
+	m_revision = ++strokeRevision;
 }
 
 //-----------------------------------------------------------------------------
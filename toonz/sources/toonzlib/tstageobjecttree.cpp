@@ -14,6 +14,8 @@
 
 #include "toonz/txsheetexpr.h"
 
+#include <QMutex>
+
 using namespace TSyntax;
 
 //=============================================================================
@@ -43,6 +45,9 @@ struct TStageObjectTree::TStageObjectTreeImp {
 
 	Grammar *m_grammar;
 
+	//!Serializes the placement evaluations, which update lazy data along the parent chains.
+	QMutex m_evaluationMutex;
+
 	/*!
     Constructs a TStageObjectTreeImp with default value.
   */
@@ -60,7 +65,7 @@ struct TStageObjectTree::TStageObjectTreeImp {
 //-----------------------------------------------------------------------------
 
 TStageObjectTree::TStageObjectTreeImp::TStageObjectTreeImp()
-	: m_currentCameraId(TStageObjectId::CameraId(0)), m_currentPreviewCameraId(TStageObjectId::CameraId(0)), m_handleManager(0), m_cameraCount(0), m_groupIdCount(0), m_splineCount(0), m_grammar(0), m_dagGridDimension(eSmall)
+	: m_currentCameraId(TStageObjectId::CameraId(0)), m_currentPreviewCameraId(TStageObjectId::CameraId(0)), m_handleManager(0), m_cameraCount(0), m_groupIdCount(0), m_splineCount(0), m_grammar(0), m_dagGridDimension(eSmall), m_evaluationMutex(QMutex::Recursive)
 {
 }
 
@@ -692,6 +697,13 @@ TSyntax::Grammar *TStageObjectTree::getGrammar() const
 	return m_imp->m_grammar;
 }
 
+//-----------------------------------------------------------------------------
+
+QMutex *TStageObjectTree::getEvaluationMutex() const
+{
+	return &m_imp->m_evaluationMutex;
+}
+
 //-----------------------------------------------------------------------------
 /*
 void TStageObjectTree::setToonzBuilder(const TDoubleParamP &param)
@@ -22,7 +22,7 @@
 //TXshCellColumn
 
 TXshCellColumn::TXshCellColumn()
-	: m_first(0)
+	: m_first(0), m_end(0)
 {
 }
 
@@ -30,43 +30,129 @@ TXshCellColumn::TXshCellColumn()
 
 TXshCellColumn::~TXshCellColumn()
 {
-	m_cells.clear();
+	m_runs.clear();
 }
 
 //-----------------------------------------------------------------------------
 
-int TXshCellColumn::getRange(int &r0, int &r1) const
+//! Returns the index of the run containing row, which must be in [m_first, m_end).
+int TXshCellColumn::findRun(int row) const
+{
+	assert(m_first <= row && row < m_end);
+	int a = 0, b = (int)m_runs.size() - 1;
+	while (a < b) {
+		int m = (a + b + 1) / 2;
+		if (m_runs[m].m_row <= row)
+			a = m;
+		else
+			b = m - 1;
+	}
+	return a;
+}
+
+//-----------------------------------------------------------------------------
+
+//! Makes a run start at row, splitting the one containing it; returns the index
+//! of that run (m_runs.size() if row is past the column).
+int TXshCellColumn::splitRun(int row)
 {
-	int cellCount = m_cells.size();
-	r0 = m_first;
-	r1 = r0 + cellCount - 1;
-	int i;
-	for (i = 0; i < cellCount && m_cells[i].isEmpty(); i++) {
+	if (row >= m_end)
+		return m_runs.size();
+	int i = findRun(row);
+	if (m_runs[i].m_row == row)
+		return i;
+	m_runs.insert(m_runs.begin() + i + 1, CellRun(m_runs[i].m_cell, row));
+	return i + 1;
+}
+
+//-----------------------------------------------------------------------------
+
+//! Joins the run i to the previous one, when they hold the same cell.
+void TXshCellColumn::mergeRun(int i)
+{
+	if (0 < i && i < (int)m_runs.size() && m_runs[i].m_cell == m_runs[i - 1].m_cell)
+		m_runs.erase(m_runs.begin() + i);
+}
+
+//-----------------------------------------------------------------------------
+
+void TXshCellColumn::shiftRuns(int i, int delta)
+{
+	for (; i < (int)m_runs.size(); i++)
+		m_runs[i].m_row += delta;
+}
+
+//-----------------------------------------------------------------------------
+
+//! Removes the empty runs at both ends of the column, updating m_first and m_end.
+void TXshCellColumn::trimRuns()
+{
+	while (!m_runs.empty() && m_runs.back().m_cell.isEmpty()) {
+		m_end = m_runs.back().m_row;
+		m_runs.pop_back();
+	}
+	int n = 0;
+	while (n < (int)m_runs.size() && m_runs[n].m_cell.isEmpty())
+		n++;
+	m_runs.erase(m_runs.begin(), m_runs.begin() + n);
+
+	if (m_runs.empty())
+		m_first = m_end = 0;
+	else
+		m_first = m_runs.front().m_row;
+}
+
+//-----------------------------------------------------------------------------
+
+//! Replaces the rows [row, row+rowCount-1] with the specified runs, which must
+//! start at row.
+void TXshCellColumn::replaceRuns(int row, int rowCount, const vector<CellRun> &runs)
+{
+	assert(row >= 0 && rowCount > 0);
+	assert(!runs.empty() && runs.front().m_row == row);
+	int end = row + rowCount;
+
+	// estendo la colonna con celle vuote, fino a comprendere [row, end)
+	if (m_runs.empty())
+		m_first = m_end = row;
+	if (row < m_first) {
+		m_runs.insert(m_runs.begin(), CellRun(TXshCell(), row));
+		m_first = row;
+	}
+	if (end > m_end) {
+		m_runs.push_back(CellRun(TXshCell(), m_end));
+		m_end = end;
 	}
-	if (i >= cellCount) {
+
+	int i0 = splitRun(row);
+	int i1 = splitRun(end);
+	m_runs.erase(m_runs.begin() + i0, m_runs.begin() + i1);
+	m_runs.insert(m_runs.begin() + i0, runs.begin(), runs.end());
+
+	mergeRun(i0 + runs.size());
+	mergeRun(i0);
+	trimRuns();
+}
+
+//-----------------------------------------------------------------------------
+
+int TXshCellColumn::getRange(int &r0, int &r1) const
+{
+	if (m_runs.empty()) {
 		r0 = 0;
 		r1 = -1;
 		return 0;
 	}
-	r0 = m_first + i;
-	for (i = cellCount - 1; i >= 0 && m_cells[i].isEmpty(); i--) {
-	}
-
-	r1 = m_first + i;
-	return r1 - r0 + 1;
+	r0 = m_first;
+	r1 = m_end - 1;
+	return m_end - m_first;
 }
 
 //-----------------------------------------------------------------------------
 
 int TXshCellColumn::getRowCount() const
 {
-	int i = m_cells.size();
-	for (; i > 0 && m_cells[i - 1].isEmpty(); i--) {
-	}
-	if (i == 0)
-		return 0;
-	else
-		return m_first + i;
+	return m_runs.empty() ? 0 : m_end;
 }
 
 //-----------------------------------------------------------------------------
@@ -90,10 +176,9 @@ int TXshCellColumn::getFirstRow() const
 const TXshCell &TXshCellColumn::getCell(int row) const
 {
 	static TXshCell emptyCell;
-	if (row < 0 || row < m_first ||
-		row >= m_first + (int)m_cells.size())
+	if (row < m_first || row >= m_end)
 		return emptyCell;
-	return m_cells[row - m_first];
+	return m_runs[findRun(row)].m_cell;
 }
 
 //-----------------------------------------------------------------------------
@@ -109,24 +194,24 @@ bool TXshCellColumn::isCellEmpty(int row) const
 void TXshCellColumn::checkColumn() const
 {
 	assert(m_first >= 0);
-	int r0, r1;
-	int range = getRange(r0, r1);
-	assert(range >= 0);
-	assert(range == (int)m_cells.size());
-	assert(getRowCount() >= 0);
-
-	TXshCell firstCell = getCell(m_first);
-	TXshCell lastCell = getCell(r1);
-	if (range == 0)
-		assert(firstCell.isEmpty() && lastCell.isEmpty());
-	else {
-		assert(firstCell.isEmpty() == 0);
-		assert(lastCell.isEmpty() == 0);
-
-		int maxFrame = getMaxFrame();
-		assert(maxFrame == r1);
-		assert(getCell(maxFrame).isEmpty() == 0);
+	if (m_runs.empty()) {
+		assert(m_first == 0 && m_end == 0);
+		return;
+	}
+
+	assert(m_runs.front().m_row == m_first);
+	assert(m_runs.back().m_row < m_end);
+	assert(!m_runs.front().m_cell.isEmpty());
+	assert(!m_runs.back().m_cell.isEmpty());
+
+	for (int i = 1; i < (int)m_runs.size(); i++) {
+		assert(m_runs[i - 1].m_row < m_runs[i].m_row);
+		assert(m_runs[i - 1].m_cell != m_runs[i].m_cell);
 	}
+
+	int r0, r1;
+	getRange(r0, r1);
+	assert(getMaxFrame() == r1 && !getCell(r1).isEmpty());
 }
 
 //-----------------------------------------------------------------------------
@@ -134,40 +219,27 @@ void TXshCellColumn::checkColumn() const
 void TXshCellColumn::getCells(int row, int rowCount, TXshCell cells[])
 {
 	const TXshCell emptyCell;
-	int first = m_first;
-	int i;
-	int cellCount = m_cells.size();
-	if (row < 0 || row + rowCount - 1 < first ||
-		row >= first + cellCount) {
-		for (i = 0; i < rowCount; i++)
-			cells[i] = emptyCell;
-		return;
-	}
-
-	int dst, src, n, delta;
-	n = rowCount;
-	delta = m_first - row;
-	if (delta < 0) { // le celle cominciano PRIMA della zona da leggere
-		dst = 0;
-		src = -delta;
-	} else { //le celle cominciano DOPO della zona da leggere
-		dst = delta;
-		src = 0;
-		n -= delta;
+	int k = 0;
+
+	if (row >= 0) {
+		// celle prima della colonna
+		for (; k < rowCount && row + k < m_first; k++)
+			cells[k] = emptyCell;
+
+		// celle della colonna: scorro i run
+		if (k < rowCount && row + k < m_end) {
+			int i = findRun(row + k);
+			for (; k < rowCount && row + k < m_end; k++) {
+				if (i + 1 < (int)m_runs.size() && m_runs[i + 1].m_row <= row + k)
+					i++;
+				cells[k] = m_runs[i].m_cell;
+			}
+		}
 	}
-	if (n + src > cellCount)
-		n = cellCount - src;
 
-	TXshCell *dstCell = cells;
-	TXshCell *endDstCell = dstCell + dst;
-	while (dstCell < endDstCell)
-		*dstCell++ = emptyCell;
-	endDstCell += n;
-	while (dstCell < endDstCell)
-		*dstCell++ = m_cells[src++];
-	endDstCell = cells + rowCount;
-	while (dstCell < endDstCell)
-		*dstCell++ = emptyCell;
+	// celle dopo la colonna
+	for (; k < rowCount; k++)
+		cells[k] = emptyCell;
 }
 
 //-----------------------------------------------------------------------------
@@ -176,73 +248,19 @@ bool TXshCellColumn::setCell(int row, const TXshCell &cell)
 {
 	if (!canSetCell(cell))
 		return false;
+
 	assert(row >= 0);
-#ifndef NDEBUG
-	checkColumn();
-#endif
-	if (m_cells.empty()) //se la colonna e' vuota
-	{
-		if (!cell.isEmpty()) {
-			m_cells.push_back(cell);
-			m_first = row;
-			//updateIcon();
-		}
-		return true;
-	}
 
-	int oldCellCount = m_cells.size();
-	assert(oldCellCount > 0);
-	int lastRow = m_first + oldCellCount - 1;
+	// una cella vuota fuori dalla colonna non cambia nulla
+	if (cell.isEmpty() && (row < m_first || row >= m_end))
+		return m_runs.empty();
+
+	replaceRuns(row, 1, vector<CellRun>(1, CellRun(cell, row)));
 
-	if (row < m_first) //prima
-	{
-		if (cell.isEmpty())
-			return false; //non faccio nulla
-		int delta = m_first - row;
-		assert(delta > 0);
-		m_cells.insert(m_cells.begin(), delta - 1, TXshCell()); //celle vuote
-		m_cells.insert(m_cells.begin(), cell);					//devo settare la prima comp. del vettore
-		m_first = row;											//row 'e la nuova firstrow
-//updateIcon();
-#ifndef NDEBUG
-		checkColumn();
-#endif
-		return true;
-	} else if (row > lastRow) //dopo
-	{
-		if (cell.isEmpty())
-			return false; //non faccio nulla
-		int count = row - lastRow - 1;
-		//se necessario, inserisco celle vuote
-		for (int i = 0; i < count; ++i)
-			m_cells.push_back(TXshCell());
-		m_cells.push_back(cell);
 #ifndef NDEBUG
-		checkColumn();
-#endif
-		return true;
-	}
-	//"[r0,r1]"
-	int index = row - m_first;
-	assert(0 <= index && index < (int)m_cells.size());
-	m_cells[index] = cell;
-	//if(index == 0) updateIcon();
-	if (cell.isEmpty()) {
-		if (row == lastRow) {
-			// verifico la presenza di celle bianche alla fine
-			while (!m_cells.empty() && m_cells.back().isEmpty())
-				m_cells.pop_back();
-		} else if (row == m_first) {
-			// verifico la presenza di celle bianche all'inizio
-			while (!m_cells.empty() && m_cells.front().isEmpty()) {
-				m_cells.erase(m_cells.begin());
-				m_first++;
-			}
-		}
-		if (m_cells.empty())
-			m_first = 0;
-	}
 	checkColumn();
+#endif
+	//updateIcon();
 	return true;
 }
 
@@ -255,50 +273,16 @@ bool TXshCellColumn::setCells(int row, int rowCount, const TXshCell cells[])
 	for (i = 0; i < rowCount; i++)
 		if (!canSetCell(cells[i]))
 			return false;
+	if (rowCount <= 0)
+		return true;
 
-	int oldCellCount = m_cells.size();
-
-	// le celle da settare sono [ra, rb]
-	int ra = row;
-	int rb = row + rowCount - 1;
-	assert(ra <= rb);
-	// le celle non vuote sono [c_ra, c_rb]
-	int c_rb = m_first + oldCellCount - 1;
-
-	if (row > c_rb) //sono oltre l'ultima riga
-	{
-		if (oldCellCount == 0)
-			m_first = row; //row 'e la nuova firstrow
-		int newCellCount = row - m_first + rowCount;
-		m_cells.resize(newCellCount);
-	} else if (row < m_first) {
-		int delta = m_first - row;
-		m_cells.insert(m_cells.begin(), delta, TXshCell());
-		m_first = row; //row e' la nuova firstrow
-	}
-	if (rb > c_rb) {
-		for (int i = 0; i < rb - c_rb; ++i)
-			m_cells.push_back(TXshCell());
-	}
-
-	int index = row - m_first;
-	assert(0 <= index && index < (int)m_cells.size());
-	for (int i = 0; i < rowCount; i++)
-		m_cells[index + i] = cells[i];
-
-	// verifico la presenza di celle bianche alla fine
-	while (!m_cells.empty() && m_cells.back().isEmpty()) {
-		m_cells.pop_back();
-	}
+	// comprimo le celle in run
+	vector<CellRun> runs;
+	for (i = 0; i < rowCount; i++)
+		if (runs.empty() || runs.back().m_cell != cells[i])
+			runs.push_back(CellRun(cells[i], row + i));
 
-	// verifico la presenza di celle bianche all'inizio
-	while (!m_cells.empty() && m_cells.front().isEmpty()) {
-		m_cells.erase(m_cells.begin());
-		m_first++;
-	}
-	if (m_cells.empty()) {
-		m_first = 0;
-	}
+	replaceRuns(row, rowCount, runs);
 	//updateIcon();
 	return true;
 }
@@ -307,85 +291,41 @@ bool TXshCellColumn::setCells(int row, int rowCount, const TXshCell cells[])
 
 void TXshCellColumn::insertEmptyCells(int row, int rowCount)
 {
-	if (m_cells.empty())
+	if (rowCount <= 0 || m_runs.empty())
 		return; //se la colonna e' vuota non devo inserire celle
 
-	if (row >= m_first + (int)m_cells.size())
-		return;			//dopo:non inserisco nulla
+	if (row >= m_end)
+		return; //dopo:non inserisco nulla
+
 	if (row <= m_first) //prima
 	{
+		shiftRuns(0, rowCount);
 		m_first += rowCount;
 	} else //in mezzo
 	{
-		int delta = row - m_first;
-		std::vector<TXshCell>::iterator it = m_cells.begin();
-		std::advance(it, delta);
-		m_cells.insert(it, rowCount, TXshCell());
+		int i = splitRun(row);
+		m_runs.insert(m_runs.begin() + i, CellRun(TXshCell(), row));
+		shiftRuns(i + 1, rowCount);
+		mergeRun(i + 1);
+		mergeRun(i);
 	}
+	m_end += rowCount;
 }
 
 //-----------------------------------------------------------------------------
 // sbianca le celle [row, row+rowCount-1] (senza shiftare)
 void TXshCellColumn::clearCells(int row, int rowCount)
 {
-	if (rowCount <= 0)
-		return;
-	if (m_cells.empty())
+	if (rowCount <= 0 || m_runs.empty())
 		return; //se la colonna e' vuota
 
-	// le celle da cancellare sono [ra, rb]
-	int ra = row;
-	int rb = row + rowCount - 1;
-	assert(ra <= rb);
-
-	int cellCount = m_cells.size();
-
-	// le celle non vuote sono [c_ra, c_rb]
-	int c_ra = m_first;
-	int c_rb = m_first + cellCount - 1;
-	assert(c_ra <= c_rb);
-
-	// se e' sotto o sopra le celle occupate non devo far nulla
-	if (rb < c_ra || ra > c_rb)
+	// restringo l'area da cancellare in modo che comprenda solo la colonna
+	int ra = tmax(row, m_first);
+	int rb = tmin(row + rowCount, m_end);
+	if (ra >= rb)
 		return;
 
-	// restringo l'area da cancellare in modo che comprenda solo celle non vuote
-	if (ra < c_ra)
-		ra = c_ra;
-	if (rb > c_rb)
-		rb = c_rb;
-
-	// devo "sbiancare" n celle
-	int n = rb - ra + 1;
-	assert(n >= 0);
-
-	if (n == cellCount) // ho cancellato tutto
-	{
-		m_cells.clear();
-		m_first = 0;
-	} else {
-		assert(ra - c_ra < (int)m_cells.size());
-		assert(ra - c_ra + n <= (int)m_cells.size());
-		//std::fill_n(&m_cells[ra-c_ra],n, TXshCell());
-		int i;
-		for (i = 0; i < n; i++)
-			m_cells[ra - c_ra + i] = TXshCell();
-
-		// verifico la presenza di celle bianche alla fine
-		while (!m_cells.empty() && m_cells.back().isEmpty()) {
-			m_cells.pop_back();
-		}
-
-		if (m_cells.empty()) {
-			m_first = 0;
-		} else {
-			// verifico la presenza di celle bianche all'inizio
-			while (!m_cells.empty() && m_cells.front().isEmpty()) {
-				m_cells.erase(m_cells.begin());
-				m_first++;
-			}
-		}
-	}
+	replaceRuns(ra, rb - ra, vector<CellRun>(1, CellRun(TXshCell(), ra)));
 	//updateIcon();
 }
 
@@ -394,63 +334,32 @@ void TXshCellColumn::clearCells(int row, int rowCount)
 // rimuove le celle [row, row+rowCount-1] (shiftando)
 void TXshCellColumn::removeCells(int row, int rowCount)
 {
-	if (rowCount <= 0)
-		return;
-	if (m_cells.empty())
+	if (rowCount <= 0 || m_runs.empty())
 		return; //se la colonna e' vuota
 
-	int cellCount = m_cells.size();
-
-	if (row >= m_first + cellCount)
+	if (row >= m_end)
 		return; //sono "sotto" l'ultima cella
-	if (row < m_first) {
-		if (row + rowCount <= m_first) //"sono sopra la prima cella"
-		{							   // aggiorno solo m_first
-			m_first -= rowCount;
-			return;
-		}
-		rowCount += row - m_first;
-		m_first = row;
-	}
 
-	assert(row >= m_first);
-	// le celle sotto m_first+cellCount sono gia' vuote
-	if (rowCount > m_first + cellCount - row)
-		rowCount = m_first + cellCount - row;
-	if (rowCount <= 0)
+	int end = row + rowCount;
+	if (end <= m_first) //sono "sopra la prima cella": sposto solo i run
+	{
+		shiftRuns(0, -rowCount);
+		m_first -= rowCount;
+		m_end -= rowCount;
 		return;
-
-	if (row == m_first) {
-		//cancello all'inizio
-		assert(rowCount <= cellCount);
-		std::vector<TXshCell>::iterator it = m_cells.begin();
-		std::vector<TXshCell>::iterator it2 = m_cells.begin();
-		std::advance(it2, rowCount);
-		m_cells.erase(it, it2);
-		// verifico la presenza di celle bianche all'inizio
-		while (!m_cells.empty() && m_cells.front().isEmpty()) {
-			m_cells.erase(m_cells.begin());
-			m_first++;
-		}
-	} else {
-		// cancello dopo l'inizio
-		int d = row - m_first;
-		std::vector<TXshCell>::iterator it = m_cells.begin();
-		std::vector<TXshCell>::iterator it2 = m_cells.begin();
-		std::advance(it, d);
-		std::advance(it2, d + rowCount);
-		m_cells.erase(it, it2);
-		if (row + rowCount == m_first + cellCount) {
-			// verifico la presenza di celle bianche alla fine
-			while (!m_cells.empty() && m_cells.back().isEmpty()) {
-				m_cells.pop_back();
-			}
-		}
 	}
 
-	if (m_cells.empty()) {
-		m_first = 0;
-	}
+	// tolgo i run in [ra, rb) e sposto in su quelli successivi
+	int ra = tmax(row, m_first);
+	int rb = tmin(end, m_end);
+	int i0 = splitRun(ra);
+	int i1 = splitRun(rb);
+	m_runs.erase(m_runs.begin() + i0, m_runs.begin() + i1);
+	shiftRuns(i0, -rowCount);
+	m_end = (end < m_end) ? m_end - rowCount : ra;
+
+	mergeRun(i0);
+	trimRuns();
 	//updateIcon();
 }
 
@@ -462,10 +371,16 @@ bool TXshCellColumn::getLevelRange(int row, int &r0, int &r1) const
 	TXshCell cell = getCell(row);
 	if (cell.isEmpty())
 		return false;
-	while (r0 > 0 && getCell(r0 - 1).m_level.getPointer() == cell.m_level.getPointer())
-		r0--;
-	while (getCell(r1 + 1).m_level.getPointer() == cell.m_level.getPointer())
-		r1++;
+
+	// i run adiacenti con lo stesso livello sono contigui
+	int i = findRun(row), a = i, b = i;
+	while (a > 0 && m_runs[a - 1].m_cell.m_level.getPointer() == cell.m_level.getPointer())
+		a--;
+	while (b + 1 < (int)m_runs.size() && m_runs[b + 1].m_cell.m_level.getPointer() == cell.m_level.getPointer())
+		b++;
+
+	r0 = m_runs[a].m_row;
+	r1 = (b + 1 < (int)m_runs.size() ? m_runs[b + 1].m_row : m_end) - 1;
 	return true;
 }
 
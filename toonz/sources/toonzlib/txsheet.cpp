@@ -9,6 +9,8 @@
 #include "tparamcontainer.h"
 #include "tparamset.h"
 #include "tfxattributes.h"
+#include "tmacrofx.h"
+#include "tzeraryfx.h"
 
 // TnzLib includes
 #include "toonz/fxdag.h"
@@ -79,6 +81,59 @@ void setColumnName(TXsheet *xsh, int col)
 		obj->setName(name);
 }
 
+//-----------------------------------------------------------------------------
+
+//! Returns whether the specified fx renders a frame out of the same frame of its
+//! inputs only - so that the levels it uses can be told from the rendered rows.
+bool isTimeLocal(TFx *fx)
+{
+	if (TMacroFx *macroFx = dynamic_cast<TMacroFx *>(fx)) {
+		const vector<TFxP> &fxs = macroFx->getFxs();
+		for (int i = 0; i < (int)fxs.size(); ++i)
+			if (!isTimeLocal(fxs[i].getPointer()))
+				return false;
+
+		return true;
+	}
+
+	// Motion blurs trace the placement of columns across the neighbouring frames
+	if (fx->getAttributes()->isSpeedAware())
+		return false;
+
+	// Particles sample their source and control columns at any frame
+	if (dynamic_cast<TZeraryFx *>(fx)) {
+		for (int p = 0; p < fx->getInputPortCount(); ++p)
+			if (fx->getInputPort(p)->isConnected())
+				return false;
+	}
+
+	// Plugins may request any frame of their inputs
+	string pluginId = fx->getPluginId();
+	return pluginId.empty() || pluginId == "STD" || pluginId == "Base" || pluginId == "Toonz_";
+}
+
+//-----------------------------------------------------------------------------
+
+//! Returns whether all the fxs of the specified xsheet (sub-xsheets excluded) are
+//! time-local.
+bool hasTimeLocalFxs(const TXsheet *xsh)
+{
+	TFxSet *internalFxs = xsh->getFxDag()->getInternalFxs();
+	for (int i = 0; i < internalFxs->getFxCount(); ++i)
+		if (!isTimeLocal(internalFxs->getFx(i)))
+			return false;
+
+	// Zerary fxs are owned by their columns
+	for (int c = 0; c < xsh->getColumnCount(); ++c) {
+		TXshColumn *column = xsh->getColumn(c);
+		TXshZeraryFxColumn *zColumn = column ? column->getZeraryFxColumn() : 0;
+		if (zColumn && !isTimeLocal(zColumn->getZeraryColumnFx()->getZeraryFx()))
+			return false;
+	}
+
+	return true;
+}
+
 } // namespace
 
 //=============================================================================
@@ -533,6 +588,66 @@ void TXsheet::getUsedLevels(set<TXshLevel *> &levels) const
 
 //-----------------------------------------------------------------------------
 
+void TXsheet::getUsedLevels(set<TXshLevel *> &levels, int r0, int r1) const
+{
+	set<pair<const TXsheet *, int>> visitedRows;
+	vector<pair<const TXsheet *, int>> todoRows;
+
+	// Xsheets with fxs which read other rows than the rendered ones are taken
+	// as a whole
+	map<const TXsheet *, bool> timeLocalXshs;
+
+	for (int r = r0; r <= r1; ++r)
+		todoRows.push_back(make_pair(this, r));
+
+	while (!todoRows.empty()) {
+		pair<const TXsheet *, int> xshRow = todoRows.back();
+		todoRows.pop_back();
+
+		if (xshRow.second < 0 || !visitedRows.insert(xshRow).second)
+			continue;
+
+		const TXsheet *xsh = xshRow.first;
+		int r = xshRow.second;
+
+		map<const TXsheet *, bool>::iterator lt = timeLocalXshs.find(xsh);
+		if (lt == timeLocalXshs.end()) {
+			lt = timeLocalXshs.insert(make_pair(xsh, hasTimeLocalFxs(xsh))).first;
+			if (!lt->second)
+				xsh->getUsedLevels(levels);
+		}
+
+		if (!lt->second)
+			continue;
+
+		int c0 = 0, c1 = xsh->getColumnCount() - 1;
+		for (int c = c0; c <= c1; ++c) {
+			TXshColumnP column = const_cast<TXsheet *>(xsh)->getColumn(c);
+			if (!column)
+				continue;
+
+			TXshCellColumn *cellColumn = column->getCellColumn();
+			if (!cellColumn)
+				continue;
+
+			TXshCell cell = cellColumn->getCell(r);
+			if (cell.isEmpty() || !cell.m_level)
+				continue;
+
+			TXshLevel *level = cell.m_level.getPointer();
+			levels.insert(level);
+
+			// A sub-xsheet cell exposes the child row given by its frame number -
+			// the same time shuffle applied when the sub-xsheet is rendered
+			if (level->getChildLevel())
+				todoRows.push_back(make_pair(level->getChildLevel()->getXsheet(),
+											 cell.m_frameId.getNumber() - 1));
+		}
+	}
+}
+
+//-----------------------------------------------------------------------------
+
 bool TXsheet::isLevelUsed(TXshLevel *level) const
 {
 	set<TXshLevel *> levels;
@@ -24,8 +24,13 @@
 // Boost includes
 #include "boost/noncopyable.hpp"
 
+// STD includes
+#include <map>
+
 // Qt includes
 #include <QString>
+#include <QMutex>
+#include <QMutexLocker>
 
 #include "toonz/txsheetexpr.h"
 
@@ -58,6 +63,25 @@ public:
 	bool found() const { return m_found; }
 };
 
+//-------------------------------------------------------------------
+
+//! Finds whether an expression reads xsheet cells - whose changes are not
+//! notified to the parameters.
+class CellDependencyFinder : public TSyntax::CalculatorNodeVisitor
+{
+	bool m_found;
+
+public:
+	CellDependencyFinder() : m_found(false) {}
+
+	void check() { m_found = true; }
+	bool found() const { return m_found; }
+};
+
+//-------------------------------------------------------------------
+
+const int MaxMemoizedValues = 1024; //!< Per parameter reference
+
 //===================================================================
 //
 // Calculator Nodes
@@ -69,11 +93,22 @@ class ParamCalculatorNode : public CalculatorNode, public TParamObserver, public
 	TDoubleParamP m_param;
 	std::auto_ptr<CalculatorNode> m_frame;
 
+	// The referenced parameter's values are memoized by frame. Changes to the parameter,
+	// and to those it references in turn, are notified to onChange(), clearing them.
+	// Values read from xsheet cells are never memoized, and values converted through the
+	// current units are kept until the units change.
+
+	mutable std::map<double, double> m_values; //!< Memoized m_param values, by frame
+	mutable int m_valuesRevision;			   //!< Incremented whenever m_values is cleared
+	mutable int m_unitsRevision;			   //!< Units revision m_values were computed with
+	mutable int m_readsCells;				   //!< Whether m_param reads xsheet cells (-1 if unknown)
+	mutable QMutex m_mutex;					   //!< Guards the memoized values
+
 public:
 	ParamCalculatorNode(Calculator *calculator,
 						const TDoubleParamP &param,
 						std::auto_ptr<CalculatorNode> frame)
-		: CalculatorNode(calculator), m_param(param), m_frame(frame)
+		: CalculatorNode(calculator), m_param(param), m_frame(frame), m_valuesRevision(0), m_unitsRevision(TMeasure::getCurrentUnitsRevision()), m_readsCells(-1)
 	{
 		param->addObserver(this);
 	}
@@ -83,9 +118,52 @@ public:
 		m_param->removeObserver(this);
 	}
 
+	double getParamValue(double frame) const
+	{
+		QMutexLocker locker(&m_mutex);
+
+		int unitsRevision = TMeasure::getCurrentUnitsRevision();
+		if (unitsRevision != m_unitsRevision) {
+			m_values.clear();
+			++m_valuesRevision;
+			m_unitsRevision = unitsRevision;
+		}
+
+		if (m_readsCells < 0) {
+			CellDependencyFinder cdf;
+			m_param->accept(cdf);
+			m_readsCells = cdf.found();
+		}
+
+		if (m_readsCells) {
+			locker.unlock();
+			return m_param->getValue(frame);
+		}
+
+		std::map<double, double>::const_iterator vt = m_values.find(frame);
+		if (vt != m_values.end())
+			return vt->second;
+
+		int revision = m_valuesRevision;
+
+		// The referenced parameter may in turn reference other parameters
+		locker.unlock();
+		double value = m_param->getValue(frame);
+		locker.relock();
+
+		// Don't store values computed before a change notification
+		if (revision == m_valuesRevision) {
+			if ((int)m_values.size() >= MaxMemoizedValues)
+				m_values.clear();
+			m_values[frame] = value;
+		}
+
+		return value;
+	}
+
 	double compute(double vars[3]) const
 	{
-		double value = m_param->getValue(m_frame->compute(vars) - 1);
+		double value = getParamValue(m_frame->compute(vars) - 1);
 		TMeasure *measure = m_param->getMeasure();
 		if (measure) {
 			const TUnit *unit = measure->getCurrentUnit();
@@ -97,8 +175,10 @@ public:
 
 	void accept(TSyntax::CalculatorNodeVisitor &visitor)
 	{
-		ParamDependencyFinder *pdf = dynamic_cast<ParamDependencyFinder *>(&visitor);
-		pdf->check(m_param.getPointer());
+		if (ParamDependencyFinder *pdf = dynamic_cast<ParamDependencyFinder *>(&visitor))
+			pdf->check(m_param.getPointer());
+
+		m_frame->accept(visitor);
 		m_param->accept(visitor);
 	}
 
@@ -110,6 +190,13 @@ public:
 		// A param change is thus propagated for this parameter, with the 'keyframe'
 		// parameter turned off - since no keyframe value is actually altered.
 
+		{
+			QMutexLocker locker(&m_mutex);
+			m_values.clear();
+			++m_valuesRevision;
+			m_readsCells = -1; // Keyframes may have been turned into cell references
+		}
+
 		if (TDoubleParam *ownerParam = getCalculator()->getOwnerParameter()) {
 			const std::set<TParamObserver *> &observers = ownerParam->observers();
 
@@ -154,7 +241,13 @@ public:
 		return d;
 	}
 
-	void accept(TSyntax::CalculatorNodeVisitor &) {}
+	void accept(TSyntax::CalculatorNodeVisitor &visitor)
+	{
+		if (CellDependencyFinder *cdf = dynamic_cast<CellDependencyFinder *>(&visitor))
+			cdf->check();
+
+		m_frame->accept(visitor);
+	}
 };
 
 //===================================================================
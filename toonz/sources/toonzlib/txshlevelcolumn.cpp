@@ -106,8 +106,9 @@ TXshColumn *TXshLevelColumn::clone() const
 	TXshLevelColumn *column = new TXshLevelColumn;
 	column->setStatusWord(getStatusWord());
 	column->setOpacity(getOpacity());
-	column->m_cells = m_cells;
+	column->m_runs = m_runs;
 	column->m_first = m_first;
+	column->m_end = m_end;
 
 	//column->updateIcon();
 	return column;
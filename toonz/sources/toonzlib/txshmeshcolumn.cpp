@@ -63,8 +63,9 @@ TXshColumn *TXshMeshColumn::clone() const
 	TXshMeshColumn *column = new TXshMeshColumn();
 
 	column->setStatusWord(getStatusWord());
-	column->m_cells = m_cells;
+	column->m_runs = m_runs;
 	column->m_first = m_first;
+	column->m_end = m_end;
 
 	return column;
 }
@@ -28,8 +28,9 @@ TXshColumn *TXshPaletteColumn::clone() const
 {
 	TXshPaletteColumn *column = new TXshPaletteColumn();
 	column->setStatusWord(getStatusWord());
-	column->m_cells = m_cells;
+	column->m_runs = m_runs;
 	column->m_first = m_first;
+	column->m_end = m_end;
 
 	//column->updateIcon();
 	return column;
@@ -16,6 +16,7 @@
 #include "toonz/stage.h"
 #include "toonz/textureutils.h"
 #include "toonz/levelset.h"
+#include "toonz/levelproxies.h"
 
 // TnzBase includes
 #include "tenv.h"
@@ -1226,6 +1227,9 @@ void TXshSimpleLevel::load()
 			}
 
 		setContentHistory(lr->getContentHistory() ? lr->getContentHistory()->clone() : 0);
+
+		if (Preferences::instance()->isLevelProxiesEnabled())
+			LevelProxies::instance()->build(this);
 	}
 	getProperties()->setCreator(creator.toStdString());
 
@@ -1429,6 +1433,9 @@ void TXshSimpleLevel::save()
 		}
 	}
 	save(path);
+
+	if (Preferences::instance()->isLevelProxiesEnabled())
+		LevelProxies::instance()->build(this);
 }
 
 //-----------------------------------------------------------------------------
@@ -1459,6 +1466,9 @@ void TXshSimpleLevel::save(const TFilePath &fp, const TFilePath &oldFp, bool ove
 		TSystem::doesExistFileOrLevel(dDstPath))
 		saveBackup(dDstPath);
 
+	// Proxies of the overwritten level get outdated
+	LevelProxies::instance()->invalidate(dDstPath);
+
 	if (isAreadOnlyLevel(dDstPath)) {
 		if (m_editableRange.empty() && !m_temporaryHookMerged) //file interaly locked
 			throw TSystemException(dDstPath, "The level cannot be saved: it is a read only level.");
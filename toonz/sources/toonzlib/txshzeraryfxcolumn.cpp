@@ -34,10 +34,13 @@ TXshZeraryFxColumn::TXshZeraryFxColumn(const TXshZeraryFxColumn &src)
 	m_zeraryFxLevel->addRef();
 	m_zeraryFxLevel->setColumn(this);
 	m_first = src.m_first;
+	m_end = src.m_end;
 	int i;
-	for (i = 0; i < (int)src.m_cells.size(); i++)
-		m_cells.push_back(TXshCell(m_zeraryFxLevel, src.m_cells[i].getFrameId()));
-	assert((int)src.m_cells.size() == (int)m_cells.size());
+	for (i = 0; i < (int)src.m_runs.size(); i++) {
+		const CellRun &run = src.m_runs[i];
+		m_runs.push_back(CellRun(run.m_cell.isEmpty() ? TXshCell() : TXshCell(m_zeraryFxLevel, run.m_cell.getFrameId()), run.m_row));
+	}
+	assert((int)src.m_runs.size() == (int)m_runs.size());
 	TFx *fx = src.getZeraryColumnFx()->getZeraryFx();
 	if (fx) {
 		wstring fxName = fx->getName();
@@ -487,12 +487,17 @@ QPainterPath FunctionPanel::getSegmentPainterPath(TDoubleParam *curve, int segme
 		path.lineTo(getWinPos(curve, frame1, vValue));
 		path.lineTo(getWinPos(curve, frame1, curve->getValue(frame1, true)));
 	} else {
-		// step = 1
-		path.moveTo(getWinPos(curve, frame));
-		while (frame + df < frame1) {
-			frame += df;
-			path.lineTo(getWinPos(curve, frame));
-		}
+		// step = 1: the segment is sampled in a single pass
+		int count = 1;
+		while (frame + count * df < frame1)
+			++count;
+
+		std::vector<double> values(count);
+		curve->getValues(frame, df, count, &values[0]);
+
+		path.moveTo(getWinPos(curve, frame, values[0]));
+		for (int i = 1; i < count; ++i)
+			path.lineTo(getWinPos(curve, frame + i * df, values[i]));
 		path.lineTo(getWinPos(curve, frame1, curve->getValue(frame1, true)));
 	}
 	return path;
@@ -0,0 +1,443 @@
+
+
+#include "legacyistream.h"
+
+// TnzCore includes
+#include "tfilepath_io.h"
+#include "tconvert.h"
+#include "texception.h"
+
+// STD includes
+#include <cctype>
+
+using namespace std;
+
+//****************************************************************************
+//    LegacyIStream implementation
+//****************************************************************************
+
+LegacyIStream::LegacyIStream(const TFilePath &fp)
+	: m_is(new Tifstream(fp)), m_line(0)
+{
+	if (m_is->peek() == 'T')
+		throw TException("Compressed documents are not supported");
+}
+
+//---------------------------------------------------------------
+
+LegacyIStream::~LegacyIStream()
+{
+	delete m_is;
+}
+
+//---------------------------------------------------------------
+
+int LegacyIStream::getNextChar()
+{
+	char c;
+	m_is->get(c);
+	if (m_is->eof())
+		return -1;
+	if (c == '\r')
+		m_line++;
+	return c;
+}
+
+//---------------------------------------------------------------
+
+void LegacyIStream::skipBlanks()
+{
+	istream &is = *m_is;
+	istream::int_type c;
+	while (c = is.peek(), (isspace(c) || c == '\r'))
+		getNextChar();
+}
+
+//---------------------------------------------------------------
+
+bool LegacyIStream::match(char c)
+{
+	if (m_is->peek() == c) {
+		getNextChar();
+		return true;
+	} else
+		return false;
+}
+
+//---------------------------------------------------------------
+
+bool LegacyIStream::matchIdent(string &ident)
+{
+	istream &is = *m_is;
+	if (!isalnum(is.peek()))
+		return false;
+	ident = "";
+	char c;
+	is.get(c);
+	ident.append(1, c);
+	while (c = is.peek(), isalnum(c) || c == '_' || c == '.' || c == '-') {
+		is.get(c);
+		ident.append(1, c);
+	}
+	return true;
+}
+
+//---------------------------------------------------------------
+
+bool LegacyIStream::matchValue(string &str)
+{
+	istream &is = *m_is;
+	char quote = is.peek();
+	char c;
+	if (!is || (quote != '\'' && quote != '\"'))
+		return false;
+	is.get(c);
+	str = "";
+	for (;;) {
+		is.get(c);
+		if (!is)
+			throw TException("expected '\"'");
+		if (c == quote)
+			break;
+		if (c == '\\') {
+			is.get(c);
+			if (!is)
+				throw TException("unexpected EOF");
+			if (c != '\'' && c != '\"' && c != '\\')
+				throw TException("bad escape sequence");
+		}
+		str.append(1, c);
+	}
+	if (c != quote)
+		throw TException("missing '\"'");
+	return true;
+}
+
+//---------------------------------------------------------------
+
+bool LegacyIStream::matchCurrentTag()
+{
+	if (m_currentTag)
+		return true;
+	Tag &tag = m_currentTag;
+	tag = Tag();
+	skipBlanks();
+	if (!match('<'))
+		return false;
+	skipBlanks();
+	if (match('!')) {
+		skipBlanks();
+		if (!match('-') || !match('-'))
+			throw TException("expected '<!--' tag");
+		istream &is = *m_is;
+		char c;
+		int status = 1;
+		while (status != 0 && is.get(c))
+			switch (status) {
+			case 1:
+				if (c == '-')
+					status = 2;
+				break;
+			case 2:
+				if (c == '-')
+					status = 3;
+				else
+					status = 1;
+				break;
+			case 3:
+				if (c == '>')
+					status = 0;
+				else if (c == '-') {
+				} else
+					status = 1;
+				break;
+			}
+		return matchCurrentTag();
+	}
+	if (match('/')) {
+		tag.m_type = Tag::EndTag;
+		skipBlanks();
+	}
+
+	if (!matchIdent(tag.m_name))
+		throw TException("expected identifier");
+	skipBlanks();
+	for (;;) {
+		if (match('>'))
+			break;
+		if (match('/')) {
+			tag.m_type = Tag::BeginEndTag;
+			skipBlanks();
+			if (match('>'))
+				break;
+			throw TException("expected '>'");
+		}
+		string name;
+		if (!matchIdent(name))
+			throw TException("expected identifier");
+		skipBlanks();
+		if (match('=')) {
+			string value;
+			skipBlanks();
+			if (!matchValue(value))
+				throw TException("expected value");
+			tag.m_attributes[name] = value;
+			skipBlanks();
+		}
+	}
+	return true;
+}
+
+//---------------------------------------------------------------
+
+void LegacyIStream::skipCurrentTag()
+{
+	if (m_currentTag.m_type == Tag::BeginEndTag)
+		return;
+	istream &is = *m_is;
+	int level = 1;
+	int c;
+	for (;;) {
+		if (is.eof())
+			break; //unexpected eof
+		c = is.peek();
+		if (c != '<') {
+			getNextChar();
+			continue;
+		}
+
+		// tag found
+		c = getNextChar();
+		if (c < 0)
+			break;
+
+		c = getNextChar();
+		if (c < 0)
+			break;
+
+		if (c == '/') {
+			// end tag
+			do
+				c = getNextChar();
+			while (c >= 0 && c != '>');
+			if (c < 0)
+				break; //unexpected eof
+			if (--level <= 0) {
+				m_tagStack.pop_back();
+				m_currentTag = Tag();
+				break;
+			}
+		} else {
+			// tag
+			int oldC;
+			do {
+				oldC = c;
+				c = getNextChar();
+			} while (c >= 0 && c != '>');
+			if (c < 0)
+				break; //unexpected eof
+			if (oldC != '/')
+				level++;
+		}
+	}
+}
+
+//---------------------------------------------------------------
+
+LegacyIStream::operator bool() const
+{
+	return (m_is && *m_is);
+}
+
+//---------------------------------------------------------------
+
+LegacyIStream &LegacyIStream::operator>>(int &v)
+{
+	*m_is >> v;
+	return *this;
+}
+
+//---------------------------------------------------------------
+
+LegacyIStream &LegacyIStream::operator>>(double &v)
+{
+	*m_is >> v;
+	return *this;
+}
+
+//---------------------------------------------------------------
+
+LegacyIStream &LegacyIStream::operator>>(wstring &v)
+{
+	string s;
+	operator>>(s);
+	v = toWideString(s);
+	return *this;
+}
+
+//---------------------------------------------------------------
+
+LegacyIStream &LegacyIStream::operator>>(string &v)
+{
+	istream &is = *m_is;
+	v = "";
+	skipBlanks();
+	char c;
+	is.get(c);
+	if (c == '\"') {
+		is.get(c);
+		while (is && c != '"') {
+			if (c == '\\') {
+				is.get(c);
+				if (!is)
+					throw TException("unexpected EOF");
+				if (c == '"')
+					v.append(1, '"');
+				else if (c == '\\')
+					v.append(1, '\\');
+				else if (c == '\'')
+					v.append(1, '\'');
+				else {
+					v.append(1, '\\');
+					v.append(1, c);
+				}
+			} else
+				v.append(1, c);
+			is.get(c);
+		}
+	} else {
+		v.append(1, c);
+		while (c = is.peek(), isalnum(c) || c == '_' || c == '&' || c == '#' || c == ';' || c == '%') {
+			is.get(c);
+			v.append(1, c);
+		}
+	}
+
+	return *this;
+}
+
+//---------------------------------------------------------------
+
+string LegacyIStream::getString()
+{
+	istream &is = *m_is;
+	string v = "";
+	skipBlanks();
+	char c = is.peek();
+	while (c != '<') {
+		is.get(c);
+		c = is.peek();
+		if (!is)
+			throw TException("unexpected EOF");
+		v.append(1, c);
+	}
+	return v;
+}
+
+//---------------------------------------------------------------
+
+LegacyIStream &LegacyIStream::operator>>(TPixel32 &v)
+{
+	istream &is = *m_is;
+	int r, g, b, m;
+	is >> r;
+	is >> g;
+	is >> b;
+	is >> m;
+	v.r = r;
+	v.g = g;
+	v.b = b;
+	v.m = m;
+	return *this;
+}
+
+//---------------------------------------------------------------
+
+LegacyIStream &LegacyIStream::operator>>(TFilePath &v)
+{
+	istream &is = *m_is;
+	string s;
+	char c;
+	skipBlanks();
+	is.get(c);
+	if (c == '"') {
+		is.get(c);
+		while (is && c != '"') {
+			s.append(1, c);
+			is.get(c);
+		}
+	} else {
+		s.append(1, c);
+		while (is) {
+			c = is.peek();
+			if (!isalnum(c) && c != '%' && c != '_')
+				break;
+			is.get(c);
+			s.append(1, c);
+		}
+	}
+
+	v = TFilePath(s);
+	return *this;
+}
+
+//---------------------------------------------------------------
+
+bool LegacyIStream::matchEndTag()
+{
+	if (m_tagStack.empty())
+		throw TException("tag stack emtpy");
+	if (!matchCurrentTag())
+		return false;
+	if (m_currentTag.m_type != Tag::EndTag)
+		return false;
+	if (m_currentTag.m_name != m_tagStack.back())
+		throw TException("end tag mismatch");
+	m_tagStack.pop_back();
+	m_currentTag = Tag();
+	return true;
+}
+
+//---------------------------------------------------------------
+
+bool LegacyIStream::eos()
+{
+	if (matchCurrentTag())
+		return m_currentTag.m_type == Tag::EndTag;
+	else
+		return !(*m_is);
+}
+
+//---------------------------------------------------------------
+
+bool LegacyIStream::matchTag(string &tagName)
+{
+	if (!matchCurrentTag())
+		return false;
+	if (m_currentTag.m_type == Tag::EndTag)
+		return false;
+	tagName = m_currentTag.m_name;
+	m_currentTag.m_name = "";
+	if (m_currentTag.m_type != Tag::BeginEndTag)
+		m_tagStack.push_back(tagName);
+	return true;
+}
+
+//---------------------------------------------------------------
+
+string LegacyIStream::getTagAttribute(string name) const
+{
+	const Tag &tag = m_currentTag;
+	std::map<string, string>::const_iterator it = tag.m_attributes.find(name);
+	if (it == tag.m_attributes.end())
+		return "";
+	else
+		return it->second;
+}
+
+//---------------------------------------------------------------
+
+bool LegacyIStream::isBeginEndTag()
+{
+	return m_currentTag.m_type == Tag::BeginEndTag;
+}
@@ -0,0 +1,83 @@
+
+
+#ifndef LEGACYISTREAM_H
+#define LEGACYISTREAM_H
+
+// TnzCore includes
+#include "tfilepath.h"
+#include "tpixel.h"
+
+// STD includes
+#include <istream>
+#include <string>
+#include <vector>
+#include <map>
+
+//! The TIStream parser as it was before documents were tokenized from memory.
+/*!
+  Characters are read one at a time through a std::istream. Only uncompressed
+  documents are supported, and persistent objects are not created - the class
+  exists to compare the values TIStream reads against the ones read by the
+  original implementation, and to time them both.
+*/
+class LegacyIStream
+{
+	struct Tag {
+		enum Type { BeginTag,
+					EndTag,
+					BeginEndTag };
+
+		std::string m_name;
+		std::map<std::string, std::string> m_attributes;
+		Type m_type;
+
+		Tag() : m_type(BeginTag) {}
+		operator bool() const { return m_name != ""; }
+	};
+
+	std::istream *m_is;
+	int m_line;
+
+	std::vector<std::string> m_tagStack;
+	Tag m_currentTag;
+
+public:
+	LegacyIStream(const TFilePath &fp);
+	~LegacyIStream();
+
+	operator bool() const;
+
+	LegacyIStream &operator>>(int &v);
+	LegacyIStream &operator>>(double &v);
+	LegacyIStream &operator>>(std::string &v);
+	LegacyIStream &operator>>(std::wstring &v);
+	LegacyIStream &operator>>(TFilePath &v);
+	LegacyIStream &operator>>(TPixel32 &v);
+
+	std::string getString();
+	bool eos();
+
+	bool matchTag(std::string &tagName);
+	bool matchEndTag();
+
+	std::string getTagAttribute(std::string name) const;
+	bool isBeginEndTag();
+
+	void skipCurrentTag();
+
+	int getLine() const { return m_line + 1; }
+
+private:
+	int getNextChar();
+	void skipBlanks();
+	bool match(char c);
+	bool matchIdent(std::string &ident);
+	bool matchValue(std::string &value);
+	bool matchCurrentTag();
+
+	// Not copyable
+	LegacyIStream(const LegacyIStream &);
+	LegacyIStream &operator=(const LegacyIStream &);
+};
+
+#endif // LEGACYISTREAM_H
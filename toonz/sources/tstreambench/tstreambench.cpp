@@ -0,0 +1,577 @@
+
+
+// TnzCore includes
+#include "tstream.h"
+#include "tfilepath_io.h"
+#include "tsystem.h"
+#include "tconvert.h"
+#include "texception.h"
+
+// Qt includes
+#include <QCoreApplication>
+#include <QStringList>
+#include <QElapsedTimer>
+
+// STD includes
+#include <iostream>
+#include <vector>
+#include <map>
+#include <cstring>
+
+#include "legacyistream.h"
+
+//! tstreambench times TIStream and checks it against the original parser.
+/*!
+  The program writes a large synthetic scene through TOStream - levels, xsheet
+  columns full of cells, animated pegbars, a palette and the scene history -
+  along with a small hand-written document collecting the syntax TOStream never
+  produces (comments, single quotes, CR-LF line ends, unusual number formats).
+
+  Both documents are read with TIStream and with LegacyIStream, the std::istream
+  based parser TIStream replaced, by the same walk: tags, attributes, values of
+  the types each tag holds, line numbers. The two token sequences must match
+  exactly - doubles bit for bit. The scene is also written compressed, and
+  TIStream must read the same tokens from it.
+
+  The scene is then parsed -repeat times by both parsers, reporting their
+  throughput. Its size is set by -columns and -rows; -keep leaves the documents
+  in the temporary folder. The exit code is 0 when all checks succeed.
+*/
+
+//******************************************************************************
+//    Local namespace
+//******************************************************************************
+
+namespace
+{
+
+bool l_failed = false;
+
+//------------------------------------------------------------------
+
+void check(bool condition, const std::string &what)
+{
+	if (condition)
+		return;
+
+	std::cout << "*error* " << what << std::endl;
+	l_failed = true;
+}
+
+//------------------------------------------------------------------
+
+int intArg(const QStringList &args, const QString &name, int defaultValue)
+{
+	int i = args.indexOf(name);
+	return (i >= 0 && i + 1 < args.size()) ? args[i + 1].toInt() : defaultValue;
+}
+
+//==================================================================
+
+//! Returns the values held by the specified tag, as a pattern repeated until
+//! its end tag: (i)nt, (d)ouble, (s)tring, (w)string, file (p)ath, (c)olor.
+//! Tags without a pattern hold other tags; (t)ext is read with getString(),
+//! and skipped tags (x) with skipCurrentTag().
+std::string valuesPattern(const std::string &tagName)
+{
+	static std::map<std::string, std::string> patterns;
+	if (patterns.empty()) {
+		patterns["generator"] = "s";
+		patterns["camera"] = "ddii";
+		patterns["dpi"] = "dd";
+		patterns["name"] = "w";
+		patterns["path"] = "p";
+		patterns["cell"] = "iissi";
+		patterns["k"] = "dds";
+		patterns["color"] = "c";
+		patterns["history"] = "t";
+		patterns["notes"] = "x";
+
+		patterns["ints"] = "i";
+		patterns["reals"] = "d";
+		patterns["words"] = "s";
+		patterns["files"] = "p";
+		patterns["colors"] = "c";
+	}
+
+	std::map<std::string, std::string>::const_iterator pt = patterns.find(tagName);
+	return (pt == patterns.end()) ? std::string() : pt->second;
+}
+
+//------------------------------------------------------------------
+
+const char *const c_attributes[] = {"id", "name", "type", "version", "framecount", "f", "dpix"};
+
+//==================================================================
+
+//! Records the tokens read by a walk, as strings.
+struct TokenRecorder {
+	std::vector<std::string> m_tokens;
+
+	void add(const std::string &token) { m_tokens.push_back(token); }
+
+	void beginTag(const std::string &name, int line) { add("<" + name + " @" + ::toString(line)); }
+	void attribute(const std::string &name, const std::string &value) { add(name + "=" + value); }
+	void endTag() { add(">"); }
+
+	void value(int v) { add("i " + ::toString(v)); }
+	void value(double v)
+	{
+		// Bit for bit
+		unsigned char bytes[sizeof(double)];
+		memcpy(bytes, &v, sizeof(double));
+
+		std::string token("d ");
+		for (int b = 0; b < (int)sizeof(double); ++b)
+			token += ::toString((int)bytes[b]) + ".";
+
+		add(token + " (" + ::toString(v) + ")");
+	}
+	void value(const std::string &v) { add("s " + v); }
+	void value(const std::wstring &v) { add("w " + ::toString(v)); }
+	void value(const TFilePath &v) { add("p " + ::toString(v.getWideString())); }
+	void value(const TPixel32 &v)
+	{
+		add("c " + ::toString(v.r) + " " + ::toString(v.g) + " " + ::toString(v.b) + " " + ::toString(v.m));
+	}
+	void text(const std::string &v) { add("t " + v); }
+	void skipped() { add("x"); }
+};
+
+//------------------------------------------------------------------
+
+//! Consumes the tokens read by a walk, as cheaply as possible - for timing.
+struct TokenCounter {
+	int m_count;
+	double m_sum;
+
+	TokenCounter() : m_count(0), m_sum(0) {}
+
+	void beginTag(const std::string &name, int line) { ++m_count; }
+	void attribute(const std::string &name, const std::string &value) { ++m_count; }
+	void endTag() {}
+
+	void value(int v) { ++m_count, m_sum += v; }
+	void value(double v) { ++m_count, m_sum += v; }
+	void value(const std::string &v) { ++m_count, m_sum += v.size(); }
+	void value(const std::wstring &v) { ++m_count, m_sum += v.size(); }
+	void value(const TFilePath &v) { ++m_count; }
+	void value(const TPixel32 &v) { ++m_count, m_sum += v.m; }
+	void text(const std::string &v) { ++m_count, m_sum += v.size(); }
+	void skipped() { ++m_count; }
+};
+
+//==================================================================
+
+template <typename Value, typename Stream, typename Sink>
+void readValue(Stream &is, Sink &sink)
+{
+	Value v;
+	is >> v;
+	sink.value(v);
+}
+
+//------------------------------------------------------------------
+
+template <typename Stream, typename Sink>
+void readChildren(Stream &is, Sink &sink);
+
+//! Reads the content of the specified tag, up to its end tag (included).
+template <typename Stream, typename Sink>
+void readContent(Stream &is, const std::string &tagName, Sink &sink)
+{
+	const std::string &pattern = valuesPattern(tagName);
+
+	if (pattern.empty())
+		readChildren(is, sink);
+	else if (pattern == "t")
+		sink.text(is.getString());
+	else if (pattern == "x") {
+		is.skipCurrentTag();
+		sink.skipped();
+		return;
+	} else {
+		for (int v = 0; !is.eos(); v = (v + 1) % pattern.size())
+			switch (pattern[v]) {
+			case 'i':
+				readValue<int>(is, sink);
+				break;
+			case 'd':
+				readValue<double>(is, sink);
+				break;
+			case 's':
+				readValue<std::string>(is, sink);
+				break;
+			case 'w':
+				readValue<std::wstring>(is, sink);
+				break;
+			case 'p':
+				readValue<TFilePath>(is, sink);
+				break;
+			case 'c':
+				readValue<TPixel32>(is, sink);
+				break;
+			}
+	}
+
+	if (!is.matchEndTag())
+		throw TException("expected </" + tagName + ">");
+}
+
+//------------------------------------------------------------------
+
+template <typename Stream, typename Sink>
+void readChildren(Stream &is, Sink &sink)
+{
+	std::string tagName;
+	while (is.matchTag(tagName)) {
+		sink.beginTag(tagName, is.getLine());
+
+		for (int a = 0; a < (int)(sizeof c_attributes / sizeof c_attributes[0]); ++a) {
+			std::string value = is.getTagAttribute(c_attributes[a]);
+			if (!value.empty())
+				sink.attribute(c_attributes[a], value);
+		}
+
+		if (!is.isBeginEndTag())
+			readContent(is, tagName, sink);
+
+		sink.endTag();
+	}
+}
+
+//------------------------------------------------------------------
+
+//! Reads the whole document with the specified parser.
+template <typename Stream, typename Sink>
+void readDocument(const TFilePath &fp, Sink &sink)
+{
+	Stream is(fp);
+	if (!is)
+		throw TException("can't open " + ::toString(fp.getWideString()));
+
+	readChildren(is, sink);
+}
+
+//------------------------------------------------------------------
+
+//! Reads the document with both parsers, and compares the tokens.
+bool compareParsers(const TFilePath &fp)
+{
+	TokenRecorder legacy, current;
+
+	try {
+		readDocument<LegacyIStream>(fp, legacy);
+	} catch (TException &e) {
+		legacy.add("exception: " + ::toString(e.getMessage()));
+	}
+
+	try {
+		readDocument<TIStream>(fp, current);
+	} catch (TException &e) {
+		current.add("exception: " + ::toString(e.getMessage()));
+	}
+
+	size_t t, count = std::min(legacy.m_tokens.size(), current.m_tokens.size());
+	for (t = 0; t < count && legacy.m_tokens[t] == current.m_tokens[t]; ++t)
+		;
+
+	if (t < count || legacy.m_tokens.size() != current.m_tokens.size()) {
+		check(false, ::toString(fp.getWideString()) + ": token " + ::toString((int)t) + " differs");
+		std::cout << "  istream:  " << (t < legacy.m_tokens.size() ? legacy.m_tokens[t] : "<end>") << std::endl;
+		std::cout << "  TIStream: " << (t < current.m_tokens.size() ? current.m_tokens[t] : "<end>") << std::endl;
+		return false;
+	}
+
+	// Failing the same way isn't a success
+	if (!legacy.m_tokens.empty() && legacy.m_tokens.back().compare(0, 11, "exception: ") == 0) {
+		check(false, ::toString(fp.getWideString()) + ": both parsers stopped with " + legacy.m_tokens.back());
+		return false;
+	}
+
+	std::cout << "  " << count << " tokens match" << std::endl;
+	return true;
+}
+
+//------------------------------------------------------------------
+
+//! Checks that TIStream reads the same tokens from both documents.
+void compareDocuments(const TFilePath &fp, const TFilePath &compressedFp)
+{
+	TokenRecorder plain, compressed;
+
+	try {
+		readDocument<TIStream>(fp, plain);
+		readDocument<TIStream>(compressedFp, compressed);
+	} catch (TException &e) {
+		check(false, "reading the compressed scene: " + ::toString(e.getMessage()));
+		return;
+	}
+
+	check(plain.m_tokens == compressed.m_tokens, "the compressed scene reads differently");
+}
+
+//------------------------------------------------------------------
+
+//! Returns the average time, in milliseconds, the parser takes to read the document.
+template <typename Stream>
+double timeParser(const TFilePath &fp, int repeat)
+{
+	QElapsedTimer timer;
+	timer.start();
+
+	TokenCounter counter;
+	for (int r = 0; r < repeat; ++r)
+		readDocument<Stream>(fp, counter);
+
+	return double(timer.elapsed()) / repeat;
+}
+
+//==================================================================
+
+//! Deterministic pseudo-random numbers, so that documents are reproducible.
+class Random
+{
+	unsigned int m_seed;
+
+public:
+	Random() : m_seed(1) {}
+
+	unsigned int next() { return (m_seed = m_seed * 1103515245 + 12345) >> 8; }
+	int next(int n) { return (int)(next() % n); }
+	double nextDouble() { return next() / double(1 << 24); }
+};
+
+//------------------------------------------------------------------
+
+std::map<std::string, std::string> attributes(const std::string &name, const std::string &value)
+{
+	std::map<std::string, std::string> attr;
+	attr[name] = value;
+	return attr;
+}
+
+//------------------------------------------------------------------
+
+void writeLevels(TOStream &os, int levelCount, Random &random)
+{
+	os.openChild("levelSet");
+	os.openChild("levels");
+
+	for (int l = 0; l < levelCount; ++l) {
+		std::map<std::string, std::string> attr;
+		attr["id"] = ::toString(l + 1);
+		attr["type"] = (l % 3) ? "pli" : "tlv";
+		os.openChild("level", attr);
+
+		// Names and paths with blanks, quotes and backslashes are written quoted
+		os.child("name") << ::toWideString("Level " + ::toString(l) + ((l % 5) ? "" : " \"A\\B\" 'c'"));
+		os.child("path") << TFilePath("+drawings/level_" + ::toString(l) + ((l % 3) ? ".pli" : ".tlv"));
+		os.child("dpi") << 0.5 + random.next(320) << 72.0 + random.next(4) / 3.0;
+		os.openCloseChild("info", attributes("dpix", ::toString(120 + l)));
+
+		os.closeChild();
+	}
+
+	os.closeChild();
+	os.closeChild();
+}
+
+//------------------------------------------------------------------
+
+void writeXsheet(TOStream &os, int columnCount, int rowCount, int levelCount, Random &random)
+{
+	os.openChild("xsheet");
+	os.openChild("columns");
+
+	for (int c = 0; c < columnCount; ++c) {
+		std::map<std::string, std::string> attr;
+		attr["id"] = ::toString(c);
+		attr["type"] = "levelColumn";
+		os.openChild("column", attr);
+
+		os.openChild("cells");
+		for (int r = 0; r < rowCount;) {
+			int count = 1 + random.next(6);
+			int fid = 1 + random.next(200);
+			std::string suffix = random.next(10) ? "" : "a";
+
+			os.child("cell") << r << count << ("L" + ::toString(random.next(levelCount) + 1))
+							 << (::toString(fid) + suffix) << random.next(3);
+			r += count;
+		}
+		os.closeChild();
+
+		if (random.next(4) == 0)
+			os.openCloseChild("empty", attributes("type", "hidden"));
+
+		os.closeChild();
+	}
+
+	os.closeChild();
+
+	os.openChild("pegbars");
+	for (int c = 0; c < columnCount; ++c) {
+		os.openChild("pegbar", attributes("id", "Col" + ::toString(c + 1)));
+		os.openChild("keyframes");
+
+		for (int k = 0, f = 0; k < 24; ++k) {
+			f += 1 + random.next(rowCount / 24 + 1);
+
+			// Integers, fractions, small and large magnitudes, negatives
+			double value;
+			switch (k % 4) {
+			case 0:
+				value = random.next(100);
+				break;
+			case 1:
+				value = random.nextDouble() * 10.0 - 5.0;
+				break;
+			case 2:
+				value = random.nextDouble() * 1e-4;
+				break;
+			default:
+				value = -random.nextDouble() * 1e7;
+				break;
+			}
+
+			os.openChild("k", attributes("f", ::toString(f)));
+			os << double(f) << value << std::string((k % 2) ? "SpeedInOut" : "Linear");
+			os.closeChild();
+		}
+
+		os.closeChild();
+		os.closeChild();
+	}
+	os.closeChild();
+
+	os.closeChild();
+}
+
+//------------------------------------------------------------------
+
+void writeScene(const TFilePath &fp, bool compressed, int columnCount, int rowCount)
+{
+	Random random;
+	int levelCount = columnCount / 2 + 1;
+
+	TOStream os(fp, compressed);
+
+	std::map<std::string, std::string> attr;
+	attr["version"] = "71.0";
+	attr["framecount"] = ::toString(rowCount);
+	os.openChild("tnz", attr);
+
+	os.child("generator") << std::string("tstreambench synthetic scene");
+
+	os.openChild("properties");
+	os.child("camera") << 16.0 << 9.0 << 1920 << 1080;
+	os.openChild("notes");
+	os << std::string("Skipped notes, containing tags");
+	os.openCloseChild("note", attributes("id", "1"));
+	os.child("text") << std::string("nested");
+	os.closeChild();
+	os.closeChild();
+
+	writeLevels(os, levelCount, random);
+	writeXsheet(os, columnCount, rowCount, levelCount, random);
+
+	os.openChild("palette");
+	os.openChild("styles");
+	for (int s = 0; s < 256; ++s)
+		os.child("color") << TPixel32(random.next(256), random.next(256), random.next(256), random.next(256));
+	os.closeChild();
+	os.closeChild();
+
+	os.openChild("history");
+	for (int h = 0; h < 50; ++h) {
+		os << std::string("saved by user" + ::toString(h) + " on host " + ::toString(h % 7) + "||");
+		os.cr();
+	}
+	os.closeChild();
+
+	os.closeChild();
+
+	if (!os.checkStatus())
+		throw TException("can't write " + ::toString(fp.getWideString()));
+}
+
+//------------------------------------------------------------------
+
+//! Writes the syntax which TOStream doesn't produce, but both parsers accept.
+void writeQuirks(const TFilePath &fp)
+{
+	Tofstream os(fp);
+
+	os << "<quirks version='1.0' name=\"a \\\"quoted\\\" \\\\ name\">\r\n"
+	   << "  <!-- a comment -- with dashes ---><ints>+5 -12 007\t2147483647 0</ints>\r\n"
+	   << "  <reals>.5 1. -0 3.25e-3 1E+2 -7.5e-05 123456789012345678901234567890 0.1 1e-300</reals>\r\n"
+	   << "  <words>plain a&b#c;d%e \"quoted \\\"x\\\" \\\\ y \\n z\"\"\"'single'</words>\r\n"
+	   << "  <files>\"C:\\dir\\file name.pli\" %ROOT%_x \"+extras/x y\"</files>\r\n"
+	   << "  <colors>255 0 128 255\r\n1 2 3 4</colors>\r\n"
+	   << "  <history>first line   with spaces\r\n second line</history>\r\n"
+	   << "  <notes><a><b x=\"1\"/>text</a><c/></notes>\r\n"
+	   << "  < empty / >\r\n"
+	   << "  <group id = \"7\"   ><ints>1</ints><empty type='x'/></group>\n"
+	   << "</quirks>\r\n";
+}
+
+} // namespace
+
+//******************************************************************************
+//    Main
+//******************************************************************************
+
+int main(int argc, char *argv[])
+{
+	QCoreApplication a(argc, argv);
+	QStringList args = a.arguments();
+
+	int columnCount = intArg(args, "-columns", 200);
+	int rowCount = intArg(args, "-rows", 2000);
+	int repeat = intArg(args, "-repeat", 5);
+
+	TFilePath dir = TSystem::getTempDir();
+	TFilePath sceneFp = dir + "tstreambench_scene.tnz";
+	TFilePath compressedFp = dir + "tstreambench_compressed.tnz";
+	TFilePath quirksFp = dir + "tstreambench_quirks.tnz";
+
+	try {
+		std::cout << "Writing a scene with " << columnCount << " columns, " << rowCount << " rows..." << std::endl;
+		writeScene(sceneFp, false, columnCount, rowCount);
+		writeScene(compressedFp, true, columnCount, rowCount);
+		writeQuirks(quirksFp);
+
+		std::cout << "Comparing the parsers on the hand-written document..." << std::endl;
+		compareParsers(quirksFp);
+
+		std::cout << "Comparing the parsers on the scene..." << std::endl;
+		if (compareParsers(sceneFp))
+			compareDocuments(sceneFp, compressedFp);
+
+		if (!l_failed) {
+			double megabytes = TFileStatus(sceneFp).getSize() / (1024.0 * 1024.0);
+			std::cout << "Parsing " << megabytes << " MB, " << repeat << " times..." << std::endl;
+
+			double legacyTime = timeParser<LegacyIStream>(sceneFp, repeat);
+			double currentTime = timeParser<TIStream>(sceneFp, repeat);
+			double compressedTime = timeParser<TIStream>(compressedFp, repeat);
+
+			std::cout << "  istream:             " << legacyTime << " ms (" << megabytes * 1000.0 / legacyTime << " MB/s)" << std::endl;
+			std::cout << "  TIStream:            " << currentTime << " ms (" << megabytes * 1000.0 / currentTime << " MB/s)" << std::endl;
+			std::cout << "  TIStream compressed: " << compressedTime << " ms" << std::endl;
+			std::cout << "  speedup: " << legacyTime / currentTime << "x" << std::endl;
+		}
+	} catch (TException &e) {
+		check(false, ::toString(e.getMessage()));
+	}
+
+	if (!args.contains("-keep")) {
+		TSystem::removeFileOrLevel(sceneFp);
+		TSystem::removeFileOrLevel(compressedFp);
+		TSystem::removeFileOrLevel(quirksFp);
+	}
+
+	std::cout << (l_failed ? "FAILED" : "OK") << std::endl;
+	return l_failed ? 1 : 0;
+}